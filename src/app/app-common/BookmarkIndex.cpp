@@ -0,0 +1,180 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/BookmarkIndex.hpp>
+
+#include <iterator>
+#include <ranges>
+
+namespace OpenKneeboard {
+
+BookmarkIndex::BookmarkIndex()
+  : mBookmarks(std::make_shared<const std::vector<Bookmark>>()) {
+}
+
+bool BookmarkIndex::SetTabs(std::span<const TabID> tabIDs) {
+  std::unique_lock lock(mMutex);
+
+  decltype(mTabs) tabs;
+  for (std::size_t order = 0; order < tabIDs.size(); ++order) {
+    const auto id = tabIDs[order];
+    auto it = mTabs.find(id);
+    auto& tab = tabs[id];
+    if (it != mTabs.end()) {
+      tab = std::move(it->second);
+    }
+    tab.mOrder = order;
+  }
+  mTabs = std::move(tabs);
+
+  // Changing the order changes every key; this is rare enough that
+  // rebuilding is fine
+  mIndex.clear();
+  for (const auto& tab: mTabs | std::views::values) {
+    this->InsertTab(tab);
+  }
+  return this->UpdateBookmarks();
+}
+
+bool BookmarkIndex::SetTabBookmarks(
+  TabID tabID,
+  std::span<const PageID> pageIDs,
+  std::span<const Bookmark> bookmarks) {
+  std::unique_lock lock(mMutex);
+
+  const auto it = mTabs.find(tabID);
+  if (it == mTabs.end()) {
+    return false;
+  }
+  auto& tab = it->second;
+
+  tab.mPageIndices.clear();
+  tab.mPageIndices.reserve(pageIDs.size());
+  for (std::size_t index = 0; index < pageIDs.size(); ++index) {
+    tab.mPageIndices.emplace(pageIDs[index], index);
+  }
+  tab.mBookmarks = {bookmarks.begin(), bookmarks.end()};
+
+  mIndex.erase(
+    mIndex.lower_bound({tab.mOrder, 0}),
+    mIndex.lower_bound({tab.mOrder + 1, 0}));
+  this->InsertTab(tab);
+  return this->UpdateBookmarks();
+}
+
+void BookmarkIndex::InsertTab(const Tab& tab) {
+  for (const auto& bookmark: tab.mBookmarks) {
+    const auto page = this->GetPageIndex(tab, bookmark.mPageID);
+    // Usually the page was just removed; the tab will clean up soon
+    if (!page) {
+      continue;
+    }
+    mIndex.insert_or_assign({tab.mOrder, *page}, bookmark);
+  }
+}
+
+bool BookmarkIndex::UpdateBookmarks() {
+  auto bookmarks = std::make_shared<const std::vector<Bookmark>>(
+    mIndex | std::views::values | std::ranges::to<std::vector>());
+
+  if (*bookmarks == *mBookmarks) {
+    return false;
+  }
+  mBookmarks = std::move(bookmarks);
+  return true;
+}
+
+BookmarkIndex::Bookmarks BookmarkIndex::GetBookmarks() const {
+  std::unique_lock lock(mMutex);
+  return mBookmarks;
+}
+
+const BookmarkIndex::Tab* BookmarkIndex::GetTab(TabID id) const {
+  const auto it = mTabs.find(id);
+  if (it == mTabs.end()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+std::optional<std::size_t> BookmarkIndex::GetPageIndex(
+  const Tab& tab,
+  PageID page) const {
+  if (!page) {
+    return std::nullopt;
+  }
+  const auto it = tab.mPageIndices.find(page);
+  if (it == tab.mPageIndices.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+std::optional<Bookmark> BookmarkIndex::GetPrevious(
+  TabID tabID,
+  std::optional<PageID> pageID) const {
+  std::unique_lock lock(mMutex);
+  const auto tab = this->GetTab(tabID);
+  if (!tab) {
+    return std::nullopt;
+  }
+
+  std::size_t page = 0;
+  if (pageID) {
+    const auto index = this->GetPageIndex(*tab, *pageID);
+    if (!index) {
+      return std::nullopt;
+    }
+    page = *index;
+  }
+
+  const auto it = mIndex.lower_bound({tab->mOrder, page});
+  if (it == mIndex.begin()) {
+    return std::nullopt;
+  }
+  return std::prev(it)->second;
+}
+
+std::optional<Bookmark> BookmarkIndex::GetNext(
+  TabID tabID,
+  std::optional<PageID> pageID) const {
+  std::unique_lock lock(mMutex);
+  const auto tab = this->GetTab(tabID);
+  if (!tab) {
+    return std::nullopt;
+  }
+
+  auto it = mIndex.end();
+  if (pageID) {
+    const auto index = this->GetPageIndex(*tab, *pageID);
+    if (!index) {
+      return std::nullopt;
+    }
+    it = mIndex.upper_bound({tab->mOrder, *index});
+  } else {
+    it = mIndex.lower_bound({tab->mOrder + 1, 0});
+  }
+
+  if (it == mIndex.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+}// namespace OpenKneeboard
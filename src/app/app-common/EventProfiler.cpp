@@ -0,0 +1,215 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/EventProfiler.hpp>
+
+#include <OpenKneeboard/dprint.hpp>
+#include <OpenKneeboard/tracing.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace OpenKneeboard::EventProfiler {
+
+namespace {
+
+using Microseconds = std::chrono::microseconds;
+using Milliseconds = std::chrono::duration<float, std::milli>;
+
+// `file_name()` pointers aren't guaranteed to be shared between translation
+// units, so compare the content
+struct Key {
+  std::string_view mFile;
+  uint_least32_t mLine {};
+  uint_least32_t mColumn {};
+
+  bool operator==(const Key&) const noexcept = default;
+};
+
+struct KeyHash {
+  std::size_t operator()(const Key& key) const noexcept {
+    return std::hash<std::string_view> {}(key.mFile)
+      ^ (static_cast<std::size_t>(key.mLine) << 8) ^ key.mColumn;
+  }
+};
+
+using Entries = std::unordered_map<Key, Entry, KeyHash>;
+
+struct Store {
+  std::mutex mMutex;
+  Entries mByReceiver;
+  Entries mByEmitter;
+  bool mEverEnabled {false};
+
+  static Store& Get() {
+    static Store sInstance;
+    return sInstance;
+  }
+};
+
+std::size_t GetBucket(Clock::duration duration) {
+  const auto us = std::chrono::duration_cast<Microseconds>(duration).count();
+  if (us <= 0) {
+    return 0;
+  }
+  return std::min<std::size_t>(
+    std::bit_width(static_cast<uint64_t>(us)), HistogramBuckets - 1);
+}
+
+void Add(
+  Entries& entries,
+  const std::source_location& location,
+  Clock::duration duration) {
+  auto& entry
+    = entries
+        .try_emplace(
+          Key {location.file_name(), location.line(), location.column()},
+          Entry {.mLocation = location})
+        .first->second;
+  ++entry.mCalls;
+  entry.mTotal += duration;
+  entry.mMax = std::max(entry.mMax, duration);
+  ++entry.mHistogram[GetBucket(duration)];
+}
+
+std::vector<Entry> GetTop(const Entries& entries, std::size_t count) {
+  std::vector<Entry> ret;
+  ret.reserve(entries.size());
+  for (const auto& [key, entry]: entries) {
+    ret.push_back(entry);
+  }
+  std::ranges::sort(ret, std::greater {}, &Entry::mTotal);
+  if (ret.size() > count) {
+    ret.erase(ret.begin() + count, ret.end());
+  }
+  return ret;
+}
+
+void Format(std::string& out, const Entry& entry) {
+  const auto& location = entry.mLocation;
+  out += std::format(
+    "- {}:{} ({})\n"
+    "  {} calls, {:0.2f}ms total, {:0.2f}ms mean, {:0.2f}ms max\n"
+    "  Histogram:",
+    location.file_name(),
+    location.line(),
+    location.function_name(),
+    entry.mCalls,
+    std::chrono::duration_cast<Milliseconds>(entry.mTotal).count(),
+    std::chrono::duration_cast<Milliseconds>(entry.mTotal).count()
+      / entry.mCalls,
+    std::chrono::duration_cast<Milliseconds>(entry.mMax).count());
+  for (std::size_t i = 0; i < HistogramBuckets; ++i) {
+    if (!entry.mHistogram[i]) {
+      continue;
+    }
+    if (i == HistogramBuckets - 1) {
+      out += std::format(
+        " >={}us: {}", uint64_t {1} << (i - 1), entry.mHistogram[i]);
+    } else {
+      out += std::format(" <{}us: {}", uint64_t {1} << i, entry.mHistogram[i]);
+    }
+  }
+  out += "\n";
+}
+
+void Trace(const char* kind, const Entry& entry) {
+  TraceLoggingWrite(
+    gTraceProvider,
+    "EventProfiler",
+    TraceLoggingValue(kind, "Kind"),
+    OPENKNEEBOARD_TraceLoggingSourceLocation(entry.mLocation),
+    TraceLoggingValue(entry.mCalls, "Calls"),
+    TraceLoggingValue(
+      std::chrono::duration_cast<Microseconds>(entry.mTotal).count(),
+      "TotalMicroseconds"),
+    TraceLoggingValue(
+      std::chrono::duration_cast<Microseconds>(entry.mMax).count(),
+      "MaxMicroseconds"));
+}
+
+}// namespace
+
+void SetEnabled(bool enabled) {
+  if (enabled) {
+    auto& store = Store::Get();
+    std::unique_lock lock(store.mMutex);
+    store.mEverEnabled = true;
+  }
+  detail::gEnabled.store(enabled, std::memory_order_relaxed);
+  dprint("Event handler profiling {}", enabled ? "enabled" : "disabled");
+}
+
+void Record(
+  const std::source_location& receiver,
+  const std::source_location& emitter,
+  Clock::duration duration) noexcept {
+  auto& store = Store::Get();
+  std::unique_lock lock(store.mMutex);
+  Add(store.mByReceiver, receiver, duration);
+  Add(store.mByEmitter, emitter, duration);
+}
+
+Report GetTopOffenders(std::size_t count) {
+  auto& store = Store::Get();
+  std::unique_lock lock(store.mMutex);
+  return {
+    .mByReceiver = GetTop(store.mByReceiver, count),
+    .mByEmitter = GetTop(store.mByEmitter, count),
+  };
+}
+
+std::string DumpTopOffenders(std::size_t count) {
+  {
+    auto& store = Store::Get();
+    std::unique_lock lock(store.mMutex);
+    if (!store.mEverEnabled) {
+      return "Event handler profiling has not been enabled.\n";
+    }
+  }
+
+  const auto report = GetTopOffenders(count);
+  std::string ret = std::format(
+    "Top {} event handlers by total time, by where they were connected:\n",
+    count);
+  for (const auto& it: report.mByReceiver) {
+    Format(ret, it);
+    Trace("Receiver", it);
+  }
+  ret += std::format("\nTop {} events by total handler time:\n", count);
+  for (const auto& it: report.mByEmitter) {
+    Format(ret, it);
+    Trace("Emitter", it);
+  }
+  return ret;
+}
+
+void Reset() {
+  auto& store = Store::Get();
+  std::unique_lock lock(store.mMutex);
+  store.mByReceiver.clear();
+  store.mByEmitter.clear();
+}
+
+}// namespace OpenKneeboard::EventProfiler
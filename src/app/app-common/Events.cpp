@@ -19,10 +19,12 @@
  */
 #include <OpenKneeboard/Events.hpp>
 
+#include <OpenKneeboard/config.hpp>
 #include <OpenKneeboard/dprint.hpp>
 #include <OpenKneeboard/fatal.hpp>
 #include <OpenKneeboard/scope_exit.hpp>
 
+#include <chrono>
 #include <queue>
 
 namespace OpenKneeboard {
@@ -186,6 +188,162 @@ void EventBase::InvokeOrEnqueue(
   queue.EmitOrEnqueue({func, location});
 }
 
+std::shared_ptr<EventMailbox> EventMailbox::GetForCurrentThread() {
+  // Weak, so that the mailbox is released when nothing targets this thread
+  thread_local std::weak_ptr<EventMailbox> tMailbox;
+  auto ret = tMailbox.lock();
+  if (!ret) {
+    ret = std::shared_ptr<EventMailbox>(new EventMailbox());
+    tMailbox = ret;
+  }
+  return ret;
+}
+
+EventMailbox::EventMailbox() = default;
+
+void EventMailbox::Post(std::unique_ptr<MPSCMailbox::Item> item) {
+  // Only the post that finds the mailbox empty needs to wake the owning
+  // thread; later posts will be picked up by the same drain
+  if (mMailbox.Push(std::move(item))) {
+    this->Drain();
+  }
+}
+
+OpenKneeboard::fire_and_forget EventMailbox::Drain() {
+  auto self = shared_from_this();
+  co_await mContext;
+
+  EventsTraceLoggingThreadActivity activity;
+  TraceLoggingWriteStart(activity, "EventMailbox::Drain()");
+  std::size_t count {};
+  {
+    // Run handlers after the whole batch has been emitted
+    const EventDelay delay;
+    count = mMailbox.Drain();
+  }
+  TraceLoggingWriteStop(
+    activity, "EventMailbox::Drain()", TraceLoggingValue(count, "Count"));
+}
+
+class CoalescingEventBase::Scheduler final
+  : public std::enable_shared_from_this<Scheduler> {
+ public:
+  static std::shared_ptr<Scheduler> GetForCurrentThread() {
+    auto ret = tScheduler.lock();
+    if (!ret) {
+      ret = std::make_shared<Scheduler>();
+      tScheduler = ret;
+    }
+    return ret;
+  }
+
+  /// nullptr if nothing is pending for the current thread
+  static std::shared_ptr<Scheduler> TryGetForCurrentThread() {
+    return tScheduler.lock();
+  }
+
+  void Schedule(std::weak_ptr<Pending> pending) {
+    {
+      std::unique_lock lock(mMutex);
+      mPending.push_back(std::move(pending));
+    }
+    this->ArmTimerIfNeeded();
+  }
+
+  void Flush() {
+    EventsTraceLoggingThreadActivity activity;
+    TraceLoggingWriteStart(activity, "CoalescingEvent::Flush()");
+    std::size_t count {};
+    // Handlers can emit other coalescing events - e.g. by forwarding - so
+    // keep going until they settle, rather than adding a frame per hop
+    for (std::size_t round = 0; round < MaxRoundsPerFlush; ++round) {
+      decltype(mPending) pending;
+      {
+        std::unique_lock lock(mMutex);
+        std::swap(pending, mPending);
+      }
+      if (pending.empty()) {
+        break;
+      }
+      const EventDelay delay;
+      for (const auto& weak: pending) {
+        if (auto it = weak.lock()) {
+          it->Deliver();
+          ++count;
+        }
+      }
+    }
+    // Anything still pending is being re-emitted by its own handlers, so
+    // leave it for the next frame
+    this->ArmTimerIfNeeded();
+    TraceLoggingWriteStop(
+      activity,
+      "CoalescingEvent::Flush()",
+      TraceLoggingValue(count, "Count"));
+  }
+
+ private:
+  // Weak, like `EventMailbox`: kept alive by pending deliveries
+  static inline thread_local std::weak_ptr<Scheduler> tScheduler;
+
+  static constexpr std::size_t MaxRoundsPerFlush = 8;
+  static constexpr auto Interval
+    = std::chrono::microseconds(1'000'000 / FramesPerSecond);
+
+  winrt::apartment_context mContext;
+
+  std::mutex mMutex;
+  // In order of first emit
+  std::vector<std::weak_ptr<Pending>> mPending;
+  bool mTimerArmed {false};
+
+  void ArmTimerIfNeeded() {
+    {
+      std::unique_lock lock(mMutex);
+      if (mTimerArmed || mPending.empty()) {
+        return;
+      }
+      mTimerArmed = true;
+    }
+    this->FlushAfterInterval();
+  }
+
+  OpenKneeboard::fire_and_forget FlushAfterInterval() {
+    auto self = shared_from_this();
+    co_await winrt::resume_after(Interval);
+    co_await mContext;
+    {
+      std::unique_lock lock(mMutex);
+      mTimerArmed = false;
+    }
+    this->Flush();
+  }
+};
+
+void CoalescingEventBase::FlushForCurrentThread() {
+  if (auto scheduler = Scheduler::TryGetForCurrentThread()) {
+    scheduler->Flush();
+  }
+}
+
+void CoalescingEventBase::Schedule(std::weak_ptr<Pending> pending) {
+  std::shared_ptr<Scheduler> scheduler;
+  try {
+    scheduler = Scheduler::GetForCurrentThread();
+  } catch (const winrt::hresult_error& e) {
+    // No COM apartment to come back to, so we can't delay delivery
+    dprint.Warning(
+      L"Couldn't coalesce event: {} - {}",
+      e.code().value,
+      std::wstring_view {e.message()});
+    if (auto it = pending.lock()) {
+      it->Deliver();
+    }
+    return;
+  }
+  scheduler->Schedule(std::move(pending));
+}
+
 EventDelay::EventDelay(std::source_location source) : mSourceLocation(source) {
   auto& queue = ThreadData::Get();
   const auto count = ++queue.mDelayDepth;
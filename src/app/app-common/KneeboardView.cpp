@@ -650,13 +650,13 @@ std::optional<Bookmark> KneeboardView::AddBookmarkForCurrentPage() {
   return ret;
 }
 
-std::vector<Bookmark> KneeboardView::GetBookmarks() const {
-  std::vector<Bookmark> ret;
-  auto inserter = std::back_inserter(ret);
-  for (auto&& tab: this->GetRootTabs()) {
-    std::ranges::copy(tab->GetBookmarks(), inserter);
-  }
-  return ret;
+BookmarkIndex::Bookmarks KneeboardView::GetBookmarks() const {
+  return mBookmarkIndex.GetBookmarks();
+}
+
+bool KneeboardView::UpdateBookmarkIndex(const ITab& tab) {
+  return mBookmarkIndex.SetTabBookmarks(
+    tab.GetRuntimeID(), tab.GetPageIDs(), tab.GetBookmarks());
 }
 
 std::vector<std::shared_ptr<ITab>> KneeboardView::GetRootTabs() const {
@@ -732,14 +732,14 @@ void KneeboardView::SetBookmark(RelativePosition pos) {
   }
 
   const auto bookmarks = this->GetBookmarks();
-  if (bookmarks.empty()) {
+  if (bookmarks->empty()) {
     return;
   }
 
   if (pos == RelativePosition::Previous) {
-    GoToBookmark(bookmarks.back());
+    GoToBookmark(bookmarks->back());
   } else {
-    GoToBookmark(bookmarks.front());
+    GoToBookmark(bookmarks->front());
   }
 }
 
@@ -748,59 +748,19 @@ std::optional<Bookmark> KneeboardView::GetBookmark(RelativePosition pos) const {
   if (!tab) {
     return {};
   }
-  const auto currentTabID = tab->GetRuntimeID();
-  const auto pages = mCurrentTabView->GetPageIDs();
-  const auto currentPageIt
-    = std::ranges::find(pages, mCurrentTabView->GetPageID());
-  if (currentPageIt == pages.end()) {
-    return {};
-  }
-
-  std::optional<Bookmark> prev;
-  bool reachedCurrentTab = false;
-  for (const auto& bookmark: this->GetBookmarks()) {
-    const bool isCurrentTab = bookmark.mTabID == currentTabID;
-    if (reachedCurrentTab && !isCurrentTab) {
-      switch (pos) {
-        case RelativePosition::Previous:
-          return prev;
-        case RelativePosition::Next:
-          return bookmark;
-      }
-      return {};
-    }
-
-    if (!(isCurrentTab || reachedCurrentTab)) {
-      prev = bookmark;
-      continue;
-    }
-
-    if (!isCurrentTab) {
-      throw std::logic_error("Should be current tab");
-    }
-    reachedCurrentTab = true;
 
-    const auto bookmarkPageIt = std::ranges::find(pages, bookmark.mPageID);
-    if (bookmarkPageIt == pages.end()) {
-      continue;
-    }
-
-    if (bookmarkPageIt < currentPageIt) {
-      prev = bookmark;
-      continue;
-    }
-    if (bookmarkPageIt == currentPageIt) {
-      continue;
-    }
-
-    if (pos == RelativePosition::Previous) {
-      return prev;
-    }
-    return bookmark;
+  // When showing a sub-tab (e.g. navigation), we're not on any of the root
+  // tab's pages, so skip the whole tab
+  std::optional<PageID> page;
+  if (mCurrentTabView->GetTabMode() == TabMode::Normal) {
+    page = mCurrentTabView->GetPageID();
   }
 
-  if (pos == RelativePosition::Previous) {
-    return prev;
+  switch (pos) {
+    case RelativePosition::Previous:
+      return mBookmarkIndex.GetPrevious(tab->GetRuntimeID(), page);
+    case RelativePosition::Next:
+      return mBookmarkIndex.GetNext(tab->GetRuntimeID(), page);
   }
   return {};
 }
@@ -826,11 +786,13 @@ void KneeboardView::SetTabViews(
   }
   mTabEvents.clear();
 
+  std::vector<ITab::RuntimeID> tabIDs;
   for (const auto& tabView: mTabViews) {
     const auto tab = tabView->GetRootTab().lock();
     if (!tab) {
       continue;
     }
+    tabIDs.push_back(tab->GetRuntimeID());
 
     auto repaint = [](auto self, auto tabView) {
       if (self->GetCurrentTabView() != tabView) {
@@ -839,16 +801,32 @@ void KneeboardView::SetTabViews(
       self->evNeedsRepaintEvent.Emit();
     } | bind_refs_front(this, tabView);
 
+    // Page order changes can reorder bookmarks too
+    auto bookmarksChanged = [](auto self, auto tab) {
+      if (self->UpdateBookmarkIndex(*tab)) {
+        self->evBookmarksChangedEvent.Emit();
+      }
+    } | bind_refs_front(this, tab);
+
     mTabEvents.insert(
       mTabEvents.end(),
       {
         AddEventListener(tabView->evNeedsRepaintEvent, repaint),
-        AddEventListener(
-          tabView->evBookmarksChangedEvent, this->evBookmarksChangedEvent),
+        AddEventListener(tab->evBookmarksChangedEvent, bookmarksChanged),
+        // Coalesced, unlike the tab's event
+        AddEventListener(tabView->evContentChangedEvent, bookmarksChanged),
         AddEventListener(tab->evAvailableFeaturesChangedEvent, repaint),
       });
   }
 
+  bool bookmarksChanged = mBookmarkIndex.SetTabs(tabIDs);
+  for (const auto& tab: this->GetRootTabs()) {
+    bookmarksChanged = this->UpdateBookmarkIndex(*tab) || bookmarksChanged;
+  }
+  if (bookmarksChanged) {
+    evBookmarksChangedEvent.Emit();
+  }
+
   if (currentView != mCurrentTabView) {
     mCurrentTabView = currentView;
     evCurrentTabChangedEvent.Emit(this->GetTabIndex());
@@ -384,7 +384,7 @@ void ChromiumPageSource::Client::OnTitleChange(
   CefRefPtr<CefBrowser>,
   const CefString& title) {
   if (auto it = mPageSource.lock()) {
-    it->evDocumentTitleChangedEvent.EnqueueForContext(mUIThread, title);
+    it->evDocumentTitleChangedEvent.EnqueueForContext(mUIThreadMailbox, title);
   }
 }
 
@@ -677,8 +677,9 @@ task<JSAPIResult> ChromiumPageSource::Client::SetPages(
     }
   }
 
-  pageSource->evContentChangedEvent.EnqueueForContext(mUIThread);
-  pageSource->evAvailableFeaturesChangedEvent.EnqueueForContext(mUIThread);
+  pageSource->evContentChangedEvent.EnqueueForContext(mUIThreadMailbox);
+  pageSource->evAvailableFeaturesChangedEvent.EnqueueForContext(
+    mUIThreadMailbox);
 
   co_return nlohmann::json {};
 }
@@ -766,7 +767,7 @@ void ChromiumPageSource::Client::SetCurrentPage(
   mBrowser->GetMainFrame()->SendProcessMessage(PID_RENDERER, message);
 
   pageSource->evPageChangeRequestedEvent.EnqueueForContext(
-    mUIThread, mViewID.value(), page.mPageID);
+    mUIThreadMailbox, mViewID.value(), page.mPageID);
 }
 
 task<JSAPIResult> ChromiumPageSource::Client::SendMessageToPeers(
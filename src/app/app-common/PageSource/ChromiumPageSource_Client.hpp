@@ -118,7 +118,8 @@ class ChromiumPageSource::Client final : public CefClient,
 
  private:
   IMPLEMENT_REFCOUNTING(Client);
-  winrt::apartment_context mUIThread;
+  std::shared_ptr<EventMailbox> mUIThreadMailbox {
+    EventMailbox::GetForCurrentThread()};
 
   wil::unique_handle mShutdownEvent;
 
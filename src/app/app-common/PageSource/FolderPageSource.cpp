@@ -20,7 +20,10 @@
 #include <OpenKneeboard/FilePageSource.hpp>
 #include <OpenKneeboard/FolderPageSource.hpp>
 
+#include <OpenKneeboard/DebugTimer.hpp>
+
 #include <OpenKneeboard/dprint.hpp>
+#include <OpenKneeboard/task/when_all.hpp>
 
 #include <shims/nlohmann/json.hpp>
 
@@ -30,6 +33,13 @@
 
 namespace OpenKneeboard {
 
+namespace {
+// Opening a file is mostly waiting on I/O and WinRT async operations, so this
+// can be higher than the core count; it's limited to avoid opening hundreds of
+// files at once
+constexpr std::size_t MaxConcurrentDelegateCreations = 8;
+}// namespace
+
 FolderPageSource::FolderPageSource(
   const audited_ptr<DXResources>& dxr,
   KneeboardState* kbs)
@@ -59,6 +69,11 @@ task<void> FolderPageSource::Reload() noexcept {
     co_return;
   }
 
+  // Full rebuild
+  this->StartScan();
+  mSnapshot = {};
+  mContents.clear();
+
   if (mPath.empty() || !std::filesystem::is_directory(mPath)) {
     EventDelay eventDelay;
     co_await this->SetDelegates({});
@@ -70,6 +85,20 @@ task<void> FolderPageSource::Reload() noexcept {
   this->OnFileModified(mPath);
 }
 
+task<void> FolderPageSource::DisposeAsync() noexcept {
+  // Scans keep us alive, so would otherwise create and publish every
+  // remaining delegate
+  this->StartScan();
+  co_await PageSourceWithDelegates::DisposeAsync();
+}
+
+uint64_t FolderPageSource::StartScan() {
+  // Don't start creating any more delegates for a superseded scan
+  mScanStopSource.request_stop();
+  mScanStopSource = {};
+  return ++mScanGeneration;
+}
+
 void FolderPageSource::SubscribeToChanges() {
   mWatcher = FilesystemWatcher::Create(mPath);
   AddEventListener(
@@ -89,45 +118,131 @@ OpenKneeboard::fire_and_forget FolderPageSource::OnFileModified(
   if (!std::filesystem::is_directory(directory)) {
     co_return;
   }
-  decltype(mContents) newContents;
-  bool modifiedOrNew = false;
-  for (const auto& entry:
-       std::filesystem::recursive_directory_iterator(directory)) {
-    if (!entry.is_regular_file()) {
-      continue;
-    }
 
-    const auto path = entry.path();
-    const auto mtime = entry.last_write_time();
+  const auto generation = this->StartScan();
+  const auto stopToken = mScanStopSource.get_token();
+  // From the change notification until the first new page is visible
+  std::optional<DebugTimer> firstPageTimer {
+    std::in_place, "Folder time to first page"};
 
-    auto it = mContents.find(path);
-    if (it != mContents.end()) {
-      // All file-sourced tabs watch their own content
-      newContents[path] = it->second;
-      newContents[path].mModified = mtime;
-      continue;
-    }
-    auto delegate = co_await FilePageSource::Create(mDXR, mKneeboard, path);
-    if (delegate) {
-      modifiedOrNew = true;
-      newContents[path] = {mtime, delegate};
-    }
+  co_await winrt::resume_background();
+  auto snapshot = FolderSnapshot::Scan(directory);
+  co_await mUIThread;
+
+  if (generation != mScanGeneration || directory != mPath) {
+    co_return;
   }
 
-  if (newContents.size() == mContents.size() && !modifiedOrNew) {
+  const auto diff = mSnapshot.Diff(snapshot);
+  if (diff.empty()) {
     dprint(L"No actual change to {}", mPath.wstring());
     co_return;
   }
-  dprint(L"Real change to {}", mPath.wstring());
+  dprint(
+    L"Real change to {}: {} added, {} removed, {} modified, {} replaced, {} "
+    L"renamed",
+    mPath.wstring(),
+    diff.mAdded.size(),
+    diff.mRemoved.size(),
+    diff.mModified.size(),
+    diff.mReplaced.size(),
+    diff.mRenamed.size());
+
+  // `entries` tracks the files that `contents` reflects, and is published
+  // with it; if this scan is superseded part-way through, the next scan
+  // diffs against what was actually published, so picks up the remainder
+  auto contents = mContents;
+  auto entries = mSnapshot.GetEntries();
+  const auto& scanned = snapshot.GetEntries();
+  std::vector<std::filesystem::path> rebuild;
+  for (const auto& path: diff.mRemoved) {
+    contents.erase(path);
+    entries.erase(path);
+  }
+  for (const auto& [from, to]: diff.mRenamed) {
+    // Delegates know their own path, so can't be reused
+    contents.erase(from);
+    entries.erase(from);
+    rebuild.push_back(to);
+  }
+  for (const auto& path: diff.mReplaced) {
+    contents.erase(path);
+    entries.erase(path);
+    rebuild.push_back(path);
+  }
+  std::ranges::copy(diff.mAdded, std::back_inserter(rebuild));
+  // File-sourced tabs watch their own content, so a modified file only needs
+  // a new delegate if we don't have one - e.g. a PDF that couldn't be opened
+  // because it was still being written
+  for (const auto& path: diff.mModified) {
+    if (contents.contains(path)) {
+      entries.insert_or_assign(path, scanned.at(path));
+      continue;
+    }
+    entries.erase(path);
+    rebuild.push_back(path);
+  }
+
+  // Publish delegates as they become ready, rather than waiting for the
+  // whole folder. `parallel_for_each()` resumes everything on this thread, so
+  // this state doesn't need synchronization.
+  bool publishing = false;
+  // Start dirty: removals need publishing even if nothing is added
+  bool dirty = true;
+  bool haveNewDelegate = false;
+  const auto publish = [&]() -> task<void> {
+    if (publishing) {
+      co_return;
+    }
+    publishing = true;
+    while (dirty && generation == mScanGeneration) {
+      dirty = false;
+      const auto publishingNewDelegate = haveNewDelegate;
+      std::vector<std::shared_ptr<IPageSource>> delegates;
+      for (const auto& [path, delegate]: contents) {
+        delegates.push_back(delegate);
+      }
+      mContents = contents;
+      mSnapshot = FolderSnapshot {entries};
+      EventDelay eventDelay;
+      co_await this->SetDelegates(std::move(delegates));
+      if (publishingNewDelegate) {
+        firstPageTimer.reset();
+      }
+    }
+    publishing = false;
+  };
+
+  DebugTimer allDelegatesTimer {
+    std::format("Folder all {} delegates", rebuild.size())};
 
-  std::vector<std::shared_ptr<IPageSource>> delegates;
-  for (const auto& [path, info]: newContents) {
-    delegates.push_back(info.mDelegate);
+  co_await parallel_for_each(
+    MaxConcurrentDelegateCreations,
+    std::move(rebuild),
+    [&](const std::filesystem::path& path) -> task<void> {
+      auto delegate = co_await FilePageSource::Create(mDXR, mKneeboard, path);
+      if (generation != mScanGeneration) {
+        co_return;
+      }
+      // Record failures too: they're retried when the file is next modified
+      entries.insert_or_assign(path, scanned.at(path));
+      if (!delegate) {
+        co_return;
+      }
+      contents[path] = std::move(delegate);
+      haveNewDelegate = true;
+      dirty = true;
+      co_await publish();
+    },
+    stopToken);
+  if (generation != mScanGeneration) {
+    co_return;
   }
 
-  EventDelay eventDelay;
-  mContents = newContents;
-  co_await this->SetDelegates(delegates);
+  co_await publish();
+  if (generation == mScanGeneration) {
+    mSnapshot = FolderSnapshot {std::move(entries)};
+  }
 }
 
 std::filesystem::path FolderPageSource::GetPath() const {
@@ -18,7 +18,9 @@
  * USA.
  */
 #include <OpenKneeboard/ImageFilePageSource.hpp>
+#include <OpenKneeboard/ProgressiveRenderTimer.hpp>
 
+#include <OpenKneeboard/config.hpp>
 #include <OpenKneeboard/dprint.hpp>
 #include <OpenKneeboard/format/filesystem.hpp>
 #include <OpenKneeboard/scope_exit.hpp>
@@ -33,6 +35,10 @@
 #include <wincodec.h>
 
 namespace OpenKneeboard {
+
+// Shown while the full-size image is decoded, if nothing is cached yet
+static constexpr PixelSize PreviewSize {256, 256};
+
 static std::expected<std::wstring, HRESULT> variable_sized_string_mem_fn(
   auto self,
   auto impl) {
@@ -141,6 +147,177 @@ ImageFilePageSource::GetFileFormatProviders(IWICImagingFactory* wic) {
   return sRet;
 }
 
+namespace {
+class D2DDecodedImage final : public DecodedImage {
+ public:
+  D2DDecodedImage(winrt::com_ptr<ID2D1Bitmap> bitmap)
+    : mBitmap(std::move(bitmap)) {
+  }
+
+  PixelSize GetSize() const override {
+    const auto size = mBitmap->GetPixelSize();
+    return {size.width, size.height};
+  }
+
+  std::size_t GetByteSize() const override {
+    const auto size = this->GetSize();
+    return std::size_t {size.mWidth} * size.mHeight * 4;
+  }
+
+  ID2D1Bitmap* GetBitmap() const {
+    return mBitmap.get();
+  }
+
+ private:
+  winrt::com_ptr<ID2D1Bitmap> mBitmap;
+};
+}// namespace
+
+class ImageFilePageSource::Decoder final : public ImageDecoder {
+ public:
+  Decoder(const audited_ptr<DXResources>& dxr) : mDXR(dxr) {
+  }
+
+  std::optional<PixelSize> GetNativeSize(
+    const std::filesystem::path& path) override {
+    auto frame = this->GetFrame(path);
+    if (!frame) {
+      return std::nullopt;
+    }
+    UINT width {}, height {};
+    if (frame->GetSize(&width, &height) != S_OK) {
+      return std::nullopt;
+    }
+    return PixelSize {width, height};
+  }
+
+  // Called from `ImageDecodeCache`'s worker threads
+  std::shared_ptr<DecodedImage> Decode(
+    const std::filesystem::path& path,
+    PixelSize size) override {
+    OPENKNEEBOARD_TraceLoggingScope("ImageFilePageSource::Decoder::Decode()");
+    auto wic = mDXR->mWIC.get();
+
+    auto frame = this->GetFrame(path);
+    if (!frame) {
+      return {};
+    }
+    auto source = frame.as<IWICBitmapSource>();
+
+    UINT nativeWidth {}, nativeHeight {};
+    frame->GetSize(&nativeWidth, &nativeHeight);
+    if (PixelSize {nativeWidth, nativeHeight} != size) {
+      winrt::com_ptr<IWICBitmapScaler> scaler;
+      wic->CreateBitmapScaler(scaler.put());
+      if (!scaler) {
+        return {};
+      }
+      if (
+        scaler->Initialize(
+          frame.get(),
+          size.mWidth,
+          size.mHeight,
+          WICBitmapInterpolationModeHighQualityCubic)
+        != S_OK) {
+        return {};
+      }
+      source = scaler.as<IWICBitmapSource>();
+    }
+
+    winrt::com_ptr<IWICFormatConverter> converter;
+    wic->CreateFormatConverter(converter.put());
+    if (!converter) {
+      return {};
+    }
+    converter->Initialize(
+      source.get(),
+      GUID_WICPixelFormat32bppPBGRA,
+      WICBitmapDitherTypeNone,
+      nullptr,
+      0.0f,
+      WICBitmapPaletteTypeMedianCut);
+
+    // Do the actual decode now, rather than while holding the D3D lock
+    winrt::com_ptr<IWICBitmap> pixels;
+    {
+      OPENKNEEBOARD_TraceLoggingScope(
+        "ImageFilePageSource::Decoder::Decode()/CreateBitmapFromSource");
+      wic->CreateBitmapFromSource(
+        converter.get(), WICBitmapCacheOnLoad, pixels.put());
+    }
+    if (!pixels) {
+      return {};
+    }
+
+    const WICRect rect {
+      0,
+      0,
+      static_cast<INT>(size.mWidth),
+      static_cast<INT>(size.mHeight),
+    };
+    winrt::com_ptr<IWICBitmapLock> pixelsLock;
+    if (pixels->Lock(&rect, WICBitmapLockRead, pixelsLock.put()) != S_OK) {
+      return {};
+    }
+    UINT stride {};
+    UINT bufferSize {};
+    BYTE* data {nullptr};
+    pixelsLock->GetStride(&stride);
+    pixelsLock->GetDataPointer(&bufferSize, &data);
+    if (!data) {
+      return {};
+    }
+
+    /* Copy the pixels into an independent Direct2D bitmap.
+     *
+     * `CreateBitmapFromWicBitmap()` would retain a reference to the WIC bitmap,
+     * which can keep the file open - and undeletable - for as long as Direct3D
+     * holds a reference to the bitmap; this is a problem for `FolderTab`s
+     * pointing at temporary folders.
+     */
+    winrt::com_ptr<ID2D1Bitmap> bitmap;
+    {
+      OPENKNEEBOARD_TraceLoggingScope(
+        "ImageFilePageSource::Decoder::Decode()/CreateBitmap");
+      const std::unique_lock d2dlock(*mDXR);
+      winrt::com_ptr<ID2D1DeviceContext> ctx;
+      winrt::check_hresult(mDXR->mD2DDevice->CreateDeviceContext(
+        D2D1_DEVICE_CONTEXT_OPTIONS_NONE, ctx.put()));
+      // For WIC, this MUST be B8G8R8A8_UNORM, not _UNORM_SRGB
+      ctx->CreateBitmap(
+        size,
+        data,
+        stride,
+        D2D1_BITMAP_PROPERTIES {
+          .pixelFormat = {
+            .format = DXGI_FORMAT_B8G8R8A8_UNORM,
+            .alphaMode = D2D1_ALPHA_MODE_PREMULTIPLIED,
+          },
+        },
+        bitmap.put());
+    }
+    if (!bitmap) {
+      return {};
+    }
+    return std::make_shared<D2DDecodedImage>(std::move(bitmap));
+  }
+
+ private:
+  audited_ptr<DXResources> mDXR;
+
+  winrt::com_ptr<IWICBitmapFrameDecode> GetFrame(
+    const std::filesystem::path& path) {
+    auto decoder
+      = ImageFilePageSource::GetDecoderFromFileName(mDXR->mWIC.get(), path);
+    if (!decoder) {
+      return {};
+    }
+    winrt::com_ptr<IWICBitmapFrameDecode> frame;
+    decoder->GetFrame(0, frame.put());
+    return frame;
+  }
+};
+
 std::shared_ptr<ImageFilePageSource> ImageFilePageSource::Create(
   const audited_ptr<DXResources>& dxr,
   const std::vector<std::filesystem::path>& paths) {
@@ -150,13 +327,22 @@ std::shared_ptr<ImageFilePageSource> ImageFilePageSource::Create(
 }
 
 ImageFilePageSource::ImageFilePageSource(const audited_ptr<DXResources>& dxr)
-  : mDXR(dxr) {
+  : mDXR(dxr),
+    mDecoder(std::make_shared<Decoder>(dxr)),
+    mDecodeCache(ImageDecodeCache::Get()) {
+}
+
+void ImageFilePageSource::ErasePagesFromDecodeCache() {
+  for (const auto& page: mPages) {
+    mDecodeCache->Erase(page.mID.GetTemporaryValue());
+  }
 }
 
 void ImageFilePageSource::SetPaths(
   const std::vector<std::filesystem::path>& paths) {
   OPENKNEEBOARD_TraceLoggingScopedActivity(
     activity, "ImageFilePageSource::SetPaths()");
+  this->ErasePagesFromDecodeCache();
   mPages.clear();
   mPages.reserve(paths.size());
   for (const auto& path: paths) {
@@ -188,8 +374,10 @@ void ImageFilePageSource::OnFileModified(const std::filesystem::path& path) {
   if (it == mPages.end()) {
     return;
   }
+  mDecodeCache->Erase(it->mID.GetTemporaryValue());
   if (std::filesystem::exists(path)) {
-    it->mBitmap = {};
+    it->mNativeSize = std::nullopt;
+    it->mPresentedFinal = false;
     it->mID = {};
   } else {
     mPages.erase(it);
@@ -205,6 +393,7 @@ std::vector<std::filesystem::path> ImageFilePageSource::GetPaths() const {
 
 ImageFilePageSource::~ImageFilePageSource() {
   this->RemoveAllEventListeners();
+  this->ErasePagesFromDecodeCache();
 }
 
 bool ImageFilePageSource::CanOpenFile(const std::filesystem::path& path) const {
@@ -290,14 +479,63 @@ std::vector<PageID> ImageFilePageSource::GetPageIDs() const {
 
 std::optional<PreferredSize> ImageFilePageSource::GetPreferredSize(
   PageID pageID) {
-  auto bitmap = GetPageBitmap(pageID);
-  if (!bitmap) {
+  const auto size = this->GetNativeSize(pageID);
+  if (!size) {
     return std::nullopt;
   }
+  return PreferredSize {*size, ScalingKind::Bitmap};
+}
+
+std::optional<PixelSize> ImageFilePageSource::GetNativeSize(PageID pageID) {
+  std::filesystem::path path;
+  {
+    std::unique_lock lock(mMutex);
+    auto it = std::ranges::find(mPages, pageID, &Page::mID);
+    if (it == mPages.end()) {
+      return std::nullopt;
+    }
+    if (it->mNativeSize) {
+      // Empty if we failed to read it
+      return it->mNativeSize->IsEmpty() ? std::nullopt : it->mNativeSize;
+    }
+    path = it->mPath;
+  }
 
-  const auto size = bitmap->GetPixelSize();
+  // Only reads the header, not the pixel data - but that's still file I/O,
+  // so don't block renders of other pages
+  const auto size = mDecoder->GetNativeSize(path);
 
-  return PreferredSize {{size.width, size.height}, ScalingKind::Bitmap};
+  std::unique_lock lock(mMutex);
+  auto it = std::ranges::find(mPages, pageID, &Page::mID);
+  if (it != mPages.end()) {
+    it->mNativeSize = size.value_or(PixelSize {});
+  }
+  return size;
+}
+
+ImageDecodeCache::Request ImageFilePageSource::GetDecodeRequest(
+  const Page& page,
+  PixelSize nativeSize,
+  PixelSize wantedSize) {
+  return {
+    .mKey = page.mID.GetTemporaryValue(),
+    .mPath = page.mPath,
+    .mDecoder = mDecoder,
+    .mNativeSize = nativeSize,
+    .mWantedSize = wantedSize,
+    .mPreviewSize = PreviewSize,
+    .mOnReady = std::bind_front(
+      &ImageFilePageSource::OnImageDecoded, weak_from_this(), mUIThread),
+  };
+}
+
+fire_and_forget ImageFilePageSource::OnImageDecoded(
+  std::weak_ptr<ImageFilePageSource> weak,
+  winrt::apartment_context uiThread) {
+  co_await uiThread;
+  if (auto self = weak.lock()) {
+    self->evNeedsRepaintEvent.Emit();
+  }
 }
 
 task<void> ImageFilePageSource::RenderPage(
@@ -305,14 +543,72 @@ task<void> ImageFilePageSource::RenderPage(
   PageID pageID,
   PixelRect rect) {
   OPENKNEEBOARD_TraceLoggingCoro("ImageFilePageSource::RenderPage");
-  auto bitmap = GetPageBitmap(pageID);
-  if (!bitmap) {
+  const auto nativeSize = this->GetNativeSize(pageID);
+  if (!nativeSize) {
+    co_return;
+  }
+
+  auto& timer = ProgressiveRenderTimer::Get();
+  const auto timerKey = pageID.GetTemporaryValue();
+
+  std::shared_ptr<DecodedImage> image;
+  // We render every frame, but only want to time until the final image
+  bool timed {false};
+  std::vector<PageID> neighbors;
+  {
+    std::unique_lock lock(mMutex);
+    auto it = std::ranges::find(mPages, pageID, &Page::mID);
+    if (it == mPages.end()) [[unlikely]] {
+      co_return;
+    }
+    timed = !it->mPresentedFinal;
+    if (timed) {
+      timer.Requested(timerKey, ProgressiveRenderTimer::Clock::now());
+    }
+
+    auto request = this->GetDecodeRequest(*it, *nativeSize, rect.mSize);
+    // Renders that aren't for a view are usually kept by the caller, e.g.
+    // as a thumbnail, so would never be replaced by the final image
+    if (!rc.GetKneeboardView()) {
+      request.mPreviewSize.reset();
+    }
+    image = mDecodeCache->GetOrQueue(request);
+
+    // Indices, as `begin() - 1` is undefined behavior
+    const auto i = static_cast<std::size_t>(it - mPages.begin());
+    if (i > 0) {
+      neighbors.push_back(mPages.at(i - 1).mID);
+    }
+    if (i + 1 < mPages.size()) {
+      neighbors.push_back(mPages.at(i + 1).mID);
+    }
+  }
+
+  // Neighbors are decoded at the largest size we might need, as we don't
+  // know the size they'll be shown at
+  for (const auto neighbor: neighbors) {
+    const auto neighborSize = this->GetNativeSize(neighbor);
+    if (!neighborSize) {
+      continue;
+    }
+    std::unique_lock lock(mMutex);
+    auto it = std::ranges::find(mPages, neighbor, &Page::mID);
+    if (it != mPages.end()) {
+      mDecodeCache->Prefetch(
+        this->GetDecodeRequest(*it, *neighborSize, MaxViewRenderSize));
+    }
+  }
+
+  if (!image) {
+    // Repainted when the decode finishes
     co_return;
   }
-  const auto pageSize = bitmap->GetPixelSize();
+  const auto bitmap
+    = std::static_pointer_cast<D2DDecodedImage>(image)->GetBitmap();
 
-  const auto renderSize
-    = PixelSize(pageSize.width, pageSize.height).ScaledToFit(rect.mSize);
+  // Lay out using the native size, so that a lower-resolution image
+  // shown while a larger one is decoded is in the same place
+  const auto renderSize = nativeSize->ScaledToFit(rect.mSize);
 
   const auto renderLeft
     = rect.Left() + ((rect.Width() - renderSize.Width()) / 2);
@@ -321,115 +617,44 @@ task<void> ImageFilePageSource::RenderPage(
 
   auto ctx = rc.d2d();
   ctx->DrawBitmap(
-    bitmap.get(),
+    bitmap,
     PixelRect {{renderLeft, renderTop}, renderSize},
     1.0f,
     D2D1_INTERPOLATION_MODE_ANISOTROPIC);
-}
-
-winrt::com_ptr<ID2D1Bitmap> ImageFilePageSource::GetPageBitmap(PageID pageID) {
-  OPENKNEEBOARD_TraceLoggingCoro("ImageFilePageSource::GetPageBitmap");
-  std::unique_lock lock(mMutex);
-  TraceLoggingWrite(
-    gTraceProvider, "ImageFilePageSource::GetPageBitmap()/acquiredLock");
-  auto it = std::ranges::find_if(
-    mPages, [pageID](const auto& page) { return page.mID == pageID; });
-  if (it == mPages.end()) [[unlikely]] {
-    return {};
-  }
-
-  auto& page = *it;
-  if (page.mBitmap) [[likely]] {
-    return page.mBitmap;
-  }
 
-  auto wic = mDXR->mWIC.get();
-  auto decoder = ImageFilePageSource::GetDecoderFromFileName(wic, page.mPath);
-  TraceLoggingWrite(
-    gTraceProvider, "ImageFilePageSource::GetPageBitmap()/haveDecoder");
-
-  if (!decoder) {
-    return {};
-  }
-
-  winrt::com_ptr<IWICBitmapFrameDecode> frame;
-  {
-    OPENKNEEBOARD_TraceLoggingScope(
-      "ImageFilePageSource::GetPageBitmap/GetFrame");
-    decoder->GetFrame(0, frame.put());
-  }
-  if (!frame) {
-    return {};
-  }
-
-  winrt::com_ptr<IWICFormatConverter> converter;
-  wic->CreateFormatConverter(converter.put());
-  if (!converter) {
-    return {};
-  }
-  converter->Initialize(
-    frame.get(),
-    GUID_WICPixelFormat32bppPBGRA,
-    WICBitmapDitherTypeNone,
-    nullptr,
-    0.0f,
-    WICBitmapPaletteTypeMedianCut);
-
-  /* `CreateBitmapFromWicBitmap` creates a Direct2D bitmap that refers to
-   * - and retains a reference to - the existing WIC bitmap.
-   *
-   * This means that Direct2D/Direct3D indirectly keep a reference to an
-   * object that keeps an open file alive; releasing the internal references
-   * is not enough to close the file - we need to also wait for Direct2D/3D to
-   * finish.
-   *
-   * This is problematic if this `FolderTab` is pointing at a temporary folder
-   * if we later want to delete the temporary folder: even after calling
-   * `SetPath({})`, DirectX may still hold references to the Direct2D bitmap,
-   * and in turn the WIC bitmap and open file.
-   *
-   * The simplest way to deal with this problem is to do an immediate on-GPU
-   * copy of the pixel data from the WIC-referencing bitmap to an independent
-   * bitmap - then the WIC bitmap can immediately be freed, and is never
-   * referenced (or kept alive) by the D3D11 render pipeline.
-   */
-  winrt::com_ptr<ID2D1Bitmap> sharedBitmap;
-  winrt::com_ptr<ID2D1DeviceContext> ctx;
-  winrt::check_hresult(mDXR->mD2DDevice->CreateDeviceContext(
-    D2D1_DEVICE_CONTEXT_OPTIONS_NONE, ctx.put()));
-
-  {
-    OPENKNEEBOARD_TraceLoggingScope(
-      "ImageFilePageSource::GetPageBitmap()/CreateBitmapFromWicBitmap");
-    ctx->CreateBitmapFromWicBitmap(converter.get(), sharedBitmap.put());
-  }
-  if (!sharedBitmap) {
-    return {};
+  if (!timed) {
+    co_return;
   }
-
-  // For WIC, this MUST be B8G8R8A8_UNORM, not _UNORM_SRGB, or the copy
-  // silently fails.
-  winrt::check_hresult(
-    ctx->CreateBitmap(
-      sharedBitmap->GetPixelSize(),
-      D2D1_BITMAP_PROPERTIES{
-        .pixelFormat = {
-          .format = DXGI_FORMAT_B8G8R8A8_UNORM,
-          .alphaMode = D2D1_ALPHA_MODE_PREMULTIPLIED,
-        },
-      },
-      page.mBitmap.put()));
-
-  if (!page.mBitmap) {
-    return {};
+  const auto mipSize = ImageDecodeCache::GetMipSize(*nativeSize, rect.mSize);
+  const auto imageSize = image->GetSize();
+  const auto quality = (imageSize.mWidth >= mipSize.mWidth
+                        && imageSize.mHeight >= mipSize.mHeight)
+    ? ProgressiveRenderTimer::Quality::Final
+    : ProgressiveRenderTimer::Quality::Preview;
+  if (quality == ProgressiveRenderTimer::Quality::Final) {
+    std::unique_lock lock(mMutex);
+    auto it = std::ranges::find(mPages, pageID, &Page::mID);
+    if (it != mPages.end()) {
+      it->mPresentedFinal = true;
+    }
   }
-  {
-    OPENKNEEBOARD_TraceLoggingScope(
-      "ImageFilePageSource::GetPageBitmap()/CopyFromBitmap");
-    page.mBitmap->CopyFromBitmap(nullptr, sharedBitmap.get(), nullptr);
+  const auto timings
+    = timer.Presented(timerKey, quality, ProgressiveRenderTimer::Clock::now());
+  if (timings) {
+    TraceLoggingWrite(
+      gTraceProvider,
+      "ImageFilePageSource::RenderPage()/FinalPixel",
+      TraceLoggingValue(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+          timings->mTimeToFirstPixel)
+          .count(),
+        "TimeToFirstPixelMicroseconds"),
+      TraceLoggingValue(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+          timings->mTimeToFinalPixel)
+          .count(),
+        "TimeToFinalPixelMicroseconds"));
   }
-
-  return page.mBitmap;
 }
 
 bool ImageFilePageSource::IsNavigationAvailable() const {
@@ -24,17 +24,27 @@
 #include <OpenKneeboard/DoodleRenderer.hpp>
 #include <OpenKneeboard/Filesystem.hpp>
 #include <OpenKneeboard/FilesystemWatcher.hpp>
+#include <OpenKneeboard/KneeboardView.hpp>
 #include <OpenKneeboard/LaunchURI.hpp>
 #include <OpenKneeboard/NavigationTab.hpp>
 #include <OpenKneeboard/PDFFilePageSource.hpp>
 #include <OpenKneeboard/PDFNavigation.hpp>
+#include <OpenKneeboard/PDFNavigationCache.hpp>
+#include <OpenKneeboard/PDFTextIndex.hpp>
+#include <OpenKneeboard/PageMetadataCache.hpp>
+#include <OpenKneeboard/PrerenderScheduler.hpp>
+#include <OpenKneeboard/ProgressiveRenderTimer.hpp>
 #include <OpenKneeboard/RuntimeFiles.hpp>
+#include <OpenKneeboard/SHM.hpp>
+#include <OpenKneeboard/SnapshotStore.hpp>
+#include <OpenKneeboard/TabView.hpp>
 
 #include <OpenKneeboard/config.hpp>
 #include <OpenKneeboard/dprint.hpp>
 #include <OpenKneeboard/final_release_deleter.hpp>
 #include <OpenKneeboard/format/filesystem.hpp>
 #include <OpenKneeboard/scope_exit.hpp>
+#include <OpenKneeboard/task/when_all.hpp>
 #include <OpenKneeboard/utf8.hpp>
 
 #include <shims/nlohmann/json.hpp>
@@ -49,7 +59,10 @@
 
 #include <windows.data.pdf.interop.h>
 
+#include <DirectXColors.h>
+
 #include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <fstream>
 #include <iterator>
@@ -57,6 +70,7 @@
 #include <random>
 #include <shared_mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <inttypes.h>
 
@@ -80,11 +94,101 @@ static constexpr auto wrap_lock(
   }
 }
 
+static const PageMetadataCache& GetPageMetadataCache() {
+  static const PageMetadataCache sCache {
+    Filesystem::GetCacheDirectory() / "PageMetadata"};
+  return sCache;
+}
+
+static const PDFNavigationCache& GetPDFNavigationCache() {
+  static const PDFNavigationCache sCache {
+    Filesystem::GetCacheDirectory() / "PDFNavigation"};
+  return sCache;
+}
+
+// Shared by all PDF tabs, so the same document open in several tabs is only
+// copied once
+static SnapshotStore& GetSnapshotStore() {
+  static const auto sStore
+    = SnapshotStore::Create(Filesystem::GetTemporaryDirectory() / "Snapshots");
+  return *sStore;
+}
+
+// Prerendering only uses idle time on the UI thread; this is how much of a
+// frame it can use at once
+static constexpr auto PrerenderBudget
+  = std::chrono::microseconds(1'000'000 / FramesPerSecond) / 2;
+
+// If a page is too slow to render within `PrerenderBudget`, it's first shown
+// at this fraction of the width and height, then replaced with the full
+// resolution render once there's time
+static constexpr uint32_t PreviewScale = 4;
+
+// How often to check if views have stopped showing the document, so that
+// their prerendered pages can be freed
+static constexpr auto PrerenderDetachCheckInterval = std::chrono::seconds(1);
+
+namespace {
+struct PageTexture {
+  PixelSize mSize;
+  winrt::com_ptr<ID3D11Texture2D> mTexture;
+  winrt::com_ptr<ID3D11ShaderResourceView> mSRV;
+  std::shared_ptr<RenderTarget> mRenderTarget;
+};
+
+std::optional<PageTexture> CreatePageTexture(
+  const audited_ptr<DXResources>& dxr,
+  const PixelSize& size) {
+  PageTexture ret {.mSize = size};
+  try {
+    const D3D11_TEXTURE2D_DESC textureDesc {
+      .Width = size.mWidth,
+      .Height = size.mHeight,
+      .MipLevels = 1,
+      .ArraySize = 1,
+      .Format = SHM::SHARED_TEXTURE_PIXEL_FORMAT,
+      .SampleDesc = {1, 0},
+      .Usage = D3D11_USAGE_DEFAULT,
+      .BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET,
+    };
+    winrt::check_hresult(dxr->mD3D11Device->CreateTexture2D(
+      &textureDesc, nullptr, ret.mTexture.put()));
+    winrt::check_hresult(dxr->mD3D11Device->CreateShaderResourceView(
+      ret.mTexture.get(), nullptr, ret.mSRV.put()));
+    ret.mRenderTarget = RenderTarget::Create(dxr, ret.mTexture);
+  } catch (const winrt::hresult_error& e) {
+    dprint.Warning(
+      "Failed to create page texture: {}", winrt::to_string(e.message()));
+    return std::nullopt;
+  }
+
+  auto d3d = ret.mRenderTarget->d3d();
+  dxr->mD3D11ImmediateContext->ClearRenderTargetView(
+    d3d.rtv(), DirectX::Colors::Transparent);
+  return ret;
+}
+
+}// namespace
+
+static void LogReloadException() {
+  try {
+    throw;
+  } catch (const std::exception& e) {
+    dprint.Warning("Exception reloading PDFFilePageSource: {}", e.what());
+    OPENKNEEBOARD_BREAK;
+  } catch (const winrt::hresult_error& e) {
+    dprint.Warning(
+      "HRESULT Exception reloading PDFFilePageSource: {}",
+      winrt::to_string(e.message()));
+    OPENKNEEBOARD_BREAK;
+  }
+}
+
 struct PDFFilePageSource::DocumentResources final {
   using LinkHandler = CursorClickableRegions<PDFNavigation::Link>;
 
   std::filesystem::path mPath;
-  std::shared_ptr<Filesystem::TemporaryCopy> mCopy;
+  std::shared_ptr<SnapshotStore::Snapshot> mCopy;
 
   std::shared_ptr<FilesystemWatcher> mWatcher;
 
@@ -95,10 +199,44 @@ struct PDFFilePageSource::DocumentResources final {
 
   bool mNavigationLoaded = false;
 
+  // Set while links for the whole document are being extracted, so that
+  // pages under the cursor can be fetched first
+  std::shared_ptr<PDFNavigation::PDF> mLinkSource;
+  std::unordered_set<PageIndex> mLinksRequested;
+
+  static std::shared_ptr<LinkHandler> CreateLinkHandler(
+    PDFFilePageSource*,
+    const std::vector<PDFNavigation::Link>&);
+
+  // Built by the first `FindText()`, as a cache miss needs a full parse of
+  // the document
+  LazyPDFTextIndex mTextIndex {[this] { return this->BuildTextIndex(); }};
+
+  std::optional<PDFTextIndex> BuildTextIndex();
+
+  // UI thread only. Each page can be a 16MiB texture, so keep only a few
+  PrerenderScheduler mPrerenderScheduler {
+    PrerenderScheduler::Options {.mMaxRendered = 6}};
+  std::unordered_map<PageIndex, PageTexture> mPrerendered;
+  bool mPrerendering = false;
+  // Views the scheduler knows about, to find out when they go away
+  std::unordered_map<PrerenderScheduler::ViewKey, std::weak_ptr<KneeboardView>>
+    mPrerenderViews;
+  bool mExpiringPrerendered = false;
+
   std::unordered_map<RenderTargetID, std::unique_ptr<CachedLayer>> mCache;
+  // Only a page's first render is timed; later ones are usually cache hits
+  std::unordered_set<PageID> mPresentedFinal;
 
   std::vector<PageID> mPageIDs;
 
+  std::optional<PageMetadataCache::Key> mMetadataKey;
+  std::optional<PageMetadata> mCachedMetadata;
+  // Initially `mCachedMetadata`; replaced piece-by-piece as the document loads
+  PageMetadata mMetadata;
+  bool mHaveRendererMetadata = false;
+  bool mHaveNavigationMetadata = false;
+
   static auto Create(
     const std::filesystem::path& path,
     std::shared_ptr<FilesystemWatcher>&& watcher) {
@@ -220,6 +358,14 @@ task<void> PDFFilePageSource::ReloadRenderer(
     }
     dprint("Opened PDF file {} for render", path.string());
 
+    std::vector<PixelSize> pageSizes;
+    pageSizes.reserve(document.PageCount());
+    for (uint32_t i = 0; i < document.PageCount(); ++i) {
+      const auto size = document.GetPage(i).Size();
+      pageSizes.push_back(
+        {static_cast<UINT32>(size.Width), static_cast<UINT32>(size.Height)});
+    }
+
     {
       const auto lock = wrap_lock(std::unique_lock {mMutex});
       // Another workaround for
@@ -231,6 +377,22 @@ task<void> PDFFilePageSource::ReloadRenderer(
       }
       doc->mPDFDocument = std::move(document);
       doc->mPageIDs.resize(doc->mPDFDocument.PageCount());
+      doc->mMetadata.mPageSizes = std::move(pageSizes);
+      doc->mHaveRendererMetadata = true;
+      // May have been rendered blank while waiting for the document
+      for (auto& [rtid, layer]: doc->mCache) {
+        layer->Reset();
+      }
+      doc->mPrerenderScheduler.Reset();
+      doc->mPrerendered.clear();
+    }
+
+    if (
+      doc->mCachedMetadata
+      && doc->mCachedMetadata->mPageSizes == doc->mMetadata.mPageSizes) {
+      // Pages were already published from the cache
+      evNeedsRepaintEvent.Emit();
+      co_return;
     }
   }
 
@@ -260,20 +422,91 @@ task<void> PDFFilePageSource::ReloadNavigation(
   }
 
   std::filesystem::path path;
+  PDFNavigationCache::Key cacheKey;
   {
     const auto lock = wrap_lock(std::shared_lock {mMutex});
     path = doc->mCopy->GetPath();
+    cacheKey = doc->mCopy->GetContentHash();
   }
-  std::optional<PDFNavigation::PDF> maybePdf;
-  try {
-    maybePdf.emplace(path);
-  } catch (const std::runtime_error& e) {
-    dprint("Failed to load PDFNavigation for PDF {}: {}", path, e.what());
-    co_return;
+
+  auto index = GetPDFNavigationCache().Load(cacheKey);
+  if (!index) {
+    std::optional<PDFNavigation::PDF> maybePdf;
+    try {
+      maybePdf.emplace(path);
+    } catch (const std::runtime_error& e) {
+      dprint("Failed to load PDFNavigation for PDF {}: {}", path, e.what());
+      co_return;
+    }
+    const auto pdf
+      = std::make_shared<PDFNavigation::PDF>(std::move(*maybePdf));
+    auto bookmarks = pdf->GetBookmarks();
+
+    bool haveLinks = false;
+    {
+      const auto lock = wrap_lock(std::shared_lock {mMutex});
+      haveLinks = !doc->mLinks.empty();
+    }
+    // Bookmarks are cheap; don't make them wait for the links
+    if (!haveLinks) {
+      this->SetNavigation(doc, bookmarks, {});
+      this->evAvailableFeaturesChangedEvent.EnqueueForContext(mUIThreadMailbox);
+      const auto lock = wrap_lock(std::unique_lock {mMutex});
+      doc->mLinkSource = pdf;
+    }
+
+    index = PDFNavigation::Index {std::move(bookmarks), pdf->GetLinks()};
+    GetPDFNavigationCache().Store(cacheKey, *index);
+    {
+      const auto lock = wrap_lock(std::unique_lock {mMutex});
+      doc->mLinkSource = {};
+    }
+  }
+
+  auto& [bookmarks, links] = *index;
+  this->SetNavigation(doc, bookmarks, links);
+
+  {
+    const auto lock = wrap_lock(std::unique_lock {mMutex});
+    doc->mMetadata.mBookmarks = std::move(bookmarks);
+    doc->mMetadata.mLinks = std::move(links);
+    doc->mHaveNavigationMetadata = true;
   }
-  auto pdf = std::move(*maybePdf);
 
-  const auto bookmarks = pdf.GetBookmarks();
+  this->evAvailableFeaturesChangedEvent.EnqueueForContext(mUIThreadMailbox);
+}
+
+std::shared_ptr<PDFFilePageSource::DocumentResources::LinkHandler>
+PDFFilePageSource::DocumentResources::CreateLinkHandler(
+  PDFFilePageSource* source,
+  const std::vector<PDFNavigation::Link>& links) {
+  auto handler = LinkHandler::Create(links);
+  source->AddEventListener(
+    handler->evClicked,
+    {
+      source->weak_from_this(),
+      [](auto self, KneeboardViewID ctx, PDFNavigation::Link link)
+        -> OpenKneeboard::fire_and_forget {
+        const auto& dest = link.mDestination;
+        switch (dest.mType) {
+          case PDFNavigation::DestinationType::Page:
+            self->evPageChangeRequestedEvent.Emit(
+              ctx, self->GetPageIDForIndex(dest.mPageIndex));
+            break;
+          case PDFNavigation::DestinationType::URI: {
+            co_await LaunchURI(dest.mURI);
+            break;
+          }
+        }
+      },
+    });
+  return handler;
+}
+
+void PDFFilePageSource::SetNavigation(
+  const std::shared_ptr<DocumentResources>& doc,
+  const std::vector<PDFNavigation::Bookmark>& bookmarks,
+  const std::vector<std::vector<PDFNavigation::Link>>& links) {
   decltype(doc->mBookmarks) navigation;
   for (int i = 0; i < bookmarks.size(); i++) {
     const auto& it = bookmarks[i];
@@ -286,39 +519,73 @@ task<void> PDFFilePageSource::ReloadNavigation(
     doc->mNavigationLoaded = true;
   }
 
-  const auto links = pdf.GetLinks();
-  decltype(mDocumentResources->mLinks) linkHandlers;
+  decltype(doc->mLinks) existingHandlers;
+  {
+    const auto lock = wrap_lock(std::shared_lock {mMutex});
+    existingHandlers = doc->mLinks;
+  }
+
+  decltype(doc->mLinks) linkHandlers;
   for (int i = 0; i < links.size(); ++i) {
-    const auto& pageLinks = links.at(i);
-    auto handler = DocumentResources::LinkHandler::Create(pageLinks);
-    AddEventListener(
-      handler->evClicked,
-      {
-        weak,
-        [](auto self, KneeboardViewID ctx, PDFNavigation::Link link)
-          -> OpenKneeboard::fire_and_forget {
-          const auto& dest = link.mDestination;
-          switch (dest.mType) {
-            case PDFNavigation::DestinationType::Page:
-              self->evPageChangeRequestedEvent.Emit(
-                ctx, self->GetPageIDForIndex(dest.mPageIndex));
-              break;
-            case PDFNavigation::DestinationType::URI: {
-              co_await LaunchURI(dest.mURI);
-              break;
-            }
-          }
-        },
-      });
-    linkHandlers[this->GetPageIDForIndex(i)] = handler;
+    const auto pageID = this->GetPageIDForIndex(i);
+    // e.g. when confirming cached links; keep the handler, so its click
+    // listener isn't added again
+    if (const auto it = existingHandlers.find(pageID);
+        it != existingHandlers.end() && it->second) {
+      it->second->SetButtons(links.at(i));
+      linkHandlers[pageID] = it->second;
+      continue;
+    }
+    linkHandlers[pageID]
+      = DocumentResources::CreateLinkHandler(this, links.at(i));
   }
 
   {
     const auto lock = wrap_lock(std::unique_lock {mMutex});
     doc->mLinks = std::move(linkHandlers);
   }
+}
+
+OpenKneeboard::fire_and_forget PDFFilePageSource::LoadPageLinks(
+  std::weak_ptr<DocumentResources> weakDoc,
+  PageID pageID) {
+  auto weak = weak_from_this();
+  std::shared_ptr<PDFNavigation::PDF> pdf;
+  PageIndex index {};
+  {
+    auto doc = weakDoc.lock();
+    if (!doc) {
+      co_return;
+    }
+    const auto lock = wrap_lock(std::unique_lock {mMutex});
+    if (!doc->mLinkSource) {
+      co_return;
+    }
+    const auto it = std::ranges::find(doc->mPageIDs, pageID);
+    if (it == doc->mPageIDs.end()) {
+      co_return;
+    }
+    index = static_cast<PageIndex>(it - doc->mPageIDs.begin());
+    if (!doc->mLinksRequested.insert(index).second) {
+      co_return;
+    }
+    pdf = doc->mLinkSource;
+  }
+
+  // Only parses this page, so is usually done long before the full pass
+  co_await winrt::resume_background();
+  const auto links = pdf->GetLinks(index);
+  pdf = {};
 
-  this->evAvailableFeaturesChangedEvent.EnqueueForContext(mUIThread);
+  auto self = weak.lock();
+  auto doc = weakDoc.lock();
+  if (!(self && doc)) {
+    co_return;
+  }
+  auto handler = DocumentResources::CreateLinkHandler(this, links);
+  const auto lock = wrap_lock(std::unique_lock {mMutex});
+  // `SetNavigation()` may have beaten us to it
+  doc->mLinks.try_emplace(pageID, std::move(handler));
 }
 
 PageID PDFFilePageSource::GetPageIDForIndex(PageIndex index) const {
@@ -346,7 +613,6 @@ PageID PDFFilePageSource::GetPageIDForIndex(PageIndex index) const {
 }
 
 task<void> PDFFilePageSource::Reload() try {
-  static uint64_t sCount = 0;
   auto uiThread = mUIThread;
   auto weak = weak_from_this();
 
@@ -372,38 +638,137 @@ task<void> PDFFilePageSource::Reload() try {
     weakDoc = mDocumentResources;
   }
 
+  // Reads the start of the file, so keep it off the UI thread
+  co_await winrt::resume_background();
+  {
+    auto self = weak.lock();
+    auto doc = weakDoc.lock();
+    if (!(self && doc)) {
+      co_return;
+    }
+    const auto key = PageMetadataCache::Key::Create(doc->mPath);
+    auto cached = key ? GetPageMetadataCache().Load(*key) : std::nullopt;
+
+    const auto lock = wrap_lock(std::unique_lock {mMutex});
+    doc->mMetadataKey = key;
+    if (cached) {
+      doc->mMetadata = *cached;
+      doc->mCachedMetadata = std::move(cached);
+    }
+  }
+
+  co_await uiThread;
+
+  auto doc = weakDoc.lock();
+  if (!(doc && doc->mCachedMetadata)) {
+    co_await this->LoadDocument(weakDoc);
+    co_return;
+  }
+
+  // Publish the pages now, and confirm them in the background
+  this->SetNavigation(
+    doc, doc->mCachedMetadata->mBookmarks, doc->mCachedMetadata->mLinks);
+  doc = {};
+  evContentChangedEvent.Emit();
+  evAvailableFeaturesChangedEvent.Emit();
+
+  [](auto self, auto weakDoc) -> OpenKneeboard::fire_and_forget {
+    co_await self->LoadDocument(weakDoc);
+  }(shared_from_this(), weakDoc);
+} catch (...) {
+  LogReloadException();
+}
+
+task<void> PDFFilePageSource::LoadDocument(
+  std::weak_ptr<DocumentResources> weakDoc) try {
+  auto uiThread = mUIThread;
+  auto weak = weak_from_this();
+
   // Do copy in a background thread so we're not hung up on antivirus
   co_await winrt::resume_background();
 
-  auto self = weak.lock();
   {
+    auto self = weak.lock();
     auto doc = weakDoc.lock();
     if (!(self && doc)) {
       co_return;
     }
-    auto tempPath = Filesystem::GetTemporaryDirectory()
-      / std::format(L"{:08x}-{}{}",
-                    ++sCount,
-                    doc->mPath.stem().wstring().substr(0, 16),
-                    doc->mPath.extension());
-    doc->mCopy
-      = std::make_shared<Filesystem::TemporaryCopy>(doc->mPath, tempPath);
+    // Reuses the previous snapshot if the content hasn't changed
+    doc->mCopy = GetSnapshotStore().Acquire(doc->mPath);
+    if (!doc->mCopy) {
+      dprint.Warning("Failed to snapshot PDF `{}`", doc->mPath);
+      co_return;
+    }
   }
 
   co_await uiThread;
 
-  for (auto&& it: std::array<task<void>, 2> {
-         this->ReloadRenderer(weakDoc), this->ReloadNavigation(weakDoc)}) {
-    co_await std::move(it);
+  std::vector<task<void>> reloads;
+  reloads.push_back(this->ReloadRenderer(weakDoc));
+  reloads.push_back(this->ReloadNavigation(weakDoc));
+  co_await when_all(std::move(reloads));
+
+  co_await winrt::resume_background();
+  auto doc = weakDoc.lock();
+  if (!doc) {
+    co_return;
+  }
+  std::optional<PageMetadata> metadata;
+  {
+    const auto lock = wrap_lock(std::shared_lock {mMutex});
+    if (
+      doc->mMetadataKey && doc->mHaveRendererMetadata
+      && doc->mHaveNavigationMetadata
+      && doc->mMetadata != doc->mCachedMetadata) {
+      metadata = doc->mMetadata;
+    }
   }
-} catch (const std::exception& e) {
-  dprint.Warning("Exception reloading PDFFilePageSource: {}", e.what());
-  OPENKNEEBOARD_BREAK;
-} catch (const winrt::hresult_error& e) {
-  dprint.Warning(
-    "HRESULT Exception reloading PDFFilePageSource: {}",
-    winrt::to_string(e.message()));
-  OPENKNEEBOARD_BREAK;
+  if (metadata) {
+    GetPageMetadataCache().Store(*doc->mMetadataKey, *metadata);
+  }
+} catch (...) {
+  LogReloadException();
+}
+
+std::optional<PDFTextIndex>
+PDFFilePageSource::DocumentResources::BuildTextIndex() {
+  const auto cacheKey = mCopy->GetContentHash();
+  if (auto index = GetPDFNavigationCache().LoadTextIndex(cacheKey)) {
+    return index;
+  }
+
+  const auto path = mCopy->GetPath();
+  try {
+    auto index = PDFTextIndex::Create(PDFNavigation::PDF {path}.GetText());
+    GetPDFNavigationCache().StoreTextIndex(cacheKey, index);
+    return index;
+  } catch (const std::runtime_error& e) {
+    dprint("Failed to extract text from PDF {}: {}", path, e.what());
+    return std::nullopt;
+  }
+}
+
+bool PDFFilePageSource::IsTextSearchAvailable() const {
+  const auto lock = wrap_lock(std::shared_lock {mMutex});
+  return mDocumentResources && mDocumentResources->mCopy;
+}
+
+std::vector<PageID> PDFFilePageSource::FindText(std::string_view query) const {
+  std::shared_ptr<DocumentResources> doc;
+  {
+    const auto lock = wrap_lock(std::shared_lock {mMutex});
+    if (!(mDocumentResources && mDocumentResources->mCopy)) {
+      return {};
+    }
+    doc = mDocumentResources;
+  }
+  const auto index = doc->mTextIndex.Get();
+
+  std::vector<PageID> ret;
+  for (const auto pageIndex: index->Find(query)) {
+    ret.push_back(this->GetPageIDForIndex(pageIndex));
+  }
+  return ret;
 }
 
 OpenKneeboard::fire_and_forget PDFFilePageSource::final_release(
@@ -414,10 +779,15 @@ OpenKneeboard::fire_and_forget PDFFilePageSource::final_release(
 
 PageIndex PDFFilePageSource::GetPageCount() const {
   const auto lock = wrap_lock(std::shared_lock {mMutex});
-  if (mDocumentResources && mDocumentResources->mPDFDocument) {
+  if (!mDocumentResources) {
+    return 0;
+  }
+  if (mDocumentResources->mPDFDocument) {
     return mDocumentResources->mPDFDocument.PageCount();
   }
-  return 0;
+  // Published from `PageMetadataCache`, still loading
+  return static_cast<PageIndex>(
+    mDocumentResources->mMetadata.mPageSizes.size());
 }
 
 std::vector<PageID> PDFFilePageSource::GetPageIDs() const {
@@ -458,6 +828,13 @@ std::optional<PreferredSize> PDFFilePageSource::GetPreferredSize(PageID id) {
     return std::nullopt;
   }
   const auto index = it - mDocumentResources->mPageIDs.begin();
+  const auto& sizes = mDocumentResources->mMetadata.mPageSizes;
+  if (index < sizes.size()) {
+    return PreferredSize {sizes.at(index), ScalingKind::Vector};
+  }
+  if (!mDocumentResources->mPDFDocument) {
+    return std::nullopt;
+  }
   auto size = mDocumentResources->mPDFDocument.GetPage(index).Size();
 
   return PreferredSize {
@@ -485,11 +862,15 @@ void PDFFilePageSource::RenderPageContent(
   }
   const auto index = pageIt - doc->mPageIDs.begin();
 
-  auto page = doc->mPDFDocument.GetPage(index);
-
   auto ctx = rt->d2d();
   ctx->FillRectangle(rect, mBackgroundBrush.get());
 
+  if (!doc->mPDFDocument) {
+    // Published from `PageMetadataCache`, still loading
+    return;
+  }
+  auto page = doc->mPDFDocument.GetPage(index);
+
   PDF_RENDER_PARAMS params {
     .DestinationWidth = rect.Width(),
     .DestinationHeight = rect.Height(),
@@ -516,6 +897,9 @@ void PDFFilePageSource::PostCursorEvent(
   const auto& pixelSize = contentSize->mPixelSize;
 
   if (!mDocumentResources->mLinks.contains(pageID)) {
+    // The full pass can take a while for large documents; start with the
+    // pages that are being interacted with
+    this->LoadPageLinks(mDocumentResources, pageID);
     mDoodles->PostCursorEvent(ctx, ev, pageID, pixelSize);
     return;
   }
@@ -627,6 +1011,24 @@ std::vector<NavigationEntry> PDFFilePageSource::GetNavigationEntries() const {
   return entries;
 }
 
+std::optional<PageContentKey> PDFFilePageSource::GetPageContentKey(
+  PageID pageID) const {
+  const auto lock = wrap_lock(std::shared_lock {mMutex});
+  const auto& doc = mDocumentResources;
+  // Until the renderer is loaded, pages are blank placeholders
+  if (!(doc && doc->mCopy && doc->mPDFDocument)) {
+    return std::nullopt;
+  }
+  const auto it = std::ranges::find(doc->mPageIDs, pageID);
+  if (it == doc->mPageIDs.end()) {
+    return std::nullopt;
+  }
+  return PageContentKey {
+    .mContentHash = doc->mCopy->GetContentHash(),
+    .mPageIndex = static_cast<PageIndex>(it - doc->mPageIDs.begin()),
+  };
+}
+
 task<void>
 PDFFilePageSource::RenderPage(RenderContext rc, PageID pageID, PixelRect rect) {
   auto rt = rc.GetRenderTarget();
@@ -643,19 +1045,335 @@ PDFFilePageSource::RenderPage(RenderContext rc, PageID pageID, PixelRect rect) {
 
   const auto cacheDimensions
     = preferredSize->mPixelSize.IntegerScaledToFit(MaxViewRenderSize);
+
+  using Quality = ProgressiveRenderTimer::Quality;
+  auto& timer = ProgressiveRenderTimer::Get();
+  const auto timerKey = pageID.GetTemporaryValue();
+  const auto timed = !mDocumentResources->mPresentedFinal.contains(pageID);
+  if (timed) {
+    timer.Requested(timerKey, ProgressiveRenderTimer::Clock::now());
+  }
+
+  // Only show a preview if a full render would stall the frame, and the
+  // prerenderer will replace it
+  const auto view = rc.GetKneeboardView();
+  const auto isSlow
+    = mDocumentResources->mPrerenderScheduler.GetStatistics().mEstimate
+    > PrerenderBudget;
+  const auto quality = (view && isSlow
+                        && !this->GetPrerenderedPageIndex(
+                          pageID, cacheDimensions))
+    ? Quality::Preview
+    : Quality::Final;
+
+  // Includes the quality, so the cached preview is replaced
+  const auto cacheKey = (pageID.GetTemporaryValue() << 1)
+    | static_cast<CachedLayer::Key>(quality == Quality::Final);
   co_await mDocumentResources->mCache[rtid]->Render(
     rect,
-    pageID.GetTemporaryValue(),
+    cacheKey,
     rt,
-    [](auto self, auto pageID, auto rt, auto size) -> task<void> {
-      self->RenderPageContent(rt, pageID, {{0, 0}, size});
+    [](auto self, auto pageID, auto quality, auto rt, auto size)
+      -> task<void> {
+      if (quality == Quality::Preview) {
+        self->RenderPagePreview(rt, pageID, size);
+      } else if (!self->CopyPrerenderedPage(rt, pageID, size)) {
+        self->RenderPageContent(rt, pageID, {{0, 0}, size});
+      }
       co_return;
-    } | bindline::bind_front(this, pageID),
+    } | bindline::bind_front(this, pageID, quality),
     cacheDimensions);
 
+  if (timed && quality == Quality::Final) {
+    mDocumentResources->mPresentedFinal.insert(pageID);
+  }
+  const auto timings = timed
+    ? timer.Presented(timerKey, quality, ProgressiveRenderTimer::Clock::now())
+    : std::nullopt;
+  if (timings) {
+    TraceLoggingWrite(
+      gTraceProvider,
+      "PDFFilePageSource::RenderPage()/FinalPixel",
+      TraceLoggingValue(timerKey, "PageID"),
+      TraceLoggingValue(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+          timings->mTimeToFirstPixel)
+          .count(),
+        "TimeToFirstPixelMicroseconds"),
+      TraceLoggingValue(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+          timings->mTimeToFinalPixel)
+          .count(),
+        "TimeToFinalPixelMicroseconds"));
+  }
+
   const auto d2d = rt->d2d();
   mDoodles->Render(d2d, pageID, rect);
   this->RenderOverDoodles(d2d, pageID, rect);
+
+  if (view) {
+    // If we showed a preview, the full-resolution render happens in idle
+    // time too
+    this->SchedulePrerender(*view, pageID, quality == Quality::Preview);
+  }
+}
+
+std::optional<PageIndex> PDFFilePageSource::GetPrerenderedPageIndex(
+  PageID pageID,
+  const PixelSize& size) const {
+  auto doc = mDocumentResources;
+  if (!doc) {
+    return std::nullopt;
+  }
+  PageIndex index {};
+  {
+    const auto lock = wrap_lock(std::shared_lock {mMutex});
+    const auto it = std::ranges::find(doc->mPageIDs, pageID);
+    if (it == doc->mPageIDs.end()) {
+      return std::nullopt;
+    }
+    index = static_cast<PageIndex>(it - doc->mPageIDs.begin());
+  }
+
+  const auto it = doc->mPrerendered.find(index);
+  if (it == doc->mPrerendered.end() || it->second.mSize != size) {
+    return std::nullopt;
+  }
+  return index;
+}
+
+bool PDFFilePageSource::CopyPrerenderedPage(
+  RenderTarget* rt,
+  PageID pageID,
+  const PixelSize& size) {
+  const auto index = this->GetPrerenderedPageIndex(pageID, size);
+  if (!index) {
+    return false;
+  }
+
+  auto d3d = rt->d3d();
+  const PixelRect pixelRect {{0, 0}, size};
+  auto sb = mDXR->mSpriteBatch.get();
+  sb->Begin(d3d.rtv(), rt->GetDimensions());
+  sb->Draw(
+    mDocumentResources->mPrerendered.at(*index).mSRV.get(),
+    pixelRect,
+    pixelRect);
+  sb->End();
+  return true;
+}
+
+void PDFFilePageSource::RenderPagePreview(
+  RenderTarget* rt,
+  PageID pageID,
+  const PixelSize& size) {
+  OPENKNEEBOARD_TraceLoggingScope("PDFFilePageSource::RenderPagePreview()");
+  const auto previewSize = size / PreviewScale;
+  if (previewSize.IsEmpty()) {
+    this->RenderPageContent(rt, pageID, {{0, 0}, size});
+    return;
+  }
+
+  const auto preview = CreatePageTexture(mDXR, previewSize);
+  if (!preview) {
+    this->RenderPageContent(rt, pageID, {{0, 0}, size});
+    return;
+  }
+  this->RenderPageContent(
+    preview->mRenderTarget.get(), pageID, {{0, 0}, previewSize});
+
+  auto d3d = rt->d3d();
+  auto sb = mDXR->mSpriteBatch.get();
+  sb->Begin(d3d.rtv(), rt->GetDimensions());
+  sb->Draw(
+    preview->mSRV.get(),
+    PixelRect {{0, 0}, size},
+    PixelRect {{0, 0}, previewSize});
+  sb->End();
+}
+
+void PDFFilePageSource::SchedulePrerender(
+  KneeboardView& view,
+  PageID pageID,
+  bool isPreview) {
+  auto doc = mDocumentResources;
+  if (!doc) {
+    return;
+  }
+  PageIndex index {};
+  PageIndex pageCount {};
+  {
+    const auto lock = wrap_lock(std::shared_lock {mMutex});
+    // Until then, we'd just be rendering the background
+    if (!doc->mPDFDocument) {
+      return;
+    }
+    const auto it = std::ranges::find(doc->mPageIDs, pageID);
+    if (it == doc->mPageIDs.end()) {
+      return;
+    }
+    index = static_cast<PageIndex>(it - doc->mPageIDs.begin());
+    pageCount = static_cast<PageIndex>(doc->mPageIDs.size());
+  }
+
+  const auto viewKey = view.GetRuntimeID().GetTemporaryValue();
+  doc->mPrerenderViews.insert_or_assign(viewKey, view.weak_from_this());
+  doc->mPrerenderScheduler.SetCurrentPage(
+    viewKey, index, pageCount, PrerenderScheduler::Clock::now(), isPreview);
+  for (const auto evicted: doc->mPrerenderScheduler.TakeEvictions()) {
+    doc->mPrerendered.erase(evicted);
+  }
+
+  if (
+    doc->mPrerenderScheduler.HasPendingWork()
+    && !std::exchange(doc->mPrerendering, true)) {
+    this->Prerender(doc);
+  }
+  this->StartExpiringPrerendered(doc);
+}
+
+OpenKneeboard::fire_and_forget PDFFilePageSource::Prerender(
+  std::weak_ptr<DocumentResources> weakDoc) {
+  auto weak = weak_from_this();
+  auto dq = mUIThreadDispatcherQueue;
+  while (true) {
+    // Only use time that the UI thread would otherwise spend idle
+    co_await wil::resume_foreground(
+      dq, winrt::Microsoft::UI::Dispatching::DispatcherQueuePriority::Low);
+    {
+      auto self = weak.lock();
+      auto doc = weakDoc.lock();
+      if (!(self && doc && doc == self->mDocumentResources)) {
+        co_return;
+      }
+      if (!self->PrerenderSlice(doc)) {
+        doc->mPrerendering = false;
+        co_return;
+      }
+    }
+    // Deferred until either there's more budget, or the user has stopped
+    // flipping through pages
+    co_await winrt::resume_after(
+      std::chrono::microseconds(1'000'000 / FramesPerSecond));
+  }
+}
+
+bool PDFFilePageSource::PrerenderSlice(
+  const std::shared_ptr<DocumentResources>& doc) {
+  OPENKNEEBOARD_TraceLoggingScope("PDFFilePageSource::PrerenderSlice()");
+  using Clock = PrerenderScheduler::Clock;
+  auto& scheduler = doc->mPrerenderScheduler;
+
+  const auto sliceStart = Clock::now();
+  while (true) {
+    const auto start = Clock::now();
+    const auto index
+      = scheduler.Next(start, PrerenderBudget - (start - sliceStart));
+    if (!index) {
+      break;
+    }
+
+    PageID pageID {nullptr};
+    {
+      const auto lock = wrap_lock(std::shared_lock {mMutex});
+      if (*index >= doc->mPageIDs.size()) {
+        scheduler.Fail(*index);
+        continue;
+      }
+      pageID = doc->mPageIDs.at(*index);
+    }
+    const auto preferredSize = this->GetPreferredSize(pageID);
+    if (!preferredSize) {
+      scheduler.Fail(*index);
+      continue;
+    }
+    const auto size
+      = preferredSize->mPixelSize.IntegerScaledToFit(MaxViewRenderSize);
+
+    auto page = CreatePageTexture(mDXR, size);
+    if (!page) {
+      scheduler.Fail(*index);
+      continue;
+    }
+    this->RenderPageContent(page->mRenderTarget.get(), pageID, {{0, 0}, size});
+
+    if (scheduler.Complete(*index, Clock::now() - start)) {
+      doc->mPrerendered.insert_or_assign(*index, std::move(*page));
+      // Replace the preview
+      if (scheduler.IsCurrent(*index)) {
+        evNeedsRepaintEvent.Emit();
+      }
+    }
+  }
+
+  for (const auto evicted: scheduler.TakeEvictions()) {
+    doc->mPrerendered.erase(evicted);
+  }
+  this->StartExpiringPrerendered(doc);
+  return scheduler.HasPendingWork();
+}
+
+void PDFFilePageSource::StartExpiringPrerendered(
+  const std::shared_ptr<DocumentResources>& doc) {
+  if (
+    doc->mPrerenderScheduler.GetNextExpiry()
+    && !std::exchange(doc->mExpiringPrerendered, true)) {
+    this->ExpirePrerendered(doc);
+  }
+}
+
+OpenKneeboard::fire_and_forget PDFFilePageSource::ExpirePrerendered(
+  std::weak_ptr<DocumentResources> weakDoc) {
+  using Clock = PrerenderScheduler::Clock;
+  auto weak = weak_from_this();
+  auto dq = mUIThreadDispatcherQueue;
+  while (true) {
+    co_await wil::resume_foreground(
+      dq, winrt::Microsoft::UI::Dispatching::DispatcherQueuePriority::Low);
+    Clock::duration wait {};
+    {
+      auto self = weak.lock();
+      auto doc = weakDoc.lock();
+      if (!(self && doc && doc == self->mDocumentResources)) {
+        co_return;
+      }
+      auto& scheduler = doc->mPrerenderScheduler;
+      const auto now = Clock::now();
+      self->RemoveDetachedPrerenderViews(doc);
+      scheduler.Expire(now);
+      for (const auto evicted: scheduler.TakeEvictions()) {
+        doc->mPrerendered.erase(evicted);
+      }
+
+      const auto expiry = scheduler.GetNextExpiry();
+      if (!expiry) {
+        doc->mExpiringPrerendered = false;
+        co_return;
+      }
+      wait = std::min<Clock::duration>(
+        *expiry - now, PrerenderDetachCheckInterval);
+    }
+    co_await winrt::resume_after(wait);
+  }
+}
+
+void PDFFilePageSource::RemoveDetachedPrerenderViews(
+  const std::shared_ptr<DocumentResources>& doc) {
+  std::vector<PageID> pageIDs;
+  {
+    const auto lock = wrap_lock(std::shared_lock {mMutex});
+    pageIDs = doc->mPageIDs;
+  }
+  std::erase_if(doc->mPrerenderViews, [&](const auto& it) {
+    const auto& [key, weakView] = it;
+    const auto view = weakView.lock();
+    const auto tabView = view ? view->GetCurrentTabView() : nullptr;
+    if (tabView && std::ranges::contains(pageIDs, tabView->GetPageID())) {
+      return false;
+    }
+    doc->mPrerenderScheduler.RemoveView(key);
+    return true;
+  });
 }
 
 fire_and_forget PDFFilePageSource::OnFileModified(
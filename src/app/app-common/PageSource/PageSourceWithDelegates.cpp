@@ -80,7 +80,12 @@ task<void> PageSourceWithDelegates::SetDelegates(
 
   auto keepAlive = shared_from_this();
 
-  auto disposers = mDelegates | std::views::transform([](auto it) {
+  // Delegates that are being kept (e.g. unchanged files in a folder) must not
+  // be disposed
+  auto disposers = mDelegates | std::views::filter([&delegates](auto it) {
+                     return std::ranges::find(delegates, it) == delegates.end();
+                   })
+    | std::views::transform([](auto it) {
                      return std::dynamic_pointer_cast<IHasDisposeAsync>(it);
                    })
     | std::views::filter([](auto it) -> bool { return !!it; })
@@ -317,6 +322,17 @@ std::vector<NavigationEntry> PageSourceWithDelegates::GetNavigationEntries()
   return entries;
 }
 
+std::optional<PageContentKey> PageSourceWithDelegates::GetPageContentKey(
+  PageID pageID) const {
+  const auto withNavigation
+    = std::dynamic_pointer_cast<IPageSourceWithNavigation>(
+      this->FindDelegate(pageID));
+  if (!withNavigation) {
+    return std::nullopt;
+  }
+  return withNavigation->GetPageContentKey(pageID);
+}
+
 bool PageSourceWithDelegates::HasDeveloperTools(PageID id) const {
   auto delegate = this->FindDelegate(id);
   if (!delegate) {
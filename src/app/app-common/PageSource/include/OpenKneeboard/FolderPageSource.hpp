@@ -21,6 +21,7 @@
 
 #include <OpenKneeboard/DXResources.hpp>
 #include <OpenKneeboard/FilesystemWatcher.hpp>
+#include <OpenKneeboard/FolderSnapshot.hpp>
 #include <OpenKneeboard/PageSourceWithDelegates.hpp>
 
 #include <shims/winrt/base.h>
@@ -29,6 +30,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <stop_token>
 
 namespace OpenKneeboard {
 
@@ -51,8 +53,13 @@ class FolderPageSource final : public PageSourceWithDelegates {
   [[nodiscard]]
   task<void> Reload() noexcept;
 
+  [[nodiscard]]
+  virtual task<void> DisposeAsync() noexcept override;
+
  private:
   void SubscribeToChanges();
+  /// Returns the new generation
+  uint64_t StartScan();
   OpenKneeboard::fire_and_forget OnFileModified(std::filesystem::path);
 
   winrt::apartment_context mUIThread;
@@ -62,11 +69,12 @@ class FolderPageSource final : public PageSourceWithDelegates {
   KneeboardState* mKneeboard = nullptr;
 
   std::filesystem::path mPath;
-  struct DelegateInfo {
-    std::filesystem::file_time_type mModified;
-    std::shared_ptr<IPageSource> mDelegate;
-  };
-  std::map<std::filesystem::path, DelegateInfo> mContents;
+  FolderSnapshot mSnapshot;
+  // Bumped by each rescan; a rescan that finishes after a newer one started
+  // is discarded, and the newer one diffs against the older snapshot
+  uint64_t mScanGeneration {};
+  std::stop_source mScanStopSource;
+  std::map<std::filesystem::path, std::shared_ptr<IPageSource>> mContents;
 };
 
 }// namespace OpenKneeboard
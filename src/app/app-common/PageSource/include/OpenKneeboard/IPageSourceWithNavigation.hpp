@@ -19,11 +19,14 @@
  */
 #pragma once
 
+#include <OpenKneeboard/ContentHash.hpp>
 #include <OpenKneeboard/IPageSource.hpp>
 #include <OpenKneeboard/UniqueID.hpp>
 
 #include <OpenKneeboard/utf8.hpp>
 
+#include <optional>
+
 namespace OpenKneeboard {
 
 struct NavigationEntry {
@@ -31,10 +34,27 @@ struct NavigationEntry {
   PageID mPageID;
 };
 
+/// Identifies what a page shows, independently of where it was loaded from
+struct PageContentKey {
+  ContentHash mContentHash {};
+  PageIndex mPageIndex {};
+
+  bool operator==(const PageContentKey&) const noexcept = default;
+};
+
 class IPageSourceWithNavigation : public virtual IPageSource {
  public:
   virtual bool IsNavigationAvailable() const = 0;
   virtual std::vector<NavigationEntry> GetNavigationEntries() const = 0;
+
+  /** For persistent caches of rendered pages, e.g. navigation thumbnails.
+   *
+   * Returns `std::nullopt` if the content can't be identified, e.g. because
+   * it's still loading, or can change without the source changing.
+   */
+  virtual std::optional<PageContentKey> GetPageContentKey(PageID) const {
+    return std::nullopt;
+  }
 };
 
 }// namespace OpenKneeboard
@@ -23,7 +23,9 @@
 #include <OpenKneeboard/Events.hpp>
 #include <OpenKneeboard/FilesystemWatcher.hpp>
 #include <OpenKneeboard/IPageSource.hpp>
+#include <OpenKneeboard/IPageSourceWithInternalCaching.hpp>
 #include <OpenKneeboard/IPageSourceWithNavigation.hpp>
+#include <OpenKneeboard/ImageDecodeCache.hpp>
 
 #include <OpenKneeboard/audited_ptr.hpp>
 
@@ -33,8 +35,15 @@
 
 namespace OpenKneeboard {
 
+/** Image files, with one page per file.
+ *
+ * Pages are drawn from `ImageDecodeCache` every frame, rather than cached by
+ * the wrapper: the wrapper's cache would keep showing whatever was rendered
+ * first, e.g. nothing, or a low-resolution preview.
+ */
 class ImageFilePageSource final
   : public virtual IPageSource,
+    public virtual IPageSourceWithInternalCaching,
     public virtual IPageSourceWithNavigation,
     public virtual EventReceiver,
     public std::enable_shared_from_this<ImageFilePageSource> {
@@ -75,21 +84,37 @@ class ImageFilePageSource final
  private:
   ImageFilePageSource(const audited_ptr<DXResources>&);
 
+  class Decoder;
+
   struct Page {
     PageID mID;
     std::filesystem::path mPath;
-    winrt::com_ptr<ID2D1Bitmap> mBitmap;
+    // Empty if it couldn't be read
+    std::optional<PixelSize> mNativeSize;
     std::shared_ptr<FilesystemWatcher> mWatcher;
+    // Stop timing once the full-quality image has been shown
+    bool mPresentedFinal {false};
   };
 
   void OnFileModified(const std::filesystem::path&);
 
   audited_ptr<DXResources> mDXR;
+  winrt::apartment_context mUIThread;
+  std::shared_ptr<Decoder> mDecoder;
+  std::shared_ptr<ImageDecodeCache> mDecodeCache;
 
   std::mutex mMutex;
   std::vector<Page> mPages = {};
 
-  winrt::com_ptr<ID2D1Bitmap> GetPageBitmap(PageID);
+  std::optional<PixelSize> GetNativeSize(PageID);
+  ImageDecodeCache::Request GetDecodeRequest(
+    const Page&,
+    PixelSize nativeSize,
+    PixelSize wantedSize);
+  void ErasePagesFromDecodeCache();
+  static fire_and_forget OnImageDecoded(
+    std::weak_ptr<ImageFilePageSource>,
+    winrt::apartment_context uiThread);
 
   static winrt::com_ptr<IWICBitmapDecoder> GetDecoderFromFileName(
     IWICImagingFactory*,
@@ -22,6 +22,8 @@
 #include <OpenKneeboard/Events.hpp>
 #include <OpenKneeboard/IPageSourceWithCursorEvents.hpp>
 #include <OpenKneeboard/IPageSourceWithNavigation.hpp>
+#include <OpenKneeboard/KneeboardViewID.hpp>
+#include <OpenKneeboard/PDFNavigation.hpp>
 
 #include <OpenKneeboard/audited_ptr.hpp>
 
@@ -32,10 +34,12 @@
 #include <filesystem>
 #include <memory>
 #include <shared_mutex>
+#include <string_view>
 
 namespace OpenKneeboard {
 
 class KneeboardState;
+class KneeboardView;
 struct DXResources;
 class DoodleRenderer;
 
@@ -69,6 +73,7 @@ class PDFFilePageSource final
 
   virtual bool IsNavigationAvailable() const override;
   virtual std::vector<NavigationEntry> GetNavigationEntries() const override;
+  std::optional<PageContentKey> GetPageContentKey(PageID) const override;
 
   virtual void PostCursorEvent(KneeboardViewID ctx, const CursorEvent&, PageID)
     override;
@@ -79,8 +84,19 @@ class PDFFilePageSource final
 
   task<void> RenderPage(RenderContext, PageID, PixelRect rect) override;
 
+  /// False until the document has been loaded
+  bool IsTextSearchAvailable() const;
+  /** Pages containing `query` as a phrase, in page order.
+   *
+   * The first search loads or builds the text index, which can take a
+   * while for a large document; don't call this from the UI thread.
+   */
+  std::vector<PageID> FindText(std::string_view query) const;
+
  private:
   winrt::apartment_context mUIThread;
+  std::shared_ptr<EventMailbox> mUIThreadMailbox {
+    EventMailbox::GetForCurrentThread()};
   // Useful because `wil::resume_foreground()` will *always* enqueue, never
   // execute immediately
   DispatcherQueue mUIThreadDispatcherQueue
@@ -95,8 +111,17 @@ class PDFFilePageSource final
   struct DocumentResources;
   std::shared_ptr<DocumentResources> mDocumentResources;
 
+  task<void> LoadDocument(std::weak_ptr<DocumentResources>);
   task<void> ReloadRenderer(std::weak_ptr<DocumentResources>);
   task<void> ReloadNavigation(std::weak_ptr<DocumentResources>);
+  void SetNavigation(
+    const std::shared_ptr<DocumentResources>&,
+    const std::vector<PDFNavigation::Bookmark>&,
+    const std::vector<std::vector<PDFNavigation::Link>>&);
+  /// Links for a single page, ahead of the rest of the document
+  OpenKneeboard::fire_and_forget LoadPageLinks(
+    std::weak_ptr<DocumentResources>,
+    PageID);
 
   fire_and_forget OnFileModified(const std::filesystem::path& path);
 
@@ -107,6 +132,21 @@ class PDFFilePageSource final
   void
   RenderOverDoodles(ID2D1DeviceContext*, PageID pageIndex, const D2D1_RECT_F&);
 
+  std::optional<PageIndex> GetPrerenderedPageIndex(PageID, const PixelSize&)
+    const;
+  bool CopyPrerenderedPage(RenderTarget*, PageID, const PixelSize&);
+  /// Render at a lower resolution, then scale up to fill `size`
+  void RenderPagePreview(RenderTarget*, PageID, const PixelSize&);
+  void SchedulePrerender(KneeboardView&, PageID, bool isPreview);
+  OpenKneeboard::fire_and_forget Prerender(std::weak_ptr<DocumentResources>);
+  /// Returns true if there's more work to do later
+  bool PrerenderSlice(const std::shared_ptr<DocumentResources>&);
+  /// Free prerendered pages once their views go idle or show something else
+  void StartExpiringPrerendered(const std::shared_ptr<DocumentResources>&);
+  OpenKneeboard::fire_and_forget ExpirePrerendered(
+    std::weak_ptr<DocumentResources>);
+  void RemoveDetachedPrerenderViews(const std::shared_ptr<DocumentResources>&);
+
   PageID GetPageIDForIndex(PageIndex index) const;
 };
 
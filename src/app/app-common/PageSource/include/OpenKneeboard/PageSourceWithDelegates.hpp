@@ -73,6 +73,7 @@ class PageSourceWithDelegates
 
   virtual bool IsNavigationAvailable() const override;
   virtual std::vector<NavigationEntry> GetNavigationEntries() const override;
+  std::optional<PageContentKey> GetPageContentKey(PageID) const override;
 
   [[nodiscard]]
   bool HasDeveloperTools(PageID) const override;
@@ -23,6 +23,7 @@
 #include <OpenKneeboard/FolderPageSource.hpp>
 
 #include <OpenKneeboard/dprint.hpp>
+#include <OpenKneeboard/task/when_all.hpp>
 
 using DCS = OpenKneeboard::DCSWorld;
 
@@ -60,6 +61,7 @@ std::string DCSAircraftTab::GetStaticGlyph() {
 }
 
 task<void> DCSAircraftTab::Reload() {
+  this->StartReload();
   mPaths = {};
   mAircraft = {};
   co_await this->SetDelegates({});
@@ -110,12 +112,18 @@ OpenKneeboard::fire_and_forget DCSAircraftTab::OnAPIEvent(
   if (mPaths == paths) {
     co_return;
   }
+  const auto stopToken = this->StartReload();
   mPaths = paths;
 
-  std::vector<std::shared_ptr<IPageSource>> delegates;
-  for (auto& path: paths) {
-    delegates.push_back(std::static_pointer_cast<IPageSource>(
-      co_await FolderPageSource::Create(mDXR, mKneeboard, path)));
+  auto delegates = co_await when_all(
+    paths.size(),
+    paths,
+    [this](const auto& path) -> task<std::shared_ptr<IPageSource>> {
+      co_return co_await FolderPageSource::Create(mDXR, mKneeboard, path);
+    });
+  if (stopToken.stop_requested()) {
+    co_await DisposeUnused(std::move(delegates));
+    co_return;
   }
   co_await this->SetDelegates(delegates);
 }
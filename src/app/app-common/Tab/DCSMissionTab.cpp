@@ -24,11 +24,25 @@
 #include <OpenKneeboard/FolderPageSource.hpp>
 
 #include <OpenKneeboard/dprint.hpp>
+#include <OpenKneeboard/task/resume_background.hpp>
+#include <OpenKneeboard/task/with_stop_token.hpp>
 
 using DCS = OpenKneeboard::DCSWorld;
 
 namespace OpenKneeboard {
 
+namespace {
+task<std::shared_ptr<DCSExtractedMission>> ExtractMission(
+  std::filesystem::path zipPath,
+  std::stop_token stopToken) {
+  // Skip it entirely if another mission or aircraft arrives first
+  if (!co_await resume_background(stopToken)) {
+    co_return nullptr;
+  }
+  co_return DCSExtractedMission::Get(zipPath);
+}
+}// namespace
+
 DCSMissionTab::DCSMissionTab(
   const audited_ptr<DXResources>& dxr,
   KneeboardState* kbs)
@@ -61,6 +75,7 @@ std::string DCSMissionTab::GetStaticGlyph() {
 }
 
 task<void> DCSMissionTab::Reload() {
+  const auto stopToken = this->StartReload();
   if (mMission.empty()) {
     co_return;
   }
@@ -70,7 +85,14 @@ task<void> DCSMissionTab::Reload() {
   co_await this->SetDelegates({});
 
   if ((!mExtracted) || mExtracted->GetZipPath() != mMission) {
-    mExtracted = DCSExtractedMission::Get(mMission);
+    // Extraction can't be interrupted, but a newer reload shouldn't wait for
+    // it; if it completes, it's cached for next time
+    const auto extracted = co_await with_stop_token(
+      stopToken, ExtractMission(mMission, stopToken));
+    if (!(extracted && *extracted)) {
+      co_return;
+    }
+    mExtracted = *extracted;
   }
 
   mDebugInformation = to_utf8(mMission) + "\n";
@@ -88,6 +110,10 @@ task<void> DCSMissionTab::Reload() {
   std::vector<std::shared_ptr<IPageSource>> sources;
 
   for (const auto& path: paths) {
+    if (stopToken.stop_requested()) {
+      co_await DisposeUnused(std::move(sources));
+      co_return;
+    }
     if (std::filesystem::exists(root / path)) {
       sources.push_back(
         co_await FolderPageSource::Create(mDXR, mKneeboard, root / path));
@@ -101,6 +127,11 @@ task<void> DCSMissionTab::Reload() {
     mDebugInformation.pop_back();
   }
 
+  if (stopToken.stop_requested()) {
+    co_await DisposeUnused(std::move(sources));
+    co_return;
+  }
+
   dprint("Mission tab: " + mDebugInformation);
   evDebugInformationHasChanged.Emit(mDebugInformation);
   co_await this->SetDelegates(sources);
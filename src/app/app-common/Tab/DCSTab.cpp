@@ -20,9 +20,11 @@
 #include <OpenKneeboard/APIEvent.hpp>
 #include <OpenKneeboard/DCSTab.hpp>
 #include <OpenKneeboard/DCSWorld.hpp>
+#include <OpenKneeboard/IHasDisposeAsync.hpp>
 #include <OpenKneeboard/KneeboardState.hpp>
 
 #include <OpenKneeboard/dprint.hpp>
+#include <OpenKneeboard/task/when_all.hpp>
 
 using DCS = OpenKneeboard::DCSWorld;
 
@@ -75,4 +77,21 @@ std::filesystem::path DCSTab::ToAbsolutePath(
   return maybeRelative;
 }
 
+std::stop_token DCSTab::StartReload() {
+  mReloadStopSource.request_stop();
+  mReloadStopSource = {};
+  return mReloadStopSource.get_token();
+}
+
+task<void> DCSTab::DisposeUnused(
+  std::vector<std::shared_ptr<IPageSource>> sources) {
+  std::vector<task<void>> disposers;
+  for (const auto& source: sources) {
+    if (auto disposable = std::dynamic_pointer_cast<IHasDisposeAsync>(source)) {
+      disposers.push_back(disposable->DisposeAsync());
+    }
+  }
+  co_await when_all(std::move(disposers));
+}
+
 }// namespace OpenKneeboard
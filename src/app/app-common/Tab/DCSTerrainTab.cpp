@@ -64,6 +64,7 @@ std::string DCSTerrainTab::GetDebugInformation() const {
 }
 
 task<void> DCSTerrainTab::Reload() {
+  this->StartReload();
   mPaths = {};
   mTerrain = {};
   co_await this->SetDelegates({});
@@ -126,13 +127,21 @@ OpenKneeboard::fire_and_forget DCSTerrainTab::OnAPIEvent(
   if (paths == mPaths) {
     co_return;
   }
+  const auto stopToken = this->StartReload();
   mPaths = paths;
 
   std::vector<std::shared_ptr<IPageSource>> delegates;
   for (auto& path: paths) {
+    if (stopToken.stop_requested()) {
+      break;
+    }
     delegates.push_back(std::static_pointer_cast<IPageSource>(
       co_await FolderPageSource::Create(mDXR, mKneeboard, path)));
   }
+  if (stopToken.stop_requested()) {
+    co_await DisposeUnused(std::move(delegates));
+    co_return;
+  }
   co_await this->SetDelegates(delegates);
 }
 
@@ -113,14 +113,25 @@ task<void> EndlessNotebookTab::SetPath(std::filesystem::path rawPath) {
     co_return;
   }
   mPath = path;
+  mLoadStopSource.request_stop();
+  mLoadStopSource = {};
   if (path.empty()) {
     co_return;
   }
+  const auto stopToken = mLoadStopSource.get_token();
 
-  auto delegate = co_await FilePageSource::Create(mDXR, mKneeboard, mPath);
+  auto delegate = co_await FilePageSource::Create(mDXR, mKneeboard, path);
   if (!delegate) {
     co_return;
   }
+  if (stopToken.stop_requested()) {
+    // Superseded by a later `SetPath()` or `Reload()`
+    if (auto disposable
+        = std::dynamic_pointer_cast<IHasDisposeAsync>(delegate)) {
+      co_await disposable->DisposeAsync();
+    }
+    co_return;
+  }
 
   mSource = nullptr;
   mSource = delegate;
@@ -18,16 +18,32 @@
  * USA.
  */
 
+#include <OpenKneeboard/Filesystem.hpp>
 #include <OpenKneeboard/NavigationTab.hpp>
+#include <OpenKneeboard/SHM.hpp>
 
 #include <OpenKneeboard/config.hpp>
 #include <OpenKneeboard/dprint.hpp>
 #include <OpenKneeboard/scope_exit.hpp>
 
+#include <winrt/Microsoft.UI.Dispatching.h>
+
+#include <wil/cppwinrt.h>
+
+#include <DirectXColors.h>
+
 #include <cstring>
 
+#include <wil/cppwinrt_helpers.h>
+
 namespace OpenKneeboard {
 
+// Shared by all navigation tabs; thread-safe
+static ThumbnailCache& GetThumbnailCache() {
+  static ThumbnailCache sCache {Filesystem::GetCacheDirectory() / "Thumbnails"};
+  return sCache;
+}
+
 bool NavigationTab::Button::operator==(
   const NavigationTab::Button& other) const noexcept {
   return std::memcmp(&mRect, &other.mRect, sizeof(mRect)) == 0;
@@ -151,6 +167,13 @@ NavigationTab::NavigationTab(
         this->evPageChangeRequestedEvent.Emit(ctx, button.mPageID);
       });
   }
+
+  // Layouts include preview rects sized for the root tab's pages
+  AddEventListener(rootTab->evContentChangedEvent, [this] {
+    mLayouts.clear();
+    // Also part of the preview cache key, so this redraws the previews
+    ++mThumbnailGeneration;
+  });
 }
 
 NavigationTab::~NavigationTab() {
@@ -205,22 +228,24 @@ task<void> NavigationTab::RenderPage(
   PageID pageID,
   PixelRect canvasRect) {
   OPENKNEEBOARD_TraceLoggingScope("NavigationTab::RenderPage()");
+  if (!mButtonTrackers.contains(pageID)) {
+    co_return;
+  }
   auto ctx = rc.d2d();
 
   const auto scale = canvasRect.Height<float>() / mPreferredSize.mHeight;
 
   ctx->FillRectangle(canvasRect, mBackgroundBrush.get());
 
-  this->CalculatePreviewMetrics(pageID);
+  const auto& layout = this->GetLayout(pageID);
+  const auto& buttons = layout.mButtons;
 
   const auto origin = canvasRect.TopLeft();
   const auto pageTransform = D2D1::Matrix3x2F::Translation(origin.mX, origin.mY)
     * D2D1::Matrix3x2F::Scale({scale, scale}, origin);
   ctx->SetTransform(pageTransform);
 
-  const auto [hoverButton, buttons] = mButtonTrackers.at(pageID)->GetState();
-
-  const auto& previewMetrics = mPreviewMetrics.at(pageID);
+  const auto hoverButton = mButtonTrackers.at(pageID)->GetHoverButton();
 
   for (int i = 0; i < buttons.size(); ++i) {
     const auto& button = buttons.at(i);
@@ -228,7 +253,7 @@ task<void> NavigationTab::RenderPage(
 
     if (button == hoverButton) {
       ctx->FillRectangle(rect, mHighlightBrush.get());
-      ctx->FillRectangle(previewMetrics.mRects.at(i), mBackgroundBrush.get());
+      ctx->FillRectangle(layout.mPreviewRects.at(i), mBackgroundBrush.get());
     } else {
       ctx->FillRectangle(rect, mInactiveBrush.get());
     }
@@ -244,7 +269,7 @@ task<void> NavigationTab::RenderPage(
 
   co_await mPreviewCache.at(rtid)->Render(
     canvasRect,
-    pageID.GetTemporaryValue(),
+    (pageID.GetTemporaryValue() << 32) ^ mThumbnailGeneration,
     rc.GetRenderTarget(),
     std::bind_front(&NavigationTab::RenderPreviewLayer, this, pageID));
 
@@ -252,64 +277,44 @@ task<void> NavigationTab::RenderPage(
 
   ctx->SetTransform(pageTransform);
 
-  std::vector<float> columnPreviewRightEdge(mRenderColumns);
   for (auto i = 0; i < buttons.size(); ++i) {
-    const auto& button = buttons.at(i);
-    const auto& previewRect = previewMetrics.mRects.at(i);
-    auto& rightEdge = columnPreviewRightEdge.at(button.mRenderColumn);
-    if (previewRect.Right() > rightEdge) {
-      rightEdge = previewRect.Right();
-    }
-    if (button == hoverButton) {
-      ctx->DrawRectangle(
-        previewRect, mHighlightBrush.get(), previewMetrics.mStroke);
+    const auto& previewRect = layout.mPreviewRects.at(i);
+    if (buttons.at(i) == hoverButton) {
+      ctx->DrawRectangle(previewRect, mHighlightBrush.get(), layout.mStroke);
     } else {
       ctx->DrawRectangle(
-        previewRect, mPreviewOutlineBrush.get(), previewMetrics.mStroke / 2);
+        previewRect, mPreviewOutlineBrush.get(), layout.mStroke / 2);
     }
   }
 
-  for (const auto& button: buttons) {
-    auto rect = button.mRect;
-    rect.left
-      = columnPreviewRightEdge.at(button.mRenderColumn) + previewMetrics.mBleed;
-    ctx->DrawTextW(
-      button.mName.data(),
-      static_cast<UINT32>(button.mName.size()),
-      mTextFormat.get(),
-      rect,
+  for (auto i = 0; i < buttons.size(); ++i) {
+    ctx->DrawTextLayout(
+      layout.mLabelOrigins.at(i),
+      layout.mLabels.at(i).get(),
       mTextBrush.get(),
       D2D1_DRAW_TEXT_OPTIONS_NO_SNAP | D2D1_DRAW_TEXT_OPTIONS_CLIP);
   }
 
-  auto pageIt = std::ranges::find(mPageIDs, pageID);
-  if (pageIt == mPageIDs.end()) {
-    co_return;
+  if (layout.mPageNumber) {
+    ctx->DrawTextLayout(
+      {0.0f, 0.0f},
+      layout.mPageNumber.get(),
+      mTextBrush.get(),
+      D2D1_DRAW_TEXT_OPTIONS_NO_SNAP);
   }
-  const auto pageIndex = static_cast<PageIndex>(pageIt - mPageIDs.begin());
-
-  auto message = winrt::to_hstring(
-    std::format(_("Page {} of {}"), pageIndex + 1, this->GetPageCount()));
-  ctx->DrawTextW(
-    message.data(),
-    static_cast<UINT32>(message.size()),
-    mPageNumberTextFormat.get(),
-    {0.0f,
-     0.0f,
-     static_cast<FLOAT>(mPreferredSize.mWidth),
-     static_cast<FLOAT>(mPreferredSize.mHeight) - previewMetrics.mBleed},
-    mTextBrush.get(),
-    D2D1_DRAW_TEXT_OPTIONS_NO_SNAP);
 }
 
-void NavigationTab::CalculatePreviewMetrics(PageID pageID) {
-  if (mPreviewMetrics.contains(pageID)) {
-    return;
+const NavigationTab::PageLayout& NavigationTab::GetLayout(PageID pageID) {
+  if (const auto it = mLayouts.find(pageID); it != mLayouts.end()) {
+    return it->second;
   }
-  PreviewMetrics m {};
-  const auto buttons = mButtonTrackers.at(pageID)->GetButtons();
+  OPENKNEEBOARD_TraceLoggingScope("NavigationTab::GetLayout()");
 
-  m.mRects.resize(buttons.size());
+  PageLayout m {};
+  m.mButtons = *mButtonTrackers.at(pageID)->GetButtons();
+  const auto& buttons = m.mButtons;
+
+  m.mPreviewRects.resize(buttons.size());
   const auto& first = buttons.front();
 
   // just a little less than the padding
@@ -317,16 +322,21 @@ void NavigationTab::CalculatePreviewMetrics(PageID pageID) {
   // arbitrary LGTM value
   m.mStroke = m.mBleed * 0.3f;
 
+  std::vector<float> columnPreviewRightEdge(mRenderColumns);
   for (auto i = 0; i < buttons.size(); ++i) {
     const auto& button = buttons.at(i);
 
     const auto height
       = (button.mRect.bottom - button.mRect.top) + (2 * m.mBleed);
+    // If the page isn't loaded yet, the layout is rebuilt when it is, as
+    // that changes the root tab's content
+    const auto preferredSize = mRootTab->GetPreferredSize(button.mPageID);
     const auto nativeSize
-      = mRootTab->GetPreferredSize(button.mPageID)->mPixelSize;
+      = preferredSize ? preferredSize->mPixelSize : ErrorPixelSize;
     const auto contentScale = height / nativeSize.mHeight;
 
-    m.mRects.at(i) = PixelRect {
+    auto& previewRect = m.mPreviewRects.at(i);
+    previewRect = PixelRect {
       Geometry2D::Point<float>(
         button.mRect.left + m.mBleed, button.mRect.top - m.mBleed)
         .Rounded<uint32_t>(),
@@ -334,9 +344,45 @@ void NavigationTab::CalculatePreviewMetrics(PageID pageID) {
         static_cast<uint32_t>(nativeSize.mWidth * contentScale), height)
         .Rounded<uint32_t>(),
     };
+
+    auto& rightEdge = columnPreviewRightEdge.at(button.mRenderColumn);
+    if (previewRect.Right() > rightEdge) {
+      rightEdge = previewRect.Right();
+    }
+  }
+
+  // Shaping is by far the most expensive part of drawing text, so do it once
+  auto dwf = mDXR->mDWriteFactory;
+  for (const auto& button: buttons) {
+    auto rect = button.mRect;
+    rect.left = columnPreviewRightEdge.at(button.mRenderColumn) + m.mBleed;
+    winrt::com_ptr<IDWriteTextLayout> label;
+    winrt::check_hresult(dwf->CreateTextLayout(
+      button.mName.data(),
+      static_cast<UINT32>(button.mName.size()),
+      mTextFormat.get(),
+      std::max(0.0f, rect.right - rect.left),
+      rect.bottom - rect.top,
+      label.put()));
+    m.mLabelOrigins.push_back({rect.left, rect.top});
+    m.mLabels.push_back(std::move(label));
   }
 
-  mPreviewMetrics.emplace(pageID, std::move(m));
+  if (const auto pageIt = std::ranges::find(mPageIDs, pageID);
+      pageIt != mPageIDs.end()) {
+    const auto pageIndex = static_cast<PageIndex>(pageIt - mPageIDs.begin());
+    const auto message = winrt::to_hstring(
+      std::format(_("Page {} of {}"), pageIndex + 1, this->GetPageCount()));
+    winrt::check_hresult(dwf->CreateTextLayout(
+      message.data(),
+      static_cast<UINT32>(message.size()),
+      mPageNumberTextFormat.get(),
+      static_cast<FLOAT>(mPreferredSize.mWidth),
+      static_cast<FLOAT>(mPreferredSize.mHeight) - m.mBleed,
+      m.mPageNumber.put()));
+  }
+
+  return mLayouts.emplace(pageID, std::move(m)).first->second;
 }
 
 task<void> NavigationTab::RenderPreviewLayer(
@@ -344,8 +390,8 @@ task<void> NavigationTab::RenderPreviewLayer(
   RenderTarget* rt,
   const PixelSize& size) {
   OPENKNEEBOARD_TraceLoggingScope("NavigationTab::RenderPreviewLayer()");
-  const auto& m = mPreviewMetrics.at(pageID);
-  const auto buttons = mButtonTrackers.at(pageID)->GetButtons();
+  const auto& m = this->GetLayout(pageID);
+  const auto& buttons = m.mButtons;
 
   const auto scale
     = size.Height<float>() / this->GetPreferredSize(pageID)->mPixelSize.mHeight;
@@ -354,13 +400,253 @@ task<void> NavigationTab::RenderPreviewLayer(
 
   for (auto i = 0; i < buttons.size(); ++i) {
     const auto& button = buttons.at(i);
-    const auto& rect = m.mRects.at(i);
-    const auto scaled = rect.StaticCast<float>() * scale;
-    co_await mRootTab->RenderPage(
-      rc, button.mPageID, scaled.Rounded<uint32_t>());
+    const auto& rect = m.mPreviewRects.at(i);
+    const auto scaled
+      = (rect.StaticCast<float>() * scale).Rounded<uint32_t>();
+
+    using State = Thumbnail::State;
+    const auto key = this->GetThumbnailKey(button.mPageID, scaled.mSize);
+    const auto state
+      = key ? this->GetThumbnail(button.mPageID, *key).mState : State::Failed;
+    switch (state) {
+      case State::Queued:
+      case State::Loading: {
+        auto ctx = rt->d2d();
+        ctx->FillRectangle(scaled, mInactiveBrush.get());
+        break;
+      }
+      case State::Ready: {
+        auto ctx = rt->d2d();
+        ctx->DrawBitmap(
+          mThumbnails.at(button.mPageID).mBitmap.get(),
+          scaled,
+          1.0f,
+          D2D1_BITMAP_INTERPOLATION_MODE_LINEAR);
+        break;
+      }
+      case State::Failed:
+        co_await mRootTab->RenderPage(rc, button.mPageID, scaled);
+        break;
+    }
   }
 }
 
+std::optional<ThumbnailCache::Key> NavigationTab::GetThumbnailKey(
+  PageID pageID,
+  const PixelSize& size) const {
+  if (size.IsEmpty()) {
+    return std::nullopt;
+  }
+  // Doodles aren't part of the page content
+  const auto withCursorEvents
+    = std::dynamic_pointer_cast<IPageSourceWithCursorEvents>(mRootTab);
+  if (withCursorEvents && withCursorEvents->CanClearUserInput(pageID)) {
+    return std::nullopt;
+  }
+
+  const auto withNavigation
+    = std::dynamic_pointer_cast<IPageSourceWithNavigation>(mRootTab);
+  if (!withNavigation) {
+    return std::nullopt;
+  }
+  const auto content = withNavigation->GetPageContentKey(pageID);
+  if (!content) {
+    return std::nullopt;
+  }
+  return ThumbnailCache::Key {
+    .mContentHash = content->mContentHash,
+    .mPage = content->mPageIndex,
+    .mSize = {size.mWidth, size.mHeight},
+  };
+}
+
+const NavigationTab::Thumbnail& NavigationTab::GetThumbnail(
+  PageID pageID,
+  const ThumbnailCache::Key& key) {
+  auto [it, inserted] = mThumbnails.try_emplace(pageID);
+  auto& thumbnail = it->second;
+  if (!inserted && thumbnail.mKey == key) {
+    return thumbnail;
+  }
+
+  // New, or the content or size changed
+  thumbnail = {.mKey = key};
+  mThumbnailQueue.push_back(pageID);
+  if (mThumbnailWorkers < MaxThumbnailWorkers) {
+    ++mThumbnailWorkers;
+    this->ThumbnailWorker(weak_from_this());
+  }
+  return thumbnail;
+}
+
+OpenKneeboard::fire_and_forget NavigationTab::ThumbnailWorker(
+  std::weak_ptr<NavigationTab> weak) {
+  auto dq = mUIThreadDispatcherQueue;
+  auto& cache = GetThumbnailCache();
+  while (true) {
+    PageID pageID {nullptr};
+    ThumbnailCache::Key key;
+    {
+      auto self = weak.lock();
+      if (!self) {
+        co_return;
+      }
+      auto& queue = self->mThumbnailQueue;
+      while (!queue.empty()) {
+        pageID = queue.front();
+        queue.pop_front();
+        // Skip pages that were requeued with a new key
+        auto& thumbnail = self->mThumbnails.at(pageID);
+        if (thumbnail.mState == Thumbnail::State::Queued) {
+          thumbnail.mState = Thumbnail::State::Loading;
+          key = thumbnail.mKey;
+          break;
+        }
+        pageID = PageID {nullptr};
+      }
+      if (!pageID) {
+        --self->mThumbnailWorkers;
+        co_return;
+      }
+    }
+
+    co_await winrt::resume_background();
+    auto thumbnail = cache.Load(key);
+    const auto fromCache = thumbnail.has_value();
+
+    // Don't delay anything more important
+    co_await wil::resume_foreground(
+      dq, winrt::Microsoft::UI::Dispatching::DispatcherQueuePriority::Low);
+    {
+      auto self = weak.lock();
+      if (!self) {
+        co_return;
+      }
+      if (!thumbnail) {
+        thumbnail = co_await self->RenderThumbnail(
+          pageID, {key.mSize.mWidth, key.mSize.mHeight});
+      }
+      self->SetThumbnail(pageID, key, thumbnail);
+    }
+
+    if (thumbnail && !fromCache) {
+      co_await winrt::resume_background();
+      cache.Store(key, *thumbnail);
+      co_await wil::resume_foreground(
+        dq, winrt::Microsoft::UI::Dispatching::DispatcherQueuePriority::Low);
+    }
+  }
+}
+
+task<std::optional<ThumbnailCache::Thumbnail>> NavigationTab::RenderThumbnail(
+  PageID pageID,
+  PixelSize size) {
+  OPENKNEEBOARD_TraceLoggingScope("NavigationTab::RenderThumbnail()");
+  const auto rtSize = mThumbnailRenderTarget
+    ? mThumbnailRenderTarget->GetDimensions()
+    : PixelSize {};
+  if (rtSize.mWidth < size.mWidth || rtSize.mHeight < size.mHeight) {
+    const D3D11_TEXTURE2D_DESC desc {
+      .Width = std::max(rtSize.mWidth, size.mWidth),
+      .Height = std::max(rtSize.mHeight, size.mHeight),
+      .MipLevels = 1,
+      .ArraySize = 1,
+      .Format = SHM::SHARED_TEXTURE_PIXEL_FORMAT,
+      .SampleDesc = {1, 0},
+      .Usage = D3D11_USAGE_DEFAULT,
+      .BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET,
+    };
+    mThumbnailTexture = nullptr;
+    if (FAILED(mDXR->mD3D11Device->CreateTexture2D(
+          &desc, nullptr, mThumbnailTexture.put()))) {
+      mThumbnailRenderTarget = nullptr;
+      co_return std::nullopt;
+    }
+    mThumbnailRenderTarget = RenderTarget::Create(mDXR, mThumbnailTexture);
+  }
+
+  {
+    auto d3d = mThumbnailRenderTarget->d3d();
+    mDXR->mD3D11ImmediateContext->ClearRenderTargetView(
+      d3d.rtv(), DirectX::Colors::Transparent);
+  }
+  co_await mRootTab->RenderPage(
+    RenderContext {mThumbnailRenderTarget.get(), nullptr},
+    pageID,
+    {{0, 0}, size});
+
+  const D3D11_TEXTURE2D_DESC stagingDesc {
+    .Width = size.mWidth,
+    .Height = size.mHeight,
+    .MipLevels = 1,
+    .ArraySize = 1,
+    .Format = SHM::SHARED_TEXTURE_PIXEL_FORMAT,
+    .SampleDesc = {1, 0},
+    .Usage = D3D11_USAGE_STAGING,
+    .CPUAccessFlags = D3D11_CPU_ACCESS_READ,
+  };
+  winrt::com_ptr<ID3D11Texture2D> staging;
+  if (FAILED(mDXR->mD3D11Device->CreateTexture2D(
+        &stagingDesc, nullptr, staging.put()))) {
+    co_return std::nullopt;
+  }
+
+  ThumbnailCache::Thumbnail ret {.mSize = {size.mWidth, size.mHeight}};
+  ret.mPixels.resize(std::size_t {size.mWidth} * size.mHeight * 4);
+  {
+    const std::unique_lock lock(*mDXR);
+    auto ctx = mDXR->mD3D11ImmediateContext.get();
+    const D3D11_BOX box {0, 0, 0, size.mWidth, size.mHeight, 1};
+    ctx->CopySubresourceRegion(
+      staging.get(), 0, 0, 0, 0, mThumbnailTexture.get(), 0, &box);
+    D3D11_MAPPED_SUBRESOURCE mapped {};
+    if (FAILED(ctx->Map(staging.get(), 0, D3D11_MAP_READ, 0, &mapped))) {
+      co_return std::nullopt;
+    }
+    const auto rowSize = std::size_t {size.mWidth} * 4;
+    for (uint32_t row = 0; row < size.mHeight; ++row) {
+      std::memcpy(
+        ret.mPixels.data() + (row * rowSize),
+        static_cast<const std::byte*>(mapped.pData) + (row * mapped.RowPitch),
+        rowSize);
+    }
+    ctx->Unmap(staging.get(), 0);
+  }
+  co_return ret;
+}
+
+void NavigationTab::SetThumbnail(
+  PageID pageID,
+  const ThumbnailCache::Key& key,
+  const std::optional<ThumbnailCache::Thumbnail>& pixels) {
+  const auto it = mThumbnails.find(pageID);
+  if (it == mThumbnails.end() || it->second.mKey != key) {
+    // Replaced while we were working on it
+    return;
+  }
+  auto& thumbnail = it->second;
+
+  if (pixels) {
+    const std::unique_lock lock(*mDXR);
+    mDXR->mD2DDeviceContext->CreateBitmap(
+      D2D1_SIZE_U {pixels->mSize.mWidth, pixels->mSize.mHeight},
+      pixels->mPixels.data(),
+      pixels->mSize.mWidth * 4,
+      D2D1_BITMAP_PROPERTIES {
+        .pixelFormat = {
+          .format = SHM::SHARED_TEXTURE_PIXEL_FORMAT,
+          .alphaMode = D2D1_ALPHA_MODE_PREMULTIPLIED,
+        },
+      },
+      thumbnail.mBitmap.put());
+  }
+  thumbnail.mState
+    = thumbnail.mBitmap ? Thumbnail::State::Ready : Thumbnail::State::Failed;
+
+  ++mThumbnailGeneration;
+  evNeedsRepaintEvent.Emit();
+}
+
 task<void> NavigationTab::Reload() {
   co_return;
 }
@@ -19,6 +19,7 @@
  */
 #include <OpenKneeboard/ChromiumPageSource.hpp>
 #include <OpenKneeboard/FilePageSource.hpp>
+#include <OpenKneeboard/IHasDisposeAsync.hpp>
 #include <OpenKneeboard/ImageFilePageSource.hpp>
 #include <OpenKneeboard/PDFFilePageSource.hpp>
 #include <OpenKneeboard/PlainTextFilePageSource.hpp>
@@ -120,10 +121,22 @@ task<void> SingleFileTab::SetPath(std::filesystem::path rawPath) {
   }
   mPath = path;
 
-  auto delegate = co_await FilePageSource::Create(mDXR, mKneeboard, mPath);
+  mLoadStopSource.request_stop();
+  mLoadStopSource = {};
+  const auto stopToken = mLoadStopSource.get_token();
+
+  auto delegate = co_await FilePageSource::Create(mDXR, mKneeboard, path);
   if (!delegate) {
     co_return;
   }
+  if (stopToken.stop_requested()) {
+    // Superseded by a later `SetPath()` or `Reload()`
+    if (auto disposable
+        = std::dynamic_pointer_cast<IHasDisposeAsync>(delegate)) {
+      co_await disposable->DisposeAsync();
+    }
+    co_return;
+  }
 
   if (std::dynamic_pointer_cast<PDFFilePageSource>(delegate)) {
     mKind = Kind::PDFFile;
@@ -21,12 +21,16 @@
 
 #include <OpenKneeboard/DCSWorld.hpp>
 #include <OpenKneeboard/Events.hpp>
+#include <OpenKneeboard/IPageSource.hpp>
 #include <OpenKneeboard/ITab.hpp>
 #include <OpenKneeboard/KneeboardState.hpp>
 
 #include <OpenKneeboard/utf8.hpp>
 
 #include <filesystem>
+#include <memory>
+#include <stop_token>
+#include <vector>
 
 namespace OpenKneeboard {
 
@@ -53,10 +57,23 @@ class DCSTab : public virtual ITab, public virtual EventReceiver {
 
   std::filesystem::path ToAbsolutePath(const std::filesystem::path&);
 
+  /** Stop any reload that's still in progress, and get a token for a new one.
+   *
+   * DCS can change the mission, aircraft, or terrain again before we've
+   * finished loading the previous one; the older load must not replace the
+   * newer one's content, and shouldn't keep competing with it.
+   */
+  std::stop_token StartReload();
+
+  /// Dispose of content from a reload that was stopped before it was used
+  [[nodiscard]]
+  static task<void> DisposeUnused(std::vector<std::shared_ptr<IPageSource>>);
+
  private:
   std::filesystem::path mInstallPath;
   std::filesystem::path mSavedGamesPath;
   EventHandlerToken mAPIEventToken;
+  std::stop_source mReloadStopSource;
 
   void OnAPIEvent(const APIEvent&);
 };
@@ -33,6 +33,7 @@
 #include <OpenKneeboard/task.hpp>
 
 #include <filesystem>
+#include <stop_token>
 
 namespace OpenKneeboard {
 
@@ -99,6 +100,8 @@ class EndlessNotebookTab final
   KneeboardState* mKneeboard;
 
   std::filesystem::path mPath;
+  // Stopped when a later `SetPath()` or `Reload()` supersedes a load
+  std::stop_source mLoadStopSource;
 
   std::shared_ptr<IPageSource> mSource;
   PageID mSourcePageID;
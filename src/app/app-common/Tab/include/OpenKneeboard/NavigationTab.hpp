@@ -28,17 +28,23 @@
 #include <OpenKneeboard/Events.hpp>
 #include <OpenKneeboard/IPageSourceWithCursorEvents.hpp>
 #include <OpenKneeboard/IPageSourceWithNavigation.hpp>
+#include <OpenKneeboard/ThumbnailCache.hpp>
 
 #include <OpenKneeboard/audited_ptr.hpp>
 
+#include <shims/winrt/base.h>
+
+#include <deque>
 #include <limits>
 #include <memory>
 
 namespace OpenKneeboard {
 
-class NavigationTab final : public TabBase,
-                            public IPageSourceWithCursorEvents,
-                            public virtual EventReceiver {
+class NavigationTab final
+  : public TabBase,
+    public IPageSourceWithCursorEvents,
+    public virtual EventReceiver,
+    public std::enable_shared_from_this<NavigationTab> {
  public:
   using Entry = NavigationEntry;
 
@@ -86,12 +92,23 @@ class NavigationTab final : public TabBase,
   using ButtonTracker = CursorClickableRegions<Button>;
   std::vector<PageID> mPageIDs;
   std::unordered_map<PageID, std::shared_ptr<ButtonTracker>> mButtonTrackers;
-  struct PreviewMetrics {
+  /** Everything about a page that doesn't change between frames.
+   *
+   * Positions are in `mPreferredSize` coordinates, so this doesn't depend on
+   * the render size.
+   */
+  struct PageLayout {
+    std::vector<Button> mButtons;
     float mBleed;
     float mStroke;
-    std::vector<PixelRect> mRects;
+    // One per button
+    std::vector<PixelRect> mPreviewRects;
+    std::vector<D2D1_POINT_2F> mLabelOrigins;
+    std::vector<winrt::com_ptr<IDWriteTextLayout>> mLabels;
+
+    winrt::com_ptr<IDWriteTextLayout> mPageNumber;
   };
-  std::unordered_map<PageID, PreviewMetrics> mPreviewMetrics;
+  std::unordered_map<PageID, PageLayout> mLayouts;
 
   winrt::com_ptr<IDWriteTextFormat> mTextFormat;
   winrt::com_ptr<IDWriteTextFormat> mPageNumberTextFormat;
@@ -101,7 +118,51 @@ class NavigationTab final : public TabBase,
   winrt::com_ptr<ID2D1SolidColorBrush> mPreviewOutlineBrush;
   winrt::com_ptr<ID2D1SolidColorBrush> mTextBrush;
 
-  void CalculatePreviewMetrics(PageID);
+  struct Thumbnail {
+    enum class State {
+      Queued,
+      Loading,
+      Ready,
+      // Rendered live instead
+      Failed,
+    };
+    ThumbnailCache::Key mKey;
+    State mState {State::Queued};
+    winrt::com_ptr<ID2D1Bitmap> mBitmap;
+  };
+  // By root tab page
+  std::unordered_map<PageID, Thumbnail> mThumbnails;
+  std::deque<PageID> mThumbnailQueue;
+  std::size_t mThumbnailWorkers {0};
+  // Included in the `mPreviewCache` key, so previews are redrawn as their
+  // thumbnails become ready
+  uint64_t mThumbnailGeneration {0};
+  // Grown as needed; shared by all thumbnail renders, so the root tab
+  // doesn't cache a layer for each one
+  std::shared_ptr<RenderTarget> mThumbnailRenderTarget;
+  winrt::com_ptr<ID3D11Texture2D> mThumbnailTexture;
+  DispatcherQueue mUIThreadDispatcherQueue
+    = DispatcherQueue::GetForCurrentThread();
+
+  // Limits concurrent disk reads; renders are on the UI thread, so are
+  // always one-at-a-time
+  static constexpr std::size_t MaxThumbnailWorkers = 2;
+
+  std::optional<ThumbnailCache::Key> GetThumbnailKey(
+    PageID,
+    const PixelSize&) const;
+  /// Queues the thumbnail if it isn't already loaded or loading
+  const Thumbnail& GetThumbnail(PageID, const ThumbnailCache::Key&);
+  OpenKneeboard::fire_and_forget ThumbnailWorker(std::weak_ptr<NavigationTab>);
+  task<std::optional<ThumbnailCache::Thumbnail>> RenderThumbnail(
+    PageID,
+    PixelSize);
+  void SetThumbnail(
+    PageID,
+    const ThumbnailCache::Key&,
+    const std::optional<ThumbnailCache::Thumbnail>&);
+
+  const PageLayout& GetLayout(PageID);
   // PageID is first for `std::bind_front()`
   [[nodiscard]] task<void>
   RenderPreviewLayer(PageID, RenderTarget*, const PixelSize& size);
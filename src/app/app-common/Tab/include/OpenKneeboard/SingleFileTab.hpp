@@ -29,6 +29,7 @@
 #include <OpenKneeboard/audited_ptr.hpp>
 
 #include <filesystem>
+#include <stop_token>
 
 namespace OpenKneeboard {
 
@@ -85,6 +86,8 @@ class SingleFileTab final : public TabBase,
 
   Kind mKind = Kind::Unknown;
   std::filesystem::path mPath;
+  // Stopped when a later `SetPath()` or `Reload()` supersedes a load
+  std::stop_source mLoadStopSource;
 };
 
 }// namespace OpenKneeboard
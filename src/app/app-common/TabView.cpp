@@ -43,8 +43,9 @@ TabView::TabView(
   }
 
   AddEventListener(tab->evNeedsRepaintEvent, this->evNeedsRepaintEvent);
+  AddEventListener(tab->evContentChangedEvent, mTabContentChangedEvent);
   AddEventListener(
-    tab->evContentChangedEvent,
+    mTabContentChangedEvent,
     std::bind_front(&TabView::OnTabContentChanged, this));
   AddEventListener(
     tab->evPageAppendedEvent,
@@ -82,7 +83,15 @@ PageID TabView::GetPageID() const {
     return *mActiveSubTabPageID;
   }
   if (mode == TabMode::Normal && mRootTabPage) {
-    return mRootTabPage->mID;
+    if (!mTabContentChangedEvent.IsPending()) {
+      return mRootTabPage->mID;
+    }
+    // We can't catch up from a const method, so if the page has been removed
+    // since, return the page that `OnTabContentChanged()` will switch to
+    const auto tab = mRootTab.lock();
+    if (tab && std::ranges::contains(tab->GetPageIDs(), mRootTabPage->mID)) {
+      return mRootTabPage->mID;
+    }
   }
 
   auto tab = this->GetTab().lock();
@@ -109,6 +118,9 @@ std::vector<PageID> TabView::GetPageIDs() const {
 }
 
 void TabView::PostCursorEvent(const CursorEvent& ev) {
+  // Otherwise, the event could go to a page that's just been removed
+  this->CatchUpWithTabContent();
+
   auto receiver = std::dynamic_pointer_cast<IPageSourceWithCursorEvents>(
     this->GetTab().lock());
   if (!receiver) {
@@ -195,12 +207,23 @@ void TabView::OnTabContentChanged() {
   }
 }
 
+void TabView::CatchUpWithTabContent() {
+  if (mTabContentChangedEvent.TakePending()) {
+    this->OnTabContentChanged();
+  }
+}
+
 void TabView::OnTabPageAppended(SuggestedPageAppendAction suggestedAction) {
   auto tab = mRootTab.lock();
   if (!tab) {
     return;
   }
 
+  // Appends aren't coalesced, so catch up with any content changes that are
+  // waiting for the next frame; otherwise, `mRootTabPage->mIndex` may be
+  // stale
+  this->CatchUpWithTabContent();
+
   auto pages = tab->GetPageIDs();
   if (pages.size() < 2 || !mRootTabPage) {
     mRootTabPage = {pages.front(), 0};
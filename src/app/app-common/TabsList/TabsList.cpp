@@ -30,6 +30,7 @@
 #include <OpenKneeboard/TabsList.hpp>
 
 #include <OpenKneeboard/dprint.hpp>
+#include <OpenKneeboard/task/when_all.hpp>
 
 #include <shims/nlohmann/json.hpp>
 
@@ -134,13 +135,8 @@ task<void> TabsList::LoadSettings(nlohmann::json config) {
     awaitables.push_back(this->LoadTabFromJSON(tab));
   }
 
-  decltype(mTabs) tabs;
-  for (auto&& it: awaitables) {
-    auto tab = co_await std::move(it);
-    if (tab) {
-      tabs.push_back(std::move(tab));
-    }
-  }
+  auto tabs = co_await when_all(std::move(awaitables));
+  std::erase(tabs, nullptr);
 
   co_await this->SetTabs(tabs);
 }
@@ -230,9 +226,7 @@ task<void> TabsList::SetTabs(std::vector<std::shared_ptr<ITab>> tabs) {
         }
       }
     }
-    for (auto& it: disposers) {
-      co_await std::move(it);
-    }
+    co_await when_all(std::move(disposers));
   }
 
   mTabs = tabs;
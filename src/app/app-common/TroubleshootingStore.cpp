@@ -18,6 +18,7 @@
  * USA.
  */
 #include <OpenKneeboard/APIEvent.hpp>
+#include <OpenKneeboard/EventProfiler.hpp>
 #include <OpenKneeboard/Filesystem.hpp>
 #include <OpenKneeboard/Settings.hpp>
 #include <OpenKneeboard/TroubleshootingStore.hpp>
@@ -25,15 +26,34 @@
 #include <OpenKneeboard/bindline.hpp>
 #include <OpenKneeboard/config.hpp>
 #include <OpenKneeboard/dprint.hpp>
+#include <OpenKneeboard/fatal.hpp>
+#include <OpenKneeboard/format/enum.hpp>
+#include <OpenKneeboard/task.hpp>
 #include <OpenKneeboard/version.hpp>
 
+#include <algorithm>
 #include <chrono>
 #include <format>
+#include <optional>
 
 namespace OpenKneeboard {
 
 static std::weak_ptr<TroubleshootingStore> gStore;
 
+static std::optional<DWORD> GetRegistryDWORD(const wchar_t* name) {
+  for (auto hkey: {HKEY_CURRENT_USER, HKEY_LOCAL_MACHINE}) {
+    DWORD value {};
+    DWORD size = sizeof(value);
+    if (
+      RegGetValueW(
+        hkey, RegistrySubKey, name, RRF_RT_REG_DWORD, nullptr, &value, &size)
+      == ERROR_SUCCESS) {
+      return value;
+    }
+  }
+  return std::nullopt;
+}
+
 std::shared_ptr<TroubleshootingStore> TroubleshootingStore::Get() {
   auto shared = gStore.lock();
   if (!shared) {
@@ -83,27 +103,20 @@ TroubleshootingStore::TroubleshootingStore() {
 
   this->InitializeLogFile();
 
+  // We're first created by `wWinMain()`, on the UI thread
+  mUIThreadStalls = std::make_unique<CoroutineRegistry::StallDetector>(
+    std::this_thread::get_id(),
+    std::chrono::microseconds(1'000'000 / FramesPerSecond));
+
+  if (GetRegistryDWORD(L"ProfileEventHandlers").value_or(0)) {
+    EventProfiler::SetEnabled(true);
+  }
+
   dprint("{}()", __FUNCTION__);
 }
 
 void TroubleshootingStore::InitializeLogFile() {
-  DWORD maxLogFiles = 0;
-  for (auto hkey: {HKEY_CURRENT_USER, HKEY_LOCAL_MACHINE}) {
-    DWORD size = sizeof(maxLogFiles);
-    if (
-      RegGetValueW(
-        hkey,
-        RegistrySubKey,
-        L"MaxLogFiles",
-        RRF_RT_REG_DWORD,
-        nullptr,
-        &maxLogFiles,
-        &size)
-      == ERROR_SUCCESS) {
-      break;
-    }
-  }
-
+  const auto maxLogFiles = GetRegistryDWORD(L"MaxLogFiles").value_or(0);
   if (maxLogFiles == 0) {
     return;
   }
@@ -221,6 +234,75 @@ std::string TroubleshootingStore::GetAPIEventsDebugLogAsString() const {
       "No events as of {}", ReadableTime(std::chrono::system_clock::now())));
 }
 
+std::string TroubleshootingStore::GetCoroutinesDebugLogAsString() const {
+  using namespace CoroutineRegistry;
+  using Milliseconds = std::chrono::duration<float, std::milli>;
+  const auto toString = [](const void* address) {
+    return StackFramePointer {const_cast<void*>(address)}.to_string();
+  };
+
+  const auto statistics = GetStatistics();
+  std::string ret = std::format(
+    "Most live at once: {} of {}\n"
+    "Untracked (registry full): {}\n\n",
+    statistics.mHighWater,
+    Capacity,
+    statistics.mUntracked);
+
+  const auto stalls = mUIThreadStalls->GetStalls();
+  ret += std::format(
+    "UI thread stalls over {:0.1f}ms:\n",
+    std::chrono::duration_cast<Milliseconds>(mUIThreadStalls->GetBudget())
+      .count());
+  if (stalls.empty()) {
+    ret += "- none\n";
+  }
+  for (const auto& it: stalls) {
+    ret += std::format(
+      "- {}: {}{:0.1f}ms in coroutine created by {}\n",
+      ReadableTime(it.mDetectedAt),
+      it.mOngoing ? "ongoing, " : "",
+      std::chrono::duration_cast<Milliseconds>(it.mDuration).count(),
+      toString(it.mCoroutine.mCreator));
+  }
+
+  // Longest-waiting first; anything stuck forever will be at the top
+  auto live = GetLiveCoroutines();
+  std::ranges::sort(live, {}, &LiveCoroutine::mSince);
+  const auto now = CoarseClock::now();
+  ret += std::format("\n{} live coroutines:\n", live.size());
+  for (const auto& it: live) {
+    ret += std::format(
+      "- {} for {:0.1f}ms on thread {}\n"
+      "  Created by: {}\n",
+      it.mState,
+      std::chrono::duration_cast<Milliseconds>(now - it.mSince).count(),
+      it.mThread,
+      toString(it.mCreator));
+    if (it.mAwaitPoint) {
+      ret += std::format("  Last suspended at: {}\n", toString(it.mAwaitPoint));
+    }
+  }
+
+#ifdef DEBUG
+  ret += std::format(
+    "\ntask<> result states:\n{}",
+    detail::gTaskResultStateStatistics.GetSnapshot().ToString());
+#endif
+  return ret;
+}
+
+std::string TroubleshootingStore::GetEventHandlersDebugLogAsString() const {
+  if (!EventProfiler::IsEnabled()) {
+    return std::format(
+      "Event handler profiling is disabled; to enable it, set the "
+      "`ProfileEventHandlers` DWORD to 1 in HKEY_CURRENT_USER\\{}, then "
+      "restart OpenKneeboard.\n",
+      winrt::to_string(RegistrySubKey));
+  }
+  return EventProfiler::DumpTopOffenders(25);
+}
+
 TroubleshootingStore::DPrintReceiver::~DPrintReceiver() {
 }
 
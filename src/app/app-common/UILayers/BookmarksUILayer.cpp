@@ -198,7 +198,7 @@ task<void> BookmarksUILayer::Render(
 
   const auto currentTabID = currentTab->GetRuntimeID();
   const auto currentPageID = currentTabView->GetPageID();
-  for (const auto& button: buttons) {
+  for (const auto& button: *buttons) {
     const D2D1_RECT_F buttonRect {
       rect.Left<float>(),
       rect.Top() + (button.mRect.top * height * scale),
@@ -206,9 +206,7 @@ task<void> BookmarksUILayer::Render(
       rect.Top() + (button.mRect.bottom * height * scale),
     };
     buttonNumber++;
-    const auto text = winrt::to_hstring(
-      button.mBookmark.mTitle.empty() ? std::format(_("#{}"), buttonNumber)
-                                      : button.mBookmark.mTitle);
+    const auto& text = button.mLabel;
 
     auto textBrush = (button == hoverButton) ? mHoverBrush : mTextBrush;
 
@@ -249,7 +247,7 @@ task<void> BookmarksUILayer::Render(
 
 bool BookmarksUILayer::IsEnabled() const {
   return mKneeboardState->GetUISettings().mBookmarks.mEnabled
-    && !mKneeboardView->GetBookmarks().empty();
+    && !mKneeboardView->GetBookmarks()->empty();
 }
 
 bool BookmarksUILayer::Button::operator==(const Button& other) const noexcept {
@@ -262,15 +260,20 @@ BookmarksUILayer::Buttons BookmarksUILayer::LayoutButtons() {
     return buttons;
   }
 
-  auto bookmarks = mKneeboardView->GetBookmarks();
+  const auto bookmarks = mKneeboardView->GetBookmarks();
 
   std::vector<Button> buttons;
-  const auto interval = 1.0f / bookmarks.size();
+  buttons.reserve(bookmarks->size());
+  const auto interval = 1.0f / bookmarks->size();
 
-  for (const auto& bookmark: bookmarks) {
+  for (const auto& bookmark: *bookmarks) {
+    const auto buttonNumber = buttons.size() + 1;
     buttons.push_back({
-      {0.0f, interval * buttons.size(), 1.0f, interval * (buttons.size() + 1)},
+      {0.0f, interval * buttons.size(), 1.0f, interval * buttonNumber},
       bookmark,
+      winrt::to_hstring(
+        bookmark.mTitle.empty() ? std::format(_("#{}"), buttonNumber)
+                                : bookmark.mTitle),
     });
   }
 
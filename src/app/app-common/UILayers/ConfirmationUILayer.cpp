@@ -125,7 +125,7 @@ task<void> ConfirmationUILayer::Render(
     mTextBrush.get());
 
   const auto [hoverButton, buttons] = dialog.mButtons->GetState();
-  for (const auto& button: buttons) {
+  for (const auto& button: *buttons) {
     const auto rr
       = D2D1::RoundedRect(button.mRect, dialog.mMargin, dialog.mMargin);
     if (button == hoverButton) {
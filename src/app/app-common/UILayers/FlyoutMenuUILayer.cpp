@@ -173,7 +173,7 @@ task<void> FlyoutMenuUILayer::Render(
 
   auto [hoverMenuItem, menuItems] = menu.mCursorImpl->GetState();
 
-  for (const auto& menuItem: menuItems) {
+  for (const auto& menuItem: *menuItems) {
     auto selectable
       = std::dynamic_pointer_cast<ISelectableToolbarItem>(menuItem.mItem);
     if (!selectable) {
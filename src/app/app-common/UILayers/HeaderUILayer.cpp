@@ -244,12 +244,12 @@ void HeaderUILayer::DrawToolbar(
   auto toolbar = toolbarInfo->mButtons;
 
   const auto [hoverButton, buttons] = toolbar->GetState();
-  if (buttons.empty()) {
+  if (buttons->empty()) {
     return;
   }
 
   const auto buttonHeight
-    = buttons.front().mRect.bottom - buttons.front().mRect.top;
+    = buttons->front().mRect.bottom - buttons->front().mRect.top;
   const auto strokeWidth = buttonHeight / 15;
 
   FLOAT dpix {}, dpiy {};
@@ -267,7 +267,7 @@ void HeaderUILayer::DrawToolbar(
   glyphFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER);
   glyphFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
 
-  for (auto button: buttons) {
+  for (auto button: *buttons) {
     auto& action = button.mAction;
     ID2D1Brush* brush = mButtonBrush.get();
     if (!action->IsEnabled()) {
@@ -79,6 +79,8 @@ class BookmarksUILayer final
   struct Button {
     D2D1_RECT_F mRect {};
     Bookmark mBookmark {};
+    // Precomputed as it's used every frame
+    winrt::hstring mLabel;
 
     bool operator==(const Button&) const noexcept;
   };
@@ -21,10 +21,13 @@
 
 #include <OpenKneeboard/CursorEvent.hpp>
 #include <OpenKneeboard/Events.hpp>
+#include <OpenKneeboard/UniformGridIndex.hpp>
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <ranges>
 
 #include <d2d1.h>
 
@@ -40,6 +43,7 @@ class CursorClickableRegions final
   : public std::enable_shared_from_this<CursorClickableRegions<Button>> {
  public:
   using SharedPtr = typename std::shared_ptr<CursorClickableRegions<Button>>;
+  using Buttons = std::shared_ptr<const std::vector<Button>>;
 
   static SharedPtr Create(const std::vector<Button>& buttons) {
     return SharedPtr(new CursorClickableRegions<Button>(buttons));
@@ -62,17 +66,27 @@ class CursorClickableRegions final
     return static_cast<bool>(mHoverButton) || static_cast<bool>(mPressedButton);
   }
 
-  std::vector<Button> GetButtons() const {
-    const auto keepAlive = this->shared_from_this();
+  /// Doesn't copy or lock; the buttons are immutable
+  Buttons GetButtons() const {
+    const auto regions = mRegions.load();
+    return {regions, &regions->mButtons};
+  }
 
+  std::tuple<std::optional<Button>, Buttons> GetState() const {
+    const auto keepAlive = this->shared_from_this();
+    auto buttons = this->GetButtons();
     std::unique_lock lock(mMutex);
-    return mButtons;
+    return {mHoverButton, std::move(buttons)};
   }
 
-  std::tuple<std::optional<Button>, std::vector<Button>> GetState() const {
+  /// Replace the regions, e.g. after a layout change
+  void SetButtons(const std::vector<Button>& buttons) {
     const auto keepAlive = this->shared_from_this();
+    mRegions.store(CreateRegions(buttons));
+
     std::unique_lock lock(mMutex);
-    return {mHoverButton, mButtons};
+    mHoverButton.reset();
+    mPressedButton.reset();
   }
 
   Event<KneeboardViewID, const Button&> evClicked;
@@ -81,16 +95,22 @@ class CursorClickableRegions final
   void PostCursorEvent(KneeboardViewID ctx, const CursorEvent& ev) {
     const auto keepAlive = this->shared_from_this();
 
-    const D2D1_POINT_2F cursor {ev.mX, ev.mY};
     const EventDelay delay;
-    std::unique_lock lock(mMutex);
-    std::optional<Button> buttonUnderCursor;
+    std::unique_lock lock(mMutex, std::defer_lock);
 
-    for (const auto& button: mButtons) {
-      if (IsPointInRect(cursor, button.mRect)) {
-        buttonUnderCursor = button;
+    // Hit test before locking, so readers aren't blocked by it. If
+    // `SetButtons()` replaces the regions meanwhile, retry: it resets the
+    // state below, so a button from the old layout must not be stored
+    std::optional<Button> buttonUnderCursor;
+    for (auto regions = mRegions.load();;) {
+      buttonUnderCursor = HitTest(*regions, ev);
+      lock.lock();
+      auto current = mRegions.load();
+      if (current == regions) {
         break;
       }
+      lock.unlock();
+      regions = std::move(current);
     }
 
     if (ev.mTouchState == CursorTouchState::NearSurface) {
@@ -138,18 +158,42 @@ class CursorClickableRegions final
   CursorClickableRegions() = delete;
 
  private:
+  // Never modified once created; replaced as a whole by `SetButtons()`
+  struct Regions {
+    std::vector<Button> mButtons;
+    UniformGridIndex mIndex;
+  };
+  std::atomic<std::shared_ptr<const Regions>> mRegions;
+
   bool mCursorTouching = false;
-  std::vector<Button> mButtons;
   std::optional<Button> mHoverButton;
   std::optional<Button> mPressedButton;
   mutable std::mutex mMutex;
 
-  constexpr bool IsPointInRect(const D2D1_POINT_2F& p, const D2D1_RECT_F& r) {
-    return p.x >= r.left && p.x <= r.right && p.y >= r.top && p.y <= r.bottom;
-  };
+  static std::optional<Button> HitTest(
+    const Regions& regions,
+    const CursorEvent& ev) {
+    const auto index = regions.mIndex.HitTest(ev.mX, ev.mY);
+    if (!index) {
+      return std::nullopt;
+    }
+    return regions.mButtons.at(*index);
+  }
+
+  static std::shared_ptr<const Regions> CreateRegions(
+    const std::vector<Button>& buttons) {
+    const auto rects
+      = buttons | std::views::transform([](const Button& button) {
+          const D2D1_RECT_F rect = button.mRect;
+          return UniformGridIndex::Rect {
+            rect.left, rect.top, rect.right, rect.bottom};
+        })
+      | std::ranges::to<std::vector>();
+    return std::make_shared<const Regions>(buttons, UniformGridIndex {rects});
+  }
 
   CursorClickableRegions(const std::vector<Button>& buttons)
-    : mButtons(buttons) {
+    : mRegions(CreateRegions(buttons)) {
   }
 };
 
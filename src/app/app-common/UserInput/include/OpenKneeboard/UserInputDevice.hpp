@@ -55,7 +55,8 @@ class UserInputDevice : protected EventReceiver {
   Event<UserAction> evUserActionEvent;
 
  private:
-  winrt::apartment_context mUIThread;
+  std::shared_ptr<EventMailbox> mUIThreadMailbox {
+    EventMailbox::GetForCurrentThread()};
   void OnButtonEvent(UserInputButtonEvent);
 
   std::unordered_set<uint64_t> mActiveButtons;
@@ -0,0 +1,107 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/Bookmark.hpp>
+#include <OpenKneeboard/ITab.hpp>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** Bookmarks for every tab in a view, ordered by (tab order, page index).
+ *
+ * Updated per-tab when bookmarks or pages change, so finding the next or
+ * previous bookmark doesn't need to walk every tab's bookmarks and pages.
+ */
+class BookmarkIndex final {
+ public:
+  using TabID = ITab::RuntimeID;
+  using Bookmarks = std::shared_ptr<const std::vector<Bookmark>>;
+
+  BookmarkIndex();
+
+  /** Replace the tab order.
+   *
+   * Existing entries for tabs that are still present are kept; new tabs
+   * have no bookmarks until `SetTabBookmarks()` is called.
+   *
+   * Returns true if `GetBookmarks()` changed.
+   */
+  bool SetTabs(std::span<const TabID>);
+
+  /** Replace the bookmarks and page order for a tab.
+   *
+   * Bookmarks for pages that aren't in `pageIDs` are ignored.
+   *
+   * Returns true if `GetBookmarks()` changed.
+   */
+  bool SetTabBookmarks(
+    TabID,
+    std::span<const PageID> pageIDs,
+    std::span<const Bookmark>);
+
+  /// All bookmarks, in navigation order; never modified once returned
+  Bookmarks GetBookmarks() const;
+
+  /** Find the closest bookmark before/after a position.
+   *
+   * If `page` is `std::nullopt`, the position is the tab as a whole, e.g.
+   * when it's showing a sub-tab; bookmarks in that tab are skipped.
+   *
+   * Returns `std::nullopt` if there isn't one, or if `page` isn't a page
+   * in the tab.
+   */
+  std::optional<Bookmark> GetPrevious(TabID, std::optional<PageID> page) const;
+  std::optional<Bookmark> GetNext(TabID, std::optional<PageID> page) const;
+
+ private:
+  struct Key {
+    std::size_t mTab {};
+    std::size_t mPage {};
+
+    constexpr auto operator<=>(const Key&) const noexcept = default;
+  };
+  struct Tab {
+    std::size_t mOrder {};
+    std::unordered_map<PageID, std::size_t> mPageIndices;
+    std::vector<Bookmark> mBookmarks;
+  };
+
+  mutable std::mutex mMutex;
+  std::unordered_map<TabID, Tab> mTabs;
+  std::map<Key, Bookmark> mIndex;
+  Bookmarks mBookmarks;
+
+  // These require `mMutex` to be held
+  void InsertTab(const Tab&);
+  bool UpdateBookmarks();
+  const Tab* GetTab(TabID) const;
+  std::optional<std::size_t> GetPageIndex(const Tab&, PageID) const;
+};
+
+}// namespace OpenKneeboard
@@ -0,0 +1,110 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <source_location>
+#include <string>
+#include <vector>
+
+/** Opt-in measurement of how long event handlers take.
+ *
+ * When enabled, every handler call is timed, and attributed both to where
+ * the handler was connected, and to where the event was emitted.
+ *
+ * When disabled, the only cost is a single relaxed load and branch per
+ * handler call.
+ */
+namespace OpenKneeboard::EventProfiler {
+
+namespace detail {
+inline std::atomic_bool gEnabled {false};
+}
+
+inline bool IsEnabled() noexcept {
+  return detail::gEnabled.load(std::memory_order_relaxed);
+}
+
+void SetEnabled(bool);
+
+using Clock = std::chrono::steady_clock;
+
+/** Bucket `i` counts calls of at least `2^(i-1)`us, but less than `2^i`us.
+ *
+ * Bucket 0 is under 1us, and the last bucket (~4s) is unbounded.
+ */
+constexpr std::size_t HistogramBuckets = 24;
+
+struct Entry {
+  std::source_location mLocation;
+  uint64_t mCalls {};
+  Clock::duration mTotal {};
+  Clock::duration mMax {};
+  std::array<uint64_t, HistogramBuckets> mHistogram {};
+};
+
+struct Report {
+  /// Keyed by where the handler was connected
+  std::vector<Entry> mByReceiver;
+  /// Keyed by where the event was emitted
+  std::vector<Entry> mByEmitter;
+};
+
+void Record(
+  const std::source_location& receiver,
+  const std::source_location& emitter,
+  Clock::duration) noexcept;
+
+/// Times the current scope, if profiling is enabled
+class Scope final {
+ public:
+  Scope(
+    const std::source_location& receiver,
+    const std::source_location& emitter) noexcept
+    : mReceiver(receiver), mEmitter(emitter), mStart(Clock::now()) {
+  }
+
+  ~Scope() {
+    Record(mReceiver, mEmitter, Clock::now() - mStart);
+  }
+
+  Scope(const Scope&) = delete;
+  Scope(Scope&&) = delete;
+  Scope& operator=(const Scope&) = delete;
+  Scope& operator=(Scope&&) = delete;
+
+ private:
+  const std::source_location& mReceiver;
+  const std::source_location& mEmitter;
+  Clock::time_point mStart;
+};
+
+/// The `count` handlers and emitters with the highest total time
+Report GetTopOffenders(std::size_t count);
+
+/// Format the top offenders, and also write them to the trace provider
+std::string DumpTopOffenders(std::size_t count);
+
+void Reset();
+
+}// namespace OpenKneeboard::EventProfiler
@@ -21,7 +21,9 @@
 
 #include "UniqueID.hpp"
 
+#include <OpenKneeboard/EventProfiler.hpp>
 #include <OpenKneeboard/KneeboardViewID.hpp>
+#include <OpenKneeboard/MPSCMailbox.hpp>
 #include <OpenKneeboard/ThreadGuard.hpp>
 
 #include <OpenKneeboard/bindline.hpp>
@@ -37,8 +39,11 @@
 #include <cstdint>
 #include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <source_location>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
@@ -190,6 +195,28 @@ class EventDelay final {
   EventsTraceLoggingThreadActivity mActivity;
 };
 
+/** Delivers events emitted by other threads to the thread that created it.
+ *
+ * Use with `Event::EnqueueForContext()`; posting is lock-free for the
+ * emitting thread, and the owning thread is woken once per batch of events,
+ * rather than once per event.
+ */
+class EventMailbox final : public std::enable_shared_from_this<EventMailbox> {
+ public:
+  /// Shared by everything that delivers to the current thread
+  static std::shared_ptr<EventMailbox> GetForCurrentThread();
+
+  void Post(std::unique_ptr<MPSCMailbox::Item>);
+
+ private:
+  EventMailbox();
+
+  winrt::apartment_context mContext;
+  MPSCMailbox mMailbox;
+
+  OpenKneeboard::fire_and_forget Drain();
+};
+
 class EventConnectionBase {
  public:
   EventHandlerToken mToken;
@@ -215,43 +242,61 @@ class EventConnection final
       new EventConnection(handler, location));
   }
 
-  constexpr operator bool() const noexcept {
-    // not bothering with the lock, as it's checked with lock in Call() and
-    // Invalidate() anyway
+  operator bool() const noexcept {
+    std::unique_lock lock(mMutex);
     return static_cast<bool>(mHandler);
   }
 
-  void Call(Args... args) {
+  void Call(Args... args, const std::source_location& emitter) {
     auto stayingAlive = this->shared_from_this();
-    auto handler = mHandler;
-    if (handler) {
-      // In release builds, ignore but drop unhandled exceptions from
-      // handlers. In debug builds, break (or crash)
-      try {
-        handler(args...);
-      } catch (const std::exception& e) {
-        dprint("Uncaught std::exception from event handler: {}", e.what());
-        OPENKNEEBOARD_BREAK;
-      } catch (const winrt::hresult_error& e) {
-        dprint(
-          L"Uncaught hresult error from event handler: {} - {}",
-          e.code().value,
-          std::wstring_view {e.message()});
-        OPENKNEEBOARD_BREAK;
-      } catch (...) {
-        dprint("Uncaught unknown exception from event handler");
-        OPENKNEEBOARD_BREAK;
-      }
+    EventHandler<Args...> handler;
+    {
+      std::unique_lock lock(mMutex);
+      handler = mHandler;
+    }
+    if (!handler) {
+      return;
     }
+    if (EventProfiler::IsEnabled()) [[unlikely]] {
+      const EventProfiler::Scope profile(mSourceLocation, emitter);
+      Invoke(handler, args...);
+      return;
+    }
+    Invoke(handler, args...);
   }
 
   virtual void Invalidate() override {
-    mHandler = {};
+    // Declared first so it's destroyed - with anything it captured - after
+    // the lock is released
+    EventHandler<Args...> handler;
+    std::unique_lock lock(mMutex);
+    std::swap(handler, mHandler);
   }
 
  private:
+  mutable std::mutex mMutex;
   EventHandler<Args...> mHandler;
   std::source_location mSourceLocation;
+
+  static void Invoke(const EventHandler<Args...>& handler, Args... args) {
+    // In release builds, ignore but drop unhandled exceptions from
+    // handlers. In debug builds, break (or crash)
+    try {
+      handler(args...);
+    } catch (const std::exception& e) {
+      dprint("Uncaught std::exception from event handler: {}", e.what());
+      OPENKNEEBOARD_BREAK;
+    } catch (const winrt::hresult_error& e) {
+      dprint(
+        L"Uncaught hresult error from event handler: {} - {}",
+        e.code().value,
+        std::wstring_view {e.message()});
+      OPENKNEEBOARD_BREAK;
+    } catch (...) {
+      dprint("Uncaught unknown exception from event handler");
+      OPENKNEEBOARD_BREAK;
+    }
+  }
 };
 
 /** a 1:n event. */
@@ -285,6 +330,15 @@ class Event final : public EventBase {
     }
   }
 
+  /// Emit in the mailbox's thread, batched with other pending events
+  void EnqueueForContext(
+    const std::shared_ptr<EventMailbox>& mailbox,
+    Args... args,
+    std::source_location location = std::source_location::current()) {
+    mailbox->Post(
+      std::make_unique<MailboxItem>(std::weak_ptr(mImpl), location, args...));
+  }
+
   EventHookToken AddHook(Hook, EventHookToken token = {}) noexcept;
   void RemoveHook(EventHookToken) noexcept;
 
@@ -298,17 +352,175 @@ class Event final : public EventBase {
   struct Impl {
     ~Impl();
 
-    std::unordered_map<
+    using Receivers = std::unordered_map<
       EventHandlerToken,
-      std::shared_ptr<EventConnection<Args...>>>
-      mReceivers;
-    std::unordered_map<EventHookToken, Hook> mHooks;
+      std::shared_ptr<EventConnection<Args...>>>;
+    using Hooks = std::unordered_map<EventHookToken, Hook>;
+
+    // Copy-on-write, so handlers can be added and removed from any thread,
+    // and `Emit()` only needs to copy pointers
+    std::mutex mMutex;
+    std::shared_ptr<const Receivers> mReceivers {
+      std::make_shared<const Receivers>()};
+    std::shared_ptr<const Hooks> mHooks {std::make_shared<const Hooks>()};
 
     void Emit(
       Args... args,
       std::source_location location = std::source_location::current());
   };
   std::shared_ptr<Impl> mImpl;
+
+  struct MailboxItem final : MPSCMailbox::Item {
+    std::weak_ptr<Impl> mImpl;
+    std::source_location mLocation;
+    std::tuple<std::decay_t<Args>...> mArgs;
+
+    MailboxItem(
+      std::weak_ptr<Impl> impl,
+      std::source_location location,
+      Args... args)
+      : mImpl(std::move(impl)), mLocation(location), mArgs(args...) {
+    }
+
+    void Run() noexcept override {
+      auto impl = mImpl.lock();
+      if (!impl) {
+        return;
+      }
+      std::apply(
+        [&](auto&... args) { impl->Emit(args..., mLocation); }, mArgs);
+    }
+  };
+};
+
+/// Shared, non-template parts of `CoalescingEvent`
+class CoalescingEventBase {
+ public:
+  /** Deliver everything that's pending for the current thread now.
+   *
+   * The frame loop calls this, so that coalesced events are delivered before
+   * the frame that they affect; otherwise, they're delivered one frame
+   * interval after they were first emitted.
+   */
+  static void FlushForCurrentThread();
+
+ protected:
+  struct Pending : std::enable_shared_from_this<Pending> {
+    virtual ~Pending() = default;
+    virtual void Deliver() noexcept = 0;
+  };
+
+  /// Call on the first emit since the last delivery
+  static void Schedule(std::weak_ptr<Pending>);
+
+ private:
+  class Scheduler;
+};
+
+/** An event that's delivered at most once per frame, however often it's
+ * emitted.
+ *
+ * Use for notifications that only need handling once per frame, and that
+ * are emitted in bursts - e.g. 'needs repaint'. Handlers run on the thread
+ * that first emitted the event in that frame; events are delivered in the
+ * order they were first emitted.
+ *
+ * Payloads are merged: containers with `merge()` - e.g.
+ * `std::unordered_set<PageID>` - are combined, and anything else is replaced
+ * by the latest value.
+ */
+template <class... Args>
+  requires(sizeof...(Args) <= 1)
+class CoalescingEvent final : public CoalescingEventBase {
+  friend class EventReceiver;
+
+ public:
+  CoalescingEvent() : mImpl(std::make_shared<Impl>()) {
+  }
+
+  void Emit(
+    Args... args,
+    std::source_location location = std::source_location::current()) {
+    mImpl->Emit(args..., location);
+  }
+
+  /** Cancel the pending delivery, if any, and return its payload.
+   *
+   * For receivers that sometimes need to catch up immediately; they can
+   * handle the returned payload themselves, instead of waiting for the next
+   * frame.
+   */
+  [[nodiscard]]
+  auto TakePending() {
+    return mImpl->TakePending();
+  }
+
+  /// Whether there's an emit that hasn't been delivered or taken yet
+  [[nodiscard]]
+  bool IsPending() const {
+    return mImpl->IsPending();
+  }
+
+ private:
+  struct Impl final : Pending {
+    Event<Args...> mEvent;
+
+    std::mutex mMutex;
+    std::optional<std::tuple<std::decay_t<Args>...>> mPending;
+    // The first emit, for tracing and profiling
+    std::source_location mLocation;
+
+    void Emit(Args... args, std::source_location location) {
+      {
+        std::unique_lock lock(mMutex);
+        if (mPending) {
+          if constexpr (sizeof...(Args) == 1) {
+            Merge(std::get<0>(*mPending), std::decay_t<Args> {args}...);
+          }
+          return;
+        }
+        mPending.emplace(args...);
+        mLocation = location;
+      }
+      Schedule(this->weak_from_this());
+    }
+
+    auto TakePending() {
+      decltype(mPending) pending;
+      std::unique_lock lock(mMutex);
+      std::swap(pending, mPending);
+      return pending;
+    }
+
+    bool IsPending() {
+      std::unique_lock lock(mMutex);
+      return mPending.has_value();
+    }
+
+    void Deliver() noexcept override {
+      decltype(mPending) pending;
+      std::source_location location;
+      {
+        std::unique_lock lock(mMutex);
+        std::swap(pending, mPending);
+        location = mLocation;
+      }
+      if (!pending) {
+        return;
+      }
+      std::apply(
+        [&](auto&... args) { mEvent.Emit(args..., location); }, *pending);
+    }
+
+    static void Merge(auto& pending, auto&& next) {
+      if constexpr (requires { pending.merge(next); }) {
+        pending.merge(next);
+      } else {
+        pending = std::move(next);
+      }
+    }
+  };
+  std::shared_ptr<Impl> mImpl;
 };
 
 class EventReceiver {
@@ -351,6 +563,30 @@ class EventReceiver {
     Event<>& forwardAs,
     std::source_location location = std::source_location::current());
 
+  template <class... Args>
+  EventHandlerToken AddEventListener(
+    CoalescingEvent<Args...>& event,
+    const std::type_identity_t<EventHandler<Args...>>& handler,
+    std::source_location location = std::source_location::current());
+
+  template <class... Args>
+  EventHandlerToken AddEventListener(
+    CoalescingEvent<Args...>& event,
+    std::type_identity_t<Event<Args...>>& forwardAs,
+    std::source_location location = std::source_location::current());
+
+  template <class... Args>
+  EventHandlerToken AddEventListener(
+    Event<Args...>& event,
+    std::type_identity_t<CoalescingEvent<Args...>>& forwardAs,
+    std::source_location location = std::source_location::current());
+
+  template <class... Args>
+  EventHandlerToken AddEventListener(
+    CoalescingEvent<Args...>& event,
+    std::type_identity_t<CoalescingEvent<Args...>>& forwardAs,
+    std::source_location location = std::source_location::current());
+
   void RemoveEventListener(EventHandlerToken);
   void RemoveAllEventListeners();
 };
@@ -361,18 +597,28 @@ std::shared_ptr<EventConnectionBase> Event<Args...>::AddHandler(
   std::source_location location) {
   auto connection = EventConnection<Args...>::Create(handler, location);
   auto token = connection->mToken;
-  mImpl->mReceivers.emplace(token, connection);
+  std::unique_lock lock(mImpl->mMutex);
+  auto receivers = std::make_shared<typename Impl::Receivers>(
+    *mImpl->mReceivers);
+  receivers->emplace(token, connection);
+  mImpl->mReceivers = std::move(receivers);
   return std::move(connection);
 }
 
 template <class... Args>
 void Event<Args...>::RemoveHandler(EventHandlerToken token) {
   std::shared_ptr<EventConnectionBase> receiver;
-  if (!mImpl->mReceivers.contains(token)) {
-    return;
+  {
+    std::unique_lock lock(mImpl->mMutex);
+    if (!mImpl->mReceivers->contains(token)) {
+      return;
+    }
+    auto receivers = std::make_shared<typename Impl::Receivers>(
+      *mImpl->mReceivers);
+    receiver = receivers->at(token);
+    receivers->erase(token);
+    mImpl->mReceivers = std::move(receivers);
   }
-  receiver = mImpl->mReceivers.at(token);
-  mImpl->mReceivers.erase(token);
   receiver->Invalidate();
 }
 
@@ -383,11 +629,16 @@ void Event<Args...>::Impl::Emit(Args... args, std::source_location location) {
     activity,
     "Event::Emit()",
     OPENKNEEBOARD_TraceLoggingSourceLocation(location));
-  //  Copy in case one is erased while we're running
-  auto receivers = mReceivers;
-  auto hooks = mHooks;
+  // Snapshot, in case handlers are added or removed while we're running
+  std::shared_ptr<const Receivers> receivers;
+  std::shared_ptr<const Hooks> hooks;
+  {
+    std::unique_lock lock(mMutex);
+    receivers = mReceivers;
+    hooks = mHooks;
+  }
 
-  for (const auto& [_, hook]: hooks) {
+  for (const auto& [_, hook]: *hooks) {
     if (hook(args...) == HookResult::STOP_PROPAGATION) {
       TraceLoggingWriteStop(
         activity,
@@ -399,9 +650,9 @@ void Event<Args...>::Impl::Emit(Args... args, std::source_location location) {
 
   InvokeOrEnqueue(
     [=]() {
-      for (const auto& [token, receiver]: receivers) {
+      for (const auto& [token, receiver]: *receivers) {
         if (receiver) {
-          receiver->Call(args...);
+          receiver->Call(args..., location);
         }
       }
     },
@@ -416,7 +667,7 @@ Event<Args...>::~Event() {
 
 template <class... Args>
 Event<Args...>::Impl::~Impl() {
-  for (const auto& [token, receiver]: mReceivers) {
+  for (const auto& [token, receiver]: *mReceivers) {
     receiver->Invalidate();
   }
 }
@@ -425,16 +676,22 @@ template <class... Args>
 EventHookToken Event<Args...>::AddHook(
   Hook hook,
   EventHookToken token) noexcept {
-  mImpl->mHooks.insert_or_assign(token, hook);
+  std::unique_lock lock(mImpl->mMutex);
+  auto hooks = std::make_shared<typename Impl::Hooks>(*mImpl->mHooks);
+  hooks->insert_or_assign(token, hook);
+  mImpl->mHooks = std::move(hooks);
   return token;
 }
 
 template <class... Args>
 void Event<Args...>::RemoveHook(EventHookToken token) noexcept {
-  auto it = mImpl->mHooks.find(token);
-  if (it != mImpl->mHooks.end()) {
-    mImpl->mHooks.erase(it);
+  std::unique_lock lock(mImpl->mMutex);
+  if (!mImpl->mHooks->contains(token)) {
+    return;
   }
+  auto hooks = std::make_shared<typename Impl::Hooks>(*mImpl->mHooks);
+  hooks->erase(token);
+  mImpl->mHooks = std::move(hooks);
 }
 
 template <class... Args>
@@ -477,4 +734,43 @@ EventHandlerToken EventReceiver::AddEventListener(
     location);
 }
 
+template <class... Args>
+EventHandlerToken EventReceiver::AddEventListener(
+  CoalescingEvent<Args...>& event,
+  const std::type_identity_t<EventHandler<Args...>>& handler,
+  std::source_location location) {
+  return AddEventListener(event.mImpl->mEvent, handler, location);
+}
+
+template <class... Args>
+EventHandlerToken EventReceiver::AddEventListener(
+  CoalescingEvent<Args...>& event,
+  std::type_identity_t<Event<Args...>>& forwardTo,
+  std::source_location location) {
+  return AddEventListener(event.mImpl->mEvent, forwardTo, location);
+}
+
+template <class... Args>
+EventHandlerToken EventReceiver::AddEventListener(
+  Event<Args...>& event,
+  std::type_identity_t<CoalescingEvent<Args...>>& forwardTo,
+  std::source_location location) {
+  return AddEventListener(
+    event,
+    [location, weak = std::weak_ptr(forwardTo.mImpl)](Args... args) {
+      if (auto forwardTo = weak.lock()) {
+        forwardTo->Emit(args..., location);
+      }
+    },
+    location);
+}
+
+template <class... Args>
+EventHandlerToken EventReceiver::AddEventListener(
+  CoalescingEvent<Args...>& event,
+  std::type_identity_t<CoalescingEvent<Args...>>& forwardTo,
+  std::source_location location) {
+  return AddEventListener(event.mImpl->mEvent, forwardTo, location);
+}
+
 }// namespace OpenKneeboard
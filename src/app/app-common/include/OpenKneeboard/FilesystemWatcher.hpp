@@ -20,32 +20,27 @@
 #pragma once
 
 #include <OpenKneeboard/Events.hpp>
-
-#include <OpenKneeboard/final_release_deleter.hpp>
-#include <OpenKneeboard/handles.hpp>
+#include <OpenKneeboard/FilesystemWatchService.hpp>
 
 #include <shims/winrt/base.h>
 
-#include <winrt/Windows.Storage.Search.h>
-
 #include <filesystem>
 #include <memory>
 
-#include <fileapi.h>
-
 namespace OpenKneeboard {
 
+/** Raises `evFilesystemModifiedEvent` on the creating thread when the path
+ * changes.
+ *
+ * This is a thin wrapper around a `FilesystemWatchService` subscription; the
+ * OS watch is shared with any other watchers in the same directory.
+ */
 class FilesystemWatcher final
   : public std::enable_shared_from_this<FilesystemWatcher> {
  public:
-  using unique_changenotification = std::
-    unique_ptr<HANDLE, CHandleDeleter<HANDLE, &FindCloseChangeNotification>>;
   static std::shared_ptr<FilesystemWatcher> Create(
     const std::filesystem::path&);
 
-  static OpenKneeboard::fire_and_forget final_release(
-    std::unique_ptr<FilesystemWatcher>);
-
   Event<std::filesystem::path> evFilesystemModifiedEvent;
 
   FilesystemWatcher() = delete;
@@ -54,19 +49,12 @@ class FilesystemWatcher final
  private:
   FilesystemWatcher(const std::filesystem::path&);
   void Initialize();
-  task<void> Run();
-  OpenKneeboard::fire_and_forget OnContentsChanged();
 
-  std::optional<task<void>> mImpl;
-
-  winrt::apartment_context mOwnerThread;
+  std::shared_ptr<EventMailbox> mOwnerThreadMailbox {
+    EventMailbox::GetForCurrentThread()};
   std::filesystem::path mPath;
 
-  std::filesystem::file_time_type mLastWriteTime;
-  bool mSettling = false;
-
-  unique_changenotification mHandle;
-  std::stop_source mStop;
+  std::unique_ptr<FilesystemWatchService::Subscription> mSubscription;
 };
 
 }// namespace OpenKneeboard
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <OpenKneeboard/Bookmark.hpp>
+#include <OpenKneeboard/BookmarkIndex.hpp>
 #include <OpenKneeboard/DXResources.hpp>
 #include <OpenKneeboard/Events.hpp>
 #include <OpenKneeboard/ITab.hpp>
@@ -102,7 +103,8 @@ class KneeboardView final : private EventReceiver,
 
   std::vector<winrt::guid> GetTabIDs() const noexcept;
 
-  std::vector<Bookmark> GetBookmarks() const;
+  /// Sorted by tab, then page
+  BookmarkIndex::Bookmarks GetBookmarks() const;
   void RemoveBookmark(const Bookmark&);
   void GoToBookmark(const Bookmark&);
 
@@ -138,6 +140,8 @@ class KneeboardView final : private EventReceiver,
   std::optional<Bookmark> GetBookmark(RelativePosition) const;
   void SetBookmark(RelativePosition);
   std::vector<std::shared_ptr<ITab>> GetRootTabs() const;
+  // Returns true if the bookmarks changed
+  bool UpdateBookmarkIndex(const ITab&);
 
   KneeboardView(
     const audited_ptr<DXResources>&,
@@ -166,6 +170,7 @@ class KneeboardView final : private EventReceiver,
   std::unique_ptr<TabViewUILayer> mTabViewUILayer;
 
   std::vector<EventHandlerToken> mTabEvents;
+  BookmarkIndex mBookmarkIndex;
 
   std::tuple<IUILayer*, std::span<IUILayer*>> GetUILayers() const;
 
@@ -76,9 +76,9 @@ class TabView final : private EventReceiver {
   bool SetTabMode(TabMode);
 
   Event<CursorEvent> evCursorEvent;
-  Event<> evNeedsRepaintEvent;
+  CoalescingEvent<> evNeedsRepaintEvent;
   Event<> evPageChangedEvent;
-  Event<> evContentChangedEvent;
+  CoalescingEvent<> evContentChangedEvent;
   Event<PageIndex> evPageChangeRequestedEvent;
   Event<> evAvailableFeaturesChangedEvent;
   Event<> evTabModeChangedEvent;
@@ -114,8 +114,14 @@ class TabView final : private EventReceiver {
 
   TabMode mTabMode = TabMode::Normal;
 
+  // Tabs can change many times per frame - e.g. while loading a folder - but
+  // we only need to catch up once
+  CoalescingEvent<> mTabContentChangedEvent;
+
   void OnTabContentChanged();
   void OnTabPageAppended(SuggestedPageAppendAction);
+  /// Handle a content change now, instead of waiting for the next frame
+  void CatchUpWithTabContent();
 
   ThreadGuard mThreadGuard;
 };
@@ -19,6 +19,7 @@
  */
 #pragma once
 
+#include <OpenKneeboard/CoroutineRegistry.hpp>
 #include <OpenKneeboard/Events.hpp>
 
 #include <OpenKneeboard/dprint.hpp>
@@ -61,6 +62,10 @@ class TroubleshootingStore final : private EventReceiver {
 
   std::string GetAPIEventsDebugLogAsString() const;
   std::string GetDPrintDebugLogAsString() const;
+  /// Live coroutines, and recent stalls on the UI thread
+  std::string GetCoroutinesDebugLogAsString() const;
+  /// Slowest event handlers, if `ProfileEventHandlers` is set in the registry
+  std::string GetEventHandlersDebugLogAsString() const;
 
   Event<APIEventEntry> evAPIEventReceived;
   Event<DPrintEntry> evDPrintMessageReceived;
@@ -71,6 +76,7 @@ class TroubleshootingStore final : private EventReceiver {
   std::jthread mDPrintThread;
   std::map<std::string, APIEventEntry> mAPIEvents;
   std::optional<std::ofstream> mLogFile;
+  std::unique_ptr<CoroutineRegistry::StallDetector> mUIThreadStalls;
 
   void InitializeLogFile();
   void WriteDPrintMessageToLogFile(const DPrintEntry&);
@@ -27,6 +27,7 @@
 
 #include <OpenKneeboard/APIEvent.hpp>
 #include <OpenKneeboard/ChromiumApp.hpp>
+#include <OpenKneeboard/CoroutineFramePool.hpp>
 #include <OpenKneeboard/DebugPrivileges.hpp>
 #include <OpenKneeboard/Elevation.hpp>
 #include <OpenKneeboard/Filesystem.hpp>
@@ -598,6 +599,16 @@ int __stdcall wWinMain(HINSTANCE, HINSTANCE, PWSTR, int showCommand) {
         HKEY_LOCAL_MACHINE, Config::RegistrySubKey, L"CreateFullDumps")
         .value_or(0);
   SetDumpType(fullDumps ? DumpType::FullDump : DumpType::MiniDump);
+  if (wil::reg::try_get_value_dword(
+        HKEY_LOCAL_MACHINE, Config::RegistrySubKey, L"FullExceptionStackTraces")
+        .value_or(0)) {
+    SetExceptionStackTraces(ExceptionStackTraces::Full);
+  }
+  if (wil::reg::try_get_value_dword(
+        HKEY_LOCAL_MACHINE, Config::RegistrySubKey, L"TrackCoroutineFrames")
+        .value_or(0)) {
+    CoroutineFramePool::EnableLeakTracking();
+  }
 
   // CreateMutex can set ERROR_ALREADY_EXISTS on success, so we need to
   // have a known-succeeding initial state.
@@ -734,6 +745,22 @@ int __stdcall wWinMain(HINSTANCE, HINSTANCE, PWSTR, int showCommand) {
   }
   gDXResources = nullptr;
 
+  if (const auto frames = CoroutineFramePool::GetStatistics();
+      frames.mFramesInFlight > 0) {
+    dprint("----- POTENTIAL LEAK -----");
+    dprint(
+      "{} coroutine frames ({} bytes) are still allocated",
+      frames.mFramesInFlight,
+      frames.mBytesInFlight);
+    for (const auto& frame: CoroutineFramePool::GetLiveFrames()) {
+      dprint(
+        "- {} bytes at {}, allocated by {}",
+        frame.mSize,
+        frame.mFrame,
+        StackFramePointer {const_cast<void*>(frame.mCaller)}.to_string());
+    }
+  }
+
   gTroubleshootingStore = {};
 
   return 0;
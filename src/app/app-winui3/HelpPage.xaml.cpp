@@ -234,6 +234,8 @@ OpenKneeboard::fire_and_forget HelpPage::OnExportClick(
 
   AddFile("debug-log.txt", ts->GetDPrintDebugLogAsString());
   AddFile("api-events.txt", ts->GetAPIEventsDebugLogAsString());
+  AddFile("coroutines.txt", ts->GetCoroutinesDebugLogAsString());
+  AddFile("event-handlers.txt", ts->GetEventHandlersDebugLogAsString());
   AddFile("openxr.txt", GetOpenXRInfo());
   AddFile("update-history.txt", GetUpdateLog());
   AddFile("renderers.txt", GetActiveConsumers());
@@ -347,6 +347,10 @@ task<void> MainWindow::FrameTick(
     co_return;
   }
 
+  // Deliver anything that's changed since the last frame, so that it's
+  // included in this one
+  CoalescingEventBase::FlushForCurrentThread();
+
   std::shared_lock kbLock(*mKneeboard, std::try_to_lock);
   if (!kbLock.owns_lock()) {
     TraceLoggingWriteStop(
@@ -1020,9 +1024,9 @@ MainWindow::NavigationItems() noexcept {
   auto navItems = winrt::single_threaded_vector<IInspectable>();
   navItems.Clear();
 
-  decltype(mKneeboardView->GetBookmarks()) bookmarks;
+  std::vector<Bookmark> bookmarks;
   if (mKneeboardView && mKneeboard->GetUISettings().mBookmarks.mEnabled) {
-    bookmarks = mKneeboardView->GetBookmarks();
+    bookmarks = *mKneeboardView->GetBookmarks();
   }
   auto bookmark = bookmarks.begin();
   size_t bookmarkCount = 0;
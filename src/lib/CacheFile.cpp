@@ -0,0 +1,176 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CacheFile.hpp>
+#include <OpenKneeboard/ContentHash.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <thread>
+
+namespace OpenKneeboard::CacheFile {
+
+namespace {
+struct Header {
+  uint32_t mMagic {};
+  uint32_t mVersion {};
+  uint64_t mPayloadSize {};
+  ContentHash mPayloadChecksum {};
+};
+// Files written with the previous 64-bit checksum have a different header
+// size, so fail to load and are replaced
+static_assert(sizeof(Header) == 56);
+
+// Files are tiny compared to the documents they describe, but a corrupt size
+// shouldn't lead to a huge allocation
+constexpr uint64_t MaxPayloadSize = 256 * 1024 * 1024;
+
+}// namespace
+
+bool Save(
+  const std::filesystem::path& path,
+  uint32_t magic,
+  uint32_t version,
+  std::span<const std::byte> payload) noexcept {
+  static std::atomic_uint64_t sCounter {};
+
+  const Header header {
+    .mMagic = magic,
+    .mVersion = version,
+    .mPayloadSize = payload.size(),
+    .mPayloadChecksum = HashContent(payload),
+  };
+
+  // Write to a temporary file then rename, so readers never see a partial
+  // file, and concurrent writers don't interleave
+  std::filesystem::path temporary;
+  std::error_code ec;
+  try {
+    std::filesystem::create_directories(path.parent_path(), ec);
+    temporary = path;
+    temporary += std::format(
+      ".{}-{}.tmp",
+      std::hash<std::thread::id> {}(std::this_thread::get_id()),
+      ++sCounter);
+  } catch (const std::exception&) {
+    // Allocation or formatting failures; as with I/O failures, we just
+    // don't cache
+    return false;
+  }
+  {
+    std::ofstream f(temporary, std::ios::binary | std::ios::trunc);
+    f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    f.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    if (!f) {
+      f.close();
+      std::filesystem::remove(temporary, ec);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(temporary, path, ec);
+  if (ec) {
+    std::filesystem::remove(temporary, ec);
+    return false;
+  }
+  return true;
+}
+
+std::optional<std::vector<std::byte>> Load(
+  const std::filesystem::path& path,
+  uint32_t magic,
+  uint32_t version) noexcept {
+  std::vector<std::byte> payload;
+  {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+      return std::nullopt;
+    }
+
+    Header header;
+    f.read(reinterpret_cast<char*>(&header), sizeof(header));
+    const bool valid = f && header.mMagic == magic
+      && header.mVersion == version
+      && header.mPayloadSize <= MaxPayloadSize && [&] {
+           try {
+             payload.resize(header.mPayloadSize);
+           } catch (const std::bad_alloc&) {
+             return false;
+           }
+           f.read(reinterpret_cast<char*>(payload.data()), payload.size());
+           // Must be exactly the right size: trailing data is corruption too
+           return f && f.peek() == std::ifstream::traits_type::eof()
+             && HashContent(payload) == header.mPayloadChecksum;
+         }();
+    if (valid) {
+      return payload;
+    }
+  }
+
+  // Corrupt, truncated, or from another version
+  std::error_code ec;
+  std::filesystem::remove(path, ec);
+  return std::nullopt;
+}
+
+void Prune(
+  const std::filesystem::path& directory,
+  std::size_t maxEntries,
+  uint64_t maxBytes) {
+  struct Entry {
+    std::filesystem::file_time_type mTime;
+    uint64_t mSize {};
+    std::filesystem::path mPath;
+  };
+  std::error_code ec;
+  std::vector<Entry> entries;
+  uint64_t totalSize {};
+  for (const auto& it: std::filesystem::directory_iterator(directory, ec)) {
+    if (it.path().extension() == ".bin") {
+      const auto size = it.file_size(ec);
+      entries.push_back({it.last_write_time(ec), ec ? 0 : size, it.path()});
+      totalSize += entries.back().mSize;
+    }
+  }
+  if (entries.size() <= maxEntries && totalSize <= maxBytes) {
+    return;
+  }
+
+  // Newest first
+  std::ranges::sort(entries, std::greater {}, &Entry::mTime);
+  std::size_t keptEntries {};
+  uint64_t keptBytes {};
+  bool full = false;
+  for (const auto& it: entries) {
+    full = full || keptEntries == maxEntries
+      || keptBytes + it.mSize > maxBytes;
+    if (full) {
+      std::filesystem::remove(it.mPath, ec);
+      continue;
+    }
+    ++keptEntries;
+    keptBytes += it.mSize;
+  }
+}
+
+}// namespace OpenKneeboard::CacheFile
@@ -0,0 +1,146 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/ContentHash.hpp>
+
+#include <OpenKneeboard/fatal.hpp>
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <vector>
+
+#include <bcrypt.h>
+
+namespace OpenKneeboard {
+
+namespace {
+
+void CheckStatus(NTSTATUS status, const char* what) {
+  if (!BCRYPT_SUCCESS(status)) {
+    fatal("{} failed: {:#010x}", what, static_cast<uint32_t>(status));
+  }
+}
+
+BCRYPT_ALG_HANDLE GetSHA256Algorithm() {
+  // Shared by all hashers and never closed; opening a provider is
+  // expensive, and BCrypt hash objects are thread-safe to create from it.
+  static const auto sAlgorithm = [] {
+    BCRYPT_ALG_HANDLE ret {};
+    CheckStatus(
+      BCryptOpenAlgorithmProvider(&ret, BCRYPT_SHA256_ALGORITHM, nullptr, 0),
+      "BCryptOpenAlgorithmProvider(SHA256)");
+    return ret;
+  }();
+  return sAlgorithm;
+}
+
+}// namespace
+
+struct ContentHasher::Impl {
+  BCRYPT_HASH_HANDLE mHash {};
+  uint64_t mByteLength {};
+};
+
+ContentHasher::ContentHasher() : mImpl(std::make_unique<Impl>()) {
+  CheckStatus(
+    BCryptCreateHash(
+      GetSHA256Algorithm(), &mImpl->mHash, nullptr, 0, nullptr, 0, 0),
+    "BCryptCreateHash");
+}
+
+ContentHasher::~ContentHasher() {
+  if (mImpl->mHash) {
+    BCryptDestroyHash(mImpl->mHash);
+  }
+}
+
+void ContentHasher::Update(std::span<const std::byte> data) {
+  mImpl->mByteLength += data.size();
+  while (!data.empty()) {
+    const auto count = std::min<std::size_t>(
+      data.size(), std::numeric_limits<ULONG>::max());
+    CheckStatus(
+      BCryptHashData(
+        mImpl->mHash,
+        reinterpret_cast<PUCHAR>(const_cast<std::byte*>(data.data())),
+        static_cast<ULONG>(count),
+        0),
+      "BCryptHashData");
+    data = data.subspan(count);
+  }
+}
+
+ContentHash ContentHasher::Finish() {
+  ContentHash ret {.mByteLength = mImpl->mByteLength};
+  CheckStatus(
+    BCryptFinishHash(
+      mImpl->mHash,
+      ret.mSHA256.data(),
+      static_cast<ULONG>(ret.mSHA256.size()),
+      0),
+    "BCryptFinishHash");
+  return ret;
+}
+
+std::string ContentHash::ToString() const {
+  std::string ret;
+  ret.reserve((mSHA256.size() * 2) + 21);
+  for (const auto byte: mSHA256) {
+    std::format_to(std::back_inserter(ret), "{:02x}", byte);
+  }
+  std::format_to(std::back_inserter(ret), "-{}", mByteLength);
+  return ret;
+}
+
+ContentHash HashContent(std::span<const std::byte> data) {
+  ContentHasher hasher;
+  hasher.Update(data);
+  return hasher.Finish();
+}
+
+std::optional<ContentHash> HashFileContent(
+  const std::filesystem::path& path,
+  std::size_t maxBytes) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) {
+    return std::nullopt;
+  }
+
+  ContentHasher hasher;
+  std::vector<std::byte> buffer(1024 * 1024);
+  while (maxBytes > 0) {
+    const auto count = std::min(buffer.size(), maxBytes);
+    f.read(reinterpret_cast<char*>(buffer.data()), count);
+    const auto read = static_cast<std::size_t>(f.gcount());
+    hasher.Update({buffer.data(), read});
+    maxBytes -= read;
+    if (read < count) {
+      if (f.bad()) {
+        return std::nullopt;
+      }
+      break;
+    }
+  }
+  return hasher.Finish();
+}
+
+}// namespace OpenKneeboard
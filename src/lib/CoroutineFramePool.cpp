@@ -0,0 +1,334 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CoroutineFramePool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+namespace OpenKneeboard::CoroutineFramePool {
+
+namespace {
+
+constexpr std::size_t Granularity = 64;
+constexpr std::size_t ClassCount = MaxPooledSize / Granularity;
+// Enough to absorb bursts without holding on to much memory per thread
+constexpr std::size_t MaxCachedPerClass = 64;
+// Blocks moved between a thread cache and the shared pool at once
+constexpr std::size_t BatchSize = 32;
+constexpr std::size_t MaxSharedPerClass = 1024;
+
+static_assert(MaxPooledSize % Granularity == 0);
+static_assert(BatchSize < MaxCachedPerClass);
+
+constexpr std::size_t GetSizeClass(std::size_t size) {
+  return (size - 1) / Granularity;
+}
+
+constexpr std::size_t GetBlockSize(std::size_t sizeClass) {
+  return (sizeClass + 1) * Granularity;
+}
+
+struct FreeBlock {
+  FreeBlock* mNext {nullptr};
+};
+
+struct FreeList {
+  FreeBlock* mHead {nullptr};
+  std::size_t mCount {};
+
+  void Push(void* block) noexcept {
+    mHead = new (block) FreeBlock {mHead};
+    ++mCount;
+  }
+
+  void* Pop() noexcept {
+    auto ret = mHead;
+    mHead = ret->mNext;
+    --mCount;
+    return ret;
+  }
+
+  void Free(std::size_t sizeClass) noexcept {
+    while (mHead) {
+      ::operator delete(this->Pop(), GetBlockSize(sizeClass));
+    }
+  }
+};
+
+// Only ever written by the owning thread, but read by `GetStatistics()`
+struct Counters {
+  std::atomic_uint64_t mAllocations;
+  std::atomic_uint64_t mPoolHits;
+  std::atomic_uint64_t mLargeAllocations;
+  // Signed, as frames are often freed by a different thread
+  std::atomic_int64_t mFrames;
+  std::atomic_int64_t mBytes;
+
+  static void Increment(auto& counter, int64_t delta = 1) noexcept {
+    counter.store(
+      counter.load(std::memory_order_relaxed) + delta,
+      std::memory_order_relaxed);
+  }
+};
+
+struct ThreadCache;
+
+// Intentionally leaked, so that frames freed during static destruction -
+// or by threads that outlive `main()` - are still safe
+struct SharedPool {
+  std::mutex mMutex;
+  std::array<FreeList, ClassCount> mFree;
+  std::vector<ThreadCache*> mThreads;
+  // Totals from threads that have exited
+  int64_t mFrames {};
+  int64_t mBytes {};
+  Statistics mRetired;
+
+  // Used after a thread's cache has been destroyed
+  std::mutex mOrphanMutex;
+  Counters mOrphanCounters;
+
+  std::atomic_bool mTracking {false};
+  std::mutex mTrackingMutex;
+  std::unordered_map<const void*, LiveFrame> mLiveFrames;
+
+  static SharedPool& Get() {
+    static auto sInstance = new SharedPool();
+    return *sInstance;
+  }
+};
+
+struct ThreadCache {
+  std::array<FreeList, ClassCount> mFree;
+  Counters mCounters;
+
+  ThreadCache() {
+    auto& shared = SharedPool::Get();
+    std::unique_lock lock(shared.mMutex);
+    shared.mThreads.push_back(this);
+  }
+
+  ~ThreadCache();
+
+  void* Allocate(std::size_t sizeClass) {
+    auto& list = mFree[sizeClass];
+    if (!list.mHead) {
+      this->Refill(sizeClass);
+    }
+    if (list.mHead) {
+      Counters::Increment(mCounters.mPoolHits);
+      return list.Pop();
+    }
+    return ::operator new(GetBlockSize(sizeClass));
+  }
+
+  void Deallocate(void* block, std::size_t sizeClass) noexcept {
+    auto& list = mFree[sizeClass];
+    list.Push(block);
+    if (list.mCount > MaxCachedPerClass) [[unlikely]] {
+      this->Release(sizeClass, BatchSize);
+    }
+  }
+
+ private:
+  void Refill(std::size_t sizeClass) {
+    auto& shared = SharedPool::Get();
+    auto& list = mFree[sizeClass];
+    std::unique_lock lock(shared.mMutex);
+    auto& from = shared.mFree[sizeClass];
+    for (std::size_t i = 0; i < BatchSize && from.mHead; ++i) {
+      list.Push(from.Pop());
+    }
+  }
+
+  void Release(std::size_t sizeClass, std::size_t count) noexcept {
+    auto& shared = SharedPool::Get();
+    auto& list = mFree[sizeClass];
+    FreeList excess;
+    {
+      std::unique_lock lock(shared.mMutex);
+      auto& to = shared.mFree[sizeClass];
+      for (std::size_t i = 0; i < count && list.mHead; ++i) {
+        if (to.mCount < MaxSharedPerClass) {
+          to.Push(list.Pop());
+        } else {
+          excess.Push(list.Pop());
+        }
+      }
+    }
+    excess.Free(sizeClass);
+  }
+
+  friend struct ThreadCacheHolder;
+};
+
+// Non-trivially-destructible thread_locals are destroyed at thread exit in
+// an unspecified order relative to each other; frames can be freed by later
+// destructors, so track whether the cache is still usable in a trivial one
+thread_local ThreadCache* tCache {nullptr};
+thread_local bool tExiting {false};
+
+struct ThreadCacheHolder {
+  ThreadCache mCache;
+
+  ThreadCacheHolder() {
+    tCache = &mCache;
+  }
+
+  ~ThreadCacheHolder() {
+    tCache = nullptr;
+    tExiting = true;
+  }
+};
+
+ThreadCache::~ThreadCache() {
+  for (std::size_t i = 0; i < ClassCount; ++i) {
+    this->Release(i, mFree[i].mCount);
+  }
+
+  auto& shared = SharedPool::Get();
+  std::unique_lock lock(shared.mMutex);
+  std::erase(shared.mThreads, this);
+  shared.mRetired.mAllocations += mCounters.mAllocations;
+  shared.mRetired.mPoolHits += mCounters.mPoolHits;
+  shared.mRetired.mLargeAllocations += mCounters.mLargeAllocations;
+  shared.mFrames += mCounters.mFrames;
+  shared.mBytes += mCounters.mBytes;
+}
+
+ThreadCache* GetThreadCache() {
+  if (tCache) [[likely]] {
+    return tCache;
+  }
+  if (tExiting) {
+    return nullptr;
+  }
+  thread_local ThreadCacheHolder holder;
+  return tCache;
+}
+
+}// namespace
+
+void* Allocate(std::size_t size, const void* caller) {
+  auto& shared = SharedPool::Get();
+  auto cache = GetThreadCache();
+  auto counters = cache ? &cache->mCounters : &shared.mOrphanCounters;
+  std::unique_lock<std::mutex> orphanLock;
+  if (!cache) [[unlikely]] {
+    orphanLock = std::unique_lock {shared.mOrphanMutex};
+  }
+
+  void* ret = nullptr;
+  if (size > MaxPooledSize) [[unlikely]] {
+    Counters::Increment(counters->mLargeAllocations);
+    ret = ::operator new(size);
+  } else if (cache) [[likely]] {
+    ret = cache->Allocate(GetSizeClass(size));
+  } else {
+    ret = ::operator new(GetBlockSize(GetSizeClass(size)));
+  }
+
+  Counters::Increment(counters->mAllocations);
+  Counters::Increment(counters->mFrames);
+  Counters::Increment(counters->mBytes, static_cast<int64_t>(size));
+
+  if (shared.mTracking.load(std::memory_order_relaxed)) [[unlikely]] {
+    std::unique_lock lock(shared.mTrackingMutex);
+    shared.mLiveFrames.emplace(ret, LiveFrame {ret, size, caller});
+  }
+  return ret;
+}
+
+void Deallocate(void* frame, std::size_t size) noexcept {
+  auto& shared = SharedPool::Get();
+  if (shared.mTracking.load(std::memory_order_relaxed)) [[unlikely]] {
+    std::unique_lock lock(shared.mTrackingMutex);
+    shared.mLiveFrames.erase(frame);
+  }
+
+  auto cache = GetThreadCache();
+  auto counters = cache ? &cache->mCounters : &shared.mOrphanCounters;
+  std::unique_lock<std::mutex> orphanLock;
+  if (!cache) [[unlikely]] {
+    orphanLock = std::unique_lock {shared.mOrphanMutex};
+  }
+  Counters::Increment(counters->mFrames, -1);
+  Counters::Increment(counters->mBytes, -static_cast<int64_t>(size));
+
+  if (size > MaxPooledSize) [[unlikely]] {
+    ::operator delete(frame, size);
+    return;
+  }
+  const auto sizeClass = GetSizeClass(size);
+  if (cache) [[likely]] {
+    cache->Deallocate(frame, sizeClass);
+    return;
+  }
+  ::operator delete(frame, GetBlockSize(sizeClass));
+}
+
+Statistics GetStatistics() {
+  auto& shared = SharedPool::Get();
+  std::unique_lock lock(shared.mMutex);
+  std::unique_lock orphanLock(shared.mOrphanMutex);
+
+  auto ret = shared.mRetired;
+  auto frames = shared.mFrames;
+  auto bytes = shared.mBytes;
+  const auto add = [&](const Counters& it) {
+    ret.mAllocations += it.mAllocations.load(std::memory_order_relaxed);
+    ret.mPoolHits += it.mPoolHits.load(std::memory_order_relaxed);
+    ret.mLargeAllocations
+      += it.mLargeAllocations.load(std::memory_order_relaxed);
+    frames += it.mFrames.load(std::memory_order_relaxed);
+    bytes += it.mBytes.load(std::memory_order_relaxed);
+  };
+  for (const auto thread: shared.mThreads) {
+    add(thread->mCounters);
+  }
+  add(shared.mOrphanCounters);
+
+  // Per-thread counters are read at slightly different times, so the sum
+  // can briefly be negative
+  ret.mFramesInFlight = static_cast<uint64_t>(std::max<int64_t>(frames, 0));
+  ret.mBytesInFlight = static_cast<uint64_t>(std::max<int64_t>(bytes, 0));
+  return ret;
+}
+
+void EnableLeakTracking() {
+  SharedPool::Get().mTracking.store(true);
+}
+
+std::vector<LiveFrame> GetLiveFrames() {
+  auto& shared = SharedPool::Get();
+  std::unique_lock lock(shared.mTrackingMutex);
+  std::vector<LiveFrame> ret;
+  ret.reserve(shared.mLiveFrames.size());
+  for (const auto& [address, frame]: shared.mLiveFrames) {
+    ret.push_back(frame);
+  }
+  return ret;
+}
+
+}// namespace OpenKneeboard::CoroutineFramePool
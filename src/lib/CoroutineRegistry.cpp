@@ -0,0 +1,390 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CoroutineRegistry.hpp>
+
+#include <OpenKneeboard/dprint.hpp>
+#include <OpenKneeboard/fatal.hpp>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <type_traits>
+
+namespace OpenKneeboard::CoroutineRegistry {
+
+namespace {
+
+// `std::thread::id` isn't constexpr-constructible everywhere, so store its
+// bits, keeping the registry constant-initialized
+using ThreadIDBits
+  = std::conditional_t<sizeof(std::thread::id) == 4, uint32_t, uint64_t>;
+static_assert(sizeof(ThreadIDBits) == sizeof(std::thread::id));
+
+// Slots are written by whichever thread is running the coroutine; keep them
+// on separate cache lines so unrelated coroutines don't contend
+struct alignas(64) Slot {
+  // Odd while an update is in progress
+  std::atomic_uint32_t mSequence {};
+  // Only meaningful while the slot is free; see `Registry`
+  std::atomic<SlotID> mNextFree {};
+
+  std::atomic_bool mInUse {false};
+  std::atomic<CoroutineState> mState {};
+  std::atomic<const void*> mCreator {nullptr};
+  std::atomic<const void*> mAwaitPoint {nullptr};
+  std::atomic<ThreadIDBits> mThread {};
+  std::atomic<CoarseClock::rep> mSince {};
+  std::atomic_uint64_t mThreadSequence {};
+
+  /* A slot is only written by the thread that currently owns its coroutine,
+   * so this doesn't need to handle concurrent writers; it just lets readers
+   * detect that they raced with an update.
+   */
+  template <class F>
+  void Update(F&& f) noexcept {
+    const auto sequence = mSequence.load(std::memory_order_relaxed);
+    mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    f();
+    mSequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  void SetState(CoroutineState state) noexcept {
+    thread_local uint64_t tSequence {};
+    mThread.store(
+      std::bit_cast<ThreadIDBits>(std::this_thread::get_id()),
+      std::memory_order_relaxed);
+    mState.store(state, std::memory_order_relaxed);
+    mSince.store(
+      CoarseClock::now().time_since_epoch().count(),
+      std::memory_order_relaxed);
+    mThreadSequence.store(++tSequence, std::memory_order_relaxed);
+  }
+
+  std::optional<LiveCoroutine> Read(SlotID id) const noexcept {
+    // If it keeps changing this quickly, it's not stuck
+    for (int attempt = 0; attempt < 3; ++attempt) {
+      const auto before = mSequence.load(std::memory_order_acquire);
+      if (before & 1) {
+        continue;
+      }
+      const auto inUse = mInUse.load(std::memory_order_relaxed);
+      const LiveCoroutine ret {
+        .mSlot = id,
+        .mCreator = mCreator.load(std::memory_order_relaxed),
+        .mAwaitPoint = mAwaitPoint.load(std::memory_order_relaxed),
+        .mThread = std::bit_cast<std::thread::id>(
+          mThread.load(std::memory_order_relaxed)),
+        .mState = mState.load(std::memory_order_relaxed),
+        .mSince = CoarseClock::time_point {
+          CoarseClock::duration {mSince.load(std::memory_order_relaxed)}},
+        .mThreadSequence = mThreadSequence.load(std::memory_order_relaxed),
+      };
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (mSequence.load(std::memory_order_relaxed) != before) {
+        continue;
+      }
+      if (!inUse) {
+        return std::nullopt;
+      }
+      return ret;
+    }
+    return std::nullopt;
+  }
+};
+
+/* Free slots are a lock-free stack; the head is tagged with a counter to
+ * avoid ABA problems when a slot is popped and pushed again while another
+ * thread is trying to pop it. Links are stored as `SlotID + 1`, so that zero
+ * means 'none', and the whole registry can be zero-initialized.
+ *
+ * Slots that have never been used aren't on the stack; they're handed out in
+ * order, so readers only need to look at slots below `mHighWater`.
+ */
+struct Registry {
+  std::array<Slot, Capacity> mSlots;
+  std::atomic_uint64_t mFreeHead {0};
+  std::atomic<SlotID> mHighWater {0};
+
+  std::atomic_uint64_t mUntracked {};
+
+  static constexpr uint64_t MakeHead(uint64_t previous, SlotID link) noexcept {
+    return (((previous >> 32) + 1) << 32) | link;
+  }
+
+  SlotID Pop() noexcept {
+    auto head = mFreeHead.load(std::memory_order_acquire);
+    while (const auto link = static_cast<SlotID>(head)) {
+      const auto next
+        = mSlots[link - 1].mNextFree.load(std::memory_order_relaxed);
+      if (mFreeHead.compare_exchange_weak(
+            head,
+            MakeHead(head, next),
+            std::memory_order_acquire,
+            std::memory_order_acquire)) {
+        return link - 1;
+      }
+    }
+
+    auto next = mHighWater.load(std::memory_order_relaxed);
+    while (next < Capacity) {
+      if (mHighWater.compare_exchange_weak(
+            next, next + 1, std::memory_order_relaxed)) {
+        return next;
+      }
+    }
+    return NoSlot;
+  }
+
+  void Push(SlotID id) noexcept {
+    auto head = mFreeHead.load(std::memory_order_relaxed);
+    do {
+      mSlots[id].mNextFree.store(
+        static_cast<SlotID>(head), std::memory_order_relaxed);
+    } while (!mFreeHead.compare_exchange_weak(
+      head,
+      MakeHead(head, id + 1),
+      std::memory_order_release,
+      std::memory_order_relaxed));
+  }
+
+  template <class F>
+  void ForEachLive(F&& f) const {
+    const auto count = mHighWater.load(std::memory_order_acquire);
+    for (SlotID id = 0; id < count; ++id) {
+      if (const auto it = mSlots[id].Read(id)) {
+        f(*it);
+      }
+    }
+  }
+
+  static Registry& Get() noexcept;
+};
+
+// Constant-initialized and trivially destructible, so it's usable by
+// coroutines created or destroyed during static initialization or
+// destruction
+constinit Registry gRegistry;
+
+Registry& Registry::Get() noexcept {
+  return gRegistry;
+}
+
+std::string ToString(const void* address) {
+  return StackFramePointer {const_cast<void*>(address)}.to_string();
+}
+
+}// namespace
+
+CoarseClock::time_point CoarseClock::now() noexcept {
+#if defined(_WIN32)
+  return time_point {duration {static_cast<rep>(GetTickCount64())}};
+#elif defined(__linux__)
+  timespec ts {};
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return time_point {duration {ts.tv_sec * 1000 + ts.tv_nsec / 1'000'000}};
+#else
+  return std::chrono::time_point_cast<duration>(
+    time_point {std::chrono::steady_clock::now().time_since_epoch()});
+#endif
+}
+
+SlotID Register(const void* creator) noexcept {
+  auto& registry = Registry::Get();
+  const auto id = registry.Pop();
+  if (id == NoSlot) [[unlikely]] {
+    registry.mUntracked.fetch_add(1, std::memory_order_relaxed);
+    return NoSlot;
+  }
+
+  auto& slot = registry.mSlots[id];
+  slot.Update([&] {
+    slot.mInUse.store(true, std::memory_order_relaxed);
+    slot.mCreator.store(creator, std::memory_order_relaxed);
+    slot.mAwaitPoint.store(nullptr, std::memory_order_relaxed);
+    slot.SetState(CoroutineState::Running);
+  });
+  return id;
+}
+
+void Unregister(SlotID id) noexcept {
+  if (id == NoSlot) {
+    return;
+  }
+  auto& registry = Registry::Get();
+  auto& slot = registry.mSlots[id];
+  slot.Update([&] { slot.mInUse.store(false, std::memory_order_relaxed); });
+  registry.Push(id);
+}
+
+void OnSuspend(SlotID id, const void* awaitPoint) noexcept {
+  if (id == NoSlot) {
+    return;
+  }
+  auto& slot = Registry::Get().mSlots[id];
+  slot.Update([&] {
+    slot.mAwaitPoint.store(awaitPoint, std::memory_order_relaxed);
+    slot.SetState(CoroutineState::Suspended);
+  });
+}
+
+void OnResume(SlotID id) noexcept {
+  if (id == NoSlot) {
+    return;
+  }
+  auto& slot = Registry::Get().mSlots[id];
+  slot.Update([&] { slot.SetState(CoroutineState::Running); });
+}
+
+void OnComplete(SlotID id) noexcept {
+  if (id == NoSlot) {
+    return;
+  }
+  auto& slot = Registry::Get().mSlots[id];
+  slot.Update([&] { slot.SetState(CoroutineState::Completed); });
+}
+
+std::vector<LiveCoroutine> GetLiveCoroutines() {
+  std::vector<LiveCoroutine> ret;
+  Registry::Get().ForEachLive(
+    [&ret](const LiveCoroutine& it) { ret.push_back(it); });
+  return ret;
+}
+
+Statistics GetStatistics() noexcept {
+  const auto& registry = Registry::Get();
+  return {
+    .mHighWater = registry.mHighWater.load(std::memory_order_relaxed),
+    .mUntracked = registry.mUntracked.load(std::memory_order_relaxed),
+  };
+}
+
+StallDetector::StallDetector(
+  std::thread::id thread,
+  std::chrono::steady_clock::duration budget)
+  : mThreadID(thread), mBudget(budget) {
+  mWatchdog = std::jthread {[this](std::stop_token stopToken) {
+    std::mutex mutex;
+    std::condition_variable_any cv;
+    std::unique_lock lock(mutex);
+    while (!stopToken.stop_requested()) {
+      cv.wait_for(lock, stopToken, mBudget, [] { return false; });
+      if (!stopToken.stop_requested()) {
+        this->Check();
+      }
+    }
+  }};
+}
+
+StallDetector::~StallDetector() = default;
+
+std::thread::id StallDetector::GetThreadID() const noexcept {
+  return mThreadID;
+}
+
+std::chrono::steady_clock::duration StallDetector::GetBudget() const noexcept {
+  return mBudget;
+}
+
+std::vector<StallDetector::Stall> StallDetector::GetStalls() const {
+  std::unique_lock lock(mMutex);
+  return mStalls;
+}
+
+void StallDetector::Check() {
+  std::optional<LiveCoroutine> running;
+  Registry::Get().ForEachLive([&](const LiveCoroutine& it) {
+    if (it.mState != CoroutineState::Running || it.mThread != mThreadID) {
+      return;
+    }
+    if (!running || it.mThreadSequence > running->mThreadSequence) {
+      running = it;
+    }
+  });
+
+  // Checks are at least a budget apart, so if it's the same run as last
+  // time, it's been running for at least a budget
+  const auto now = std::chrono::steady_clock::now();
+  const auto stalled = running && mCandidate
+    && running->mSlot == mCandidate->mSlot
+    && running->mThreadSequence == mCandidate->mThreadSequence;
+  if (!running) {
+    mCandidate = std::nullopt;
+  } else if (!stalled) {
+    mCandidate = {running->mSlot, running->mThreadSequence, now};
+  }
+  const auto duration = stalled
+    ? std::max<std::chrono::steady_clock::duration>(
+        now - mCandidate->mFirstSeen, CoarseClock::now() - running->mSince)
+    : std::chrono::steady_clock::duration {};
+
+  std::optional<Stall> ended;
+  std::optional<Stall> started;
+  {
+    std::unique_lock lock(mMutex);
+    if (!mStalls.empty() && mStalls.back().mOngoing) {
+      auto& ongoing = mStalls.back();
+      if (
+        stalled && running->mSlot == ongoing.mCoroutine.mSlot
+        && running->mThreadSequence == ongoing.mCoroutine.mThreadSequence) {
+        ongoing.mDuration = duration;
+        return;
+      }
+      ongoing.mOngoing = false;
+      ended = ongoing;
+    }
+    if (stalled) {
+      if (mStalls.size() == MaxStalls) {
+        mStalls.erase(mStalls.begin());
+      }
+      started = mStalls.emplace_back(
+        *running, std::chrono::system_clock::now(), duration);
+    }
+  }
+
+  using Milliseconds = std::chrono::duration<float, std::milli>;
+  if (ended) {
+    dprint(
+      "Coroutine stall ended after at least {:0.1f}ms",
+      std::chrono::duration_cast<Milliseconds>(ended->mDuration).count());
+  }
+  if (started) {
+    dprint.Warning(
+      "Coroutine created by {} has been running on thread {} for {:0.1f}ms; "
+      "budget is {:0.1f}ms",
+      ToString(started->mCoroutine.mCreator),
+      mThreadID,
+      std::chrono::duration_cast<Milliseconds>(started->mDuration).count(),
+      std::chrono::duration_cast<Milliseconds>(mBudget).count());
+  }
+}
+
+}// namespace OpenKneeboard::CoroutineRegistry
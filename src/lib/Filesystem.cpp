@@ -273,6 +273,19 @@ std::filesystem::path GetLocalAppDataDirectory() {
   return sPath;
 }
 
+std::filesystem::path GetCacheDirectory() {
+  static LazyPath sPath {[]() -> std::filesystem::path {
+    const auto base = GetLocalAppDataDirectory();
+    if (base.empty()) {
+      return {};
+    }
+    const auto ret = base / "Cache";
+    std::filesystem::create_directories(ret);
+    return ret;
+  }};
+  return sPath;
+}
+
 std::filesystem::path GetLogsDirectory() {
   static LazyPath sPath {[]() -> std::filesystem::path {
     const auto oldPath = GetLocalAppDataDirectory() / "Logs";
@@ -340,26 +353,4 @@ ScopedDeleter::~ScopedDeleter() noexcept {
     std::filesystem::remove_all(mPath);
   }
 }
-
-TemporaryCopy::TemporaryCopy(
-  const std::filesystem::path& source,
-  const std::filesystem::path& destination) {
-  if (!std::filesystem::exists(source)) {
-    throw std::logic_error("TemporaryCopy created without a source file");
-  }
-  if (std::filesystem::exists(destination)) {
-    throw std::logic_error(
-      "TemporaryCopy created, but destination already exists");
-  }
-  std::filesystem::copy(source, destination);
-  mCopy = destination;
-}
-
-TemporaryCopy::~TemporaryCopy() noexcept {
-  std::filesystem::remove(mCopy);
-}
-
-std::filesystem::path TemporaryCopy::GetPath() const noexcept {
-  return mCopy;
-}
 };// namespace OpenKneeboard::Filesystem
\ No newline at end of file
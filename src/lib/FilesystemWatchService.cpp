@@ -0,0 +1,322 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/FilesystemWatchService.hpp>
+
+#include <algorithm>
+
+namespace OpenKneeboard {
+
+FilesystemWatchBackend::Handle::~Handle() = default;
+FilesystemWatchBackend::~FilesystemWatchBackend() = default;
+
+FilesystemWatchService::Subscription::Subscription(
+  std::shared_ptr<FilesystemWatchService> service,
+  uint64_t id)
+  : mService(std::move(service)), mID(id) {
+}
+
+FilesystemWatchService::Subscription::~Subscription() {
+  mService->Unsubscribe(mID);
+}
+
+std::shared_ptr<FilesystemWatchService> FilesystemWatchService::Get() {
+  static const auto sInstance
+    = FilesystemWatchService::Create(CreatePlatformFilesystemWatchBackend());
+  return sInstance;
+}
+
+std::shared_ptr<FilesystemWatchService> FilesystemWatchService::Create(
+  std::unique_ptr<FilesystemWatchBackend> backend,
+  Clock::duration settleTime) {
+  return std::shared_ptr<FilesystemWatchService>(
+    new FilesystemWatchService(std::move(backend), settleTime));
+}
+
+FilesystemWatchService::FilesystemWatchService(
+  std::unique_ptr<FilesystemWatchBackend> backend,
+  Clock::duration settleTime)
+  : mBackend(std::move(backend)),
+    mSettleTime(settleTime),
+    mWheelTime(Clock::now()) {
+  mThread = std::jthread {std::bind_front(&FilesystemWatchService::Run, this)};
+}
+
+FilesystemWatchService::~FilesystemWatchService() {
+  mThread.request_stop();
+  mThread.join();
+  // Subscriptions keep us alive, so there shouldn't be any watches left
+  mWatches.clear();
+}
+
+FilesystemWatchService::FileState FilesystemWatchService::GetFileState(
+  const std::filesystem::path& path) {
+  std::error_code ec;
+  FileState ret;
+  ret.mSize = std::filesystem::file_size(path, ec);
+  if (ec) {
+    return {};
+  }
+  ret.mModified = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return {};
+  }
+  ret.mExists = true;
+  return ret;
+}
+
+std::unique_ptr<FilesystemWatchService::Subscription>
+FilesystemWatchService::Subscribe(
+  const std::filesystem::path& path,
+  Callback callback) {
+  std::error_code ec;
+  const auto isDirectory = std::filesystem::is_directory(path, ec);
+  const WatchKey key {isDirectory ? path : path.parent_path(), isDirectory};
+  const auto initialState = isDirectory ? FileState {} : GetFileState(path);
+
+  std::unique_ptr<FilesystemWatchBackend::Handle> handle;
+  std::unique_lock lock(mMutex);
+  if (!mWatches.contains(key)) {
+    // Backend may do I/O, and may call back into us
+    lock.unlock();
+    handle = mBackend->Watch(key.first, key.second, [this, key]() {
+      this->OnDirectoryChanged(key);
+    });
+    lock.lock();
+  }
+
+  // If the watch existed, we've held the lock since checking, so an
+  // `Unsubscribe()` can't have erased it. Otherwise, another thread may have
+  // created it while the lock was released, so we only add our handle if it
+  // still needs one.
+  auto& watch = mWatches[key];
+  if (handle && !watch.mHandle) {
+    watch.mHandle = std::move(handle);
+  }
+
+  const auto id = mNextSubscriberID++;
+  watch.mSubscribers.insert(id);
+  auto& subscriber = mSubscribers[id];
+  subscriber.mPath = path;
+  subscriber.mWatch = key;
+  subscriber.mIsDirectory = isDirectory;
+  subscriber.mCallback = std::move(callback);
+  subscriber.mLastNotified = initialState;
+  lock.unlock();
+
+  // If another thread won the race to create the watch, `handle` is
+  // destroyed here, outside of the lock
+  handle.reset();
+
+  return std::unique_ptr<Subscription>(
+    new Subscription(shared_from_this(), id));
+}
+
+void FilesystemWatchService::Unsubscribe(uint64_t id) {
+  std::scoped_lock dispatchLock(mDispatchMutex);
+
+  std::unique_ptr<FilesystemWatchBackend::Handle> handle;
+  {
+    std::unique_lock lock(mMutex);
+    const auto it = mSubscribers.find(id);
+    if (it == mSubscribers.end()) {
+      return;
+    }
+    if (it->second.mDeadline) {
+      --mPendingCount;
+    }
+    const auto key = it->second.mWatch;
+    mSubscribers.erase(it);
+
+    const auto watchIt = mWatches.find(key);
+    if (watchIt == mWatches.end()) {
+      return;
+    }
+    watchIt->second.mSubscribers.erase(id);
+    if (watchIt->second.mSubscribers.empty()) {
+      handle = std::move(watchIt->second.mHandle);
+      mWatches.erase(watchIt);
+    }
+  }
+  // Destroying the handle waits for in-progress backend callbacks, which
+  // need `mMutex`
+  handle.reset();
+}
+
+void FilesystemWatchService::OnDirectoryChanged(const WatchKey& key) {
+  std::unique_lock lock(mMutex);
+  ++mStatistics.mBackendNotifications;
+
+  const auto it = mWatches.find(key);
+  if (it == mWatches.end()) {
+    return;
+  }
+
+  const auto now = Clock::now();
+  for (const auto id: it->second.mSubscribers) {
+    auto& subscriber = mSubscribers.at(id);
+    if (!subscriber.mFirstNotification) {
+      subscriber.mFirstNotification = now;
+    }
+    this->Schedule(id, subscriber, now + mSettleTime);
+  }
+  lock.unlock();
+  mWakeup.notify_one();
+}
+
+void FilesystemWatchService::Schedule(
+  uint64_t id,
+  Subscriber& subscriber,
+  Clock::time_point deadline) {
+  if (mPendingCount == 0) {
+    // The wheel stops turning while idle
+    mWheelTime = Clock::now();
+  }
+  if (!subscriber.mDeadline) {
+    ++mPendingCount;
+  }
+  // Any existing wheel entry is now stale, and will be dropped when reached
+  subscriber.mDeadline = deadline;
+
+  const auto ticks = std::max<Clock::rep>(
+    1, (deadline - mWheelTime + WheelTick - Clock::duration(1)) / WheelTick);
+  const auto slot
+    = (mWheelCursor + static_cast<std::size_t>(ticks)) % WheelSlots;
+  mWheel.at(slot).push_back({id, deadline});
+}
+
+void FilesystemWatchService::Run(std::stop_token stop) {
+  std::unique_lock lock(mMutex);
+  while (!stop.stop_requested()) {
+    if (mPendingCount == 0) {
+      mWakeup.wait(lock, stop, [this] { return mPendingCount > 0; });
+      continue;
+    }
+
+    // We only want to wake for the next tick or a stop request, but need
+    // a predicate for the stop_token overload
+    mWakeup.wait_until(lock, stop, mWheelTime + WheelTick, [] {
+      return false;
+    });
+
+    std::vector<uint64_t> due;
+    const auto now = Clock::now();
+    while (mWheelTime + WheelTick <= now) {
+      mWheelTime += WheelTick;
+      mWheelCursor = (mWheelCursor + 1) % WheelSlots;
+      std::erase_if(mWheel.at(mWheelCursor), [&](const WheelEntry& entry) {
+        const auto it = mSubscribers.find(entry.mSubscriber);
+        if (
+          it == mSubscribers.end()
+          || it->second.mDeadline != entry.mDeadline) {
+          // Unsubscribed or rescheduled
+          return true;
+        }
+        if (entry.mDeadline > now) {
+          // Needs another rotation
+          return false;
+        }
+        it->second.mDeadline.reset();
+        --mPendingCount;
+        due.push_back(entry.mSubscriber);
+        return true;
+      });
+    }
+
+    if (due.empty()) {
+      continue;
+    }
+    lock.unlock();
+    this->Dispatch(std::move(due));
+    lock.lock();
+  }
+}
+
+void FilesystemWatchService::Dispatch(std::vector<uint64_t> due) {
+  std::scoped_lock dispatchLock(mDispatchMutex);
+
+  for (const auto id: due) {
+    std::filesystem::path path;
+    bool isDirectory {};
+    FileState lastNotified;
+    {
+      std::unique_lock lock(mMutex);
+      const auto it = mSubscribers.find(id);
+      if (it == mSubscribers.end()) {
+        continue;
+      }
+      path = it->second.mPath;
+      isDirectory = it->second.mIsDirectory;
+      lastNotified = it->second.mLastNotified;
+    }
+
+    const auto state = isDirectory ? FileState {} : GetFileState(path);
+
+    std::unique_lock lock(mMutex);
+    const auto it = mSubscribers.find(id);
+    if (it == mSubscribers.end()) {
+      continue;
+    }
+    auto& subscriber = it->second;
+    if (subscriber.mDeadline) {
+      // Notified again while we were checking
+      continue;
+    }
+
+    if (!isDirectory) {
+      if (
+        state.mExists
+        && std::filesystem::file_time_type::clock::now() - state.mModified
+          < mSettleTime) {
+        // Probably still being written
+        this->Schedule(id, subscriber, Clock::now() + mSettleTime);
+        continue;
+      }
+      if (state == lastNotified) {
+        subscriber.mFirstNotification.reset();
+        continue;
+      }
+    }
+
+    subscriber.mLastNotified = state;
+    if (subscriber.mFirstNotification) {
+      const auto latency = Clock::now() - *subscriber.mFirstNotification;
+      mStatistics.mTotalLatency += latency;
+      mStatistics.mMaxLatency = std::max(mStatistics.mMaxLatency, latency);
+      subscriber.mFirstNotification.reset();
+    }
+    ++mStatistics.mCallbacks;
+
+    const auto callback = subscriber.mCallback;
+    lock.unlock();
+    callback(path);
+  }
+}
+
+FilesystemWatchService::Statistics FilesystemWatchService::GetStatistics()
+  const {
+  std::unique_lock lock(mMutex);
+  auto ret = mStatistics;
+  ret.mOSWatches = std::ranges::count_if(
+    mWatches, [](const auto& it) { return !!it.second.mHandle; });
+  ret.mSubscriptions = mSubscribers.size();
+  return ret;
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,114 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/FilesystemWatchService.hpp>
+
+#include <OpenKneeboard/dprint.hpp>
+#include <OpenKneeboard/format/filesystem.hpp>
+
+#include <Windows.h>
+
+#include <threadpoolapiset.h>
+
+#include <atomic>
+
+namespace OpenKneeboard {
+
+namespace {
+
+class Win32Handle final : public FilesystemWatchBackend::Handle {
+ public:
+  Win32Handle(HANDLE notification, std::function<void()> onChanged)
+    : mNotification(notification), mOnChanged(std::move(onChanged)) {
+    mWait = CreateThreadpoolWait(&Win32Handle::OnSignalled, this, nullptr);
+    SetThreadpoolWait(mWait, mNotification, nullptr);
+  }
+
+  ~Win32Handle() override {
+    mStopping.test_and_set();
+    // Twice: an in-progress callback may have re-armed the wait before it saw
+    // `mStopping`
+    for (int i = 0; i < 2; ++i) {
+      SetThreadpoolWait(mWait, nullptr, nullptr);
+      WaitForThreadpoolWaitCallbacks(mWait, /* cancel pending = */ TRUE);
+    }
+    CloseThreadpoolWait(mWait);
+    FindCloseChangeNotification(mNotification);
+  }
+
+ private:
+  HANDLE mNotification {INVALID_HANDLE_VALUE};
+  PTP_WAIT mWait {nullptr};
+  std::function<void()> mOnChanged;
+  // Stop in-progress callbacks from re-arming the wait
+  std::atomic_flag mStopping;
+
+  static void CALLBACK OnSignalled(
+    PTP_CALLBACK_INSTANCE,
+    void* context,
+    PTP_WAIT wait,
+    TP_WAIT_RESULT) {
+    auto self = reinterpret_cast<Win32Handle*>(context);
+    if (self->mStopping.test()) {
+      return;
+    }
+    self->mOnChanged();
+    if (!FindNextChangeNotification(self->mNotification)) {
+      dprint.Warning(
+        "FindNextChangeNotification() failed: {:#010x}",
+        static_cast<uint32_t>(GetLastError()));
+      return;
+    }
+    if (self->mStopping.test()) {
+      return;
+    }
+    // Threadpool waits are one-shot
+    SetThreadpoolWait(wait, self->mNotification, nullptr);
+  }
+};
+
+class Win32Backend final : public FilesystemWatchBackend {
+ public:
+  std::unique_ptr<Handle> Watch(
+    const std::filesystem::path& directory,
+    bool recursive,
+    std::function<void()> onChanged) override {
+    const auto handle = FindFirstChangeNotificationW(
+      directory.wstring().c_str(),
+      recursive,
+      FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME
+        | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE);
+    if (handle == INVALID_HANDLE_VALUE) {
+      dprint.Warning(
+        "Failed to watch `{}`: {:#010x}",
+        directory,
+        static_cast<uint32_t>(GetLastError()));
+      return nullptr;
+    }
+    return std::make_unique<Win32Handle>(handle, std::move(onChanged));
+  }
+};
+
+}// namespace
+
+std::unique_ptr<FilesystemWatchBackend> CreatePlatformFilesystemWatchBackend() {
+  return std::make_unique<Win32Backend>();
+}
+
+}// namespace OpenKneeboard
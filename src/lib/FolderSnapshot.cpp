@@ -0,0 +1,202 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/FolderSnapshot.hpp>
+
+#include <deque>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace OpenKneeboard {
+
+namespace {
+
+uint64_t GetFileID(const std::filesystem::path& path) noexcept {
+#ifdef _WIN32
+  const auto handle = CreateFileW(
+    path.c_str(),
+    /* desired access: metadata only */ 0,
+    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_FLAG_BACKUP_SEMANTICS,
+    NULL);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return 0;
+  }
+  BY_HANDLE_FILE_INFORMATION info {};
+  const auto haveInfo = GetFileInformationByHandle(handle, &info);
+  CloseHandle(handle);
+  if (!haveInfo) {
+    return 0;
+  }
+  return (static_cast<uint64_t>(info.nFileIndexHigh) << 32)
+    | info.nFileIndexLow;
+#else
+  struct stat info {};
+  if (stat(path.c_str(), &info) != 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(info.st_ino);
+#endif
+}
+
+}// namespace
+
+bool FolderSnapshotDiff::empty() const noexcept {
+  return mAdded.empty() && mRemoved.empty() && mModified.empty()
+    && mReplaced.empty() && mRenamed.empty();
+}
+
+FolderSnapshot::FolderSnapshot(Entries entries) : mEntries(std::move(entries)) {
+}
+
+FolderSnapshot FolderSnapshot::Scan(const std::filesystem::path& root) {
+  Entries entries;
+
+  std::error_code ec;
+  std::filesystem::recursive_directory_iterator it(
+    root, std::filesystem::directory_options::skip_permission_denied, ec);
+  if (ec) {
+    return {};
+  }
+
+  for (const auto end = std::filesystem::recursive_directory_iterator {};
+       it != end;
+       it.increment(ec)) {
+    if (ec) {
+      break;
+    }
+    const auto& entry = *it;
+    if (!entry.is_regular_file(ec)) {
+      continue;
+    }
+    const auto size = entry.file_size(ec);
+    if (ec) {
+      continue;
+    }
+    const auto modified = entry.last_write_time(ec);
+    if (ec) {
+      continue;
+    }
+    entries.emplace(
+      entry.path(),
+      Entry {
+        .mSize = size,
+        .mModified = modified,
+        .mFileID = GetFileID(entry.path()),
+      });
+  }
+
+  return FolderSnapshot {std::move(entries)};
+}
+
+FolderSnapshotDiff FolderSnapshot::Diff(const FolderSnapshot& newer) const {
+  FolderSnapshotDiff diff;
+
+  const auto& before = mEntries;
+  const auto& after = newer.mEntries;
+
+  for (const auto& [path, entry]: before) {
+    const auto it = after.find(path);
+    if (it == after.end()) {
+      diff.mRemoved.push_back(path);
+      continue;
+    }
+    const auto& newEntry = it->second;
+    if (entry == newEntry) {
+      continue;
+    }
+    if (entry.mFileID && newEntry.mFileID && entry.mFileID != newEntry.mFileID) {
+      diff.mReplaced.push_back(path);
+      continue;
+    }
+    diff.mModified.push_back(path);
+  }
+
+  for (const auto& [path, entry]: after) {
+    if (!before.contains(path)) {
+      diff.mAdded.push_back(path);
+    }
+  }
+
+  if (diff.mRemoved.empty() || diff.mAdded.empty()) {
+    return diff;
+  }
+
+  // Pair up removals and additions of the same file as renames/moves.
+  //
+  // With hard links, several paths can share a file ID; pair each removed
+  // path with at most one added path, and don't pair at all if the file is
+  // still at a path it had before - that's a link being added or removed,
+  // not a move.
+  std::unordered_set<uint64_t> keptIDs;
+  for (const auto& [path, entry]: before) {
+    if (entry.mFileID && after.contains(path)) {
+      keptIDs.insert(entry.mFileID);
+    }
+  }
+
+  std::unordered_map<uint64_t, std::deque<std::filesystem::path>> removedByID;
+  for (const auto& path: diff.mRemoved) {
+    const auto id = before.at(path).mFileID;
+    if (id && !keptIDs.contains(id)) {
+      removedByID[id].push_back(path);
+    }
+  }
+
+  std::set<std::filesystem::path> renamedFrom;
+  std::vector<std::filesystem::path> added;
+  for (auto& path: diff.mAdded) {
+    const auto id = after.at(path).mFileID;
+    const auto it = id ? removedByID.find(id) : removedByID.end();
+    if (it == removedByID.end() || it->second.empty()) {
+      added.push_back(std::move(path));
+      continue;
+    }
+    auto from = std::move(it->second.front());
+    it->second.pop_front();
+    renamedFrom.insert(from);
+    diff.mRenamed.emplace_back(std::move(from), std::move(path));
+  }
+  diff.mAdded = std::move(added);
+
+  std::erase_if(diff.mRemoved, [&](const auto& path) {
+    return renamedFrom.contains(path);
+  });
+
+  return diff;
+}
+
+const FolderSnapshot::Entries& FolderSnapshot::GetEntries() const noexcept {
+  return mEntries;
+}
+
+bool FolderSnapshot::empty() const noexcept {
+  return mEntries.empty();
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,376 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/ImageDecodeCache.hpp>
+
+#include <algorithm>
+#include <utility>
+
+namespace OpenKneeboard {
+
+namespace {
+
+bool Covers(PixelSize have, PixelSize want) {
+  return have.mWidth >= want.mWidth && have.mHeight >= want.mHeight;
+}
+
+class SyntheticImage final : public DecodedImage {
+ public:
+  SyntheticImage(PixelSize size) : mSize(size) {
+  }
+
+  PixelSize GetSize() const override {
+    return mSize;
+  }
+
+  std::size_t GetByteSize() const override {
+    return std::size_t {mSize.mWidth} * mSize.mHeight * 4;
+  }
+
+ private:
+  PixelSize mSize;
+};
+
+class SyntheticImageDecoder final : public ImageDecoder {
+ public:
+  SyntheticImageDecoder(
+    PixelSize nativeSize,
+    std::chrono::milliseconds decodeTime)
+    : mNativeSize(nativeSize), mDecodeTime(decodeTime) {
+  }
+
+  std::optional<PixelSize> GetNativeSize(
+    const std::filesystem::path&) override {
+    return mNativeSize;
+  }
+
+  std::shared_ptr<DecodedImage> Decode(
+    const std::filesystem::path&,
+    PixelSize size) override {
+    std::this_thread::sleep_for(mDecodeTime);
+    return std::make_shared<SyntheticImage>(size);
+  }
+
+ private:
+  PixelSize mNativeSize;
+  std::chrono::milliseconds mDecodeTime;
+};
+
+}// namespace
+
+DecodedImage::~DecodedImage() = default;
+ImageDecoder::~ImageDecoder() = default;
+
+std::shared_ptr<ImageDecoder> CreateSyntheticImageDecoder(
+  PixelSize nativeSize,
+  std::chrono::milliseconds decodeTime) {
+  return std::make_shared<SyntheticImageDecoder>(nativeSize, decodeTime);
+}
+
+std::shared_ptr<ImageDecodeCache> ImageDecodeCache::Get() {
+  static const auto sInstance = std::make_shared<ImageDecodeCache>(
+    DefaultByteBudget,
+    std::clamp<std::size_t>(std::thread::hardware_concurrency() / 2, 1, 4));
+  return sInstance;
+}
+
+ImageDecodeCache::ImageDecodeCache(
+  std::size_t byteBudget,
+  std::size_t threadCount)
+  : mByteBudget(byteBudget) {
+  mStatistics.mByteBudget = byteBudget;
+  mWorkers.reserve(threadCount);
+  for (std::size_t i = 0; i < threadCount; ++i) {
+    mWorkers.emplace_back(std::bind_front(&ImageDecodeCache::Run, this));
+  }
+}
+
+ImageDecodeCache::~ImageDecodeCache() {
+  for (auto& it: mWorkers) {
+    it.request_stop();
+  }
+  mWorkers.clear();
+}
+
+PixelSize ImageDecodeCache::GetMipSize(
+  PixelSize nativeSize,
+  PixelSize wantedSize) {
+  if (nativeSize.IsEmpty() || wantedSize.IsEmpty()) {
+    return nativeSize;
+  }
+  const auto fit = nativeSize.ScaledToFit(
+    wantedSize, Geometry2D::ScaleToFitMode::ShrinkOnly);
+
+  auto ret = nativeSize;
+  while (true) {
+    const auto next = ret / 2u;
+    if (next.IsEmpty() || !Covers(next, fit)) {
+      return ret;
+    }
+    ret = next;
+  }
+}
+
+std::shared_ptr<DecodedImage> ImageDecodeCache::GetOrQueue(
+  const Request& request) {
+  std::unique_lock lock(mMutex);
+  auto [it, inserted] = mEntries.try_emplace(request.mKey);
+  auto& entry = it->second;
+  if (inserted) {
+    entry.mGeneration = mNextGeneration++;
+  }
+  entry.mLastUsed = ++mUseCounter;
+
+  const auto size = GetMipSize(request.mNativeSize, request.mWantedSize);
+  if (entry.mImage && Covers(entry.mImage->GetSize(), size)) {
+    ++mStatistics.mHits;
+    return entry.mImage;
+  }
+
+  ++mStatistics.mMisses;
+  this->Enqueue(request, Priority::Visible, entry);
+  return entry.mImage;
+}
+
+void ImageDecodeCache::Prefetch(const Request& request) {
+  std::unique_lock lock(mMutex);
+  auto [it, inserted] = mEntries.try_emplace(request.mKey);
+  auto& entry = it->second;
+  if (inserted) {
+    entry.mGeneration = mNextGeneration++;
+  }
+
+  const auto size = GetMipSize(request.mNativeSize, request.mWantedSize);
+  if (entry.mImage && Covers(entry.mImage->GetSize(), size)) {
+    return;
+  }
+  this->Enqueue(request, Priority::Prefetch, entry);
+}
+
+void ImageDecodeCache::Enqueue(
+  const Request& request,
+  Priority priority,
+  Entry& entry) {
+  if (entry.mFailed) {
+    return;
+  }
+
+  entry.mPath = request.mPath;
+  entry.mDecoder = request.mDecoder;
+  entry.mOnReady = request.mOnReady;
+
+  const auto size = GetMipSize(request.mNativeSize, request.mWantedSize);
+  if (entry.mDecodingSize && Covers(*entry.mDecodingSize, size)) {
+    return;
+  }
+
+  const auto preview = (priority == Priority::Visible && request.mPreviewSize)
+    ? GetMipSize(request.mNativeSize, *request.mPreviewSize)
+    : size;
+
+  auto& pending
+    = entry.mSizeAfterPreview ? entry.mSizeAfterPreview : entry.mPendingSize;
+  if (pending) {
+    pending = PixelSize {
+      std::max(pending->mWidth, size.mWidth),
+      std::max(pending->mHeight, size.mHeight),
+    };
+    entry.mPendingPriority = std::max(entry.mPendingPriority, priority);
+  } else if (
+    !(entry.mImage || entry.mDecodingSize || Covers(preview, size))) {
+    entry.mPendingSize = preview;
+    entry.mSizeAfterPreview = size;
+    entry.mPendingPriority = priority;
+  } else {
+    entry.mPendingSize = size;
+    entry.mPendingPriority = priority;
+  }
+
+  if (entry.mDecodingSize) {
+    // Requeued by the worker when the current decode finishes
+    return;
+  }
+  if (entry.mQueued && *entry.mQueued >= entry.mPendingPriority) {
+    return;
+  }
+
+  entry.mQueued = entry.mPendingPriority;
+  if (entry.mPendingPriority == Priority::Visible) {
+    mVisibleQueue.push_back(request.mKey);
+  } else {
+    mPrefetchQueue.push_back(request.mKey);
+  }
+  mWorkAvailable.notify_one();
+}
+
+void ImageDecodeCache::Erase(Key key) {
+  std::unique_lock lock(mMutex);
+  const auto it = mEntries.find(key);
+  if (it == mEntries.end()) {
+    return;
+  }
+  if (it->second.mImage) {
+    mStatistics.mBytes -= it->second.mImage->GetByteSize();
+  }
+  // Any in-progress decode is discarded when it completes
+  mEntries.erase(it);
+}
+
+void ImageDecodeCache::SetByteBudget(std::size_t budget) {
+  std::unique_lock lock(mMutex);
+  mByteBudget = budget;
+  mStatistics.mByteBudget = budget;
+  this->Evict(std::nullopt);
+}
+
+ImageDecodeCache::Statistics ImageDecodeCache::GetStatistics() const {
+  std::unique_lock lock(mMutex);
+  auto ret = mStatistics;
+  ret.mImages = std::ranges::count_if(
+    mEntries, [](const auto& it) { return !!it.second.mImage; });
+  return ret;
+}
+
+void ImageDecodeCache::Evict(std::optional<Key> keep) {
+  while (mStatistics.mBytes > mByteBudget) {
+    auto lru = mEntries.end();
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+      if (it->first == keep || !it->second.mImage) {
+        continue;
+      }
+      if (
+        lru == mEntries.end()
+        || it->second.mLastUsed < lru->second.mLastUsed) {
+        lru = it;
+      }
+    }
+    if (lru == mEntries.end()) {
+      return;
+    }
+
+    auto& entry = lru->second;
+    mStatistics.mBytes -= entry.mImage->GetByteSize();
+    ++mStatistics.mEvictions;
+    entry.mImage = {};
+    if (!(entry.mPendingSize || entry.mDecodingSize)) {
+      mEntries.erase(lru);
+    }
+  }
+}
+
+void ImageDecodeCache::Run(std::stop_token stop) {
+  std::unique_lock lock(mMutex);
+  while (!stop.stop_requested()) {
+    mWorkAvailable.wait(lock, stop, [this] {
+      return !(mVisibleQueue.empty() && mPrefetchQueue.empty());
+    });
+    if (stop.stop_requested()) {
+      return;
+    }
+
+    auto& queue = mVisibleQueue.empty() ? mPrefetchQueue : mVisibleQueue;
+    const auto key = queue.front();
+    queue.pop_front();
+
+    auto it = mEntries.find(key);
+    if (it == mEntries.end()) {
+      continue;
+    }
+    {
+      auto& entry = it->second;
+      entry.mQueued = std::nullopt;
+      if (entry.mDecodingSize || !entry.mPendingSize) {
+        // Either stale, or will be requeued when the current decode completes
+        continue;
+      }
+      entry.mDecodingSize = std::exchange(entry.mPendingSize, std::nullopt);
+      if (entry.mSizeAfterPreview) {
+        // Requeued below when the preview is ready
+        entry.mPendingSize
+          = std::exchange(entry.mSizeAfterPreview, std::nullopt);
+        ++mStatistics.mPreviewDecodes;
+      }
+    }
+
+    const auto generation = it->second.mGeneration;
+    const auto path = it->second.mPath;
+    const auto decoder = it->second.mDecoder;
+    const auto size = *it->second.mDecodingSize;
+
+    lock.unlock();
+    const auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<DecodedImage> image;
+    try {
+      image = decoder->Decode(path, size);
+    } catch (...) {
+      // Treated the same as any other failure
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    lock.lock();
+
+    ++mStatistics.mDecodes;
+    mStatistics.mTotalDecodeTime += elapsed;
+
+    it = mEntries.find(key);
+    if (it == mEntries.end() || it->second.mGeneration != generation) {
+      continue;
+    }
+    auto& entry = it->second;
+    entry.mDecodingSize = std::nullopt;
+
+    if (!image) {
+      ++mStatistics.mFailedDecodes;
+      entry.mFailed = true;
+      entry.mPendingSize = std::nullopt;
+      continue;
+    }
+
+    std::function<void()> onReady;
+    if (!(entry.mImage && Covers(entry.mImage->GetSize(), image->GetSize()))) {
+      if (entry.mImage) {
+        mStatistics.mBytes -= entry.mImage->GetByteSize();
+      }
+      entry.mImage = image;
+      entry.mLastUsed = ++mUseCounter;
+      mStatistics.mBytes += image->GetByteSize();
+      onReady = entry.mOnReady;
+    }
+
+    if (entry.mPendingSize) {
+      if (Covers(image->GetSize(), *entry.mPendingSize)) {
+        entry.mPendingSize = std::nullopt;
+      } else if (!entry.mQueued) {
+        entry.mQueued = entry.mPendingPriority;
+        (entry.mPendingPriority == Priority::Visible ? mVisibleQueue
+                                                     : mPrefetchQueue)
+          .push_back(key);
+      }
+    }
+
+    this->Evict(key);
+
+    if (onReady) {
+      lock.unlock();
+      onReady();
+      lock.lock();
+    }
+  }
+}
+
+}// namespace OpenKneeboard
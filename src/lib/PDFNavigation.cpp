@@ -30,10 +30,15 @@
 #include <Windows.h>
 #include <shellapi.h>
 
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <fstream>
 #include <map>
+#include <mutex>
+#include <numeric>
 #include <optional>
+#include <thread>
 
 #include <qpdf/QPDF.hh>
 #include <qpdf/QPDFOutlineDocumentHelper.hh>
@@ -43,18 +48,51 @@ namespace OpenKneeboard::PDFNavigation {
 
 using PageIndexMap = std::map<QPDFObjGen, PageIndex>;
 
-struct PDF::Impl {
-  Impl(const std::filesystem::path&);
-  ~Impl();
+// Below this, starting more QPDF instances costs more than it saves
+constexpr std::size_t MinPagesPerThread = 64;
+
+// Not thread-safe; each thread needs its own
+struct Document {
+  Document(const char* description, const char* data, std::size_t size);
 
   QPDF mQPDF;
   std::optional<QPDFOutlineDocumentHelper> mOutlineDocumentHelper;
   std::vector<QPDFPageObjectHelper> mPages;
   PageIndexMap mPageIndices;
+
+  Document() = delete;
+  Document(const Document&) = delete;
+  Document& operator=(const Document&) = delete;
+};
+
+struct PDF::Impl {
+  Impl(const std::filesystem::path&);
+  ~Impl();
+
+  std::string mUTF8Path;
+  std::size_t mSize {};
   winrt::file_handle mFile;
   winrt::handle mMapping;
   void* mView = nullptr;
 
+  std::mutex mMutex;
+  std::optional<Document> mDocument;
+  // Populated lazily by `GetLinks(PageIndex)`, or all at once by `GetLinks()`
+  std::vector<std::optional<std::vector<Link>>> mLinks;
+
+  /** Call `extract(Document&, PageIndex)` for each page, possibly in
+   * parallel, then `store(PageIndex, result)` with `mMutex` held.
+   *
+   * Each extra thread gets its own QPDF instance, as they're not
+   * thread-safe. The calling thread uses `mDocument` a page at a time, so
+   * other callers aren't blocked for the whole pass.
+   */
+  template <class Extract, class Store>
+  void ForEachPage(
+    const std::vector<PageIndex>& pages,
+    Extract&& extract,
+    Store&& store);
+
   Impl() = delete;
   Impl(const Impl&) = delete;
   Impl(Impl&&) = delete;
@@ -269,19 +307,79 @@ static std::vector<Link> ExtractLinks(
   return links;
 }
 
-static std::vector<std::vector<Link>> ExtractLinks(
-  QPDFOutlineDocumentHelper& outlineHelper,
-  std::vector<QPDFPageObjectHelper>& pages,
-  const PageIndexMap& pageIndices) {
-  DebugTimer timer("Links");
-  std::vector<std::vector<Link>> allLinks;
-  allLinks.reserve(pages.size());
+/** Collects the strings drawn by text operators, in content stream order.
+ *
+ * Bytes are used as-is, which is right for the common simple fonts, and
+ * any text in Latin-1 or ASCII-compatible encodings; other bytes are only
+ * used as word separators by `PDFTextIndex`. Form XObjects aren't followed.
+ */
+class TextExtractor final : public QPDFObjectHandle::ParserCallbacks {
+ public:
+  void handleObject(QPDFObjectHandle object) override {
+    if (!object.isOperator()) {
+      mOperands.push_back(object);
+      return;
+    }
+
+    const auto op = object.getOperatorValue();
+    if (op == "Tj" || op == "'" || op == "\"") {
+      // `'` and `"` start a new line first
+      if (op != "Tj") {
+        this->Separate();
+      }
+      if (!mOperands.empty() && mOperands.back().isString()) {
+        mText += mOperands.back().getStringValue();
+      }
+    } else if (op == "TJ") {
+      if (!mOperands.empty() && mOperands.back().isArray()) {
+        for (auto& it: mOperands.back().getArrayAsVector()) {
+          if (it.isString()) {
+            mText += it.getStringValue();
+          } else if (it.isNumber() && it.getNumericValue() < -WordSpacing) {
+            // Large adjustments are used instead of space characters
+            this->Separate();
+          }
+        }
+      }
+    } else if (
+      op == "Td" || op == "TD" || op == "T*" || op == "Tm" || op == "BT"
+      || op == "ET") {
+      this->Separate();
+    }
+    mOperands.clear();
+  }
+
+  void handleEOF() override {
+  }
+
+  std::string GetText() && {
+    return std::move(mText);
+  }
 
-  for (auto& page: pages) {
-    allLinks.push_back(ExtractLinks(outlineHelper, page, pageIndices));
+ private:
+  // In thousandths of an em
+  static constexpr double WordSpacing = 200;
+
+  std::vector<QPDFObjectHandle> mOperands;
+  std::string mText;
+
+  void Separate() {
+    if (!(mText.empty() || mText.back() == '\n')) {
+      mText += '\n';
+    }
   }
+};
 
-  return allLinks;
+Document::Document(
+  const char* description,
+  const char* data,
+  std::size_t size) {
+  mQPDF.processMemoryFile(description, data, size);
+  mPages = QPDFPageDocumentHelper(mQPDF).getAllPages();
+  for (const auto& page: mPages) {
+    mPageIndices[page.getObjectHandle().getObjGen()] = mPageIndices.size();
+  }
+  mOutlineDocumentHelper.emplace(mQPDF);
 }
 
 PDF::Impl::Impl(const std::filesystem::path& path) {
@@ -292,7 +390,7 @@ PDF::Impl::Impl(const std::filesystem::path& path) {
 
   DebugTimer initTimer("PDF Init");
 
-  const auto fileSize = std::filesystem::file_size(path);
+  mSize = std::filesystem::file_size(path);
   const auto wpath = path.wstring();
   mFile = Win32::or_default::CreateFile(
     wpath.c_str(),
@@ -310,43 +408,174 @@ PDF::Impl::Impl(const std::filesystem::path& path) {
     mFile.get(),
     nullptr,
     PAGE_READONLY,
-    fileSize >> 32,
-    static_cast<DWORD>(fileSize),
+    mSize >> 32,
+    static_cast<DWORD>(mSize),
     nullptr);
   if (!mMapping) {
     dprint("Failed to create file mapping of PDF");
     return;
   }
-  mView = MapViewOfFile(mMapping.get(), FILE_MAP_READ, 0, 0, fileSize);
+  mView = MapViewOfFile(mMapping.get(), FILE_MAP_READ, 0, 0, mSize);
 
-  const auto utf8Path = to_utf8(path);
-  mQPDF.processMemoryFile(
-    utf8Path.c_str(), reinterpret_cast<const char*>(mView), fileSize);
-  mPages = QPDFPageDocumentHelper(mQPDF).getAllPages();
-  for (const auto& page: mPages) {
-    mPageIndices[page.getObjectHandle().getObjGen()] = mPageIndices.size();
-  }
-  mOutlineDocumentHelper.emplace(mQPDF);
+  mUTF8Path = to_utf8(path);
+  mDocument.emplace(
+    mUTF8Path.c_str(), reinterpret_cast<const char*>(mView), mSize);
+  mLinks.resize(mDocument->mPages.size());
 }
 
 PDF::Impl::~Impl() {
+  // Must be destroyed before the view it was loaded from
+  mDocument.reset();
   if (mView) {
     UnmapViewOfFile(mView);
   }
 }
 
 std::vector<Bookmark> PDF::GetBookmarks() {
-  if (p->mPages.empty()) {
+  const std::unique_lock lock(p->mMutex);
+  if (!p->mDocument || p->mDocument->mPages.empty()) {
     return {};
   }
-  return ExtractBookmarks(*p->mOutlineDocumentHelper, p->mPageIndices);
+  return ExtractBookmarks(
+    *p->mDocument->mOutlineDocumentHelper, p->mDocument->mPageIndices);
 }
 
-std::vector<std::vector<Link>> PDF::GetLinks() {
-  if (p->mPages.empty()) {
+PageIndex PDF::GetPageCount() {
+  const std::unique_lock lock(p->mMutex);
+  return p->mLinks.size();
+}
+
+std::vector<Link> PDF::GetLinks(PageIndex index) {
+  const std::unique_lock lock(p->mMutex);
+  if (index >= p->mLinks.size()) {
     return {};
   }
-  return ExtractLinks(*p->mOutlineDocumentHelper, p->mPages, p->mPageIndices);
+  auto& links = p->mLinks.at(index);
+  if (!links) {
+    auto& doc = *p->mDocument;
+    links = ExtractLinks(
+      *doc.mOutlineDocumentHelper, doc.mPages.at(index), doc.mPageIndices);
+  }
+  return *links;
+}
+
+template <class Extract, class Store>
+void PDF::Impl::ForEachPage(
+  const std::vector<PageIndex>& pages,
+  Extract&& extract,
+  Store&& store) {
+  const auto threadCount = std::min<std::size_t>(
+    std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u),
+    pages.size() / MinPagesPerThread);
+
+  std::atomic_size_t next {0};
+  // Pages a worker claimed but couldn't process; guarded by `mMutex`
+  std::vector<PageIndex> failed;
+  std::vector<std::jthread> workers;
+  for (std::size_t thread = 1; thread < threadCount; ++thread) {
+    workers.emplace_back([&] {
+      std::optional<Document> doc;
+      try {
+        doc.emplace(
+          mUTF8Path.c_str(), reinterpret_cast<const char*>(mView), mSize);
+      } catch (const std::exception& e) {
+        // Pages this thread hasn't claimed are picked up by the others
+        dprint.Warning("Failed to load PDF for worker: {}", e.what());
+        return;
+      }
+      for (auto i = next++; i < pages.size(); i = next++) {
+        const auto page = pages.at(i);
+        try {
+          auto result = extract(*doc, page);
+          const std::unique_lock lock(mMutex);
+          store(page, std::move(result));
+        } catch (const std::exception& e) {
+          dprint.Warning("Failed to process PDF page: {}", e.what());
+          const std::unique_lock lock(mMutex);
+          failed.push_back(page);
+        }
+      }
+    });
+  }
+
+  for (auto i = next++; i < pages.size(); i = next++) {
+    const auto page = pages.at(i);
+    const std::unique_lock lock(mMutex);
+    store(page, extract(*mDocument, page));
+  }
+
+  // Retry failures with the main instance, so they fail - or succeed - the
+  // same way as if there were no workers
+  workers.clear();
+  for (const auto page: failed) {
+    const std::unique_lock lock(mMutex);
+    store(page, extract(*mDocument, page));
+  }
+}
+
+std::vector<std::vector<Link>> PDF::GetLinks() {
+  DebugTimer timer("Links");
+
+  std::vector<PageIndex> remaining;
+  {
+    const std::unique_lock lock(p->mMutex);
+    for (PageIndex i = 0; i < p->mLinks.size(); ++i) {
+      if (!p->mLinks.at(i)) {
+        remaining.push_back(i);
+      }
+    }
+  }
+
+  p->ForEachPage(
+    remaining,
+    [](Document& doc, PageIndex page) {
+      return ExtractLinks(
+        *doc.mOutlineDocumentHelper, doc.mPages.at(page), doc.mPageIndices);
+    },
+    [this](PageIndex page, std::vector<Link>&& links) {
+      // May have been populated by `GetLinks(PageIndex)` in the mean time
+      auto& slot = p->mLinks.at(page);
+      if (!slot) {
+        slot = std::move(links);
+      }
+    });
+
+  const std::unique_lock lock(p->mMutex);
+  std::vector<std::vector<Link>> ret;
+  ret.reserve(p->mLinks.size());
+  for (const auto& it: p->mLinks) {
+    ret.push_back(it.value_or(std::vector<Link> {}));
+  }
+  return ret;
+}
+
+std::vector<std::string> PDF::GetText() {
+  DebugTimer timer("Text");
+
+  std::vector<PageIndex> pages;
+  {
+    const std::unique_lock lock(p->mMutex);
+    pages.resize(p->mLinks.size());
+  }
+  std::iota(pages.begin(), pages.end(), 0);
+
+  std::vector<std::string> ret(pages.size());
+  p->ForEachPage(
+    pages,
+    [](Document& doc, PageIndex page) {
+      TextExtractor extractor;
+      try {
+        doc.mPages.at(page).parseContents(&extractor);
+      } catch (const std::exception& e) {
+        // Keep whatever we got before the error
+        dprint.Warning("Failed to extract text from PDF page: {}", e.what());
+      }
+      return std::move(extractor).GetText();
+    },
+    [&ret](PageIndex page, std::string&& text) {
+      ret.at(page) = std::move(text);
+    });
+  return ret;
 }
 
 }// namespace OpenKneeboard::PDFNavigation
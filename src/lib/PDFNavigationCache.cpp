@@ -0,0 +1,210 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/PDFNavigationCache.hpp>
+
+#include <format>
+
+namespace OpenKneeboard {
+
+namespace {
+// 'OKPN'
+constexpr uint32_t NavigationMagic = 0x4e504b4f;
+// 'OKPT'
+constexpr uint32_t TextMagic = 0x54504b4f;
+// Bump whenever the layout below, or the meaning of any field, changes
+constexpr uint32_t Version = 2;
+
+void WriteLink(CacheFile::Writer& w, const PDFNavigation::Link& link) {
+  w.Write(link.mRect);
+  w.Write(static_cast<uint8_t>(link.mDestination.mType));
+  w.Write(link.mDestination.mPageIndex);
+  w.Write(link.mDestination.mURI);
+}
+
+bool ReadLink(CacheFile::Reader& r, PDFNavigation::Link& link) {
+  uint8_t type {};
+  if (!(r.Read(link.mRect) && r.Read(type))) {
+    return false;
+  }
+  switch (static_cast<PDFNavigation::DestinationType>(type)) {
+    case PDFNavigation::DestinationType::Page:
+    case PDFNavigation::DestinationType::URI:
+      break;
+    default:
+      return false;
+  }
+  link.mDestination.mType = static_cast<PDFNavigation::DestinationType>(type);
+  return r.Read(link.mDestination.mPageIndex)
+    && r.Read(link.mDestination.mURI);
+}
+
+void WriteKey(CacheFile::Writer& w, const PDFNavigationCache::Key& key) {
+  w.Write(key);
+}
+
+/// Returns false unless the stored key matches `expected`
+bool ReadKey(CacheFile::Reader& r, const PDFNavigationCache::Key& expected) {
+  PDFNavigationCache::Key key;
+  return r.Read(key) && key == expected;
+}
+
+// Pruning removes the least-recently written entries
+void MarkAsUsed(const std::filesystem::path& path) {
+  std::error_code ec;
+  std::filesystem::last_write_time(
+    path, std::filesystem::file_time_type::clock::now(), ec);
+}
+
+}// namespace
+
+void PDFNavigation::Write(
+  CacheFile::Writer& w,
+  const std::vector<Bookmark>& bookmarks) {
+  w.Write(static_cast<uint32_t>(bookmarks.size()));
+  for (const auto& it: bookmarks) {
+    w.Write(it.mName);
+    w.Write(it.mPageIndex);
+  }
+}
+
+void PDFNavigation::Write(
+  CacheFile::Writer& w,
+  const std::vector<std::vector<Link>>& links) {
+  w.Write(static_cast<uint32_t>(links.size()));
+  for (const auto& page: links) {
+    w.Write(static_cast<uint32_t>(page.size()));
+    for (const auto& link: page) {
+      WriteLink(w, link);
+    }
+  }
+}
+
+bool PDFNavigation::Read(
+  CacheFile::Reader& r,
+  std::vector<Bookmark>& bookmarks) {
+  uint32_t count {};
+  if (!r.ReadCount(count, sizeof(uint32_t) + sizeof(PageIndex))) {
+    return false;
+  }
+  bookmarks.resize(count);
+  for (auto& it: bookmarks) {
+    if (!(r.Read(it.mName) && r.Read(it.mPageIndex))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PDFNavigation::Read(
+  CacheFile::Reader& r,
+  std::vector<std::vector<Link>>& links) {
+  uint32_t count {};
+  if (!r.ReadCount(count, sizeof(uint32_t))) {
+    return false;
+  }
+  links.resize(count);
+  for (auto& page: links) {
+    uint32_t linkCount {};
+    if (!r.ReadCount(linkCount, sizeof(D2D1_RECT_F))) {
+      return false;
+    }
+    page.resize(linkCount);
+    for (auto& link: page) {
+      if (!ReadLink(r, link)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+PDFNavigationCache::PDFNavigationCache(const std::filesystem::path& directory)
+  : mDirectory(directory) {
+}
+
+std::filesystem::path PDFNavigationCache::GetEntryPath(
+  const Key& key,
+  std::string_view kind) const {
+  return mDirectory / std::format("{}.{}.bin", key.ToString(), kind);
+}
+
+std::optional<PDFNavigation::Index> PDFNavigationCache::Load(
+  const Key& key) const {
+  const auto path = this->GetEntryPath(key, "navigation");
+  const auto payload = CacheFile::Load(path, NavigationMagic, Version);
+  if (!payload) {
+    return std::nullopt;
+  }
+
+  CacheFile::Reader r(*payload);
+  PDFNavigation::Index ret;
+  if (!(ReadKey(r, key) && PDFNavigation::Read(r, ret.mBookmarks)
+        && PDFNavigation::Read(r, ret.mLinks) && r.IsAtEnd())) {
+    return std::nullopt;
+  }
+  MarkAsUsed(path);
+  return ret;
+}
+
+void PDFNavigationCache::Store(
+  const Key& key,
+  const PDFNavigation::Index& index) const {
+  CacheFile::Writer w;
+  WriteKey(w, key);
+  PDFNavigation::Write(w, index.mBookmarks);
+  PDFNavigation::Write(w, index.mLinks);
+
+  const auto path = this->GetEntryPath(key, "navigation");
+  if (CacheFile::Save(path, NavigationMagic, Version, w.GetBuffer())) {
+    CacheFile::Prune(mDirectory, MaxEntries);
+  }
+}
+
+std::optional<PDFTextIndex> PDFNavigationCache::LoadTextIndex(
+  const Key& key) const {
+  const auto path = this->GetEntryPath(key, "text");
+  const auto payload = CacheFile::Load(path, TextMagic, Version);
+  if (!payload) {
+    return std::nullopt;
+  }
+
+  CacheFile::Reader r(*payload);
+  PDFTextIndex ret;
+  if (!(ReadKey(r, key) && ret.Read(r) && r.IsAtEnd())) {
+    return std::nullopt;
+  }
+  MarkAsUsed(path);
+  return ret;
+}
+
+void PDFNavigationCache::StoreTextIndex(
+  const Key& key,
+  const PDFTextIndex& index) const {
+  CacheFile::Writer w;
+  WriteKey(w, key);
+  index.Write(w);
+
+  const auto path = this->GetEntryPath(key, "text");
+  if (CacheFile::Save(path, TextMagic, Version, w.GetBuffer())) {
+    CacheFile::Prune(mDirectory, MaxEntries);
+  }
+}
+
+}// namespace OpenKneeboard
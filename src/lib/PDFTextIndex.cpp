@@ -0,0 +1,213 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/PDFTextIndex.hpp>
+
+#include <algorithm>
+#include <span>
+#include <unordered_map>
+
+namespace OpenKneeboard {
+
+namespace {
+
+constexpr bool IsWordChar(char c) noexcept {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+    || (c >= '0' && c <= '9');
+}
+
+constexpr char ToLower(char c) noexcept {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+template <class F>
+void ForEachWord(std::string_view text, F&& f) {
+  std::string word;
+  for (const auto c: text) {
+    if (IsWordChar(c)) {
+      word.push_back(ToLower(c));
+      continue;
+    }
+    if (!word.empty()) {
+      f(std::move(word));
+      word.clear();
+    }
+  }
+  if (!word.empty()) {
+    f(std::move(word));
+  }
+}
+
+}// namespace
+
+PDFTextIndex PDFTextIndex::Create(const std::vector<std::string>& pageText) {
+  std::unordered_map<std::string, std::vector<Occurrence>> occurrences;
+  for (PageIndex page = 0; page < pageText.size(); ++page) {
+    uint32_t position = 0;
+    ForEachWord(pageText.at(page), [&](std::string&& word) {
+      occurrences[std::move(word)].push_back({page, position++});
+    });
+  }
+
+  PDFTextIndex ret;
+  ret.mWords.reserve(occurrences.size());
+  for (auto& [text, wordOccurrences]: occurrences) {
+    ret.mWords.push_back(
+      {text, 0, static_cast<uint32_t>(wordOccurrences.size())});
+  }
+  std::ranges::sort(ret.mWords, {}, &Word::mText);
+
+  for (auto& word: ret.mWords) {
+    // Already sorted, as pages and positions were visited in order
+    const auto& wordOccurrences = occurrences.at(word.mText);
+    word.mFirst = static_cast<uint32_t>(ret.mOccurrences.size());
+    ret.mOccurrences.insert(
+      ret.mOccurrences.end(), wordOccurrences.begin(), wordOccurrences.end());
+  }
+  return ret;
+}
+
+bool PDFTextIndex::IsEmpty() const noexcept {
+  return mWords.empty();
+}
+
+const PDFTextIndex::Word* PDFTextIndex::FindWord(std::string_view text) const {
+  const auto it = std::ranges::lower_bound(mWords, text, {}, &Word::mText);
+  if (it == mWords.end() || it->mText != text) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+std::vector<PageIndex> PDFTextIndex::Find(std::string_view query) const {
+  std::vector<std::span<const Occurrence>> words;
+  bool missing = false;
+  ForEachWord(query, [&](std::string&& text) {
+    const auto word = this->FindWord(text);
+    if (!word) {
+      missing = true;
+      return;
+    }
+    words.push_back(
+      std::span {mOccurrences}.subspan(word->mFirst, word->mCount));
+  });
+  if (missing || words.empty()) {
+    return {};
+  }
+
+  // Start from the rarest word, and check its neighbours are where they
+  // should be
+  const auto rarest = static_cast<uint32_t>(
+    std::ranges::min_element(words, {}, [](const auto& it) {
+      return it.size();
+    })
+    - words.begin());
+
+  std::vector<PageIndex> ret;
+  for (const auto& candidate: words.at(rarest)) {
+    if (!ret.empty() && ret.back() == candidate.mPageIndex) {
+      continue;
+    }
+    if (candidate.mPosition < rarest) {
+      continue;
+    }
+    const auto start = candidate.mPosition - rarest;
+    const auto matches = [&] {
+      for (std::size_t i = 0; i < words.size(); ++i) {
+        const Occurrence wanted {
+          candidate.mPageIndex, start + static_cast<uint32_t>(i)};
+        if (!std::ranges::binary_search(words.at(i), wanted)) {
+          return false;
+        }
+      }
+      return true;
+    }();
+    if (matches) {
+      ret.push_back(candidate.mPageIndex);
+    }
+  }
+  return ret;
+}
+
+void PDFTextIndex::Write(CacheFile::Writer& w) const {
+  w.Write(static_cast<uint32_t>(mWords.size()));
+  for (const auto& it: mWords) {
+    w.Write(it.mText);
+    w.Write(it.mFirst);
+    w.Write(it.mCount);
+  }
+  w.Write(static_cast<uint32_t>(mOccurrences.size()));
+  for (const auto& it: mOccurrences) {
+    w.Write(it.mPageIndex);
+    w.Write(it.mPosition);
+  }
+}
+
+bool PDFTextIndex::Read(CacheFile::Reader& r) {
+  uint32_t count {};
+  if (!r.ReadCount(count, sizeof(uint32_t) * 3)) {
+    return false;
+  }
+  mWords.resize(count);
+  for (auto& it: mWords) {
+    if (!(r.Read(it.mText) && r.Read(it.mFirst) && r.Read(it.mCount))) {
+      return false;
+    }
+  }
+  if (!r.ReadCount(count, sizeof(Occurrence))) {
+    return false;
+  }
+  mOccurrences.resize(count);
+  for (auto& it: mOccurrences) {
+    if (!(r.Read(it.mPageIndex) && r.Read(it.mPosition))) {
+      return false;
+    }
+  }
+
+  // `Find()` relies on these invariants; don't trust the file
+  const auto valid = std::ranges::is_sorted(mWords, {}, &Word::mText)
+    && std::ranges::all_of(mWords, [&](const Word& word) {
+         return uint64_t {word.mFirst} + word.mCount <= mOccurrences.size()
+           && std::ranges::is_sorted(
+             std::span {mOccurrences}.subspan(word.mFirst, word.mCount));
+       });
+  if (!valid) {
+    *this = {};
+  }
+  return valid;
+}
+
+LazyPDFTextIndex::LazyPDFTextIndex(Builder builder)
+  : mBuilder(std::move(builder)) {
+}
+
+std::shared_ptr<const PDFTextIndex> LazyPDFTextIndex::Get() {
+  std::unique_lock lock(mMutex);
+  if (mIndex) {
+    return mIndex;
+  }
+  auto index = mBuilder();
+  mIndex = std::make_shared<const PDFTextIndex>(
+    index ? std::move(*index) : PDFTextIndex {});
+  // Usually holds the document path and cache; no longer needed
+  mBuilder = {};
+  return mIndex;
+}
+
+}// namespace OpenKneeboard
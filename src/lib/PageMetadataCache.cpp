@@ -0,0 +1,147 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CacheFile.hpp>
+#include <OpenKneeboard/ContentHash.hpp>
+#include <OpenKneeboard/PDFNavigationCache.hpp>
+#include <OpenKneeboard/PageMetadataCache.hpp>
+
+#include <format>
+
+namespace OpenKneeboard {
+
+namespace {
+// 'OKPM'
+constexpr uint32_t Magic = 0x4d504b4f;
+// Bump whenever the layout below, or the meaning of any field, changes
+constexpr uint32_t Version = 2;
+
+void WriteKey(CacheFile::Writer& w, const PageMetadataCache::Key& key) {
+  const auto path = key.mPath.u8string();
+  w.Write(
+    std::string_view {reinterpret_cast<const char*>(path.data()), path.size()});
+  w.Write(key.mSize);
+  w.Write(key.mModified);
+  w.Write(key.mContentPrefixHash);
+}
+
+bool ReadKey(CacheFile::Reader& r, PageMetadataCache::Key& key) {
+  std::string path;
+  if (!r.Read(path)) {
+    return false;
+  }
+  key.mPath = std::filesystem::path {std::u8string_view {
+    reinterpret_cast<const char8_t*>(path.data()), path.size()}};
+  return r.Read(key.mSize) && r.Read(key.mModified)
+    && r.Read(key.mContentPrefixHash);
+}
+
+}// namespace
+
+std::optional<PageMetadataCache::Key> PageMetadataCache::Key::Create(
+  const std::filesystem::path& path) {
+  std::error_code ec;
+  Key ret;
+  ret.mPath = std::filesystem::canonical(path, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  ret.mSize = std::filesystem::file_size(ret.mPath, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  const auto modified = std::filesystem::last_write_time(ret.mPath, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  ret.mModified = modified.time_since_epoch().count();
+  const auto hash = HashFileContent(ret.mPath, ContentPrefixSize);
+  if (!hash) {
+    return std::nullopt;
+  }
+  ret.mContentPrefixHash = *hash;
+  return ret;
+}
+
+PageMetadataCache::PageMetadataCache(const std::filesystem::path& directory)
+  : mDirectory(directory) {
+}
+
+std::filesystem::path PageMetadataCache::GetEntryPath(const Key& key) const {
+  // One entry per path; a changed file replaces the previous entry
+  const auto path = key.mPath.u8string();
+  const auto hash = HashContent(std::as_bytes(std::span {path}));
+  return mDirectory / std::format("{}.bin", hash.ToString());
+}
+
+std::optional<PageMetadata> PageMetadataCache::Load(const Key& key) const {
+  const auto payload
+    = CacheFile::Load(this->GetEntryPath(key), Magic, Version);
+  if (!payload) {
+    return std::nullopt;
+  }
+
+  CacheFile::Reader r(*payload);
+  Key storedKey;
+  if (!(ReadKey(r, storedKey) && storedKey == key)) {
+    // Stale; will be replaced when the caller stores the new metadata
+    return std::nullopt;
+  }
+
+  PageMetadata ret;
+  uint32_t count {};
+  if (!r.ReadCount(count, sizeof(PixelSize))) {
+    return std::nullopt;
+  }
+  ret.mPageSizes.resize(count);
+  for (auto& it: ret.mPageSizes) {
+    if (!(r.Read(it.mWidth) && r.Read(it.mHeight))) {
+      return std::nullopt;
+    }
+  }
+
+  if (!(PDFNavigation::Read(r, ret.mBookmarks)
+        && PDFNavigation::Read(r, ret.mLinks) && r.IsAtEnd())) {
+    return std::nullopt;
+  }
+  return ret;
+}
+
+void PageMetadataCache::Store(const Key& key, const PageMetadata& metadata)
+  const {
+  CacheFile::Writer w;
+  WriteKey(w, key);
+
+  w.Write(static_cast<uint32_t>(metadata.mPageSizes.size()));
+  for (const auto& it: metadata.mPageSizes) {
+    w.Write(it.mWidth);
+    w.Write(it.mHeight);
+  }
+
+  PDFNavigation::Write(w, metadata.mBookmarks);
+  PDFNavigation::Write(w, metadata.mLinks);
+
+  const auto path = this->GetEntryPath(key);
+  const auto isNew = !std::filesystem::exists(path);
+  if (CacheFile::Save(path, Magic, Version, w.GetBuffer()) && isNew) {
+    CacheFile::Prune(mDirectory, MaxEntries);
+  }
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,247 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/PrerenderScheduler.hpp>
+
+#include <algorithm>
+#include <ranges>
+#include <utility>
+
+namespace OpenKneeboard {
+
+PrerenderScheduler::PrerenderScheduler() : PrerenderScheduler(Options {}) {
+}
+
+PrerenderScheduler::PrerenderScheduler(const Options& options)
+  : mOptions(options) {
+  mStatistics.mEstimate = mOptions.mInitialEstimate;
+}
+
+void PrerenderScheduler::AdvanceTo(Clock::time_point now) {
+  mNow = std::max(mNow, now);
+  const auto removed = std::erase_if(mViews, [this](const auto& it) {
+    return mNow - it.second.mLastSeen >= mOptions.mViewTimeout;
+  });
+  if (removed) {
+    this->UpdateEvictions();
+  }
+}
+
+void PrerenderScheduler::SetCurrentPage(
+  ViewKey key,
+  PageIndex current,
+  PageIndex pageCount,
+  Clock::time_point now,
+  bool isPreview) {
+  auto& view = mViews[key];
+  const auto changed
+    = view.mCurrent != current || view.mPageCount != pageCount;
+  view.mCurrent = current;
+  view.mPageCount = pageCount;
+  view.mIsPreview = isPreview;
+  view.mLastSeen = now;
+  this->AdvanceTo(now);
+  if (changed) {
+    mLastChange = now;
+    this->UpdateEvictions();
+  }
+}
+
+void PrerenderScheduler::RemoveView(ViewKey key) {
+  if (mViews.erase(key)) {
+    this->UpdateEvictions();
+  }
+}
+
+void PrerenderScheduler::Expire(Clock::time_point now) {
+  this->AdvanceTo(now);
+}
+
+std::optional<PrerenderScheduler::Clock::time_point>
+PrerenderScheduler::GetNextExpiry() const {
+  if (mRendered.empty() || mViews.empty()) {
+    return std::nullopt;
+  }
+  const auto oldest = std::ranges::min(
+    mViews | std::views::values | std::views::transform(&View::mLastSeen));
+  return oldest + mOptions.mViewTimeout;
+}
+
+std::vector<PageIndex> PrerenderScheduler::GetKeptPages() const {
+  std::vector<PageIndex> ret;
+  auto push = [&](PageIndex page) {
+    if (
+      ret.size() < mOptions.mMaxRendered
+      && !std::ranges::contains(ret, page)) {
+      ret.push_back(page);
+    }
+  };
+
+  for (const auto& [key, view]: mViews) {
+    if (view.mCurrent < view.mPageCount) {
+      push(view.mCurrent);
+    }
+  }
+
+  const auto maxDistance
+    = std::max(mOptions.mPagesAhead, mOptions.mPagesBehind);
+  for (PageIndex distance = 1; distance <= maxDistance; ++distance) {
+    for (const auto& [key, view]: mViews) {
+      if (
+        distance <= mOptions.mPagesAhead
+        && view.mCurrent + distance < view.mPageCount) {
+        push(view.mCurrent + distance);
+      }
+      if (distance <= mOptions.mPagesBehind && view.mCurrent >= distance) {
+        push(view.mCurrent - distance);
+      }
+    }
+  }
+  return ret;
+}
+
+std::vector<PageIndex> PrerenderScheduler::GetWantedPages() const {
+  auto ret = this->GetKeptPages();
+  // The final version is already shown, so rendering it again is waste
+  std::erase_if(ret, [this](PageIndex page) {
+    bool isCurrent = false;
+    for (const auto& [key, view]: mViews) {
+      if (view.mCurrent != page) {
+        continue;
+      }
+      if (view.mIsPreview) {
+        return false;
+      }
+      isCurrent = true;
+    }
+    return isCurrent;
+  });
+  return ret;
+}
+
+std::optional<PageIndex> PrerenderScheduler::GetNextWantedPage() const {
+  for (const auto page: this->GetWantedPages()) {
+    if (!(mRendered.contains(page) || mFailed.contains(page))) {
+      return page;
+    }
+  }
+  return std::nullopt;
+}
+
+bool PrerenderScheduler::ShouldKeep(PageIndex page) const {
+  return std::ranges::contains(this->GetKeptPages(), page);
+}
+
+void PrerenderScheduler::UpdateEvictions() {
+  for (auto it = mRendered.begin(); it != mRendered.end();) {
+    if (this->ShouldKeep(*it)) {
+      ++it;
+      continue;
+    }
+    mEvictions.push_back(*it);
+    it = mRendered.erase(it);
+  }
+}
+
+std::optional<PageIndex> PrerenderScheduler::Next(
+  Clock::time_point now,
+  Duration budget) {
+  this->AdvanceTo(now);
+  this->UpdateEvictions();
+  if (mInProgress) {
+    return std::nullopt;
+  }
+
+  const auto page = this->GetNextWantedPage();
+  if (!page) {
+    return std::nullopt;
+  }
+
+  if (mStatistics.mEstimate > budget) {
+    // Don't add a stall while the user is flipping through pages
+    const auto settleTime = this->IsCurrent(*page)
+      ? mOptions.mCurrentPageSettleTime
+      : mOptions.mSettleTime;
+    if (mNow - mLastChange < settleTime) {
+      return std::nullopt;
+    }
+    ++mStatistics.mOverBudget;
+  }
+
+  ++mStatistics.mStarted;
+  mInProgress = page;
+  return page;
+}
+
+bool PrerenderScheduler::Complete(PageIndex page, Duration renderTime) {
+  // Exponentially-weighted moving average, weighting the new value 1/4
+  mStatistics.mEstimate = (mStatistics.mEstimate * 3 + renderTime) / 4;
+
+  // Not in progress if we were `Reset()` while it was rendering
+  const auto wasInProgress = mInProgress == page;
+  if (wasInProgress) {
+    mInProgress.reset();
+  }
+  if (!(wasInProgress && this->ShouldKeep(page))) {
+    ++mStatistics.mDiscarded;
+    return false;
+  }
+  ++mStatistics.mCompleted;
+  mRendered.insert(page);
+  return true;
+}
+
+void PrerenderScheduler::Fail(PageIndex page) {
+  if (mInProgress == page) {
+    mInProgress.reset();
+  }
+  mFailed.insert(page);
+  ++mStatistics.mFailed;
+}
+
+std::vector<PageIndex> PrerenderScheduler::TakeEvictions() {
+  return std::exchange(mEvictions, {});
+}
+
+bool PrerenderScheduler::IsRendered(PageIndex page) const {
+  return mRendered.contains(page);
+}
+
+bool PrerenderScheduler::IsCurrent(PageIndex page) const {
+  return std::ranges::any_of(
+    mViews, [page](const auto& it) { return it.second.mCurrent == page; });
+}
+
+bool PrerenderScheduler::HasPendingWork() const {
+  return mInProgress || this->GetNextWantedPage();
+}
+
+void PrerenderScheduler::Reset() {
+  mRendered.clear();
+  mFailed.clear();
+  mEvictions.clear();
+  // Anything in progress is for the old document
+  mInProgress.reset();
+}
+
+PrerenderScheduler::Statistics PrerenderScheduler::GetStatistics() const {
+  return mStatistics;
+}
+
+}// namespace OpenKneeboard
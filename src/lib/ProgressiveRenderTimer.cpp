@@ -0,0 +1,92 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/ProgressiveRenderTimer.hpp>
+
+#include <algorithm>
+
+namespace OpenKneeboard {
+
+ProgressiveRenderTimer& ProgressiveRenderTimer::Get() {
+  static ProgressiveRenderTimer sInstance;
+  return sInstance;
+}
+
+void ProgressiveRenderTimer::Requested(Key key, Clock::time_point now) {
+  std::unique_lock lock(mMutex);
+  if (mPending.contains(key)) {
+    return;
+  }
+
+  if (mPending.size() >= MaxPending) {
+    const auto oldest = std::ranges::min_element(
+      mPending, {}, [](const auto& it) { return it.second.mSequence; });
+    mPending.erase(oldest);
+    ++mStatistics.mAbandoned;
+  }
+  mPending.emplace(key, Pending {now, std::nullopt, mNextSequence++});
+}
+
+std::optional<ProgressiveRenderTimer::Timings>
+ProgressiveRenderTimer::Presented(
+  Key key,
+  Quality quality,
+  Clock::time_point now) {
+  std::unique_lock lock(mMutex);
+  const auto it = mPending.find(key);
+  if (it == mPending.end()) {
+    return std::nullopt;
+  }
+
+  auto& pending = it->second;
+  if (!pending.mFirstPixel) {
+    pending.mFirstPixel = now;
+  }
+  if (quality != Quality::Final) {
+    return std::nullopt;
+  }
+
+  const Timings ret {
+    .mTimeToFirstPixel = *pending.mFirstPixel - pending.mRequested,
+    .mTimeToFinalPixel = now - pending.mRequested,
+    .mHadPreview = *pending.mFirstPixel != now,
+  };
+  mPending.erase(it);
+
+  auto& stats = mStatistics;
+  ++stats.mPages;
+  if (ret.mHadPreview) {
+    ++stats.mPreviews;
+  }
+  stats.mTotalTimeToFirstPixel += ret.mTimeToFirstPixel;
+  stats.mMaxTimeToFirstPixel
+    = std::max(stats.mMaxTimeToFirstPixel, ret.mTimeToFirstPixel);
+  stats.mTotalTimeToFinalPixel += ret.mTimeToFinalPixel;
+  stats.mMaxTimeToFinalPixel
+    = std::max(stats.mMaxTimeToFinalPixel, ret.mTimeToFinalPixel);
+  return ret;
+}
+
+ProgressiveRenderTimer::Statistics ProgressiveRenderTimer::GetStatistics()
+  const {
+  std::unique_lock lock(mMutex);
+  return mStatistics;
+}
+
+}// namespace OpenKneeboard
@@ -370,6 +370,14 @@ class Impl {
 
   ~Impl() {
     UnmapViewOfFile(mMapping);
+
+    using Instrumentation = TStateMachine::Instrumentation;
+    if constexpr (requires { Instrumentation::Statistics; }) {
+      dprint(
+        "{} statistics:\n{}",
+        magic_enum::enum_type_name<State>(),
+        Instrumentation::Statistics->GetSnapshot().ToString());
+    }
   }
 
   bool IsValid() const {
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <OpenKneeboard/StateMachine.hpp>
+#include <OpenKneeboard/StateMachineStatistics.hpp>
 
 #include <OpenKneeboard/array.hpp>
 
@@ -37,6 +38,8 @@ enum class ReaderState {
 #undef IT
 };
 
+inline constinit StateMachineStatistics<ReaderState> gReaderStateStatistics;
+
 using ReaderStateMachine = StateMachine<
   ReaderState,
   ReaderState::Unlocked,
@@ -46,7 +49,8 @@ using ReaderStateMachine = StateMachine<
       Transition {ReaderState::Locked, ReaderState::CreatingSnapshot},
       Transition {ReaderState::CreatingSnapshot, ReaderState::Locked},
     }),
-  ReaderState::Unlocked>;
+  ReaderState::Unlocked,
+  InstrumentStateMachineInDebugBuilds<&gReaderStateStatistics>>;
 
 static_assert(lockable_state_machine<SHM::ReaderStateMachine>);
 
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <OpenKneeboard/StateMachine.hpp>
+#include <OpenKneeboard/StateMachineStatistics.hpp>
 
 #include <OpenKneeboard/array.hpp>
 
@@ -40,6 +41,8 @@ enum class WriterState {
 #undef IT
 };
 
+inline constinit StateMachineStatistics<WriterState> gWriterStateStatistics;
+
 using WriterStateMachine = StateMachine<
   WriterState,
   WriterState::Unlocked,
@@ -54,7 +57,8 @@ using WriterStateMachine = StateMachine<
       Transition {WriterState::Locked, WriterState::Detaching},
       Transition {WriterState::Detaching, WriterState::Locked},
     }),
-  WriterState::Unlocked>;
+  WriterState::Unlocked,
+  InstrumentStateMachineInDebugBuilds<&gWriterStateStatistics>>;
 
 static_assert(lockable_state_machine<SHM::WriterStateMachine>);
 
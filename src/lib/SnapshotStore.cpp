@@ -0,0 +1,334 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/ContentHash.hpp>
+#include <OpenKneeboard/SnapshotStore.hpp>
+
+#include <algorithm>
+#include <format>
+
+namespace OpenKneeboard {
+
+namespace {
+
+// If the file is still being written, give up rather than snapshotting
+// something that never existed
+constexpr unsigned int MaxAttempts = 3;
+
+constexpr auto TemporaryExtension = ".tmp";
+
+struct FileState {
+  uint64_t mSize {};
+  std::filesystem::file_time_type mModified {};
+  bool operator==(const FileState&) const noexcept = default;
+};
+
+std::optional<FileState> GetFileState(const std::filesystem::path& path) {
+  std::error_code ec;
+  FileState ret;
+  ret.mSize = std::filesystem::file_size(path, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  ret.mModified = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  return ret;
+}
+
+/** Copy, sharing storage with the source if the filesystem supports it.
+ *
+ * `CopyFile2()` - used by `std::filesystem::copy_file()` - already does a
+ * block clone on ReFS and Dev Drives where the OS supports it, so there's
+ * nothing extra to do.
+ */
+bool CloneOrCopyFile(
+  const std::filesystem::path& source,
+  const std::filesystem::path& destination) {
+  std::error_code ec;
+  std::filesystem::copy_file(source, destination, ec);
+  return !ec;
+}
+
+}// namespace
+
+SnapshotStore::Snapshot::Snapshot(
+  std::shared_ptr<SnapshotStore> store,
+  std::filesystem::path path,
+  const ContentHash& contentHash)
+  : mStore(std::move(store)),
+    mPath(std::move(path)),
+    mContentHash(contentHash) {
+}
+
+SnapshotStore::Snapshot::~Snapshot() {
+  mStore->Release(this, mContentHash);
+}
+
+std::filesystem::path SnapshotStore::Snapshot::GetPath() const noexcept {
+  return mPath;
+}
+
+ContentHash SnapshotStore::Snapshot::GetContentHash() const noexcept {
+  return mContentHash;
+}
+
+std::shared_ptr<SnapshotStore> SnapshotStore::Create(
+  const std::filesystem::path& directory) {
+  std::shared_ptr<SnapshotStore> ret {new SnapshotStore(directory)};
+  ret->RemoveStale();
+  return ret;
+}
+
+SnapshotStore::SnapshotStore(const std::filesystem::path& directory)
+  : mDirectory(directory) {
+  std::error_code ec;
+  std::filesystem::create_directories(mDirectory, ec);
+}
+
+SnapshotStore::~SnapshotStore() {
+  // Snapshots keep the store alive, so there aren't any left
+  this->RemovePending();
+}
+
+std::filesystem::path SnapshotStore::GetSnapshotPath(
+  const Key& key,
+  const std::filesystem::path& extension,
+  uint64_t uniqueID) const {
+  // Keep the extension, as some consumers care
+  if (!uniqueID) {
+    return mDirectory
+      / std::format("{}{}", key.ToString(), extension.string());
+  }
+  return mDirectory
+    / std::format("{}.{}{}", key.ToString(), uniqueID, extension.string());
+}
+
+bool SnapshotStore::IsIntact(
+  const std::filesystem::path& path,
+  const Key& key) {
+  const auto state = GetFileState(path);
+  return state && state->mSize == key.mByteLength
+    && HashFileContent(path) == key;
+}
+
+bool SnapshotStore::IsUnchanged(const Entry& entry, const Key& key) {
+  const auto state = GetFileState(entry.mPath);
+  return state && state->mSize == key.mByteLength
+    && state->mModified == entry.mModified;
+}
+
+std::shared_ptr<SnapshotStore::Snapshot> SnapshotStore::FindLive(
+  const Key& key) {
+  auto it = mEntries.find(key);
+  if (it == mEntries.end()) {
+    return nullptr;
+  }
+  return it->second.mSnapshot.lock();
+}
+
+void SnapshotStore::Forget(const Snapshot* snapshot, const Key& key) {
+  auto it = mEntries.find(key);
+  if (it == mEntries.end() || it->second.mOwner != snapshot) {
+    return;
+  }
+  mEntries.erase(it);
+  // Still open by its current users; `Release()` won't find the entry, so
+  // clean it up later instead
+  mPendingRemoval.push_back(snapshot->GetPath());
+  ++mStatistics.mDamaged;
+}
+
+std::shared_ptr<SnapshotStore::Snapshot> SnapshotStore::Adopt(
+  const Key& key,
+  const std::filesystem::path& path) {
+  std::shared_ptr<Snapshot> ret {
+    new Snapshot(this->shared_from_this(), path, key)};
+  std::error_code ec;
+  const auto modified = std::filesystem::last_write_time(path, ec);
+  mEntries.insert_or_assign(key, Entry {ret, ret.get(), path, modified});
+  std::erase(mPendingRemoval, path);
+  return ret;
+}
+
+std::shared_ptr<SnapshotStore::Snapshot> SnapshotStore::Acquire(
+  const std::filesystem::path& source) {
+  this->RemovePending();
+
+  for (unsigned int attempt = 0; attempt < MaxAttempts; ++attempt) {
+    const auto before = GetFileState(source);
+    if (!before) {
+      return nullptr;
+    }
+    const auto hash = HashFileContent(source);
+    if (!hash) {
+      return nullptr;
+    }
+    if (hash->mByteLength != before->mSize || GetFileState(source) != before) {
+      continue;
+    }
+
+    const Key& key = *hash;
+    const auto path = this->GetSnapshotPath(key, source.extension());
+
+    // Snapshots are only immutable if nothing else writes to our directory.
+    // Live files were hashed when they were created or adopted, so just
+    // check they haven't been touched since; re-hashing them would double
+    // the cost of every reload.
+    std::shared_ptr<Snapshot> live;
+    {
+      std::unique_lock lock(mMutex);
+      live = this->FindLive(key);
+      if (live) {
+        if (IsUnchanged(mEntries.at(key), key)) {
+          ++mStatistics.mReused;
+          return live;
+        }
+        this->Forget(live.get(), key);
+      }
+    }
+
+    // Left over from a release we couldn't clean up, or a previous run.
+    // Check it's intact before trusting it.
+    if (!live && IsIntact(path, key)) {
+      std::unique_lock lock(mMutex);
+      if (auto existing = this->FindLive(key)) {
+        ++mStatistics.mReused;
+        return existing;
+      }
+      // Files are only removed with the lock held, so this can't change
+      // before we adopt it
+      if (std::filesystem::exists(path)) {
+        ++mStatistics.mReused;
+        return this->Adopt(key, path);
+      }
+    }
+
+    // Copy outside of the lock; other sources shouldn't have to wait for us
+    auto temporary = path;
+    {
+      std::unique_lock lock(mMutex);
+      temporary += std::format(".{}{}", ++mNextTemporaryID, TemporaryExtension);
+      mInProgress.insert(temporary);
+    }
+    const auto copied = CloneOrCopyFile(source, temporary);
+
+    // The source may have changed while we were copying it
+    const auto valid = copied && GetFileState(source) == before
+      && IsIntact(temporary, key);
+
+    std::unique_lock lock(mMutex);
+    mInProgress.erase(temporary);
+    std::error_code ec;
+    if (!valid) {
+      std::filesystem::remove(temporary, ec);
+      if (!copied) {
+        return nullptr;
+      }
+      continue;
+    }
+
+    // Someone else snapshotted the same content while we were copying; it
+    // was verified when they adopted it
+    if (auto existing = this->FindLive(key)) {
+      std::filesystem::remove(temporary, ec);
+      ++mStatistics.mReused;
+      return existing;
+    }
+
+    auto destination = path;
+    std::filesystem::rename(temporary, destination, ec);
+    if (ec) {
+      // Usually because a damaged or stale copy is still open elsewhere
+      destination = this->GetSnapshotPath(
+        key, source.extension(), mNextTemporaryID);
+      std::filesystem::rename(temporary, destination, ec);
+    }
+    if (ec) {
+      std::filesystem::remove(temporary, ec);
+      return nullptr;
+    }
+
+    ++mStatistics.mCopied;
+    mStatistics.mBytesCopied += key.mByteLength;
+    return this->Adopt(key, destination);
+  }
+  return nullptr;
+}
+
+void SnapshotStore::Release(const Snapshot* snapshot, const Key& key) {
+  std::unique_lock lock(mMutex);
+  auto it = mEntries.find(key);
+  // If the entry belongs to someone else, the file was adopted by a new
+  // snapshot after we expired, and it's theirs to clean up
+  if (it == mEntries.end() || it->second.mOwner != snapshot) {
+    return;
+  }
+  mEntries.erase(it);
+
+  const auto path = snapshot->GetPath();
+  std::error_code ec;
+  std::filesystem::remove(path, ec);
+  if (ec) {
+    mPendingRemoval.push_back(path);
+  }
+}
+
+void SnapshotStore::RemovePending() {
+  std::unique_lock lock(mMutex);
+  std::erase_if(mPendingRemoval, [](const auto& path) {
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return !ec;
+  });
+}
+
+void SnapshotStore::RemoveStale() {
+  std::unique_lock lock(mMutex);
+  mPendingRemoval.clear();
+
+  std::error_code ec;
+  for (const auto& it: std::filesystem::directory_iterator(mDirectory, ec)) {
+    const auto& path = it.path();
+    // Expired entries are included too: their files are about to be removed
+    // by `Release()` anyway
+    const auto inUse = mInProgress.contains(path)
+      || std::ranges::any_of(mEntries, [&](const auto& entry) {
+           return entry.second.mPath == path;
+         });
+    if (inUse) {
+      continue;
+    }
+    std::error_code removeError;
+    std::filesystem::remove(path, removeError);
+    if (removeError) {
+      mPendingRemoval.push_back(path);
+    } else {
+      ++mStatistics.mStaleRemoved;
+    }
+  }
+}
+
+SnapshotStore::Statistics SnapshotStore::GetStatistics() const {
+  std::unique_lock lock(mMutex);
+  return mStatistics;
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,167 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/TaskExecutor.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace OpenKneeboard {
+
+namespace {
+thread_local std::weak_ptr<RunQueue> tCurrentRunQueue;
+}
+
+RunQueue::ThreadScope::ThreadScope(const std::shared_ptr<RunQueue>& queue)
+  : mPrevious(std::exchange(tCurrentRunQueue, queue)) {
+}
+
+RunQueue::ThreadScope::~ThreadScope() {
+  tCurrentRunQueue = std::move(mPrevious);
+}
+
+RunQueue::RunQueue() = default;
+
+RunQueue::~RunQueue() = default;
+
+std::shared_ptr<RunQueue> RunQueue::Create() {
+  return std::shared_ptr<RunQueue>(new RunQueue());
+}
+
+std::shared_ptr<RunQueue> RunQueue::GetForCurrentThread() noexcept {
+  return tCurrentRunQueue.lock();
+}
+
+bool RunQueue::TryPost(std::coroutine_handle<> coro) noexcept {
+  bool wake = false;
+  {
+    std::unique_lock lock(mMutex);
+    if (mStopped) {
+      return false;
+    }
+    mQueue.push_back(coro);
+    ++mStatistics.mPosted;
+    // Only pay for a notification if `Run()` is actually asleep
+    wake = std::exchange(mWaiting, false);
+  }
+  if (wake) {
+    mWakeup.notify_one();
+  }
+  return true;
+}
+
+std::size_t RunQueue::Resume(std::vector<std::coroutine_handle<>>& batch) {
+  for (const auto& coro: batch) {
+    coro.resume();
+  }
+  const auto count = batch.size();
+  batch.clear();
+
+  std::unique_lock lock(mMutex);
+  mStatistics.mResumed += count;
+  return count;
+}
+
+void RunQueue::Run() {
+  // Posters may release the last external reference while we're running
+  const auto self = this->shared_from_this();
+  const ThreadScope scope(self);
+
+  // Swap batches rather than popping one at a time, so producers only
+  // contend with us once per batch
+  std::vector<std::coroutine_handle<>> batch;
+  while (true) {
+    {
+      std::unique_lock lock(mMutex);
+      while (mQueue.empty() && !mStopped) {
+        mWaiting = true;
+        ++mStatistics.mWaits;
+        mWakeup.wait(lock, [this] { return !mWaiting || mStopped; });
+      }
+      if (mQueue.empty()) {
+        return;
+      }
+      std::swap(batch, mQueue);
+    }
+    this->Resume(batch);
+  }
+}
+
+std::size_t RunQueue::RunPending() {
+  std::vector<std::coroutine_handle<>> batch;
+  {
+    std::unique_lock lock(mMutex);
+    std::swap(batch, mQueue);
+  }
+  return this->Resume(batch);
+}
+
+void RunQueue::Stop() noexcept {
+  {
+    std::unique_lock lock(mMutex);
+    mStopped = true;
+  }
+  mWakeup.notify_all();
+}
+
+RunQueue::Statistics RunQueue::GetStatistics() const {
+  std::unique_lock lock(mMutex);
+  return mStatistics;
+}
+
+ThreadPool::ThreadPool(std::size_t threadCount) {
+  threadCount = std::max<std::size_t>(threadCount, 1);
+  mQueues.reserve(threadCount);
+  mThreads.reserve(threadCount);
+  for (std::size_t i = 0; i < threadCount; ++i) {
+    auto queue = RunQueue::Create();
+    mQueues.push_back(queue);
+    mThreads.emplace_back([queue] { queue->Run(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  for (const auto& queue: mQueues) {
+    queue->Stop();
+  }
+  // Join before the queues are released, as they're still draining
+  mThreads.clear();
+}
+
+ThreadPool& ThreadPool::GetDefault() {
+  static ThreadPool sInstance {std::thread::hardware_concurrency()};
+  return sInstance;
+}
+
+std::size_t ThreadPool::GetThreadCount() const noexcept {
+  return mThreads.size();
+}
+
+void ThreadPool::Post(std::coroutine_handle<> coro) noexcept {
+  const auto index
+    = mNextQueue.fetch_add(1, std::memory_order_relaxed) % mQueues.size();
+  if (!mQueues[index]->TryPost(coro)) [[unlikely]] {
+    // Only possible if something is still using the pool while it's being
+    // destroyed
+    std::terminate();
+  }
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,134 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CacheFile.hpp>
+#include <OpenKneeboard/ThumbnailCache.hpp>
+
+#include <format>
+
+namespace OpenKneeboard {
+
+namespace {
+// 'OKTH'
+constexpr uint32_t Magic = 0x48544b4f;
+// Bump whenever the layout below, or the meaning of any field, changes
+constexpr uint32_t Version = 2;
+
+constexpr std::size_t BytesPerPixel = 4;
+
+void WriteKey(CacheFile::Writer& w, const ThumbnailCache::Key& key) {
+  w.Write(key.mContentHash);
+  w.Write(key.mPage);
+  w.Write(key.mSize.mWidth);
+  w.Write(key.mSize.mHeight);
+}
+
+/// Returns false unless the stored key matches `expected`
+bool ReadKey(CacheFile::Reader& r, const ThumbnailCache::Key& expected) {
+  ThumbnailCache::Key key;
+  return r.Read(key.mContentHash) && r.Read(key.mPage)
+    && r.Read(key.mSize.mWidth) && r.Read(key.mSize.mHeight)
+    && key == expected;
+}
+
+std::size_t GetByteSize(const ThumbnailCache::Size& size) {
+  return std::size_t {size.mWidth} * size.mHeight * BytesPerPixel;
+}
+
+}// namespace
+
+ThumbnailCache::ThumbnailCache(
+  const std::filesystem::path& directory,
+  uint64_t maxBytes)
+  : mDirectory(directory), mMaxBytes(maxBytes) {
+}
+
+std::filesystem::path ThumbnailCache::GetEntryPath(const Key& key) const {
+  return mDirectory
+    / std::format(
+           "{}-{}-{}x{}.bin",
+           key.mContentHash.ToString(),
+           key.mPage,
+           key.mSize.mWidth,
+           key.mSize.mHeight);
+}
+
+std::optional<ThumbnailCache::Thumbnail> ThumbnailCache::Load(const Key& key) {
+  const auto path = this->GetEntryPath(key);
+  const auto payload = CacheFile::Load(path, Magic, Version);
+
+  // The size is part of the key, so a valid entry is exactly this size
+  Thumbnail ret {.mSize = key.mSize};
+  const auto valid = payload && [&] {
+    CacheFile::Reader r(*payload);
+    if (!ReadKey(r, key)) {
+      return false;
+    }
+    ret.mPixels.resize(GetByteSize(key.mSize));
+    return r.ReadBytes(ret.mPixels) && r.IsAtEnd();
+  }();
+
+  std::unique_lock lock(mMutex);
+  if (!valid) {
+    ++mStatistics.mMisses;
+    return std::nullopt;
+  }
+  ++mStatistics.mHits;
+  lock.unlock();
+
+  // Pruning removes the least-recently written entries
+  std::error_code ec;
+  std::filesystem::last_write_time(
+    path, std::filesystem::file_time_type::clock::now(), ec);
+  return ret;
+}
+
+void ThumbnailCache::Store(const Key& key, const Thumbnail& thumbnail) {
+  if (
+    thumbnail.mSize != key.mSize
+    || thumbnail.mPixels.size() != GetByteSize(key.mSize)) {
+    return;
+  }
+
+  CacheFile::Writer w;
+  WriteKey(w, key);
+  w.WriteBytes(thumbnail.mPixels);
+  const auto path = this->GetEntryPath(key);
+  if (!CacheFile::Save(path, Magic, Version, w.GetBuffer())) {
+    return;
+  }
+
+  std::unique_lock lock(mMutex);
+  ++mStatistics.mStores;
+  if (++mStoresSincePrune < StoresPerPrune) {
+    return;
+  }
+  mStoresSincePrune = 0;
+  ++mStatistics.mPrunes;
+  lock.unlock();
+
+  CacheFile::Prune(mDirectory, MaxEntries, mMaxBytes);
+}
+
+ThumbnailCache::Statistics ThumbnailCache::GetStatistics() const {
+  std::unique_lock lock(mMutex);
+  return mStatistics;
+}
+
+}// namespace OpenKneeboard
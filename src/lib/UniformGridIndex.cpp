@@ -0,0 +1,153 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/UniformGridIndex.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace OpenKneeboard {
+
+namespace {
+
+bool IsValid(const UniformGridIndex::Rect& r) {
+  // Also false for NaNs
+  return std::isfinite(r.mLeft) && std::isfinite(r.mTop)
+    && std::isfinite(r.mRight) && std::isfinite(r.mBottom)
+    && r.mLeft <= r.mRight && r.mTop <= r.mBottom;
+}
+
+bool Contains(const UniformGridIndex::Rect& r, float x, float y) {
+  return x >= r.mLeft && x <= r.mRight && y >= r.mTop && y <= r.mBottom;
+}
+
+}// namespace
+
+UniformGridIndex::UniformGridIndex(std::span<const Rect> rects)
+  : mRects(rects.begin(), rects.end()) {
+  if (mRects.size() < MinGridSize) {
+    return;
+  }
+
+  float right = std::numeric_limits<float>::lowest();
+  float bottom = std::numeric_limits<float>::lowest();
+  mLeft = std::numeric_limits<float>::max();
+  mTop = std::numeric_limits<float>::max();
+  std::size_t validCount {};
+  for (const auto& r: mRects) {
+    if (!IsValid(r)) {
+      continue;
+    }
+    ++validCount;
+    mLeft = std::min(mLeft, r.mLeft);
+    mTop = std::min(mTop, r.mTop);
+    right = std::max(right, r.mRight);
+    bottom = std::max(bottom, r.mBottom);
+  }
+  if (validCount < MinGridSize) {
+    return;
+  }
+
+  // Aim for about one rectangle per cell
+  const auto perAxis = std::clamp<uint32_t>(
+    static_cast<uint32_t>(std::ceil(std::sqrt(validCount))),
+    1,
+    MaxCellsPerAxis);
+  const auto width = right - mLeft;
+  const auto height = bottom - mTop;
+  mColumns = (width > 0) ? perAxis : 1;
+  mRows = (height > 0) ? perAxis : 1;
+  mCellWidth = (width > 0) ? (width / mColumns) : 1;
+  mCellHeight = (height > 0) ? (height / mRows) : 1;
+
+  // Two passes - count, then fill - so each cell is contiguous
+  const auto cellCount = std::size_t {mColumns} * mRows;
+  mCellStart.assign(cellCount + 1, 0);
+  auto forEachCell = [this](const Rect& r, auto&& fn) {
+    const auto lastRow = this->GetRow(r.mBottom);
+    const auto lastColumn = this->GetColumn(r.mRight);
+    for (auto row = this->GetRow(r.mTop); row <= lastRow; ++row) {
+      for (auto column = this->GetColumn(r.mLeft); column <= lastColumn;
+           ++column) {
+        fn((std::size_t {row} * mColumns) + column);
+      }
+    }
+  };
+  for (const auto& r: mRects) {
+    if (IsValid(r)) {
+      forEachCell(r, [this](std::size_t cell) { ++mCellStart[cell + 1]; });
+    }
+  }
+  for (std::size_t i = 1; i <= cellCount; ++i) {
+    mCellStart[i] += mCellStart[i - 1];
+  }
+
+  mCellItems.resize(mCellStart.back());
+  auto next = mCellStart;
+  for (uint32_t i = 0; i < mRects.size(); ++i) {
+    if (IsValid(mRects[i])) {
+      forEachCell(
+        mRects[i], [&](std::size_t cell) { mCellItems[next[cell]++] = i; });
+    }
+  }
+}
+
+uint32_t UniformGridIndex::GetColumn(float x) const noexcept {
+  const auto column = std::floor((x - mLeft) / mCellWidth);
+  return static_cast<uint32_t>(
+    std::clamp(column, 0.0f, static_cast<float>(mColumns - 1)));
+}
+
+uint32_t UniformGridIndex::GetRow(float y) const noexcept {
+  const auto row = std::floor((y - mTop) / mCellHeight);
+  return static_cast<uint32_t>(
+    std::clamp(row, 0.0f, static_cast<float>(mRows - 1)));
+}
+
+std::optional<std::size_t> UniformGridIndex::HitTest(float x, float y) const {
+  if (mCellStart.empty()) {
+    for (std::size_t i = 0; i < mRects.size(); ++i) {
+      if (Contains(mRects[i], x, y)) {
+        return i;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Outside the bounding box; also false for NaNs
+  if (!(x >= mLeft && y >= mTop)) {
+    return std::nullopt;
+  }
+  const auto cell
+    = (std::size_t {this->GetRow(y)} * mColumns) + this->GetColumn(x);
+  for (auto i = mCellStart[cell]; i < mCellStart[cell + 1]; ++i) {
+    const auto index = mCellItems[i];
+    if (Contains(mRects[index], x, y)) {
+      return index;
+    }
+  }
+  return std::nullopt;
+}
+
+std::size_t UniformGridIndex::GetCellCount() const noexcept {
+  return std::size_t {mColumns} * mRows;
+}
+
+}// namespace OpenKneeboard
@@ -33,6 +33,7 @@
 
 #include <Windows.h>
 
+#include <array>
 #include <atomic>
 #include <bit>
 #include <chrono>
@@ -40,6 +41,7 @@
 #include <fstream>
 #include <source_location>
 #include <stacktrace>
+#include <utility>
 
 #include <DbgHelp.h>
 #include <wchar.h>
@@ -76,6 +78,9 @@ struct ExceptionRecord {
   enum class Flags : uint64_t {
     None = 0,
     ForceForNextException = 1,
+    // Set by `SetForNextException()`: recorded on another stack, e.g. by a
+    // `task<>` whose awaiter rethrows it
+    Carried = 2,
   };
 
   StackTrace mCreationStack;
@@ -102,6 +107,119 @@ struct WILFailureRecord {
 static thread_local std::optional<WILFailureRecord> tLatestWILFailure {};
 
 MINIDUMP_TYPE gMinidumpType {MiniDumpNormal};
+
+std::atomic<ExceptionStackTraces> gExceptionStackTraces {
+  ExceptionStackTraces::Sampled};
+
+// Walking the whole stack is most of the cost of a throw; that doesn't
+// matter for rare or fatal exceptions, but some code throws for expected
+// control flow, e.g. file-not-found or cancellation during reloads.
+constexpr uint64_t FullTracesPerExceptionType = 8;
+constexpr uint64_t FullTraceInterval = 64;
+// Enough for the throw site and the coroutine or function that threw
+constexpr std::size_t ShallowTraceFrames = 16;
+
+/** How many times each exception type has been thrown.
+ *
+ * Types are identified by their `_ThrowInfo`, so the same type thrown from
+ * different modules is counted separately. This is a fixed-size lock-free
+ * table as it's used for every throw; if it fills up, the remaining types
+ * are always treated as new.
+ */
+class ExceptionTypeCounters final {
+ public:
+  uint64_t Increment(const void* type) noexcept {
+    const auto hash = std::hash<const void*> {}(type);
+    for (std::size_t i = 0; i < Capacity; ++i) {
+      auto& slot = mSlots[(hash + i) % Capacity];
+      const void* existing = slot.mType.load(std::memory_order_acquire);
+      if (!existing) {
+        slot.mType.compare_exchange_strong(
+          existing, type, std::memory_order_acq_rel);
+        existing = slot.mType.load(std::memory_order_acquire);
+      }
+      if (existing == type) {
+        return slot.mCount.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    return 0;
+  }
+
+ private:
+  static constexpr std::size_t Capacity = 256;
+  struct Slot {
+    std::atomic<const void*> mType {nullptr};
+    std::atomic_uint64_t mCount {};
+  };
+  std::array<Slot, Capacity> mSlots;
+};
+ExceptionTypeCounters gExceptionTypeCounters;
+
+std::size_t GetMaxStackFramesForException(const void* throwInfo) noexcept {
+  if (
+    gExceptionStackTraces.load(std::memory_order_relaxed)
+    == ExceptionStackTraces::Full) {
+    return StackTrace::MaxFrames;
+  }
+  const auto previous = gExceptionTypeCounters.Increment(throwInfo);
+  if (
+    previous < FullTracesPerExceptionType
+    || (previous % FullTraceInterval) == 0) {
+    return StackTrace::MaxFrames;
+  }
+  return ShallowTraceFrames;
+}
+
+// Returns a `malloc()`ed buffer and the frame count
+OPENKNEEBOARD_NOINLINE
+std::pair<void**, std::size_t> CaptureStackFrames(
+  std::size_t skip,
+  std::size_t maxFrames) noexcept {
+  // Capture straight into the result; a buffer the size of
+  // `CaptureAllStackFrames()`'s would be most of the cost, as every page of
+  // it needs to be probed
+  auto ret = static_cast<void**>(malloc(sizeof(void*) * maxFrames));
+  std::size_t frames = 0;
+  // Function sporadically fails (as does std::stacktrace::current() on MS STL)
+  while (!(frames = CaptureStackBackTrace(skip, maxFrames, ret, nullptr))) {
+    // retry
+  }
+  return {ret, frames};
+}
+
+OPENKNEEBOARD_NOINLINE
+std::pair<void**, std::size_t> CaptureAllStackFrames(
+  std::size_t skip) noexcept {
+  void* buffer[StackTrace::MaxFrames];
+  std::size_t frames = 0;
+  while (!(frames = CaptureStackBackTrace(
+              skip, std::size(buffer), buffer, nullptr))) {
+    // retry
+  }
+  // Not using a vector to avoid initialization overhead
+  auto ret = static_cast<void**>(malloc(sizeof(void*) * frames));
+  memcpy(ret, buffer, sizeof(void*) * frames);
+  return {ret, frames};
+}
+
+/** Replace a sampled trace for an exception that's about to be reported.
+ *
+ * The throw site is still on the stack: the unhandled exception filter runs
+ * before unwinding, and catch blocks run on top of the throwing frames. A
+ * trace carried over from another stack can't be completed, as that stack
+ * is gone; the report's own trace covers where it was rethrown.
+ */
+OPENKNEEBOARD_NOINLINE
+void CaptureFullTraceForReportedException() noexcept {
+  using enum ExceptionRecord::Flags;
+  if (!(tLatestException && tLatestException->mCreationStack.IsTruncated())) {
+    return;
+  }
+  if ((tLatestException->mFlags & Carried) == Carried) {
+    return;
+  }
+  tLatestException->mCreationStack = StackTrace::Current(1);
+}
 }// namespace
 
 template <class CharT>
@@ -363,8 +481,11 @@ static std::string GetFatalLogContents(
   if (tLatestException) {
     f << "\n"
       << "Latest Exception\n"
-      << "================\n\n"
-      << tLatestException->mCreationStack << "\n";
+      << "================\n\n";
+    if (tLatestException->mCreationStack.IsTruncated()) {
+      f << "Only the frames nearest the throw were recorded.\n\n";
+    }
+    f << tLatestException->mCreationStack << "\n";
   }
 
   if (tLatestWILFailure) {
@@ -473,6 +594,13 @@ static void OnTerminate() {
 
 LONG __callback WINAPI
 OnUnhandledException(LPEXCEPTION_POINTERS exceptionPointers) {
+  // 'msc' | 0xE0000000: a C++ exception, so the one we last recorded
+  constexpr DWORD CxxExceptionCode = 0xE06D7363;
+  if (
+    exceptionPointers
+    && exceptionPointers->ExceptionRecord->ExceptionCode == CxxExceptionCode) {
+    CaptureFullTraceForReportedException();
+  }
   CrashMeta meta {};
   FatalAndDump(meta, {"Uncaught exceptions"}, exceptionPointers);
   return EXCEPTION_EXECUTE_HANDLER;
@@ -526,7 +654,7 @@ extern "C" void __stdcall CxxThrowExceptionHook(
   } else if (pExceptionObject) {
     // Otherwise, it's a rethrow
     tLatestException = {
-      StackTrace::Current(1),
+      StackTrace::Current(1, GetMaxStackFramesForException(pThrowInfo)),
     };
   }
 
@@ -562,21 +690,21 @@ std::span<StackFramePointer> StackTrace::GetEntries() const {
 }
 
 OPENKNEEBOARD_FORCEINLINE
-StackTrace StackTrace::Current(std::size_t skip) noexcept {
-  // std::stacktrace::_Max_frames in the Microsoft STL as of 2025-01-16
-  void* buffer[0xFFFF];
-  // Function sporadically fails (as does std::stacktrace::current() on MS STL)
-  std::size_t frames = 0;
-  while (!(
-    frames = CaptureStackBackTrace(skip, std::size(buffer), buffer, nullptr))) {
-    // retry
-  }
+StackTrace StackTrace::Current(
+  std::size_t skip,
+  std::size_t maxFrames) noexcept {
   static_assert(sizeof(StackFramePointer) == sizeof(void*));
-  // Not using a vector to avoid initialization overhead
+  if (maxFrames == 0) {
+    return {};
+  }
+  // +1 for the capture function
+  const auto [frames, size] = (maxFrames < MaxFrames)
+    ? CaptureStackFrames(skip + 1, maxFrames)
+    : CaptureAllStackFrames(skip + 1);
   StackTrace ret;
-  ret.mData = {malloc(sizeof(void*) * frames), &free};
-  memcpy(ret.mData.get(), buffer, sizeof(void*) * frames);
-  ret.mSize = frames;
+  ret.mData = {frames, &free};
+  ret.mSize = size;
+  ret.mTruncated = (maxFrames < MaxFrames) && (size == maxFrames);
   return ret;
 }
 
@@ -588,9 +716,10 @@ StackTrace StackTrace::GetForMostRecentException() {
 }
 
 void StackTrace::SetForNextException(const StackTrace& v) {
+  using enum ExceptionRecord::Flags;
   tLatestException = ExceptionRecord {
     v,
-    ExceptionRecord::Flags::ForceForNextException,
+    ForceForNextException | Carried,
   };
 }
 
@@ -619,6 +748,10 @@ void SetDumpType(DumpType type) {
   }
 }
 
+void SetExceptionStackTraces(ExceptionStackTraces value) {
+  gExceptionStackTraces.store(value, std::memory_order_relaxed);
+}
+
 void fatal_with_hresult(HRESULT hr) {
   using namespace OpenKneeboard::detail;
   prepare_to_fatal();
@@ -642,6 +775,11 @@ void fatal_with_exception(std::exception_ptr ep) {
     std::unreachable();
   }
 
+  // Usually called from the exception's catch block
+  if (ep == std::current_exception()) {
+    CaptureFullTraceForReportedException();
+  }
+
   try {
     std::rethrow_exception(ep);
   } catch (const winrt::hresult_error& e) {
@@ -0,0 +1,168 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/** Versioned, checksummed binary files for on-disk caches.
+ *
+ * Files are:
+ * - a header containing a magic number, version, payload size, and payload
+ *   checksum
+ * - the payload, in native byte order
+ *
+ * Anything that doesn't match exactly is treated as a cache miss, and
+ * deleted; caches must always be safe to throw away.
+ */
+namespace OpenKneeboard::CacheFile {
+
+class Writer final {
+ public:
+  template <class T>
+    requires std::is_trivially_copyable_v<T>
+  void Write(const T& value) {
+    const auto begin = reinterpret_cast<const std::byte*>(&value);
+    mBuffer.insert(mBuffer.end(), begin, begin + sizeof(T));
+  }
+
+  void Write(std::string_view value) {
+    this->Write(static_cast<uint32_t>(value.size()));
+    const auto begin = reinterpret_cast<const std::byte*>(value.data());
+    mBuffer.insert(mBuffer.end(), begin, begin + value.size());
+  }
+
+  void WriteBytes(std::span<const std::byte> value) {
+    mBuffer.insert(mBuffer.end(), value.begin(), value.end());
+  }
+
+  std::span<const std::byte> GetBuffer() const noexcept {
+    return mBuffer;
+  }
+
+ private:
+  std::vector<std::byte> mBuffer;
+};
+
+/// All reads are bounds-checked; once a read fails, all later reads fail
+class Reader final {
+ public:
+  Reader(std::span<const std::byte> buffer) : mBuffer(buffer) {
+  }
+
+  template <class T>
+    requires std::is_trivially_copyable_v<T>
+  [[nodiscard]]
+  bool Read(T& value) {
+    if (mFailed || mBuffer.size() < sizeof(T)) {
+      mFailed = true;
+      return false;
+    }
+    std::memcpy(&value, mBuffer.data(), sizeof(T));
+    mBuffer = mBuffer.subspan(sizeof(T));
+    return true;
+  }
+
+  [[nodiscard]]
+  bool Read(std::string& value) {
+    uint32_t size {};
+    if (!this->Read(size)) {
+      return false;
+    }
+    if (mBuffer.size() < size) {
+      mFailed = true;
+      return false;
+    }
+    value.assign(reinterpret_cast<const char*>(mBuffer.data()), size);
+    mBuffer = mBuffer.subspan(size);
+    return true;
+  }
+
+  /// Fill `value` exactly
+  [[nodiscard]]
+  bool ReadBytes(std::span<std::byte> value) {
+    if (mFailed || mBuffer.size() < value.size()) {
+      mFailed = true;
+      return false;
+    }
+    std::memcpy(value.data(), mBuffer.data(), value.size());
+    mBuffer = mBuffer.subspan(value.size());
+    return true;
+  }
+
+  /// Read a count, rejecting any that can't possibly fit in the remaining
+  /// data; this avoids huge allocations from corrupt files
+  [[nodiscard]]
+  bool ReadCount(uint32_t& count, std::size_t minElementSize) {
+    if (!this->Read(count)) {
+      return false;
+    }
+    if (minElementSize && count > mBuffer.size() / minElementSize) {
+      mFailed = true;
+      return false;
+    }
+    return true;
+  }
+
+  bool IsAtEnd() const noexcept {
+    return !mFailed && mBuffer.empty();
+  }
+
+ private:
+  std::span<const std::byte> mBuffer;
+  bool mFailed {false};
+};
+
+/** Atomically replace `path`.
+ *
+ * Returns false on failure; callers will usually want to ignore failures.
+ */
+bool Save(
+  const std::filesystem::path& path,
+  uint32_t magic,
+  uint32_t version,
+  std::span<const std::byte> payload) noexcept;
+
+/// Returns the payload if the file is present and valid
+std::optional<std::vector<std::byte>> Load(
+  const std::filesystem::path& path,
+  uint32_t magic,
+  uint32_t version) noexcept;
+
+/** Remove the least-recently-written `.bin` files.
+ *
+ * The newest files are kept while there are at most `maxEntries` of them,
+ * totalling at most `maxBytes`.
+ */
+void Prune(
+  const std::filesystem::path& directory,
+  std::size_t maxEntries,
+  uint64_t maxBytes = std::numeric_limits<uint64_t>::max());
+
+}// namespace OpenKneeboard::CacheFile
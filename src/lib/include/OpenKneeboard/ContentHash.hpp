@@ -0,0 +1,79 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+
+namespace OpenKneeboard {
+
+/** Identifies content by its SHA-256 digest and length.
+ *
+ * These are used as the only identity for cached and deduplicated data, so
+ * a collision would show the wrong document; that rules out faster
+ * non-cryptographic hashes. The length is part of the key so that even a
+ * digest collision needs equal-length content.
+ */
+struct ContentHash {
+  std::array<uint8_t, 32> mSHA256 {};
+  uint64_t mByteLength {};
+
+  /// Hex digest and length, e.g. for file names
+  std::string ToString() const;
+
+  auto operator<=>(const ContentHash&) const noexcept = default;
+};
+
+class ContentHasher final {
+ public:
+  ContentHasher();
+  ~ContentHasher();
+
+  ContentHasher(const ContentHasher&) = delete;
+  ContentHasher& operator=(const ContentHasher&) = delete;
+
+  void Update(std::span<const std::byte>);
+  /// The hasher can't be used again afterwards
+  ContentHash Finish();
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> mImpl;
+};
+
+ContentHash HashContent(std::span<const std::byte>);
+
+/** Hash at most `maxBytes` from the start of the file.
+ *
+ * Returns `std::nullopt` if the file can't be read.
+ */
+std::optional<ContentHash> HashFileContent(
+  const std::filesystem::path&,
+  std::size_t maxBytes = std::numeric_limits<std::size_t>::max());
+
+}// namespace OpenKneeboard
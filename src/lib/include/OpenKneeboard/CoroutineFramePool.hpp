@@ -0,0 +1,71 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** Allocator for `task<>` and `fire_and_forget` coroutine frames.
+ *
+ * Frames are allocated and freed constantly - e.g. every event handler that's
+ * a coroutine - so they're pooled in size classes, with a per-thread cache in
+ * front of a shared pool. Frames are often freed on a different thread than
+ * they were allocated on; that's fine, as blocks in a size class are
+ * interchangeable.
+ */
+namespace OpenKneeboard::CoroutineFramePool {
+
+// Frames larger than this go straight to `::operator new`
+constexpr std::size_t MaxPooledSize = 4096;
+
+struct Statistics {
+  uint64_t mAllocations {};
+  // Allocations served from a free list, rather than `::operator new`
+  uint64_t mPoolHits {};
+  // Allocations larger than `MaxPooledSize`
+  uint64_t mLargeAllocations {};
+  uint64_t mFramesInFlight {};
+  uint64_t mBytesInFlight {};
+};
+
+struct LiveFrame {
+  const void* mFrame {nullptr};
+  std::size_t mSize {};
+  // The return address of the allocation, i.e. inside the coroutine
+  const void* mCaller {nullptr};
+};
+
+[[nodiscard]]
+void* Allocate(std::size_t size, const void* caller);
+void Deallocate(void* frame, std::size_t size) noexcept;
+
+Statistics GetStatistics();
+
+/** Record every frame allocated from now on, so leaks can be reported.
+ *
+ * This adds a global lock to every allocation, so should only be used for
+ * debugging; it can't be disabled again.
+ */
+void EnableLeakTracking();
+/// Empty unless `EnableLeakTracking()` has been called
+std::vector<LiveFrame> GetLiveFrames();
+
+}// namespace OpenKneeboard::CoroutineFramePool
@@ -0,0 +1,163 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/** Live `task<>` and `fire_and_forget` coroutines, and what they're doing.
+ *
+ * Every coroutine registers itself in a fixed-size slot table when it's
+ * created, and updates its slot whenever it suspends or resumes. Updates are
+ * a handful of relaxed stores and a `CoarseClock` read, and slots are claimed
+ * and released with a lock-free free list, so this is always enabled.
+ *
+ * Readers never block writers: each slot has a sequence number, and reads
+ * that race with an update are retried or skipped.
+ */
+namespace OpenKneeboard::CoroutineRegistry {
+
+// Coroutines created while all slots are in use aren't tracked
+constexpr std::size_t Capacity = 4096;
+
+using SlotID = uint32_t;
+constexpr SlotID NoSlot = ~SlotID {0};
+
+/** A monotonic clock that's much cheaper to read than `steady_clock`.
+ *
+ * The resolution is that of the system tick: usually 10-16ms on Windows.
+ */
+struct CoarseClock {
+  using rep = int64_t;
+  using period = std::milli;
+  using duration = std::chrono::duration<rep, period>;
+  using time_point = std::chrono::time_point<CoarseClock>;
+  static constexpr bool is_steady = true;
+
+  static time_point now() noexcept;
+};
+
+enum class CoroutineState : uint8_t {
+  Running,
+  Suspended,
+  // Reached `final_suspend()`, but not yet destroyed
+  Completed,
+};
+
+struct LiveCoroutine {
+  SlotID mSlot {NoSlot};
+  // The return address into the code that created the coroutine
+  const void* mCreator {nullptr};
+  // The most recent `co_await` that suspended, if any
+  const void* mAwaitPoint {nullptr};
+  // The thread it's running on, or last ran on
+  std::thread::id mThread;
+  CoroutineState mState {CoroutineState::Running};
+  CoarseClock::time_point mSince;
+  // Increases with every state change on `mThread`, so coroutines that
+  // changed state in the same clock tick can still be ordered
+  uint64_t mThreadSequence {};
+};
+
+struct Statistics {
+  // The most coroutines that have been tracked at once
+  std::size_t mHighWater {};
+  // Registrations that found every slot in use
+  uint64_t mUntracked {};
+};
+
+/// Returns `NoSlot` if the registry is full; other functions accept it
+[[nodiscard]]
+SlotID Register(const void* creator) noexcept;
+void Unregister(SlotID) noexcept;
+
+void OnSuspend(SlotID, const void* awaitPoint) noexcept;
+void OnResume(SlotID) noexcept;
+void OnComplete(SlotID) noexcept;
+
+std::vector<LiveCoroutine> GetLiveCoroutines();
+Statistics GetStatistics() noexcept;
+
+/** Flags coroutines that keep a thread busy for longer than a budget.
+ *
+ * Only one coroutine can actually be executing on a thread at a time: the
+ * most recently resumed one that's still running. Callers further up the
+ * stack - e.g. a coroutine that started a child task that hasn't suspended
+ * yet - are also marked as running, but aren't blamed.
+ *
+ * The thread is checked once per budget; a coroutine is flagged if it's
+ * still in the same run as at the previous check, so stalls are reported
+ * once they've lasted between one and two budgets.
+ */
+class StallDetector final {
+ public:
+  struct Stall {
+    LiveCoroutine mCoroutine;
+    std::chrono::system_clock::time_point mDetectedAt;
+    // At least this long
+    std::chrono::steady_clock::duration mDuration {};
+    bool mOngoing {true};
+  };
+
+  // Enough to cover a burst of hitches, without the dump getting unwieldy
+  static constexpr std::size_t MaxStalls = 32;
+
+  StallDetector() = delete;
+  StallDetector(
+    std::thread::id thread,
+    std::chrono::steady_clock::duration budget);
+  ~StallDetector();
+
+  StallDetector(const StallDetector&) = delete;
+  StallDetector& operator=(const StallDetector&) = delete;
+
+  std::thread::id GetThreadID() const noexcept;
+  std::chrono::steady_clock::duration GetBudget() const noexcept;
+
+  /// Most recent last
+  std::vector<Stall> GetStalls() const;
+
+ private:
+  const std::thread::id mThreadID;
+  const std::chrono::steady_clock::duration mBudget;
+
+  // The innermost running coroutine at the previous check; only used by the
+  // watchdog thread
+  struct Candidate {
+    SlotID mSlot {NoSlot};
+    uint64_t mThreadSequence {};
+    std::chrono::steady_clock::time_point mFirstSeen;
+  };
+  std::optional<Candidate> mCandidate;
+
+  mutable std::mutex mMutex;
+  // Only the most recent stall can be ongoing
+  std::vector<Stall> mStalls;
+
+  std::jthread mWatchdog;
+
+  void Check();
+};
+
+}// namespace OpenKneeboard::CoroutineRegistry
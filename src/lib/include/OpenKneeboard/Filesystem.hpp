@@ -38,6 +38,8 @@ void CreateDirectoryShortcut(
  * it guarantees to be in canonical form */
 std::filesystem::path GetTemporaryDirectory();
 std::filesystem::path GetLocalAppDataDirectory();
+/// Everything in here must be safe to delete at any time
+std::filesystem::path GetCacheDirectory();
 std::filesystem::path GetLogsDirectory();
 std::filesystem::path GetCrashLogsDirectory();
 std::filesystem::path GetRuntimeDirectory();
@@ -78,21 +80,4 @@ class ScopedDeleter {
   std::filesystem::path mPath;
 };
 
-class TemporaryCopy final {
- public:
-  TemporaryCopy(
-    const std::filesystem::path& source,
-    const std::filesystem::path& destination);
-  ~TemporaryCopy() noexcept;
-
-  TemporaryCopy() = delete;
-  TemporaryCopy(const TemporaryCopy&) = delete;
-  TemporaryCopy& operator=(const TemporaryCopy&) = delete;
-
-  std::filesystem::path GetPath() const noexcept;
-
- private:
-  std::filesystem::path mCopy;
-};
-
 }// namespace OpenKneeboard::Filesystem
@@ -0,0 +1,210 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** OS-specific part of `FilesystemWatchService`.
+ *
+ * Backends only need to say 'something in this directory changed'; working
+ * out which subscribers are affected is done by the service.
+ */
+class FilesystemWatchBackend {
+ public:
+  class Handle {
+   public:
+    /// Must not return while a callback is in progress
+    virtual ~Handle();
+  };
+
+  virtual ~FilesystemWatchBackend();
+
+  /** Start watching a directory.
+   *
+   * `onChanged` may be called from any thread until the handle is destroyed.
+   *
+   * Returns nullptr if the directory can't be watched.
+   */
+  [[nodiscard]]
+  virtual std::unique_ptr<Handle> Watch(
+    const std::filesystem::path& directory,
+    bool recursive,
+    std::function<void()> onChanged)
+    = 0;
+};
+
+/// Uses `FindFirstChangeNotificationW()`
+std::unique_ptr<FilesystemWatchBackend> CreatePlatformFilesystemWatchBackend();
+
+/** Process-wide filesystem watches.
+ *
+ * - subscriptions to files in the same directory - or to the same directory -
+ *   share a single OS watch
+ * - bursts of notifications are debounced with a single timer wheel, rather
+ *   than a timer or polling loop per subscriber
+ * - file subscribers are only notified if the file's size, modification time
+ *   or existence changed; directory subscribers are notified for any change
+ *   in the tree
+ *
+ * Callbacks are invoked from the service's timer thread.
+ */
+class FilesystemWatchService final
+  : public std::enable_shared_from_this<FilesystemWatchService> {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Callback = std::function<void(const std::filesystem::path&)>;
+
+  static constexpr Clock::duration DefaultSettleTime
+    = std::chrono::milliseconds(100);
+
+  class Subscription final {
+   public:
+    Subscription() = delete;
+    Subscription(const Subscription&) = delete;
+    Subscription& operator=(const Subscription&) = delete;
+    ~Subscription();
+
+   private:
+    friend class FilesystemWatchService;
+    Subscription(std::shared_ptr<FilesystemWatchService>, uint64_t id);
+
+    std::shared_ptr<FilesystemWatchService> mService;
+    uint64_t mID {};
+  };
+
+  struct Statistics {
+    /// i.e. handle count
+    std::size_t mOSWatches {};
+    std::size_t mSubscriptions {};
+    uint64_t mBackendNotifications {};
+    uint64_t mCallbacks {};
+    /// From the first notification in a burst to the callback
+    Clock::duration mTotalLatency {};
+    Clock::duration mMaxLatency {};
+  };
+
+  /// The shared instance, using the platform backend
+  static std::shared_ptr<FilesystemWatchService> Get();
+
+  static std::shared_ptr<FilesystemWatchService> Create(
+    std::unique_ptr<FilesystemWatchBackend>,
+    Clock::duration settleTime = DefaultSettleTime);
+
+  FilesystemWatchService() = delete;
+  ~FilesystemWatchService();
+
+  /** Watch a file or directory until the subscription is destroyed.
+   *
+   * Once the destructor returns, the callback will not be invoked again,
+   * unless it was destroyed from inside the callback.
+   */
+  [[nodiscard]]
+  std::unique_ptr<Subscription> Subscribe(
+    const std::filesystem::path&,
+    Callback);
+
+  Statistics GetStatistics() const;
+
+ private:
+  FilesystemWatchService(
+    std::unique_ptr<FilesystemWatchBackend>,
+    Clock::duration settleTime);
+
+  // A 64-slot wheel of 25ms covers 1.6s; longer delays take extra rotations
+  static constexpr std::size_t WheelSlots = 64;
+  static constexpr Clock::duration WheelTick = std::chrono::milliseconds(25);
+
+  struct FileState {
+    bool mExists {false};
+    std::filesystem::file_time_type mModified {};
+    uintmax_t mSize {};
+
+    bool operator==(const FileState&) const noexcept = default;
+  };
+  static FileState GetFileState(const std::filesystem::path&);
+
+  using WatchKey = std::pair<std::filesystem::path, bool /* recursive */>;
+  struct Watch {
+    std::unique_ptr<FilesystemWatchBackend::Handle> mHandle;
+    std::unordered_set<uint64_t> mSubscribers;
+  };
+
+  struct Subscriber {
+    std::filesystem::path mPath;
+    WatchKey mWatch;
+    bool mIsDirectory {false};
+    Callback mCallback;
+    FileState mLastNotified;
+
+    // Debounce state
+    std::optional<Clock::time_point> mDeadline;
+    std::optional<Clock::time_point> mFirstNotification;
+  };
+
+  struct WheelEntry {
+    uint64_t mSubscriber {};
+    Clock::time_point mDeadline;
+  };
+
+  void Unsubscribe(uint64_t id);
+  void OnDirectoryChanged(const WatchKey&);
+  void Schedule(uint64_t id, Subscriber&, Clock::time_point deadline);
+  void Run(std::stop_token);
+  void Dispatch(std::vector<uint64_t> due);
+
+  std::unique_ptr<FilesystemWatchBackend> mBackend;
+  Clock::duration mSettleTime;
+
+  mutable std::mutex mMutex;
+  // Held while invoking callbacks, so that `Unsubscribe()` can wait for them;
+  // recursive so a callback can destroy its own subscription
+  std::recursive_mutex mDispatchMutex;
+  std::condition_variable_any mWakeup;
+
+  uint64_t mNextSubscriberID {1};
+  std::map<WatchKey, Watch> mWatches;
+  std::unordered_map<uint64_t, Subscriber> mSubscribers;
+
+  std::array<std::vector<WheelEntry>, WheelSlots> mWheel;
+  std::size_t mWheelCursor {0};
+  std::size_t mPendingCount {0};
+  Clock::time_point mWheelTime;
+
+  Statistics mStatistics;
+
+  std::jthread mThread;
+};
+
+}// namespace OpenKneeboard
@@ -0,0 +1,92 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <cinttypes>
+#include <filesystem>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace OpenKneeboard {
+
+struct FolderSnapshotEntry {
+  uintmax_t mSize {};
+  std::filesystem::file_time_type mModified {};
+  /** Volume-unique file identifier (NTFS file index, or inode).
+   *
+   * Zero if unavailable. Used to tell a rename/move apart from a
+   * delete-and-create, and an in-place write apart from a replacement.
+   */
+  uint64_t mFileID {};
+
+  constexpr bool operator==(const FolderSnapshotEntry&) const noexcept
+    = default;
+};
+
+struct FolderSnapshotDiff {
+  using path = std::filesystem::path;
+
+  std::vector<path> mAdded;
+  std::vector<path> mRemoved;
+  /// Same file, new content - e.g. written in place
+  std::vector<path> mModified;
+  /// Same path, different file - e.g. 'save to temporary, rename over'
+  std::vector<path> mReplaced;
+  /// Same file, new path; `{from, to}`
+  std::vector<std::pair<path, path>> mRenamed;
+
+  bool empty() const noexcept;
+};
+
+/** Platform-neutral record of the regular files in a directory tree.
+ *
+ * Directory change notifications only tell us that *something* changed;
+ * comparing snapshots tells us what, so that only the affected files need
+ * to be reopened.
+ */
+class FolderSnapshot final {
+ public:
+  using Entry = FolderSnapshotEntry;
+  using Entries = std::map<std::filesystem::path, Entry>;
+
+  FolderSnapshot() = default;
+  explicit FolderSnapshot(Entries);
+
+  /** Recursively scan a directory.
+   *
+   * Files that disappear or can't be inspected during the scan are skipped;
+   * we'll get another change notification for them.
+   */
+  static FolderSnapshot Scan(const std::filesystem::path& root);
+
+  /// What changed from `this` to `newer`
+  FolderSnapshotDiff Diff(const FolderSnapshot& newer) const;
+
+  const Entries& GetEntries() const noexcept;
+  bool empty() const noexcept;
+
+  bool operator==(const FolderSnapshot&) const noexcept = default;
+
+ private:
+  Entries mEntries;
+};
+
+}// namespace OpenKneeboard
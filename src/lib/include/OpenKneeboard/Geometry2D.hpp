@@ -19,15 +19,22 @@
  */
 #pragma once
 
+// The Direct2D/Direct3D conversions are Windows-only; everything else is
+// portable, so that code using these types can be tested anywhere
+#ifdef _WIN32
 #include <d3d11.h>
+#endif
 
 #include <algorithm>
 #include <array>
 #include <cmath>
 #include <compare>
+#include <cstdint>
 #include <concepts>
 
+#ifdef _WIN32
 #include <d2d1.h>
+#endif
 
 namespace OpenKneeboard::Geometry2D {
 
@@ -168,6 +175,7 @@ struct Size {
     };
   }
 
+#ifdef _WIN32
   constexpr operator D2D1_SIZE_U() const
     requires std::integral<T>
   {
@@ -177,6 +185,7 @@ struct Size {
   constexpr operator D2D1_SIZE_F() const {
     return StaticCast<FLOAT, D2D1_SIZE_F>();
   }
+#endif
 };
 
 template <class T>
@@ -242,6 +251,7 @@ struct Point {
     };
   }
 
+#ifdef _WIN32
   constexpr operator D2D1_POINT_2F() const noexcept {
     return StaticCast<FLOAT, D2D1_POINT_2F>();
   }
@@ -251,6 +261,7 @@ struct Point {
   {
     return StaticCast<UINT32, D2D1_POINT_2U>();
   }
+#endif
 };
 
 template <class T>
@@ -397,6 +408,7 @@ struct Rect {
     };
   }
 
+#ifdef _WIN32
   constexpr operator D3D11_RECT() const
     requires std::integral<T>
   {
@@ -412,6 +424,7 @@ struct Rect {
   constexpr operator D2D1_RECT_F() const {
     return StaticCastWithBottomRight<FLOAT, D2D1_RECT_F>();
   }
+#endif
 };
 
 }// namespace OpenKneeboard::Geometry2D
\ No newline at end of file
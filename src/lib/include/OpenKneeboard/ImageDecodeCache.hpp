@@ -0,0 +1,204 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/Pixels.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/// A decoded - and possibly downscaled - image
+class DecodedImage {
+ public:
+  virtual ~DecodedImage();
+
+  virtual PixelSize GetSize() const = 0;
+  virtual std::size_t GetByteSize() const = 0;
+};
+
+/** Format/platform-specific part of `ImageDecodeCache`.
+ *
+ * `Decode()` is called from the cache's worker threads, possibly concurrently.
+ */
+class ImageDecoder {
+ public:
+  virtual ~ImageDecoder();
+
+  /// Read the dimensions without decoding the pixel data
+  virtual std::optional<PixelSize> GetNativeSize(
+    const std::filesystem::path&) = 0;
+
+  /// Returns nullptr on failure
+  virtual std::shared_ptr<DecodedImage> Decode(
+    const std::filesystem::path&,
+    PixelSize size)
+    = 0;
+};
+
+/** Decoder that doesn't read the file, or produce any pixel data.
+ *
+ * Useful for exercising the scheduling and eviction logic without codecs.
+ */
+std::shared_ptr<ImageDecoder> CreateSyntheticImageDecoder(
+  PixelSize nativeSize,
+  std::chrono::milliseconds decodeTime);
+
+/** Process-wide cache of decoded images.
+ *
+ * - images are decoded on background threads, so cache misses don't stall
+ *   the caller
+ * - images are decoded at the smallest power-of-two reduction of the native
+ *   size that covers the requested size, so small changes in view size don't
+ *   cause a decode
+ * - least-recently-used images are evicted to stay within a byte budget
+ *   shared by all users
+ */
+class ImageDecodeCache final {
+ public:
+  // Callers must make sure keys are unique across the process, e.g. by
+  // using `PageID`s
+  using Key = uint64_t;
+
+  // One full-size page is `MaxViewRenderSize` * 4 bytes = 16MiB
+  static constexpr std::size_t DefaultByteBudget = 256 * 1024 * 1024;
+
+  enum class Priority {
+    Prefetch,
+    Visible,
+  };
+
+  struct Request {
+    Key mKey {};
+    std::filesystem::path mPath;
+    std::shared_ptr<ImageDecoder> mDecoder;
+    PixelSize mNativeSize;
+    PixelSize mWantedSize;
+    /** If nothing is cached yet, first decode at this size.
+     *
+     * Gets something on screen quickly; the wanted size is decoded
+     * afterwards. Ignored for prefetches.
+     */
+    std::optional<PixelSize> mPreviewSize;
+    /// Called from a worker thread once a new image is available
+    std::function<void()> mOnReady;
+  };
+
+  struct Statistics {
+    std::size_t mBytes {};
+    std::size_t mByteBudget {};
+    std::size_t mImages {};
+    uint64_t mHits {};
+    uint64_t mMisses {};
+    uint64_t mDecodes {};
+    uint64_t mPreviewDecodes {};
+    uint64_t mFailedDecodes {};
+    uint64_t mEvictions {};
+    std::chrono::steady_clock::duration mTotalDecodeTime {};
+  };
+
+  /// The shared instance, with the default budget
+  static std::shared_ptr<ImageDecodeCache> Get();
+
+  ImageDecodeCache(std::size_t byteBudget, std::size_t threadCount);
+  ~ImageDecodeCache();
+
+  ImageDecodeCache(const ImageDecodeCache&) = delete;
+  ImageDecodeCache& operator=(const ImageDecodeCache&) = delete;
+
+  /** The size an image will be decoded at.
+   *
+   * This is never larger than the native size.
+   */
+  static PixelSize GetMipSize(PixelSize nativeSize, PixelSize wantedSize);
+
+  /** Get the cached image, queueing a decode if needed.
+   *
+   * If a smaller image than wanted is cached, it is returned while the larger
+   * one is decoded. Returns nullptr if nothing is cached yet.
+   */
+  std::shared_ptr<DecodedImage> GetOrQueue(const Request&);
+
+  /// Decode in the background if not already cached
+  void Prefetch(const Request&);
+
+  /// Drop the image and any pending decodes
+  void Erase(Key);
+
+  void SetByteBudget(std::size_t);
+  Statistics GetStatistics() const;
+
+ private:
+  struct Entry {
+    std::filesystem::path mPath;
+    std::shared_ptr<ImageDecoder> mDecoder;
+    std::function<void()> mOnReady;
+    // Distinguishes an entry from one erased and recreated with the same key
+    // while a decode was in progress
+    uint64_t mGeneration {};
+
+    std::shared_ptr<DecodedImage> mImage;
+    uint64_t mLastUsed {};
+
+    // Decode wanted, but not started
+    std::optional<PixelSize> mPendingSize;
+    Priority mPendingPriority {Priority::Prefetch};
+    // If `mPendingSize` is a preview, what to decode once it's started
+    std::optional<PixelSize> mSizeAfterPreview;
+    // In `mVisibleQueue` or `mPrefetchQueue`
+    std::optional<Priority> mQueued;
+    std::optional<PixelSize> mDecodingSize;
+    bool mFailed {false};
+  };
+
+  mutable std::mutex mMutex;
+  std::condition_variable_any mWorkAvailable;
+
+  std::unordered_map<Key, Entry> mEntries;
+  // May contain keys that have since been erased, decoded, or queued with
+  // a higher priority; these are skipped by the workers
+  std::deque<Key> mVisibleQueue;
+  std::deque<Key> mPrefetchQueue;
+
+  std::size_t mByteBudget {};
+  uint64_t mNextGeneration {1};
+  uint64_t mUseCounter {};
+  Statistics mStatistics;
+
+  std::vector<std::jthread> mWorkers;
+
+  void Enqueue(const Request&, Priority, Entry&);
+  void Evict(std::optional<Key> keep);
+  void Run(std::stop_token);
+};
+
+}// namespace OpenKneeboard
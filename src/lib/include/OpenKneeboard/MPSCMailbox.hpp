@@ -0,0 +1,110 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace OpenKneeboard {
+
+/** A lock-free multi-producer, single-consumer queue of work items.
+ *
+ * `Push()` can be called from any thread. Only the push that finds the
+ * mailbox empty returns true; that caller must arrange for `Drain()` to be
+ * called in the consuming context. Anything pushed before that drain starts
+ * is handled by the same drain, so a burst of pushes costs a single wakeup.
+ *
+ * Items are run in the order their pushes completed, so each producer's items
+ * are run in the order it pushed them.
+ */
+class MPSCMailbox final {
+ public:
+  class Item {
+   public:
+    virtual ~Item() = default;
+    virtual void Run() noexcept = 0;
+
+   private:
+    friend class MPSCMailbox;
+    Item* mNext {nullptr};
+  };
+
+  MPSCMailbox() = default;
+  ~MPSCMailbox() {
+    // Never ran, but still need freeing
+    Free(mHead.exchange(nullptr, std::memory_order_acquire));
+  }
+
+  MPSCMailbox(const MPSCMailbox&) = delete;
+  MPSCMailbox(MPSCMailbox&&) = delete;
+  MPSCMailbox& operator=(const MPSCMailbox&) = delete;
+  MPSCMailbox& operator=(MPSCMailbox&&) = delete;
+
+  /// Returns true if the caller must wake the consumer
+  [[nodiscard]]
+  bool Push(std::unique_ptr<Item> owned) noexcept {
+    auto item = owned.release();
+    auto head = mHead.load(std::memory_order_relaxed);
+    do {
+      item->mNext = head;
+    } while (!mHead.compare_exchange_weak(
+      head, item, std::memory_order_release, std::memory_order_relaxed));
+    return head == nullptr;
+  }
+
+  /** Run everything pushed so far; returns the number of items run.
+   *
+   * Must only be called from the consuming context. Items pushed while this
+   * is running - including by the items themselves - are left for the next
+   * drain, which the pushing thread is responsible for waking.
+   */
+  std::size_t Drain() noexcept {
+    // The stack is newest-first; reverse it to get push order
+    Item* fifo = nullptr;
+    for (auto it = mHead.exchange(nullptr, std::memory_order_acquire); it;) {
+      auto next = it->mNext;
+      it->mNext = fifo;
+      fifo = it;
+      it = next;
+    }
+
+    std::size_t count = 0;
+    while (fifo) {
+      std::unique_ptr<Item> item {fifo};
+      fifo = fifo->mNext;
+      item->Run();
+      ++count;
+    }
+    return count;
+  }
+
+ private:
+  std::atomic<Item*> mHead {nullptr};
+
+  static void Free(Item* it) noexcept {
+    while (it) {
+      std::unique_ptr<Item> item {it};
+      it = it->mNext;
+    }
+  }
+};
+
+}// namespace OpenKneeboard
@@ -23,6 +23,7 @@
 #include <OpenKneeboard/inttypes.hpp>
 
 #include <cinttypes>
+#include <cstring>
 #include <filesystem>
 #include <map>
 #include <memory>
@@ -36,6 +37,8 @@ namespace OpenKneeboard::PDFNavigation {
 struct Bookmark final {
   std::string mName;
   PageIndex mPageIndex;
+
+  bool operator==(const Bookmark&) const noexcept = default;
 };
 
 enum class DestinationType {
@@ -67,9 +70,30 @@ class PDF final {
   PDF(PDF&&);
   ~PDF();
 
+  PageIndex GetPageCount();
   std::vector<Bookmark> GetBookmarks();
+
+  /** Links for a single page.
+   *
+   * Only parses the annotations for that page, and remembers the result;
+   * use this when only a few pages are needed, e.g. the visible page.
+   */
+  std::vector<Link> GetLinks(PageIndex);
+  /** Links for all pages; one entry per page.
+   *
+   * Large documents are split across several threads, each with their own
+   * QPDF instance. Pages already fetched with `GetLinks(PageIndex)` are
+   * reused.
+   */
   std::vector<std::vector<Link>> GetLinks();
 
+  /** Text drawn on each page; one entry per page.
+   *
+   * Intended for search, not display: text is in content stream order,
+   * which isn't always reading order.
+   */
+  std::vector<std::string> GetText();
+
   PDF& operator=(PDF&&);
 
  private:
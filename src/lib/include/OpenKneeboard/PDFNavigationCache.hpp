@@ -0,0 +1,89 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/CacheFile.hpp>
+#include <OpenKneeboard/ContentHash.hpp>
+#include <OpenKneeboard/PDFNavigation.hpp>
+#include <OpenKneeboard/PDFTextIndex.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace OpenKneeboard {
+
+namespace PDFNavigation {
+
+/// Everything `PDF` extracts from a document
+struct Index final {
+  std::vector<Bookmark> mBookmarks;
+  /// One entry per page
+  std::vector<std::vector<Link>> mLinks;
+
+  bool operator==(const Index&) const noexcept = default;
+};
+
+// Shared with other caches that embed navigation data
+void Write(CacheFile::Writer&, const std::vector<Bookmark>&);
+void Write(CacheFile::Writer&, const std::vector<std::vector<Link>>&);
+[[nodiscard]]
+bool Read(CacheFile::Reader&, std::vector<Bookmark>&);
+[[nodiscard]]
+bool Read(CacheFile::Reader&, std::vector<std::vector<Link>>&);
+
+}// namespace PDFNavigation
+
+/** Persistent cache of `PDFNavigation::Index` and `PDFTextIndex`, so large
+ * documents don't need to have their outline, annotations, and text parsed
+ * every time they're loaded.
+ *
+ * Entries are keyed by the SHA-256 and length of the full content - usually
+ * from a `SnapshotStore::Snapshot` - so they're shared between copies of the
+ * same document, and never stale.
+ */
+class PDFNavigationCache final {
+ public:
+  // Entries are small; this is mostly to stop the directory growing forever
+  static constexpr std::size_t MaxEntries = 1024;
+
+  using Key = ContentHash;
+
+  PDFNavigationCache() = delete;
+  PDFNavigationCache(const std::filesystem::path& directory);
+
+  std::optional<PDFNavigation::Index> Load(const Key&) const;
+  void Store(const Key&, const PDFNavigation::Index&) const;
+
+  // Separate from the navigation index as it's much slower to build, so is
+  // built later, and may not be built at all
+  std::optional<PDFTextIndex> LoadTextIndex(const Key&) const;
+  void StoreTextIndex(const Key&, const PDFTextIndex&) const;
+
+ private:
+  std::filesystem::path mDirectory;
+
+  std::filesystem::path GetEntryPath(const Key&, std::string_view kind) const;
+  void Prune() const;
+};
+
+}// namespace OpenKneeboard
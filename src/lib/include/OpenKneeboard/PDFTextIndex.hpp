@@ -0,0 +1,112 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/CacheFile.hpp>
+
+#include <OpenKneeboard/inttypes.hpp>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** Inverted index of the words on each page of a document.
+ *
+ * Words are runs of ASCII letters and digits, compared case-insensitively;
+ * everything else is a separator. Each occurrence records its page and
+ * position, so multi-word queries only match the words in order.
+ */
+class PDFTextIndex final {
+ public:
+  PDFTextIndex() = default;
+  /// `pageText` has one entry per page
+  static PDFTextIndex Create(const std::vector<std::string>& pageText);
+
+  /** Pages containing all words of `query`, consecutively and in order.
+   *
+   * For example, "251.000" matches "251.000", "251 000", and "251-000", but
+   * not "251.0001" or "000 251".
+   */
+  std::vector<PageIndex> Find(std::string_view query) const;
+
+  bool IsEmpty() const noexcept;
+
+  void Write(CacheFile::Writer&) const;
+  [[nodiscard]]
+  bool Read(CacheFile::Reader&);
+
+  bool operator==(const PDFTextIndex&) const noexcept = default;
+
+ private:
+  struct Occurrence {
+    PageIndex mPageIndex {};
+    uint32_t mPosition {};
+
+    auto operator<=>(const Occurrence&) const noexcept = default;
+  };
+  struct Word {
+    std::string mText;
+    // Range in `mOccurrences`, sorted by page then position
+    uint32_t mFirst {};
+    uint32_t mCount {};
+
+    bool operator==(const Word&) const noexcept = default;
+  };
+
+  // Sorted by `mText`
+  std::vector<Word> mWords;
+  std::vector<Occurrence> mOccurrences;
+
+  const Word* FindWord(std::string_view) const;
+};
+
+/** A `PDFTextIndex` that isn't built until it's first needed.
+ *
+ * Building usually needs a full parse of the document, which is wasted if
+ * nothing ever searches it.
+ */
+class LazyPDFTextIndex final {
+ public:
+  /// Returns `std::nullopt` if the text can't be extracted
+  using Builder = std::function<std::optional<PDFTextIndex>()>;
+
+  LazyPDFTextIndex() = delete;
+  explicit LazyPDFTextIndex(Builder);
+
+  /** Build the index if needed.
+   *
+   * Concurrent callers wait for the first build. If it fails, the index is
+   * empty, and the build isn't retried.
+   */
+  std::shared_ptr<const PDFTextIndex> Get();
+
+ private:
+  std::mutex mMutex;
+  Builder mBuilder;
+  std::shared_ptr<const PDFTextIndex> mIndex;
+};
+
+}// namespace OpenKneeboard
@@ -0,0 +1,82 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/ContentHash.hpp>
+#include <OpenKneeboard/PDFNavigation.hpp>
+#include <OpenKneeboard/Pixels.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/// What a page source needs to know to publish its pages
+struct PageMetadata {
+  std::vector<PixelSize> mPageSizes;
+  std::vector<PDFNavigation::Bookmark> mBookmarks;
+  /// One entry per page, or empty
+  std::vector<std::vector<PDFNavigation::Link>> mLinks;
+
+  bool operator==(const PageMetadata&) const noexcept = default;
+};
+
+/** Persistent cache of `PageMetadata`, so documents don't need to be opened
+ * and parsed before their pages can be shown at startup.
+ *
+ * Entries are only used if the file's canonical path, size, modification
+ * time, and a hash of the start of the content all match; callers should
+ * still load the document in the background, and update the cache if it
+ * changed.
+ */
+class PageMetadataCache final {
+ public:
+  // Enough to cover the header and usually the first page's objects
+  static constexpr std::size_t ContentPrefixSize = 64 * 1024;
+  // Entries are small; this is mostly to stop the directory growing forever
+  static constexpr std::size_t MaxEntries = 1024;
+
+  struct Key {
+    std::filesystem::path mPath;
+    uint64_t mSize {};
+    int64_t mModified {};
+    ContentHash mContentPrefixHash {};
+
+    /// Returns `std::nullopt` if the file can't be read
+    static std::optional<Key> Create(const std::filesystem::path&);
+
+    bool operator==(const Key&) const noexcept = default;
+  };
+
+  PageMetadataCache() = delete;
+  PageMetadataCache(const std::filesystem::path& directory);
+
+  std::optional<PageMetadata> Load(const Key&) const;
+  void Store(const Key&, const PageMetadata&) const;
+
+ private:
+  std::filesystem::path mDirectory;
+
+  std::filesystem::path GetEntryPath(const Key&) const;
+};
+
+}// namespace OpenKneeboard
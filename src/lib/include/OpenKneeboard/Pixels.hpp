@@ -21,6 +21,8 @@
 
 #include <OpenKneeboard/Geometry2D.hpp>
 
+#include <cstdint>
+
 namespace OpenKneeboard {
 
 using PixelSize = Geometry2D::Size<uint32_t>;
@@ -0,0 +1,176 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/inttypes.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** Decides which pages to render speculatively, and when.
+ *
+ * This is only the policy; the caller does the rendering, and tells the
+ * scheduler what happened. All times are passed in, so this can be driven
+ * by a simulated clock.
+ *
+ * - the pages around each view's current page are wanted, nearest first
+ * - a view's current page is wanted first while it only shows a preview
+ * - a page is started if its estimated render time fits in the remaining
+ *   frame budget, or if the user has stopped flipping pages for a while
+ * - when the user jumps, pages that are no longer wanted are dropped; if
+ *   one was already being rendered, `Complete()` says to discard it
+ * - views that are removed or time out stop keeping pages, and at most
+ *   `mMaxRendered` pages are kept at once
+ *
+ * Not thread-safe.
+ */
+class PrerenderScheduler final {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Duration = Clock::duration;
+  using ViewKey = uint64_t;
+
+  struct Options {
+    PageIndex mPagesAhead {1};
+    PageIndex mPagesBehind {1};
+    // Views that haven't shown a page for this long are ignored
+    Duration mViewTimeout {std::chrono::seconds(5)};
+    /** Hard limit on the number of rendered pages, including current pages.
+     *
+     * Pages nearest the current pages are kept first.
+     */
+    std::size_t mMaxRendered {8};
+    // Once the current pages have been stable this long, start renders that
+    // don't fit in the frame budget
+    Duration mSettleTime {std::chrono::milliseconds(250)};
+    // Until we have a measurement
+    Duration mInitialEstimate {std::chrono::milliseconds(20)};
+    // Like `mSettleTime`, but for current pages shown as a preview
+    Duration mCurrentPageSettleTime {std::chrono::milliseconds(50)};
+  };
+
+  struct Statistics {
+    uint64_t mStarted {};
+    uint64_t mCompleted {};
+    // Finished, but no longer wanted
+    uint64_t mDiscarded {};
+    uint64_t mFailed {};
+    // Started despite not fitting in the frame budget
+    uint64_t mOverBudget {};
+    Duration mEstimate {};
+  };
+
+  PrerenderScheduler();
+  explicit PrerenderScheduler(const Options&);
+
+  /** Call whenever a view shows a page.
+   *
+   * If the view only showed a cheap preview of the page, set `isPreview` so
+   * that the full-quality version is rendered when there's time.
+   */
+  void SetCurrentPage(
+    ViewKey,
+    PageIndex current,
+    PageIndex pageCount,
+    Clock::time_point now,
+    bool isPreview = false);
+  /// Call when a view stops showing this document
+  void RemoveView(ViewKey);
+
+  /// Forget views that have timed out, even if nothing else is happening
+  void Expire(Clock::time_point now);
+  /** When `Expire()` would next free something.
+   *
+   * `std::nullopt` if nothing is rendered, so there's nothing to free.
+   */
+  std::optional<Clock::time_point> GetNextExpiry() const;
+
+  /** The next page to render, if any should be started now.
+   *
+   * `budget` is how much of the current frame is still available.
+   */
+  std::optional<PageIndex> Next(Clock::time_point now, Duration budget);
+
+  /** Record a finished render.
+   *
+   * Returns false if the page is no longer wanted, and should be discarded.
+   */
+  [[nodiscard]]
+  bool Complete(PageIndex, Duration renderTime);
+  /// Failed pages aren't retried until `Reset()`
+  void Fail(PageIndex);
+
+  /** Pages that were rendered, but are no longer wanted.
+   *
+   * The caller should free them; they're forgotten by the scheduler.
+   */
+  std::vector<PageIndex> TakeEvictions();
+
+  bool IsRendered(PageIndex) const;
+  /// True if any view is showing this page
+  bool IsCurrent(PageIndex) const;
+  /// True if any wanted pages haven't been rendered
+  bool HasPendingWork() const;
+
+  /// Forget everything that's been rendered, e.g. when the document changes
+  void Reset();
+
+  Statistics GetStatistics() const;
+
+ private:
+  struct View {
+    PageIndex mCurrent {};
+    PageIndex mPageCount {};
+    bool mIsPreview {false};
+    Clock::time_point mLastSeen {};
+  };
+
+  Options mOptions;
+  std::map<ViewKey, View> mViews;
+  // Latest time we've been told about
+  Clock::time_point mNow {};
+  Clock::time_point mLastChange {};
+
+  std::set<PageIndex> mRendered;
+  std::set<PageIndex> mFailed;
+  std::optional<PageIndex> mInProgress;
+  std::vector<PageIndex> mEvictions;
+
+  Statistics mStatistics;
+
+  void AdvanceTo(Clock::time_point);
+  /// Current pages, then nearest first, up to `mMaxRendered`
+  std::vector<PageIndex> GetKeptPages() const;
+  /// Kept pages, excluding current pages that aren't only a preview
+  std::vector<PageIndex> GetWantedPages() const;
+  /// Wanted, and not rendered or failed
+  std::optional<PageIndex> GetNextWantedPage() const;
+  bool ShouldKeep(PageIndex) const;
+  void UpdateEvictions();
+};
+
+}// namespace OpenKneeboard
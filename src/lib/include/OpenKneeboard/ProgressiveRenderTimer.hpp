@@ -0,0 +1,100 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+
+namespace OpenKneeboard {
+
+/** Measures how long pages take to appear.
+ *
+ * - time to first pixel: from a page being requested until anything is
+ *   shown for it, e.g. a low-resolution preview
+ * - time to final pixel: until it's shown at full quality
+ *
+ * Thread-safe.
+ */
+class ProgressiveRenderTimer final {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Duration = Clock::duration;
+  // Callers must make sure keys are unique across the process, e.g. by
+  // using `PageID`s
+  using Key = uint64_t;
+
+  enum class Quality {
+    Preview,
+    Final,
+  };
+
+  struct Statistics {
+    uint64_t mPages {};
+    // Pages that showed a preview before the final render
+    uint64_t mPreviews {};
+    // Requested but never finished, e.g. because the user moved on
+    uint64_t mAbandoned {};
+    Duration mTotalTimeToFirstPixel {};
+    Duration mMaxTimeToFirstPixel {};
+    Duration mTotalTimeToFinalPixel {};
+    Duration mMaxTimeToFinalPixel {};
+  };
+
+  struct Timings {
+    Duration mTimeToFirstPixel {};
+    Duration mTimeToFinalPixel {};
+    bool mHadPreview {false};
+  };
+
+  // Pending pages beyond this are abandoned, oldest first
+  static constexpr std::size_t MaxPending = 64;
+
+  /// The shared instance
+  static ProgressiveRenderTimer& Get();
+
+  /// Start timing, unless this key is already being timed
+  void Requested(Key, Clock::time_point);
+
+  /** Record that the page was shown.
+   *
+   * Returns the timings when this completes a page; does nothing if the key
+   * isn't being timed.
+   */
+  std::optional<Timings> Presented(Key, Quality, Clock::time_point);
+
+  Statistics GetStatistics() const;
+
+ private:
+  struct Pending {
+    Clock::time_point mRequested {};
+    std::optional<Clock::time_point> mFirstPixel;
+    uint64_t mSequence {};
+  };
+
+  mutable std::mutex mMutex;
+  std::map<Key, Pending> mPending;
+  uint64_t mNextSequence {};
+  Statistics mStatistics;
+};
+
+}// namespace OpenKneeboard
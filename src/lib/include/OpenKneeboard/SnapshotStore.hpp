@@ -0,0 +1,150 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/ContentHash.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** Private, immutable copies of files, addressed by content hash.
+ *
+ * This is used for documents that we want to keep open without stopping the
+ * user from modifying or replacing the original.
+ *
+ * - snapshots of identical content share one file, regardless of the source
+ * - re-snapshotting an unchanged file reuses the existing snapshot
+ * - copies are made with a reflink/block clone where the filesystem supports
+ *   it, so they share storage with the source until either is modified
+ *
+ * Hard links aren't used: they share the file - including sharing locks and
+ * in-place modifications - so they aren't snapshots.
+ */
+class SnapshotStore final : public std::enable_shared_from_this<SnapshotStore> {
+ public:
+  class Snapshot final {
+   public:
+    Snapshot() = delete;
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+    ~Snapshot();
+
+    std::filesystem::path GetPath() const noexcept;
+    ContentHash GetContentHash() const noexcept;
+
+   private:
+    friend class SnapshotStore;
+    Snapshot(
+      std::shared_ptr<SnapshotStore>,
+      std::filesystem::path,
+      const ContentHash&);
+
+    std::shared_ptr<SnapshotStore> mStore;
+    std::filesystem::path mPath;
+    ContentHash mContentHash {};
+  };
+
+  struct Statistics {
+    uint64_t mReused {};
+    // Includes block clones, which the OS does for us where it can
+    uint64_t mCopied {};
+    uint64_t mBytesCopied {};
+    uint64_t mStaleRemoved {};
+    // Live snapshots that no longer matched their content hash
+    uint64_t mDamaged {};
+  };
+
+  /// `directory` is owned by the store; anything in it may be deleted
+  static std::shared_ptr<SnapshotStore> Create(
+    const std::filesystem::path& directory);
+
+  SnapshotStore() = delete;
+  ~SnapshotStore();
+
+  /** Get a snapshot of the current contents of `source`.
+   *
+   * Safe to call concurrently, including for the same source. This reads the
+   * whole file to hash it, so shouldn't be called from the UI thread.
+   *
+   * Returns nullptr if the file can't be read, or keeps changing while we
+   * try to snapshot it.
+   */
+  std::shared_ptr<Snapshot> Acquire(const std::filesystem::path& source);
+
+  /** Remove any files not referenced by a live snapshot.
+   *
+   * Usually left over from a previous crash, or files that were still open
+   * elsewhere when their last snapshot was released.
+   */
+  void RemoveStale();
+
+  Statistics GetStatistics() const;
+
+ private:
+  SnapshotStore(const std::filesystem::path& directory);
+
+  using Key = ContentHash;
+  struct Entry {
+    std::weak_ptr<Snapshot> mSnapshot;
+    // Distinguishes the snapshot that created this entry from an expired one
+    // that hasn't finished releasing yet
+    const Snapshot* mOwner {nullptr};
+    std::filesystem::path mPath;
+    // When the file was verified against the key
+    std::filesystem::file_time_type mModified {};
+  };
+
+  std::filesystem::path mDirectory;
+
+  mutable std::mutex mMutex;
+  std::map<Key, Entry> mEntries;
+  // Temporary files that are currently being written
+  std::set<std::filesystem::path> mInProgress;
+  // Files we failed to delete, e.g. because they were still open
+  std::vector<std::filesystem::path> mPendingRemoval;
+  uint64_t mNextTemporaryID {};
+  Statistics mStatistics;
+
+  /// `uniqueID` is used if the usual path is occupied by a damaged file
+  std::filesystem::path GetSnapshotPath(
+    const Key&,
+    const std::filesystem::path& extension,
+    uint64_t uniqueID = 0) const;
+  /// Reads the whole file, so don't hold `mMutex`
+  static bool IsIntact(const std::filesystem::path&, const Key&);
+  /// Cheap check that a verified file hasn't been modified since
+  static bool IsUnchanged(const Entry&, const Key&);
+  // These require `mMutex` to be held
+  std::shared_ptr<Snapshot> FindLive(const Key&);
+  /// Stop sharing a snapshot whose file was modified
+  void Forget(const Snapshot*, const Key&);
+  std::shared_ptr<Snapshot> Adopt(const Key&, const std::filesystem::path&);
+  void Release(const Snapshot*, const Key&);
+  void RemovePending();
+};
+
+}// namespace OpenKneeboard
@@ -80,6 +80,8 @@ namespace OpenKneeboard {
  * - you can replace `StateMachine` with `AtomicStateMachine` if you require
  *   `std::atomic`'s usual behavior
  * - you can omit the final state parameter, or provide `std::nullopt`
+ * - you can record transition counts and time in each state by passing an
+ *   instrumentation policy; see `StateMachineStatistics.hpp`
  */
 
 template <class State>
@@ -100,6 +102,22 @@ template <class T, auto V>
 constexpr bool is_optional_value_v
   = std::same_as<std::nullopt_t, decltype(V)> || std::same_as<T, decltype(V)>;
 
+/** The default instrumentation policy: records nothing.
+ *
+ * Policies are a base class of the state machine, so can keep per-instance
+ * data; this one is empty, so adds neither storage nor code.
+ */
+struct NoStateMachineInstrumentation {
+ protected:
+  template <auto in, auto out>
+  constexpr void OnTransition() noexcept {
+  }
+
+  template <auto in, auto out>
+  constexpr void OnFailedTransition() noexcept {
+  }
+};
+
 /// Use either StateMachine or AtomicStateMachine instead
 template <
   class State,
@@ -107,12 +125,14 @@ template <
   State TInitialState,
   size_t TransitionCount,
   std::array<Transition<State>, TransitionCount> Transitions,
-  auto TFinalState>
+  auto TFinalState,
+  class TInstrumentation = NoStateMachineInstrumentation>
   requires(TransitionCount >= 1)
   && std::is_scoped_enum_v<State> && is_optional_value_v<State, TFinalState>
-class StateMachineBase {
+class StateMachineBase : protected TInstrumentation {
  public:
   using Values = State;
+  using Instrumentation = TInstrumentation;
   static constexpr auto InitialState = TInitialState;
   static constexpr auto FinalState = TFinalState;
   static constexpr auto HasFinalState
@@ -190,13 +210,15 @@ template <
   State InitialState,
   auto Transitions,
   auto FinalState = std::nullopt,
+  class Instrumentation = NoStateMachineInstrumentation,
   class Base = StateMachineBase<
     State,
     State,
     InitialState,
     Transitions.size(),
     Transitions,
-    FinalState>>
+    FinalState,
+    Instrumentation>>
 class StateMachine final : public Base {
  public:
   constexpr StateMachine(
@@ -210,9 +232,11 @@ class StateMachine final : public Base {
     requires(Base::template IsValidTransition<in, out>())
   {
     if (this->mState != in) [[unlikely]] {
+      this->template OnFailedTransition<in, out>();
       return std::unexpected {this->mState};
     }
     this->mState = out;
+    this->template OnTransition<in, out>();
     return {};
   }
 };
@@ -222,13 +246,15 @@ template <
   State InitialState,
   auto Transitions,
   auto FinalState = std::nullopt,
+  class Instrumentation = NoStateMachineInstrumentation,
   class Base = StateMachineBase<
     State,
     std::atomic<State>,
     InitialState,
     Transitions.size(),
     Transitions,
-    FinalState>>
+    FinalState,
+    Instrumentation>>
 class AtomicStateMachine final : public Base {
  public:
   constexpr AtomicStateMachine(
@@ -245,8 +271,10 @@ class AtomicStateMachine final : public Base {
   {
     auto current = in;
     if (!this->mState.compare_exchange_strong(current, out)) {
+      this->template OnFailedTransition<in, out>();
       return std::unexpected {current};
     }
+    this->template OnTransition<in, out>();
     return {};
   }
 
@@ -0,0 +1,227 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/StateMachine.hpp>
+
+#include <OpenKneeboard/format/enum.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <type_traits>
+
+namespace OpenKneeboard {
+
+/** Per-transition counters and time-in-state histograms for a kind of state
+ * machine.
+ *
+ * To record into one, give it static storage duration, and pass
+ * `InstrumentStateMachine<&statistics>` as the `Instrumentation` parameter
+ * of `StateMachine` or `AtomicStateMachine`; every state machine using the
+ * same statistics adds to the same counters.
+ *
+ * Updates are relaxed atomic increments: none are lost, but a snapshot taken
+ * during transitions may be slightly inconsistent between counters.
+ */
+template <class State>
+  requires std::is_scoped_enum_v<State>
+class StateMachineStatistics final {
+ public:
+  static constexpr std::size_t StateCount = magic_enum::enum_count<State>();
+  /** Bucket `i` counts times of at least `2^(i-1)`us, but less than `2^i`us.
+   *
+   * Bucket 0 is under 1us, and the last bucket (~18 minutes) is unbounded.
+   */
+  static constexpr std::size_t HistogramBuckets = 32;
+
+  template <class T>
+  using ByTransition = std::array<std::array<T, StateCount>, StateCount>;
+  template <class T>
+  using ByStateAndBucket
+    = std::array<std::array<T, HistogramBuckets>, StateCount>;
+
+  struct Snapshot {
+    /// Indexed by `[GetIndex(in)][GetIndex(out)]`
+    ByTransition<uint64_t> mTransitions {};
+    /** Transitions that failed because the machine was not in the `in` state.
+     *
+     * For `AtomicStateMachine`, these are failed compare-exchanges, usually
+     * because another thread transitioned first.
+     */
+    ByTransition<uint64_t> mFailedTransitions {};
+    /// Indexed by `[GetIndex(state)][bucket]`
+    ByStateAndBucket<uint64_t> mTimeInState {};
+
+    std::string ToString() const;
+  };
+
+  constexpr StateMachineStatistics() = default;
+
+  StateMachineStatistics(const StateMachineStatistics&) = delete;
+  StateMachineStatistics(StateMachineStatistics&&) = delete;
+  StateMachineStatistics& operator=(const StateMachineStatistics&) = delete;
+  StateMachineStatistics& operator=(StateMachineStatistics&&) = delete;
+
+  static constexpr std::size_t GetIndex(State state) {
+    return magic_enum::enum_index(state).value();
+  }
+
+  static constexpr std::size_t GetBucket(
+    std::chrono::steady_clock::duration timeInState) noexcept {
+    const auto us
+      = std::chrono::duration_cast<std::chrono::microseconds>(timeInState)
+          .count();
+    if (us <= 0) {
+      return 0;
+    }
+    return std::min<std::size_t>(
+      std::bit_width(static_cast<uint64_t>(us)), HistogramBuckets - 1);
+  }
+
+  template <State in, State out>
+  void RecordTransition(
+    std::chrono::steady_clock::duration timeInState) noexcept {
+    constexpr auto inIndex = GetIndex(in);
+    constexpr auto outIndex = GetIndex(out);
+    Increment(mTransitions[inIndex][outIndex]);
+    Increment(mTimeInState[inIndex][GetBucket(timeInState)]);
+  }
+
+  template <State in, State out>
+  void RecordFailedTransition() noexcept {
+    Increment(mFailedTransitions[GetIndex(in)][GetIndex(out)]);
+  }
+
+  Snapshot GetSnapshot() const noexcept {
+    Snapshot ret;
+    Load(ret.mTransitions, mTransitions);
+    Load(ret.mFailedTransitions, mFailedTransitions);
+    Load(ret.mTimeInState, mTimeInState);
+    return ret;
+  }
+
+ private:
+  ByTransition<std::atomic_uint64_t> mTransitions {};
+  ByTransition<std::atomic_uint64_t> mFailedTransitions {};
+  ByStateAndBucket<std::atomic_uint64_t> mTimeInState {};
+
+  static void Increment(std::atomic_uint64_t& counter) noexcept {
+    counter.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static void Load(auto& to, const auto& from) noexcept {
+    for (std::size_t i = 0; i < from.size(); ++i) {
+      for (std::size_t j = 0; j < from[i].size(); ++j) {
+        to[i][j] = from[i][j].load(std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+template <class State>
+  requires std::is_scoped_enum_v<State>
+std::string StateMachineStatistics<State>::Snapshot::ToString() const {
+  constexpr auto states = magic_enum::enum_values<State>();
+
+  std::string ret;
+  for (const auto in: states) {
+    for (const auto out: states) {
+      const auto i = GetIndex(in);
+      const auto j = GetIndex(out);
+      const auto succeeded = mTransitions[i][j];
+      const auto failed = mFailedTransitions[i][j];
+      if (succeeded || failed) {
+        ret += std::format(
+          "{} -> {}: {} ({} failed)\n", in, out, succeeded, failed);
+      }
+    }
+  }
+
+  for (const auto state: states) {
+    const auto& buckets = mTimeInState[GetIndex(state)];
+    if (std::ranges::all_of(buckets, [](auto it) { return it == 0; })) {
+      continue;
+    }
+    ret += std::format("Time in {}:\n", state);
+    for (std::size_t i = 0; i < HistogramBuckets; ++i) {
+      if (!buckets[i]) {
+        continue;
+      }
+      if (i == HistogramBuckets - 1) {
+        ret += std::format(
+          "- >= {}us: {}\n", uint64_t {1} << (i - 1), buckets[i]);
+      } else {
+        ret += std::format("- < {}us: {}\n", uint64_t {1} << i, buckets[i]);
+      }
+    }
+  }
+  return ret;
+}
+
+/** Instrumentation policy recording into `*TStatistics`.
+ *
+ * Adds a timestamp to each state machine, and a clock read to each
+ * successful transition.
+ */
+template <auto* TStatistics>
+class InstrumentStateMachine {
+ public:
+  static constexpr auto Statistics = TStatistics;
+
+ protected:
+  InstrumentStateMachine() noexcept
+    : mEnteredAt(Clock::now().time_since_epoch().count()) {
+  }
+
+  template <auto in, auto out>
+  void OnTransition() noexcept {
+    const auto now = Clock::now().time_since_epoch().count();
+    const auto enteredAt = mEnteredAt.exchange(now, std::memory_order_relaxed);
+    // Racing transitions on an `AtomicStateMachine` can swap timestamps
+    TStatistics->template RecordTransition<in, out>(
+      Clock::duration {std::max<Clock::rep>(now - enteredAt, 0)});
+  }
+
+  template <auto in, auto out>
+  void OnFailedTransition() noexcept {
+    TStatistics->template RecordFailedTransition<in, out>();
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  std::atomic<Clock::rep> mEnteredAt;
+};
+
+/// `InstrumentStateMachine` in debug builds, and free in release builds
+template <auto* TStatistics>
+using InstrumentStateMachineInDebugBuilds =
+#ifdef DEBUG
+  InstrumentStateMachine<TStatistics>;
+#else
+  NoStateMachineInstrumentation;
+#endif
+
+}// namespace OpenKneeboard
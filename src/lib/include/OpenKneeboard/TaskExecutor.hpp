@@ -0,0 +1,150 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** Coroutines waiting to be resumed on a specific thread.
+ *
+ * `task<>` always resumes its awaiter on the thread that created it. On a
+ * thread that's running a `RunQueue`, that's done by posting to the queue;
+ * this is portable, and cheaper than the COM path, which needs a thread pool
+ * hop followed by a cross-apartment call.
+ *
+ * Threads without a `RunQueue` - such as the UI thread - use COM instead.
+ */
+class RunQueue final : public std::enable_shared_from_this<RunQueue> {
+ public:
+  struct Statistics {
+    uint64_t mPosted {};
+    uint64_t mResumed {};
+    // How often `Run()` had to wait for more work
+    uint64_t mWaits {};
+  };
+
+  /// Makes a queue the current thread's queue until destroyed
+  class ThreadScope final {
+   public:
+    ThreadScope() = delete;
+    ThreadScope(const ThreadScope&) = delete;
+    ThreadScope& operator=(const ThreadScope&) = delete;
+
+    explicit ThreadScope(const std::shared_ptr<RunQueue>&);
+    ~ThreadScope();
+
+   private:
+    std::weak_ptr<RunQueue> mPrevious;
+  };
+
+  RunQueue(const RunQueue&) = delete;
+  RunQueue& operator=(const RunQueue&) = delete;
+  ~RunQueue();
+
+  static std::shared_ptr<RunQueue> Create();
+  /// Returns nullptr if the current thread doesn't have a queue
+  static std::shared_ptr<RunQueue> GetForCurrentThread() noexcept;
+
+  /** Queue a coroutine to be resumed by `Run()` or `RunPending()`.
+   *
+   * Safe to call from any thread; returns false if the queue has been
+   * stopped.
+   */
+  [[nodiscard]]
+  bool TryPost(std::coroutine_handle<>) noexcept;
+
+  /** Resume coroutines as they're posted, until `Stop()` is called.
+   *
+   * The queue is the current thread's queue while this is running; anything
+   * already queued when `Stop()` is called is still resumed.
+   */
+  void Run();
+  /// Resume everything that's already queued; returns how many were resumed
+  std::size_t RunPending();
+  void Stop() noexcept;
+
+  Statistics GetStatistics() const;
+
+ private:
+  RunQueue();
+
+  mutable std::mutex mMutex;
+  std::condition_variable mWakeup;
+  std::vector<std::coroutine_handle<>> mQueue;
+  bool mStopped {false};
+  bool mWaiting {false};
+  Statistics mStatistics;
+
+  std::size_t Resume(std::vector<std::coroutine_handle<>>&);
+};
+
+/** Fixed-size thread pool, where each thread runs its own `RunQueue`.
+ *
+ * Coroutines started on a pool thread resume on that same thread, as with
+ * any other `RunQueue`.
+ */
+class ThreadPool final {
+ public:
+  ThreadPool() = delete;
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  explicit ThreadPool(std::size_t threadCount);
+  /// Stops the threads, after resuming anything already posted
+  ~ThreadPool();
+
+  static ThreadPool& GetDefault();
+
+  std::size_t GetThreadCount() const noexcept;
+  void Post(std::coroutine_handle<>) noexcept;
+
+  /// `co_await pool.schedule()` to continue on a pool thread
+  auto schedule() noexcept {
+    struct awaiter {
+      ThreadPool* mPool {nullptr};
+
+      bool await_ready() const noexcept {
+        return false;
+      }
+      void await_suspend(std::coroutine_handle<> coro) const noexcept {
+        mPool->Post(coro);
+      }
+      void await_resume() const noexcept {
+      }
+    };
+    return awaiter {this};
+  }
+
+ private:
+  std::vector<std::shared_ptr<RunQueue>> mQueues;
+  std::vector<std::jthread> mThreads;
+  std::atomic_size_t mNextQueue {0};
+};
+
+}// namespace OpenKneeboard
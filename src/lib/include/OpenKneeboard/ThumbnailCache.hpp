@@ -0,0 +1,107 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/ContentHash.hpp>
+
+#include <OpenKneeboard/inttypes.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** Persistent cache of rendered page thumbnails, e.g. for `NavigationTab`.
+ *
+ * Entries are keyed by a hash of the document's content - not its path - so
+ * they're never stale, and are shared between copies of the same document.
+ *
+ * Files are evicted least-recently-used first to stay within a byte budget;
+ * loading an entry counts as using it.
+ *
+ * This only deals with keys, files, and pixel bytes - not Direct3D or
+ * Direct2D types - so it can be tested on its own.
+ */
+class ThumbnailCache final {
+ public:
+  // A thumbnail is usually a few tens of KiB
+  static constexpr uint64_t DefaultMaxBytes = 64 * 1024 * 1024;
+  static constexpr std::size_t MaxEntries = 8192;
+  // Pruning lists the directory, so don't do it for every thumbnail
+  static constexpr std::size_t StoresPerPrune = 16;
+
+  struct Size {
+    uint32_t mWidth {};
+    uint32_t mHeight {};
+
+    bool operator==(const Size&) const noexcept = default;
+  };
+
+  struct Key {
+    ContentHash mContentHash {};
+    PageIndex mPage {};
+    Size mSize;
+
+    bool operator==(const Key&) const noexcept = default;
+  };
+
+  /// Tightly-packed, premultiplied BGRA
+  struct Thumbnail {
+    Size mSize;
+    std::vector<std::byte> mPixels;
+
+    bool operator==(const Thumbnail&) const noexcept = default;
+  };
+
+  struct Statistics {
+    uint64_t mHits {};
+    uint64_t mMisses {};
+    uint64_t mStores {};
+    uint64_t mPrunes {};
+  };
+
+  ThumbnailCache() = delete;
+  ThumbnailCache(
+    const std::filesystem::path& directory,
+    uint64_t maxBytes = DefaultMaxBytes);
+
+  /// Thread-safe; does file I/O, so shouldn't be called from the UI thread
+  std::optional<Thumbnail> Load(const Key&);
+  /// Thread-safe; does file I/O, so shouldn't be called from the UI thread
+  void Store(const Key&, const Thumbnail&);
+
+  Statistics GetStatistics() const;
+
+ private:
+  std::filesystem::path mDirectory;
+  uint64_t mMaxBytes {};
+
+  mutable std::mutex mMutex;
+  std::size_t mStoresSincePrune {StoresPerPrune};
+  Statistics mStatistics;
+
+  std::filesystem::path GetEntryPath(const Key&) const;
+};
+
+}// namespace OpenKneeboard
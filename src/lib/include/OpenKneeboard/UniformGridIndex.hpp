@@ -0,0 +1,82 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** Immutable spatial index for point-in-rectangle queries.
+ *
+ * Rectangles are bucketed into a uniform grid over their bounding box, so a
+ * query only tests the rectangles overlapping one cell. This suits UI
+ * regions - buttons, links - which are roughly evenly spread.
+ *
+ * Thread-safe, as it can't be modified after construction.
+ */
+class UniformGridIndex final {
+ public:
+  struct Rect {
+    float mLeft {};
+    float mTop {};
+    float mRight {};
+    float mBottom {};
+  };
+
+  // Below this, a linear scan is faster than the grid
+  static constexpr std::size_t MinGridSize = 16;
+  static constexpr uint32_t MaxCellsPerAxis = 256;
+
+  UniformGridIndex() = default;
+  explicit UniformGridIndex(std::span<const Rect>);
+
+  /** The first rectangle containing the point, if any.
+   *
+   * Edges are inclusive, and 'first' is by position in the original span,
+   * so overlapping rectangles behave the same as a linear scan.
+   */
+  std::optional<std::size_t> HitTest(float x, float y) const;
+
+  std::size_t GetCellCount() const noexcept;
+
+ private:
+  std::vector<Rect> mRects;
+
+  float mLeft {};
+  float mTop {};
+  float mCellWidth {};
+  float mCellHeight {};
+  uint32_t mColumns {};
+  uint32_t mRows {};
+  // Compressed rows: the rectangles in cell `i` are
+  // `mCellItems[mCellStart[i]]` to `mCellItems[mCellStart[i + 1] - 1]`,
+  // in ascending order
+  std::vector<uint32_t> mCellStart;
+  std::vector<uint32_t> mCellItems;
+
+  uint32_t GetColumn(float x) const noexcept;
+  uint32_t GetRow(float y) const noexcept;
+};
+
+}// namespace OpenKneeboard
@@ -84,8 +84,13 @@ struct StackFramePointer {
 };
 
 struct StackTrace {
+  // std::stacktrace::_Max_frames in the Microsoft STL as of 2025-01-16
+  static constexpr std::size_t MaxFrames = 0xFFFF;
+
   OPENKNEEBOARD_FORCEINLINE
-  static StackTrace Current(std::size_t skip = 0) noexcept;
+  static StackTrace Current(
+    std::size_t skip = 0,
+    std::size_t maxFrames = MaxFrames) noexcept;
 
   friend std::ostream& operator<<(std::ostream&, const StackTrace&);
 
@@ -100,9 +105,15 @@ struct StackTrace {
   static StackTrace GetForMostRecentException();
   static void SetForNextException(const StackTrace&);
 
+  /// True if `maxFrames` cut the trace short
+  inline bool IsTruncated() const noexcept {
+    return mTruncated;
+  }
+
  private:
   std::shared_ptr<void> mData;
   std::size_t mSize {0};
+  bool mTruncated {false};
 
   std::span<StackFramePointer> GetEntries() const;
 };
@@ -151,6 +162,19 @@ enum class DumpType {
 };
 void SetDumpType(DumpType);
 
+/** How much of the stack to record when an exception is thrown.
+ *
+ * Traces are recorded as raw frame pointers either way; they're only
+ * symbolized if they're reported.
+ */
+enum class ExceptionStackTraces {
+  /// Full traces for the first few exceptions of each type, then for a
+  /// sample of them; the rest only record the frames nearest the throw
+  Sampled,
+  Full,
+};
+void SetExceptionStackTraces(ExceptionStackTraces);
+
 template <class... Ts>
 OPENKNEEBOARD_NOINLINE [[noreturn]]
 void fatal(std::format_string<Ts...> fmt, Ts&&... values) noexcept {
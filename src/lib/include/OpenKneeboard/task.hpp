@@ -19,7 +19,11 @@
  */
 #pragma once
 
+#include <OpenKneeboard/CoroutineFramePool.hpp>
+#include <OpenKneeboard/CoroutineRegistry.hpp>
 #include <OpenKneeboard/StateMachine.hpp>
+#include <OpenKneeboard/StateMachineStatistics.hpp>
+#include <OpenKneeboard/TaskExecutor.hpp>
 
 #include <OpenKneeboard/dprint.hpp>
 #include <OpenKneeboard/fatal.hpp>
@@ -28,8 +32,10 @@
 
 #include <shims/winrt/base.h>
 
+#ifdef _WIN32
 #include <combaseapi.h>
 #include <ctxtcall.h>
+#endif
 
 #include <atomic>
 #include <coroutine>
@@ -59,6 +65,9 @@ enum class TaskPromiseResultState {
   ReturnedVoid,
 };
 
+inline constinit StateMachineStatistics<TaskPromiseResultState>
+  gTaskResultStateStatistics;
+
 /* Union so we can do std::atomic.
  *
  * - TaskPromiseState is sizeof(ptr), but always an invalid pointer
@@ -90,16 +99,36 @@ constexpr bool operator==(TaskPromiseWaiting a, TaskPromiseWaiting b) noexcept {
   return a.mNext == b.mNext;
 }
 
+/** Where to resume the awaiter of a task<>.
+ *
+ * Exactly one backend is used:
+ * - if the creating thread is running a `RunQueue`, resumption is posted to
+ *   that queue
+ * - otherwise, on Windows, the thread pool calls back into the creating
+ *   thread's COM context
+ */
 struct TaskContext {
+  std::shared_ptr<RunQueue> mRunQueue;
+#ifdef _WIN32
   winrt::com_ptr<IContextCallback> mCOMCallback;
+#endif
   std::thread::id mThreadID = std::this_thread::get_id();
   StackFramePointer mCaller {nullptr};
 
-  inline TaskContext(StackFramePointer&& caller) : mCaller(std::move(caller)) {
+  inline TaskContext(StackFramePointer&& caller)
+    : mRunQueue(RunQueue::GetForCurrentThread()), mCaller(std::move(caller)) {
+    if (mRunQueue) {
+      return;
+    }
+#ifdef _WIN32
     if (!SUCCEEDED(CoGetObjectContext(IID_PPV_ARGS(mCOMCallback.put()))))
       [[unlikely]] {
-      this->fatal("Attempted to create a task<> from thread without COM");
+      this->fatal(
+        "Attempted to create a task<> from thread without COM or a RunQueue");
     }
+#else
+    this->fatal("Attempted to create a task<> from thread without a RunQueue");
+#endif
   }
 
   template <class... Ts>
@@ -210,6 +239,17 @@ struct TaskFinalAwaiter {
       return;
     }
 
+    if (context.mRunQueue) {
+      // Once posted, the awaiter may destroy our promise - and the context -
+      // before `TryPost()` returns
+      const auto queue = context.mRunQueue;
+      if (queue->TryPost(oldState.mNext)) [[likely]] {
+        return;
+      }
+      context.fatal("Failed to post coroutine resumption: RunQueue stopped");
+    }
+
+#ifdef _WIN32
     auto resumeData = new ResumeData {
       .mContext = context,
       .mCoro = oldState.mNext,
@@ -224,12 +264,14 @@ struct TaskFinalAwaiter {
     context.fatal(
       "Failed to enqueue resumption on thread pool: {:010x}",
       static_cast<uint32_t>(threadPoolError));
+#endif
   }
 
   void await_resume() const noexcept {
   }
 
  private:
+#ifdef _WIN32
   struct ResumeData {
     TaskContext mContext;
     std::coroutine_handle<> mCoro;
@@ -293,11 +335,56 @@ struct TaskFinalAwaiter {
       TraceLoggingCodePointer(context.mCaller.mValue, "Caller"));
     return S_OK;
   }
+#endif
 };
 
 template <class TTraits>
 struct Task;
 
+/// The awaiter for `co_await it`, found the same way as the compiler does
+template <class T>
+decltype(auto) get_awaiter(T&& it) {
+  if constexpr (requires { static_cast<T&&>(it).operator co_await(); }) {
+    return static_cast<T&&>(it).operator co_await();
+  } else if constexpr (requires { operator co_await(static_cast<T&&>(it)); }) {
+    return operator co_await(static_cast<T&&>(it));
+  } else {
+    return static_cast<T&&>(it);
+  }
+}
+
+/// Records suspension and resumption in the `CoroutineRegistry`
+template <class TAwaiter>
+struct TaskRegistryAwaiter {
+  TAwaiter mAwaiter;
+  CoroutineRegistry::SlotID mSlot {CoroutineRegistry::NoSlot};
+
+  decltype(auto) await_ready() {
+    return mAwaiter.await_ready();
+  }
+
+  // Not inlined, so that `_ReturnAddress()` is the `co_await`
+  template <class TPromise>
+  OPENKNEEBOARD_NOINLINE decltype(auto) await_suspend(
+    std::coroutine_handle<TPromise> handle) {
+    // Once the wrapped `await_suspend()` returns, we may have been resumed
+    // on another thread, or destroyed
+    const auto slot = mSlot;
+    CoroutineRegistry::OnSuspend(slot, _ReturnAddress());
+    try {
+      return mAwaiter.await_suspend(handle);
+    } catch (...) {
+      CoroutineRegistry::OnResume(slot);
+      throw;
+    }
+  }
+
+  decltype(auto) await_resume() {
+    CoroutineRegistry::OnResume(mSlot);
+    return mAwaiter.await_resume();
+  }
+};
+
 template <class TTraits>
 struct TaskPromiseBase {
   using traits_type = TTraits;
@@ -315,7 +402,8 @@ struct TaskPromiseBase {
       Transition {NoResult, HaveVoidResult},
       Transition {HaveVoidResult, ReturnedVoid},
     },
-    std::nullopt>
+    std::nullopt,
+    InstrumentStateMachineInDebugBuilds<&gTaskResultStateStatistics>>
     mResultState;
 
   StackTrace mUncaughtStack;
@@ -325,6 +413,7 @@ struct TaskPromiseBase {
 
   TaskContext mContext;
   TaskExceptionBehavior mOnException = TTraits::OnException;
+  CoroutineRegistry::SlotID mRegistrySlot {CoroutineRegistry::NoSlot};
 
   TaskPromiseBase() = delete;
   TaskPromiseBase(const TaskPromiseBase<TTraits>&) = delete;
@@ -334,7 +423,8 @@ struct TaskPromiseBase {
   TaskPromiseBase<TTraits>& operator=(TaskPromiseBase<TTraits>&&) = delete;
 
   TaskPromiseBase(TaskContext&& context) noexcept
-    : mContext(std::move(context)) {
+    : mContext(std::move(context)),
+      mRegistrySlot(CoroutineRegistry::Register(mContext.mCaller.mValue)) {
     TraceLoggingWrite(
       gTraceProvider,
       "TaskPromiseBase<>::TaskPromiseBase()",
@@ -349,6 +439,19 @@ struct TaskPromiseBase {
         "ResultState"));
   }
 
+  ~TaskPromiseBase() {
+    CoroutineRegistry::Unregister(mRegistrySlot);
+  }
+
+  // Frames are created and destroyed constantly, e.g. by event handlers
+  static void* operator new(std::size_t size) {
+    return CoroutineFramePool::Allocate(size, _ReturnAddress());
+  }
+
+  static void operator delete(void* frame, std::size_t size) noexcept {
+    CoroutineFramePool::Deallocate(frame, size);
+  }
+
   auto get_return_object() {
     return static_cast<TaskPromise<TTraits>*>(this);
   }
@@ -426,12 +529,15 @@ struct TaskPromiseBase {
         std::format("{}", mResultState.Get(std::memory_order_relaxed)).c_str(),
         "ResultState"),
       TraceLoggingValue(std::uncaught_exceptions(), "UncaughtExceptions"));
+    CoroutineRegistry::OnComplete(mRegistrySlot);
     return {*this};
   }
 
   template <class TAwaitable>
-  TAwaitable&& await_transform(TAwaitable&& it) noexcept {
-    return static_cast<TAwaitable&&>(it);
+  auto await_transform(TAwaitable&& it) {
+    using awaiter_t = decltype(get_awaiter(static_cast<TAwaitable&&>(it)));
+    return TaskRegistryAwaiter<awaiter_t> {
+      get_awaiter(static_cast<TAwaitable&&>(it)), mRegistrySlot};
   }
 
   auto await_transform(noexcept_task_t) noexcept {
@@ -725,8 +831,8 @@ struct [[nodiscard]] Task {
 namespace OpenKneeboard::inline task_ns {
 /** A coroutine that:
  * - always returns to the same thread it was invoked from
- * - to implement that, requires that it is called from a thread with a COM
- * apartment
+ * - to implement that, requires that it is called from a thread that is
+ * running a `RunQueue`, or has a COM apartment
  * - calls fatal() if not awaited
  * - statically requires that the reuslt is discarded via [[nodiscard]]
  * - calls fatal() if there is an uncaught exception
@@ -0,0 +1,61 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/task/with_stop_token.hpp>
+
+#include <shims/winrt/base.h>
+
+#include <coroutine>
+#include <stop_token>
+
+namespace OpenKneeboard {
+
+/** `winrt::resume_background()`, unless `stopToken` is stopped.
+ *
+ * Resumes with `CancellableError::Cancelled` if the token was stopped before
+ * we got a thread pool thread. If it was stopped before this was awaited,
+ * this doesn't switch threads at all.
+ */
+[[nodiscard]]
+inline auto resume_background(std::stop_token stopToken) noexcept {
+  struct awaitable {
+    std::stop_token mStopToken;
+    decltype(winrt::resume_background()) mImpl {winrt::resume_background()};
+
+    bool await_ready() const noexcept {
+      return mStopToken.stop_requested();
+    }
+
+    void await_suspend(std::coroutine_handle<> coro) {
+      mImpl.await_suspend(coro);
+    }
+
+    CancellableResult<void> await_resume() const noexcept {
+      if (mStopToken.stop_requested()) {
+        return std::unexpected {CancellableError::Cancelled};
+      }
+      return {};
+    }
+  };
+  return awaitable {std::move(stopToken)};
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,330 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/task.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <stop_token>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace OpenKneeboard::detail {
+
+template <class T>
+struct task_result {};
+
+template <class TTraits>
+struct task_result<Task<TTraits>> {
+  using type = typename TTraits::result_type;
+};
+
+template <class T>
+using task_result_t = typename task_result<std::remove_cvref_t<T>>::type;
+
+template <class T>
+using when_all_result_t
+  = std::conditional_t<std::same_as<T, void>, void, std::vector<T>>;
+
+// `std::optional<void>` is ill-formed, even if unused
+template <class T>
+using when_all_storage_t = std::optional<
+  std::conditional_t<std::same_as<T, void>, std::monostate, T>>;
+
+/** Call `fn` for each input, with at most `maxConcurrency` in flight.
+ *
+ * No further calls are started once one throws, or `stopToken` is stopped;
+ * the first exception is rethrown after the calls already in flight have
+ * completed.
+ *
+ * If `TResult` is not void, `results` must have one entry per input.
+ */
+template <class TResult, class TInput, class TFn>
+task<void> invoke_bounded(
+  std::size_t maxConcurrency,
+  std::vector<TInput>& inputs,
+  TFn& fn,
+  std::stop_token stopToken,
+  std::vector<when_all_storage_t<TResult>>& results) {
+  OPENKNEEBOARD_ASSERT(maxConcurrency > 0 || inputs.empty());
+
+  struct State {
+    std::vector<TInput>& mInputs;
+    TFn& mFn;
+    std::stop_token mStopToken;
+    std::vector<when_all_storage_t<TResult>>& mResults;
+    std::size_t mNext {0};
+    std::exception_ptr mException;
+  };
+  State state {inputs, fn, stopToken, results};
+
+  const auto worker = [](State& state) -> task<void> {
+    while (state.mNext < state.mInputs.size() && !state.mException
+           && !state.mStopToken.stop_requested()) {
+      const auto i = state.mNext++;
+      try {
+        if constexpr (std::same_as<TResult, void>) {
+          co_await std::invoke(state.mFn, state.mInputs.at(i));
+        } else {
+          state.mResults.at(i).emplace(
+            co_await std::invoke(state.mFn, state.mInputs.at(i)));
+        }
+      } catch (...) {
+        if (!state.mException) {
+          state.mException = std::current_exception();
+        }
+      }
+    }
+  };
+
+  std::vector<task<void>> workers;
+  const auto workerCount = std::min(maxConcurrency, inputs.size());
+  workers.reserve(workerCount);
+  for (std::size_t i = 0; i < workerCount; ++i) {
+    workers.push_back(worker(state));
+  }
+  for (auto&& it: workers) {
+    co_await std::move(it);
+  }
+
+  if (state.mException) {
+    std::rethrow_exception(state.mException);
+  }
+}
+
+template <class T>
+struct WhenAnyState {
+  std::atomic_flag mHaveFirst;
+  std::size_t mIndex {};
+  std::exception_ptr mException;
+  when_all_storage_t<T> mResult;
+
+  // nullptr, the waiting coroutine, or `this` once a task has completed
+  std::atomic<void*> mContinuation {nullptr};
+
+  void complete() noexcept {
+    const auto waiting
+      = mContinuation.exchange(this, std::memory_order_acq_rel);
+    if (waiting) {
+      std::coroutine_handle<>::from_address(waiting).resume();
+    }
+  }
+
+  struct Awaiter {
+    WhenAnyState& mState;
+
+    bool await_ready() const noexcept {
+      return mState.mContinuation.load(std::memory_order_acquire) == &mState;
+    }
+
+    bool await_suspend(std::coroutine_handle<> waiting) noexcept {
+      void* expected = nullptr;
+      // If this fails, a task completed since `await_ready()`
+      return mState.mContinuation.compare_exchange_strong(
+        expected, waiting.address(), std::memory_order_acq_rel);
+    }
+
+    void await_resume() const noexcept {
+    }
+  };
+
+  Awaiter wait() noexcept {
+    return {*this};
+  }
+};
+
+template <class T>
+OpenKneeboard::fire_and_forget when_any_watch(
+  std::shared_ptr<WhenAnyState<T>> state,
+  std::size_t index,
+  task<T> it) {
+  when_all_storage_t<T> result;
+  std::exception_ptr exception;
+  try {
+    if constexpr (std::same_as<T, void>) {
+      co_await std::move(it);
+      result.emplace();
+    } else {
+      result.emplace(co_await std::move(it));
+    }
+  } catch (...) {
+    exception = std::current_exception();
+  }
+
+  if (state->mHaveFirst.test_and_set(std::memory_order_acq_rel)) {
+    co_return;
+  }
+  state->mIndex = index;
+  state->mException = std::move(exception);
+  state->mResult = std::move(result);
+  state->complete();
+}
+
+}// namespace OpenKneeboard::detail
+
+namespace OpenKneeboard {
+
+/// Which task passed to `when_any()` completed first, and its result
+template <class T>
+struct when_any_result {
+  std::size_t mIndex {};
+  T mValue;
+};
+
+template <>
+struct when_any_result<void> {
+  std::size_t mIndex {};
+};
+
+/** Wait for all of the already-started tasks to complete.
+ *
+ * Every task is awaited, even if an earlier one throws; the first exception
+ * is rethrown once they have all finished.
+ *
+ * Results are in the same order as the tasks.
+ */
+template <class T>
+task<detail::when_all_result_t<T>> when_all(std::vector<task<T>> tasks) {
+  std::exception_ptr exception;
+  [[maybe_unused]] std::vector<detail::when_all_storage_t<T>> results;
+  if constexpr (!std::same_as<T, void>) {
+    results.reserve(tasks.size());
+  }
+
+  for (auto&& it: tasks) {
+    try {
+      if constexpr (std::same_as<T, void>) {
+        co_await std::move(it);
+      } else {
+        results.emplace_back(co_await std::move(it));
+      }
+    } catch (...) {
+      if (!exception) {
+        exception = std::current_exception();
+      }
+    }
+  }
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+
+  if constexpr (!std::same_as<T, void>) {
+    co_return results | std::views::transform([](auto& it) {
+                return std::move(it).value();
+              })
+      | std::ranges::to<std::vector>();
+  }
+}
+
+/** Call `fn` for each input, with at most `maxConcurrency` in flight.
+ *
+ * As `task<>` starts eagerly, this takes a function to create each task rather
+ * than the tasks themselves.
+ *
+ * - results are in the same order as the inputs, regardless of completion
+ *   order
+ * - like all `task<>`s, `fn`'s continuations run on the calling thread, so
+ *   `fn` can safely touch state owned by that thread between `co_await`s
+ * - if a call throws, no further calls are started; the first exception is
+ *   rethrown after the calls that are already in flight have completed
+ */
+template <
+  class TInput,
+  class TFn,
+  class TResult = detail::task_result_t<std::invoke_result_t<TFn&, TInput&>>>
+task<detail::when_all_result_t<TResult>>
+when_all(std::size_t maxConcurrency, std::vector<TInput> inputs, TFn fn) {
+  std::vector<detail::when_all_storage_t<TResult>> results;
+  if constexpr (!std::same_as<TResult, void>) {
+    results.resize(inputs.size());
+  }
+  co_await detail::invoke_bounded<TResult>(
+    maxConcurrency, inputs, fn, {}, results);
+
+  if constexpr (!std::same_as<TResult, void>) {
+    co_return results | std::views::transform([](auto& it) {
+                return std::move(it).value();
+              })
+      | std::ranges::to<std::vector>();
+  }
+}
+
+/** Call `fn` for each input, with at most `maxConcurrency` in flight.
+ *
+ * This is the bounded `when_all()` for work that doesn't produce results,
+ * and may be abandoned part-way through:
+ *
+ * - once `stopToken` is stopped, no further calls are started; this returns
+ *   normally after the calls already in flight have completed
+ * - if a call throws, no further calls are started; the first exception is
+ *   rethrown after the calls that are already in flight have completed
+ */
+template <class TInput, class TFn>
+task<void> parallel_for_each(
+  std::size_t maxConcurrency,
+  std::vector<TInput> inputs,
+  TFn fn,
+  std::stop_token stopToken = {}) {
+  std::vector<detail::when_all_storage_t<void>> unused;
+  co_await detail::invoke_bounded<void>(
+    maxConcurrency, inputs, fn, std::move(stopToken), unused);
+}
+
+/** Wait for the first of the already-started tasks to complete.
+ *
+ * Returns the index and result of the first task to complete, or rethrows
+ * its exception.
+ *
+ * The other tasks keep running until they complete, and their results or
+ * exceptions are discarded; anything they reference must outlive them, not
+ * just this call. To stop them early, pass them a `std::stop_token`, and
+ * request a stop when this returns.
+ */
+template <class T>
+task<when_any_result<T>> when_any(std::vector<task<T>> tasks) {
+  OPENKNEEBOARD_ASSERT(!tasks.empty(), "when_any() requires at least 1 task");
+
+  const auto state = std::make_shared<detail::WhenAnyState<T>>();
+  for (std::size_t i = 0; i < tasks.size(); ++i) {
+    detail::when_any_watch<T>(state, i, std::move(tasks.at(i)));
+  }
+  co_await state->wait();
+
+  if (state->mException) {
+    std::rethrow_exception(state->mException);
+  }
+  if constexpr (std::same_as<T, void>) {
+    co_return when_any_result<void> {state->mIndex};
+  } else {
+    co_return when_any_result<T> {
+      state->mIndex, std::move(state->mResult).value()};
+  }
+}
+
+}// namespace OpenKneeboard
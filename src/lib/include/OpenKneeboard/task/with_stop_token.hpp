@@ -0,0 +1,89 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/task.hpp>
+#include <OpenKneeboard/task/when_all.hpp>
+
+#include <shims/winrt/base.h>
+
+#include <expected>
+#include <memory>
+#include <stop_token>
+
+namespace OpenKneeboard {
+
+enum class CancellableError {
+  Cancelled,
+};
+template <class T>
+using CancellableResult = std::expected<T, CancellableError>;
+
+/** Await `it`, unless `stopToken` is stopped first.
+ *
+ * If the token is stopped first, this resumes with
+ * `CancellableError::Cancelled` without waiting for `it`. Tasks can't be
+ * interrupted, so `it` keeps running until it completes, and its result or
+ * exception is discarded; pass it the token too if it can stop early.
+ */
+template <class T>
+task<CancellableResult<T>> with_stop_token(
+  std::stop_token stopToken,
+  task<T> it) {
+  // Index 0 is `it`, index 1 is the stop token
+  const auto state = std::make_shared<detail::WhenAnyState<T>>();
+  detail::when_any_watch<T>(state, 0, std::move(it));
+
+  if (
+    stopToken.stop_requested()
+    && !state->mHaveFirst.test_and_set(std::memory_order_acq_rel)) {
+    co_return std::unexpected {CancellableError::Cancelled};
+  }
+
+  {
+    const std::stop_callback onStop(stopToken, [state]() {
+      if (state->mHaveFirst.test_and_set(std::memory_order_acq_rel)) {
+        return;
+      }
+      state->mIndex = 1;
+      // Don't resume our caller from inside `request_stop()`, which is
+      // usually called by code that's about to start replacement work
+      [](auto state) -> fire_and_forget {
+        co_await winrt::resume_background();
+        state->complete();
+      }(state);
+    });
+    co_await state->wait();
+  }
+
+  if (state->mIndex == 1) {
+    co_return std::unexpected {CancellableError::Cancelled};
+  }
+  if (state->mException) {
+    std::rethrow_exception(state->mException);
+  }
+  if constexpr (std::same_as<T, void>) {
+    co_return {};
+  } else {
+    co_return std::move(state->mResult).value();
+  }
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,117 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/Tests.hpp>
+
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace OpenKneeboard::Tests {
+
+namespace {
+
+struct TestCase {
+  std::string_view mName;
+  void (*mBody)() {nullptr};
+};
+
+// Function-local, as registrations run during static initialization
+std::vector<TestCase>& GetTestCases() {
+  static std::vector<TestCase> sTestCases;
+  return sTestCases;
+}
+
+std::size_t gFailures {};
+
+struct RequirementFailed {};
+
+void ReportFailure(
+  std::string_view expression,
+  const std::source_location& location) {
+  ++gFailures;
+  std::fprintf(
+    stderr,
+    "%s:%u: check failed: %.*s\n",
+    location.file_name(),
+    static_cast<unsigned int>(location.line()),
+    static_cast<int>(expression.size()),
+    expression.data());
+}
+
+}// namespace
+
+void Register(std::string_view name, void (*body)()) {
+  GetTestCases().push_back({name, body});
+}
+
+void Check(
+  bool passed,
+  std::string_view expression,
+  const std::source_location& location) {
+  if (!passed) {
+    ReportFailure(expression, location);
+  }
+}
+
+void Require(
+  bool passed,
+  std::string_view expression,
+  const std::source_location& location) {
+  if (!passed) {
+    ReportFailure(expression, location);
+    throw RequirementFailed {};
+  }
+}
+
+}// namespace OpenKneeboard::Tests
+
+/// Runs every test case, or those whose names contain `argv[1]`
+int main(int argc, char** argv) {
+  using namespace OpenKneeboard::Tests;
+  const std::string_view filter = (argc > 1) ? argv[1] : "";
+
+  std::size_t failedCases {};
+  for (const auto& [name, body]: GetTestCases()) {
+    if (!filter.empty() && name.find(filter) == std::string_view::npos) {
+      continue;
+    }
+    const auto failuresBefore = gFailures;
+    try {
+      body();
+    } catch (const RequirementFailed&) {
+    } catch (const std::exception& e) {
+      ++gFailures;
+      std::fprintf(stderr, "uncaught exception: %s\n", e.what());
+    } catch (...) {
+      ++gFailures;
+      std::fprintf(stderr, "uncaught exception\n");
+    }
+    const bool passed = (gFailures == failuresBefore);
+    failedCases += passed ? 0 : 1;
+    std::printf(
+      "[%s] %.*s\n",
+      passed ? "PASS" : "FAIL",
+      static_cast<int>(name.size()),
+      name.data());
+  }
+  std::fflush(stdout);
+  return failedCases ? 1 : 0;
+}
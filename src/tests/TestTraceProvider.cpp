@@ -0,0 +1,31 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/tracing.hpp>
+
+namespace OpenKneeboard {
+/* PS >
+ * [System.Diagnostics.Tracing.EventSource]::new("OpenKneeboard.Tests")
+ * 46b582af-4d20-53ae-cd11-9edb829ce073
+ */
+TRACELOGGING_DEFINE_PROVIDER(
+  gTraceProvider,
+  "OpenKneeboard.Tests",
+  (0x46b582af, 0x4d20, 0x53ae, 0xcd, 0x11, 0x9e, 0xdb, 0x82, 0x9c, 0xe0, 0x73));
+}// namespace OpenKneeboard
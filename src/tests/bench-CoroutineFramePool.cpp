@@ -0,0 +1,183 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CoroutineFramePool.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <exception>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+/// Starts suspended; destroying the handle frees the frame
+template <bool Pooled>
+struct coro {
+  struct promise_type {
+    static void* operator new(std::size_t size) {
+      if constexpr (Pooled) {
+        return CoroutineFramePool::Allocate(size, nullptr);
+      } else {
+        return ::operator new(size);
+      }
+    }
+
+    static void operator delete(void* frame, std::size_t size) noexcept {
+      if constexpr (Pooled) {
+        CoroutineFramePool::Deallocate(frame, size);
+      } else {
+        ::operator delete(frame, size);
+      }
+    }
+
+    coro get_return_object() noexcept {
+      return {std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() noexcept {
+      return {};
+    }
+    std::suspend_always final_suspend() noexcept {
+      return {};
+    }
+    void return_void() noexcept {
+    }
+    void unhandled_exception() noexcept {
+      std::terminate();
+    }
+  };
+
+  std::coroutine_handle<promise_type> mHandle;
+};
+
+template <bool Pooled>
+coro<Pooled> SmallFrame(int value) {
+  co_await std::suspend_always {};
+  std::printf("%d", value);
+}
+
+// About the size of a typical event handler's frame
+template <bool Pooled>
+coro<Pooled> LargeFrame(int value) {
+  std::array<int, 128> buffer {};
+  buffer[value % buffer.size()] = value;
+  co_await std::suspend_always {};
+  std::printf("%d", buffer[0]);
+}
+
+constexpr std::size_t Rounds = 200;
+// Frames in flight at once
+constexpr std::size_t Batch = 1000;
+
+template <bool Pooled>
+void CreateBatch(std::vector<std::coroutine_handle<>>& out, int round) {
+  for (std::size_t i = 0; i < Batch; ++i) {
+    out.push_back(
+      (i % 2) ? SmallFrame<Pooled>(round).mHandle
+              : LargeFrame<Pooled>(round).mHandle);
+  }
+}
+
+void DestroyBatch(std::vector<std::coroutine_handle<>>& batch) {
+  for (const auto handle: batch) {
+    handle.destroy();
+  }
+  batch.clear();
+}
+
+/// Frames per second, created and destroyed on the same thread
+template <bool Pooled>
+double SameThread() {
+  std::vector<std::coroutine_handle<>> batch;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t round = 0; round < Rounds; ++round) {
+    CreateBatch<Pooled>(batch, static_cast<int>(round));
+    DestroyBatch(batch);
+  }
+  const std::chrono::duration<double> elapsed
+    = std::chrono::steady_clock::now() - start;
+  return (Rounds * Batch) / elapsed.count();
+}
+
+/** Frames per second, created on one thread and destroyed on another.
+ *
+ * Like coroutines started on one thread that complete on a thread pool.
+ */
+template <bool Pooled>
+double CrossThread() {
+  std::vector<std::vector<std::coroutine_handle<>>> batches(Rounds);
+  const auto start = std::chrono::steady_clock::now();
+  {
+    std::atomic_size_t created {0};
+    std::jthread producer([&] {
+      for (std::size_t round = 0; round < Rounds; ++round) {
+        CreateBatch<Pooled>(batches[round], static_cast<int>(round));
+        created.store(round + 1, std::memory_order_release);
+      }
+    });
+    std::jthread consumer([&] {
+      for (std::size_t round = 0; round < Rounds; ++round) {
+        while (created.load(std::memory_order_acquire) <= round) {
+          std::this_thread::yield();
+        }
+        DestroyBatch(batches[round]);
+      }
+    });
+  }
+  const std::chrono::duration<double> elapsed
+    = std::chrono::steady_clock::now() - start;
+  return (Rounds * Batch) / elapsed.count();
+}
+
+}// namespace
+
+/** Coroutine frame allocation throughput, pooled vs `::operator new`.
+ *
+ * Exits with a non-zero status if any pooled frames are left in flight.
+ */
+int main() {
+  const auto before = CoroutineFramePool::GetStatistics();
+
+  std::printf(
+    "same thread: %.1fM frames/s pooled, %.1fM/s default\n",
+    SameThread<true>() / 1e6,
+    SameThread<false>() / 1e6);
+  std::printf(
+    "cross thread: %.1fM frames/s pooled, %.1fM/s default\n",
+    CrossThread<true>() / 1e6,
+    CrossThread<false>() / 1e6);
+
+  const auto after = CoroutineFramePool::GetStatistics();
+  const auto allocations = after.mAllocations - before.mAllocations;
+  std::printf(
+    "%llu pooled allocations, %.1f%% from free lists\n",
+    static_cast<unsigned long long>(allocations),
+    (100.0 * (after.mPoolHits - before.mPoolHits)) / allocations);
+
+  const bool ok = (after.mFramesInFlight == before.mFramesInFlight);
+  if (!ok) {
+    std::fprintf(stderr, "FAILED\n");
+  }
+  return ok ? 0 : 1;
+}
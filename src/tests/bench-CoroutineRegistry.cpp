@@ -0,0 +1,206 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CoroutineRegistry.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace OpenKneeboard;
+using namespace OpenKneeboard::CoroutineRegistry;
+
+namespace {
+
+thread_local std::coroutine_handle<> tPending;
+
+struct Suspend {
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(std::coroutine_handle<> coro) const noexcept {
+    tPending = coro;
+  }
+  void await_resume() const noexcept {
+  }
+};
+
+/** Starts immediately, and is kept until destroyed.
+ *
+ * If `Tracked`, it makes the same registry calls as `task<>`: register on
+ * creation, an update for every suspension and resumption, and on
+ * completion, and unregister on destruction.
+ */
+template <bool Tracked>
+struct coro {
+  struct promise_type {
+    SlotID mSlot {NoSlot};
+
+    promise_type() {
+      if constexpr (Tracked) {
+        mSlot = Register(&tPending);
+      }
+    }
+
+    ~promise_type() {
+      if constexpr (Tracked) {
+        Unregister(mSlot);
+      }
+    }
+
+    coro get_return_object() noexcept {
+      return {std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_never initial_suspend() noexcept {
+      return {};
+    }
+    std::suspend_always final_suspend() noexcept {
+      if constexpr (Tracked) {
+        OnComplete(mSlot);
+      }
+      return {};
+    }
+    void return_void() noexcept {
+    }
+    void unhandled_exception() noexcept {
+      std::abort();
+    }
+
+    auto await_transform(Suspend) noexcept {
+      struct awaiter {
+        SlotID mSlot {NoSlot};
+
+        explicit awaiter(SlotID slot) : mSlot(slot) {
+        }
+
+        bool await_ready() const noexcept {
+          return false;
+        }
+        void await_suspend(std::coroutine_handle<> coro) const noexcept {
+          if constexpr (Tracked) {
+            OnSuspend(mSlot, &tPending);
+          }
+          Suspend {}.await_suspend(coro);
+        }
+        void await_resume() const noexcept {
+          if constexpr (Tracked) {
+            OnResume(mSlot);
+          }
+        }
+      };
+      return awaiter(mSlot);
+    }
+  };
+
+  std::coroutine_handle<promise_type> mHandle;
+};
+
+template <bool Tracked>
+coro<Tracked> FourSuspensions(std::size_t& counter) {
+  co_await Suspend {};
+  ++counter;
+  co_await Suspend {};
+  ++counter;
+  co_await Suspend {};
+  ++counter;
+  co_await Suspend {};
+  ++counter;
+}
+
+/// Wall-clock nanoseconds per coroutine, on each thread
+template <bool Tracked>
+double Measure(std::size_t threadCount, std::size_t perThread) {
+  const auto start = std::chrono::steady_clock::now();
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t i = 0; i < threadCount; ++i) {
+      threads.emplace_back([perThread] {
+        std::size_t counter {};
+        for (std::size_t j = 0; j < perThread; ++j) {
+          const auto handle = FourSuspensions<Tracked>(counter).mHandle;
+          while (!handle.done()) {
+            std::exchange(tPending, {}).resume();
+          }
+          handle.destroy();
+        }
+        if (counter != perThread * 4) {
+          std::abort();
+        }
+      });
+    }
+  }
+  const std::chrono::duration<double, std::nano> elapsed
+    = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / perThread;
+}
+
+}// namespace
+
+/** The cost of tracking coroutines in the registry.
+ *
+ * This is only meaningful for release builds. Compares a coroutine that
+ * suspends four times with and without the registry updates `task<>` makes;
+ * the difference is the per-coroutine overhead.
+ *
+ * Exits with a non-zero status if any coroutines are left registered.
+ */
+int main() {
+  constexpr std::size_t PerThread = 1'000'000;
+  constexpr std::size_t Repetitions = 5;
+
+  const auto before = GetLiveCoroutines().size();
+  std::vector<std::size_t> threadCounts {1};
+  // More threads than cores would just measure time slicing
+  if (const auto cores = std::thread::hardware_concurrency(); cores > 1) {
+    threadCounts.push_back(cores);
+  }
+  for (const auto threads: threadCounts) {
+    double untracked = std::numeric_limits<double>::max();
+    double tracked = std::numeric_limits<double>::max();
+    for (std::size_t i = 0; i < Repetitions; ++i) {
+      untracked = std::min(untracked, Measure<false>(threads, PerThread));
+      tracked = std::min(tracked, Measure<true>(threads, PerThread));
+    }
+    std::printf(
+      "%zu thread(s): %.1fns per coroutine untracked, %.1fns tracked "
+      "(+%.1fns)\n",
+      threads,
+      untracked,
+      tracked,
+      tracked - untracked);
+  }
+
+  const auto stats = GetStatistics();
+  std::printf(
+    "high water: %zu slots; untracked: %llu\n",
+    stats.mHighWater,
+    static_cast<unsigned long long>(stats.mUntracked));
+
+  const bool ok = (GetLiveCoroutines().size() == before);
+  if (!ok) {
+    std::fprintf(stderr, "FAILED\n");
+  }
+  return ok ? 0 : 1;
+}
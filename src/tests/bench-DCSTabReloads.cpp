@@ -0,0 +1,200 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/TaskExecutor.hpp>
+
+#include <OpenKneeboard/task/when_all.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+constexpr std::size_t Switches = 10;
+constexpr std::size_t FoldersPerAircraft = 3;
+constexpr std::size_t FilesPerFolder = 30;
+constexpr std::size_t Concurrency = 8;
+constexpr std::size_t FilesPerAircraft = FoldersPerAircraft * FilesPerFolder;
+
+struct Result {
+  std::size_t mCreated {};
+  std::size_t mCreatedForCurrent {};
+  // From the last switch until its aircraft's delegates were all created
+  Milliseconds mCurrentReady {};
+};
+
+/// An aircraft tab that's reloaded every time the player switches aircraft
+struct AircraftTab {
+  ThreadPool& mPool;
+  // Just for `Wait()`, so it doesn't compete with file loads
+  ThreadPool& mClock;
+  std::chrono::microseconds mOpenTime {};
+  bool mUseStopTokens {};
+
+  /// Like a file delegate: I/O on a pool thread
+  task<void> CreateDelegate() {
+    co_await mPool.schedule();
+    std::this_thread::sleep_for(mOpenTime);
+  }
+
+  task<void> Wait(std::chrono::microseconds duration) {
+    co_await mClock.schedule();
+    std::this_thread::sleep_for(duration);
+  }
+
+  /// Like a reload: each folder's files, up to `Concurrency` at a time
+  task<void> Load(
+    std::stop_token stopToken,
+    std::size_t& created,
+    Clock::time_point& finished) {
+    std::vector<std::size_t> files;
+    for (std::size_t i = 0; i < FilesPerFolder; ++i) {
+      files.push_back(i);
+    }
+    for (std::size_t folder = 0; folder < FoldersPerAircraft; ++folder) {
+      if (stopToken.stop_requested()) {
+        co_return;
+      }
+      co_await parallel_for_each(
+        Concurrency,
+        files,
+        [this, &created](std::size_t) -> task<void> {
+          co_await this->CreateDelegate();
+          ++created;
+        },
+        stopToken);
+    }
+    finished = Clock::now();
+  }
+
+  task<Result> SwitchAircraft(std::chrono::microseconds interval) {
+    std::vector<std::size_t> created(Switches);
+    std::vector<Clock::time_point> finished(Switches);
+    std::vector<task<void>> loads;
+
+    // As in `DCSTab::StartReload()`
+    std::stop_source stopSource;
+    Clock::time_point lastSwitch;
+    for (std::size_t i = 0; i < Switches; ++i) {
+      if (i > 0) {
+        co_await this->Wait(interval);
+      }
+      stopSource.request_stop();
+      stopSource = {};
+      lastSwitch = Clock::now();
+      loads.push_back(this->Load(
+        mUseStopTokens ? stopSource.get_token() : std::stop_token {},
+        created.at(i),
+        finished.at(i)));
+    }
+    co_await when_all(std::move(loads));
+
+    Result ret {
+      .mCreatedForCurrent = created.back(),
+      .mCurrentReady = finished.back() - lastSwitch,
+    };
+    for (const auto count: created) {
+      ret.mCreated += count;
+    }
+    co_return ret;
+  }
+};
+
+/** Run on a `RunQueue` on this thread, as the tab's owner would.
+ *
+ * `task<>` resumes on the thread that created it, so delegates are counted
+ * on this thread.
+ */
+Result Run(AircraftTab& tab, std::chrono::microseconds interval) {
+  const auto queue = RunQueue::Create();
+  const RunQueue::ThreadScope scope(queue);
+
+  Result ret;
+  [](
+    AircraftTab& tab,
+    std::chrono::microseconds interval,
+    Result& ret,
+    RunQueue& queue) -> fire_and_forget {
+    ret = co_await tab.SwitchAircraft(interval);
+    queue.Stop();
+  }(tab, interval, ret, *queue);
+  queue->Run();
+  return ret;
+}
+
+}// namespace
+
+/** Switching aircraft several times in quick succession.
+ *
+ * Each switch reloads an aircraft tab with 3 folders of 30 files, opening
+ * up to 8 at a time on a pool thread. Compares the original behavior, where
+ * every superseded load runs to completion, with stopping them via a
+ * `std::stop_token` as `DCSTab` now does. Reports how many delegates were
+ * created in total, and how long the final aircraft took to load.
+ *
+ * Exits with a non-zero status if the final aircraft isn't fully loaded, if
+ * superseded loads are cut short without stop tokens, or if stop tokens
+ * don't reduce the wasted work.
+ */
+int main() {
+  constexpr std::chrono::microseconds OpenTime {2000};
+
+  ThreadPool pool {Concurrency};
+  ThreadPool clock {1};
+  bool ok = true;
+  for (const auto interval: {
+         OpenTime / 2,
+         OpenTime * 3 / 2,
+         OpenTime * 5 / 2,
+       }) {
+    AircraftTab original {pool, clock, OpenTime, false};
+    const auto before = Run(original, interval);
+    AircraftTab stoppable {pool, clock, OpenTime, true};
+    const auto after = Run(stoppable, interval);
+
+    std::printf(
+      "%zu switches %lldus apart, %lldus per file: without stop tokens, "
+      "%zu delegates and %.1fms to load; with, %zu and %.1fms\n",
+      Switches,
+      static_cast<long long>(interval.count()),
+      static_cast<long long>(OpenTime.count()),
+      before.mCreated,
+      before.mCurrentReady.count(),
+      after.mCreated,
+      after.mCurrentReady.count());
+    ok = ok && (before.mCreated == Switches * FilesPerAircraft)
+      && (before.mCreatedForCurrent == FilesPerAircraft)
+      && (after.mCreatedForCurrent == FilesPerAircraft)
+      && (after.mCreated < before.mCreated);
+  }
+
+  if (!ok) {
+    std::fprintf(stderr, "FAILED\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/EventProfiler.hpp>
+#include <OpenKneeboard/Events.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+struct Receiver final : EventReceiver {
+  using EventReceiver::AddEventListener;
+
+  ~Receiver() override {
+    this->RemoveAllEventListeners();
+  }
+};
+
+/// Nanoseconds per call of `fn`
+double Measure(std::size_t iterations, auto&& fn) {
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    fn();
+  }
+  const std::chrono::duration<double, std::nano> elapsed
+    = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+}// namespace
+
+/** The cost of event handler profiling.
+ *
+ * This is only meaningful for release builds. Compares emitting an event to
+ * a trivial handler with profiling off and on, and calling the handler
+ * directly. With profiling off, the only cost over an unprofiled emit is a
+ * relaxed load and branch, which should be lost in the noise.
+ *
+ * Exits with a non-zero status if calls are missed, or recorded while
+ * profiling is off.
+ */
+int main() {
+  constexpr std::size_t Iterations = 1'000'000;
+  constexpr std::size_t Repetitions = 5;
+
+  Event<> event;
+  Receiver receiver;
+  uint64_t calls {};
+  receiver.AddEventListener(event, [&calls] { ++calls; });
+
+  const EventHandler<> handler {[&calls] { ++calls; }};
+
+  double direct = std::numeric_limits<double>::max();
+  double off = std::numeric_limits<double>::max();
+  double on = std::numeric_limits<double>::max();
+  for (std::size_t i = 0; i < Repetitions; ++i) {
+    direct = std::min(direct, Measure(Iterations, [&] { handler(); }));
+    EventProfiler::SetEnabled(false);
+    off = std::min(off, Measure(Iterations, [&] { event.Emit(); }));
+    EventProfiler::SetEnabled(true);
+    on = std::min(on, Measure(Iterations, [&] { event.Emit(); }));
+    EventProfiler::SetEnabled(false);
+  }
+
+  std::printf(
+    "handler alone: %.1fns\n"
+    "emit, profiling off: %.1fns\n"
+    "emit, profiling on: %.1fns (+%.1fns)\n",
+    direct,
+    off,
+    on,
+    on - off);
+
+  const auto report = EventProfiler::GetTopOffenders(1);
+  const auto recorded
+    = report.mByReceiver.empty() ? 0 : report.mByReceiver.front().mCalls;
+  if (calls != 3 * Repetitions * Iterations) {
+    std::fprintf(
+      stderr, "FAILED: %llu calls\n", static_cast<unsigned long long>(calls));
+    return 1;
+  }
+  if (recorded != Repetitions * Iterations) {
+    std::fprintf(
+      stderr,
+      "FAILED: %llu calls profiled\n",
+      static_cast<unsigned long long>(recorded));
+    return 1;
+  }
+  return 0;
+}
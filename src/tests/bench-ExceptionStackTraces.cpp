@@ -0,0 +1,128 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/TaskExecutor.hpp>
+
+#include <OpenKneeboard/config.hpp>
+#include <OpenKneeboard/fatal.hpp>
+#include <OpenKneeboard/task.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t Iterations = 2000;
+
+struct Result {
+  std::size_t mCaught {};
+  std::size_t mTruncated {};
+  Clock::duration mElapsed {};
+};
+
+OPENKNEEBOARD_NOINLINE
+std::size_t ThrowAtDepth(std::size_t depth) {
+  if (depth == 0) {
+    throw std::runtime_error("expected");
+  }
+  // Not a tail call, so each level is a real frame
+  return ThrowAtDepth(depth - 1) + 1;
+}
+
+task<void> Throw(std::size_t depth) {
+  ThrowAtDepth(depth);
+  co_return;
+}
+
+/// Like a file that's missing during a reload: thrown, then caught by the
+/// task's awaiter
+task<void> ThrowAndCatch(std::size_t depth, Result& result) {
+  try {
+    co_await Throw(depth);
+  } catch (const std::runtime_error&) {
+    ++result.mCaught;
+    if (StackTrace::GetForMostRecentException().IsTruncated()) {
+      ++result.mTruncated;
+    }
+  }
+}
+
+Result Run(ExceptionStackTraces traces, std::size_t depth) {
+  SetExceptionStackTraces(traces);
+  const auto queue = RunQueue::Create();
+  const RunQueue::ThreadScope scope(queue);
+
+  Result result;
+  [](std::size_t depth, Result& result, RunQueue& queue) -> fire_and_forget {
+    const auto start = Clock::now();
+    for (std::size_t i = 0; i < Iterations; ++i) {
+      co_await ThrowAndCatch(depth, result);
+    }
+    result.mElapsed = Clock::now() - start;
+    queue.Stop();
+  }(depth, result, *queue);
+  queue->Run();
+  return result;
+}
+
+double Microseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}// namespace
+
+/** Cost of throwing through a `task<>` and catching in its awaiter, with
+ * full and sampled exception stack traces.
+ *
+ * Traces are recorded by the `_CxxThrowException` hook, so this only builds
+ * on Windows, like the hook.
+ *
+ * Exits with a non-zero status if an exception is missed, if full traces
+ * are truncated, or if sampling doesn't truncate most traces.
+ */
+int main() {
+  divert_process_failure_to_fatal();
+
+  bool ok = true;
+  for (const std::size_t depth: {10, 60}) {
+    const auto full = Run(ExceptionStackTraces::Full, depth);
+    const auto sampled = Run(ExceptionStackTraces::Sampled, depth);
+    std::printf(
+      "depth %zu: %.1fus per throw with full traces, %.1fus sampled "
+      "(%zu of %zu truncated)\n",
+      depth,
+      Microseconds(full.mElapsed) / Iterations,
+      Microseconds(sampled.mElapsed) / Iterations,
+      sampled.mTruncated,
+      Iterations);
+    ok = ok && full.mCaught == Iterations && sampled.mCaught == Iterations
+      && full.mTruncated == 0 && sampled.mTruncated > Iterations / 2;
+  }
+
+  if (!ok) {
+    std::fprintf(stderr, "FAILED\n");
+    return 1;
+  }
+  return 0;
+}
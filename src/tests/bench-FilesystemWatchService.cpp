@@ -0,0 +1,133 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/FilesystemWatchService.hpp>
+
+#include <OpenKneeboard/Tests/FakeFilesystemWatchBackend.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+/** OS watch counts and notification latency for a folder of images.
+ *
+ * Models a folder tab plus one image tab per file, each watching its own
+ * file; without the service, that's one OS watch per subscriber.
+ *
+ * Exits with a non-zero status if the service doesn't share watches, or
+ * misses or duplicates notifications.
+ */
+int main() {
+  constexpr std::size_t FileCount = 300;
+  constexpr std::size_t ChangedCount = 50;
+  constexpr std::size_t NotificationsPerChange = 4;
+
+  std::random_device random;
+  const auto root = std::filesystem::temp_directory_path()
+    / ("OpenKneeboard-bench-FilesystemWatchService-"
+       + std::to_string(random()));
+  std::filesystem::create_directories(root);
+
+  std::vector<std::filesystem::path> files;
+  for (std::size_t i = 0; i < FileCount; ++i) {
+    files.push_back(root / ("page-" + std::to_string(i) + ".png"));
+    std::ofstream(files.back(), std::ios::binary) << "x";
+  }
+  // Anything newer than the settle time is assumed to still be being written
+  std::this_thread::sleep_for(FilesystemWatchService::DefaultSettleTime);
+
+  auto ownedBackend = std::make_unique<Tests::FakeFilesystemWatchBackend>();
+  auto backend = ownedBackend.get();
+  auto service = FilesystemWatchService::Create(std::move(ownedBackend));
+
+  std::atomic<std::size_t> folderCallbacks {};
+  std::atomic<std::size_t> fileCallbacks {};
+  const auto callback = [&](const std::filesystem::path& path) {
+    ++(path == root ? folderCallbacks : fileCallbacks);
+  };
+
+  std::vector<std::unique_ptr<FilesystemWatchService::Subscription>>
+    subscriptions;
+  subscriptions.push_back(service->Subscribe(root, callback));
+  for (const auto& file: files) {
+    subscriptions.push_back(service->Subscribe(file, callback));
+  }
+
+  const auto watches = backend->GetWatchCount();
+  std::printf(
+    "%zu subscriptions: %zu OS watches (%zu without sharing)\n",
+    subscriptions.size(),
+    watches,
+    subscriptions.size());
+
+  // Simulate an editor saving some of the images; each save produces
+  // several OS notifications
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < ChangedCount; ++i) {
+    std::ofstream(files.at(i), std::ios::binary | std::ios::app) << "y";
+    for (std::size_t j = 0; j < NotificationsPerChange; ++j) {
+      backend->Notify(root);
+    }
+  }
+  while ((fileCallbacks < ChangedCount || !folderCallbacks)
+         && std::chrono::steady_clock::now() - start < 10s) {
+    std::this_thread::sleep_for(1ms);
+  }
+  // Catch any duplicates
+  std::this_thread::sleep_for(FilesystemWatchService::DefaultSettleTime * 2);
+
+  const auto stats = service->GetStatistics();
+  const auto ms = [](auto duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  std::printf(
+    "%llu notifications -> %zu file callbacks (%zu changed), %zu folder "
+    "callbacks\n",
+    static_cast<unsigned long long>(stats.mBackendNotifications),
+    fileCallbacks.load(),
+    ChangedCount,
+    folderCallbacks.load());
+  if (stats.mCallbacks) {
+    std::printf(
+      "latency: mean %.1fms, max %.1fms (settle time %.1fms)\n",
+      ms(stats.mTotalLatency) / stats.mCallbacks,
+      ms(stats.mMaxLatency),
+      ms(FilesystemWatchService::DefaultSettleTime));
+  }
+
+  subscriptions.clear();
+  service.reset();
+  std::error_code ec;
+  std::filesystem::remove_all(root, ec);
+
+  const bool ok
+    = (watches == 2) && (fileCallbacks == ChangedCount) && folderCallbacks;
+  if (!ok) {
+    std::fprintf(stderr, "FAILED\n");
+  }
+  return ok ? 0 : 1;
+}
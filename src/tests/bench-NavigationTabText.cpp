@@ -0,0 +1,205 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/config.hpp>
+
+#include <shims/winrt/base.h>
+
+#include <d2d1_1.h>
+#include <d3d11.h>
+#include <dwrite.h>
+#include <dxgi.h>
+
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <string>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr UINT32 Width = 1024;
+constexpr UINT32 Height = 768;
+constexpr std::size_t LabelCount = 20;
+constexpr std::size_t FrameCount = 500;
+
+struct Label {
+  std::wstring mText;
+  D2D1_RECT_F mRect;
+};
+
+double Microseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}// namespace
+
+/** Per-frame CPU cost of drawing a NavigationTab page's text, shaping it
+ * every frame as NavigationTab used to, and drawing pre-shaped layouts as
+ * it does now.
+ *
+ * Draws 20 bookmark labels and a page footer per frame, on a WARP device so
+ * that the numbers don't depend on the GPU.
+ *
+ * Exits with a non-zero status if Direct2D reports a drawing error.
+ */
+int main() {
+  winrt::com_ptr<ID3D11Device> d3d;
+  winrt::check_hresult(D3D11CreateDevice(
+    nullptr,
+    D3D_DRIVER_TYPE_WARP,
+    nullptr,
+    D3D11_CREATE_DEVICE_BGRA_SUPPORT,
+    nullptr,
+    0,
+    D3D11_SDK_VERSION,
+    d3d.put(),
+    nullptr,
+    nullptr));
+
+  winrt::com_ptr<ID2D1Factory1> d2df;
+  winrt::check_hresult(
+    D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, d2df.put()));
+  winrt::com_ptr<ID2D1Device> d2d;
+  winrt::check_hresult(
+    d2df->CreateDevice(d3d.as<IDXGIDevice>().get(), d2d.put()));
+  winrt::com_ptr<ID2D1DeviceContext> ctx;
+  winrt::check_hresult(
+    d2d->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE, ctx.put()));
+
+  winrt::com_ptr<ID2D1Bitmap1> target;
+  const D2D1_BITMAP_PROPERTIES1 targetProperties {
+    .pixelFormat = {
+      .format = DXGI_FORMAT_B8G8R8A8_UNORM,
+      .alphaMode = D2D1_ALPHA_MODE_PREMULTIPLIED,
+    },
+    .bitmapOptions = D2D1_BITMAP_OPTIONS_TARGET,
+  };
+  winrt::check_hresult(ctx->CreateBitmap(
+    {Width, Height}, nullptr, 0, &targetProperties, target.put()));
+  ctx->SetTarget(target.get());
+
+  winrt::com_ptr<ID2D1SolidColorBrush> brush;
+  winrt::check_hresult(
+    ctx->CreateSolidColorBrush(D2D1::ColorF(0.0f, 0.0f, 0.0f), brush.put()));
+
+  winrt::com_ptr<IDWriteFactory> dwf;
+  winrt::check_hresult(DWriteCreateFactory(
+    DWRITE_FACTORY_TYPE_SHARED,
+    __uuidof(IDWriteFactory),
+    reinterpret_cast<IUnknown**>(dwf.put())));
+  winrt::com_ptr<IDWriteTextFormat> textFormat;
+  winrt::check_hresult(dwf->CreateTextFormat(
+    VariableWidthUIFont,
+    nullptr,
+    DWRITE_FONT_WEIGHT_NORMAL,
+    DWRITE_FONT_STYLE_NORMAL,
+    DWRITE_FONT_STRETCH_NORMAL,
+    Height / (3.0f * (LabelCount + 1)),
+    L"",
+    textFormat.put()));
+  textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
+  winrt::com_ptr<IDWriteInlineObject> ellipsis;
+  winrt::check_hresult(
+    dwf->CreateEllipsisTrimmingSign(textFormat.get(), ellipsis.put()));
+  DWRITE_TRIMMING trimming {
+    .granularity = DWRITE_TRIMMING_GRANULARITY_CHARACTER};
+  winrt::check_hresult(textFormat->SetTrimming(&trimming, ellipsis.get()));
+
+  std::vector<Label> labels;
+  const auto rowHeight = static_cast<float>(Height) / (LabelCount + 1);
+  for (std::size_t i = 0; i < LabelCount; ++i) {
+    const auto top = rowHeight * i;
+    labels.push_back({
+      std::format(L"{} - Approach chart, runway {}L ILS or LOC", i + 1, i),
+      {Width / 4.0f, top, static_cast<float>(Width), top + rowHeight},
+    });
+  }
+  labels.push_back({
+    L"Page 3 of 12",
+    {0.0f, Height - rowHeight, static_cast<float>(Width), Height},
+  });
+
+  constexpr auto options
+    = D2D1_DRAW_TEXT_OPTIONS_NO_SNAP | D2D1_DRAW_TEXT_OPTIONS_CLIP;
+  bool ok = true;
+
+  auto start = Clock::now();
+  for (std::size_t frame = 0; frame < FrameCount; ++frame) {
+    ctx->BeginDraw();
+    ctx->Clear(D2D1::ColorF(1.0f, 1.0f, 1.0f));
+    for (const auto& label: labels) {
+      ctx->DrawTextW(
+        label.mText.data(),
+        static_cast<UINT32>(label.mText.size()),
+        textFormat.get(),
+        label.mRect,
+        brush.get(),
+        options);
+    }
+    ok = SUCCEEDED(ctx->EndDraw()) && ok;
+  }
+  const auto shapedPerFrame = Clock::now() - start;
+
+  start = Clock::now();
+  std::vector<winrt::com_ptr<IDWriteTextLayout>> layouts;
+  for (const auto& label: labels) {
+    winrt::com_ptr<IDWriteTextLayout> layout;
+    winrt::check_hresult(dwf->CreateTextLayout(
+      label.mText.data(),
+      static_cast<UINT32>(label.mText.size()),
+      textFormat.get(),
+      label.mRect.right - label.mRect.left,
+      label.mRect.bottom - label.mRect.top,
+      layout.put()));
+    layouts.push_back(std::move(layout));
+  }
+  const auto layoutTime = Clock::now() - start;
+
+  start = Clock::now();
+  for (std::size_t frame = 0; frame < FrameCount; ++frame) {
+    ctx->BeginDraw();
+    ctx->Clear(D2D1::ColorF(1.0f, 1.0f, 1.0f));
+    for (std::size_t i = 0; i < labels.size(); ++i) {
+      const auto& rect = labels.at(i).mRect;
+      ctx->DrawTextLayout(
+        {rect.left, rect.top}, layouts.at(i).get(), brush.get(), options);
+    }
+    ok = SUCCEEDED(ctx->EndDraw()) && ok;
+  }
+  const auto preshaped = Clock::now() - start;
+
+  std::printf(
+    "shaped every frame: %.1fus per frame\n",
+    Microseconds(shapedPerFrame) / FrameCount);
+  std::printf(
+    "pre-shaped layouts: %.1fus per frame, plus %.1fus once per page\n",
+    Microseconds(preshaped) / FrameCount,
+    Microseconds(layoutTime));
+
+  if (!ok) {
+    std::fprintf(stderr, "FAILED\n");
+    return 1;
+  }
+  return 0;
+}
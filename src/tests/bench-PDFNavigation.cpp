@@ -0,0 +1,143 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/PDFNavigation.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFPageDocumentHelper.hh>
+#include <qpdf/QPDFWriter.hh>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr PageIndex PageCount = 1500;
+// Like a chart index, or an airport directory
+constexpr std::size_t LinksPerPage = 40;
+
+/// Each page has a grid of links to other pages
+void WriteDocument(const std::filesystem::path& path) {
+  QPDF pdf;
+  pdf.emptyPDF();
+  QPDFPageDocumentHelper helper(pdf);
+  for (PageIndex i = 0; i < PageCount; ++i) {
+    helper.addPage(
+      QPDFPageObjectHelper {pdf.makeIndirectObject(QPDFObjectHandle::parse(
+        "<< /Type /Page /MediaBox [0 0 612 792] >>"))},
+      false);
+  }
+
+  auto pages = helper.getAllPages();
+  for (PageIndex i = 0; i < PageCount; ++i) {
+    auto annotations = QPDFObjectHandle::newArray();
+    for (std::size_t j = 0; j < LinksPerPage; ++j) {
+      const auto x = static_cast<double>((j % 4) * 150);
+      const auto y = static_cast<double>((j / 4) * 70);
+      auto destination = QPDFObjectHandle::newArray();
+      destination.appendItem(
+        pages.at((i + j + 1) % PageCount).getObjectHandle());
+      destination.appendItem(QPDFObjectHandle::newName("/Fit"));
+
+      auto annotation = QPDFObjectHandle::newDictionary();
+      annotation.replaceKey("/Type", QPDFObjectHandle::newName("/Annot"));
+      annotation.replaceKey("/Subtype", QPDFObjectHandle::newName("/Link"));
+      annotation.replaceKey(
+        "/Rect",
+        QPDFObjectHandle::newArray(
+          QPDFObjectHandle::Rectangle {x, y, x + 140, y + 60}));
+      annotation.replaceKey("/Dest", destination);
+      annotations.appendItem(pdf.makeIndirectObject(annotation));
+    }
+    pages.at(i).getObjectHandle().replaceKey("/Annots", annotations);
+  }
+
+  QPDFWriter writer(pdf, path.string().c_str());
+  writer.write();
+}
+
+double Milliseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}// namespace
+
+/** Time until the visible page's links are usable, and until all are.
+ *
+ * Before per-page extraction, every page's annotations were walked on one
+ * QPDF instance before any link was usable; that's modelled here by asking
+ * for each page in turn.
+ *
+ * Exits with a non-zero status if the parallel pass doesn't find the same
+ * links as the sequential one.
+ */
+int main() {
+  std::random_device random;
+  const auto path = std::filesystem::temp_directory_path()
+    / ("OpenKneeboard-bench-PDFNavigation-" + std::to_string(random())
+       + ".pdf");
+  WriteDocument(path);
+
+  std::vector<std::vector<PDFNavigation::Link>> sequential;
+  {
+    PDFNavigation::PDF pdf(path);
+    const auto start = Clock::now();
+    for (PageIndex i = 0; i < pdf.GetPageCount(); ++i) {
+      sequential.push_back(pdf.GetLinks(i));
+    }
+    std::printf(
+      "sequential: %.1fms until any links are usable\n",
+      Milliseconds(Clock::now() - start));
+  }
+
+  std::vector<std::vector<PDFNavigation::Link>> parallel;
+  {
+    PDFNavigation::PDF pdf(path);
+    const auto start = Clock::now();
+    const auto visible = pdf.GetLinks(PageCount / 2);
+    const auto firstPage = Clock::now() - start;
+    parallel = pdf.GetLinks();
+    std::printf(
+      "per-page: %.2fms for the visible page (%zu links), %.1fms for all "
+      "pages\n",
+      Milliseconds(firstPage),
+      visible.size(),
+      Milliseconds(Clock::now() - start));
+  }
+
+  std::error_code ec;
+  std::filesystem::remove(path, ec);
+
+  const bool ok = sequential.size() == PageCount && parallel == sequential
+    && std::ranges::all_of(sequential, [](const auto& links) {
+         return links.size() == LinksPerPage;
+       });
+  if (!ok) {
+    std::fprintf(stderr, "FAILED\n");
+  }
+  return ok ? 0 : 1;
+}
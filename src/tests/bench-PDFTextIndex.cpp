@@ -0,0 +1,147 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/PDFTextIndex.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr PageIndex PageCount = 1500;
+constexpr std::size_t WordsPerPage = 600;
+constexpr std::size_t Vocabulary = 20000;
+constexpr std::size_t QueryCount = 2000;
+
+std::vector<std::string> MakeDocument() {
+  std::mt19937 random(1);
+  std::uniform_int_distribution<std::size_t> word(0, Vocabulary - 1);
+  std::vector<std::string> ret(PageCount);
+  for (auto& page: ret) {
+    for (std::size_t i = 0; i < WordsPerPage; ++i) {
+      page += "W" + std::to_string(word(random)) + (i % 12 ? " " : ". ");
+    }
+  }
+  return ret;
+}
+
+std::vector<std::string> Split(std::string_view text) {
+  std::vector<std::string> ret;
+  std::string word;
+  for (const auto c: text) {
+    if (std::isalnum(static_cast<unsigned char>(c))) {
+      word.push_back(static_cast<char>(std::tolower(c)));
+      continue;
+    }
+    if (!word.empty()) {
+      ret.push_back(std::move(word));
+      word.clear();
+    }
+  }
+  if (!word.empty()) {
+    ret.push_back(std::move(word));
+  }
+  return ret;
+}
+
+/// What a search without an index has to do: tokenize every page
+std::vector<PageIndex> Scan(
+  const std::vector<std::string>& document,
+  std::string_view query) {
+  const auto wanted = Split(query);
+  std::vector<PageIndex> ret;
+  for (PageIndex page = 0; page < document.size(); ++page) {
+    const auto words = Split(document.at(page));
+    if (std::ranges::search(words, wanted).begin() != words.end()) {
+      ret.push_back(page);
+    }
+  }
+  return ret;
+}
+
+double Milliseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}// namespace
+
+/** Text search latency with and without the index, and the cost of
+ * building it.
+ *
+ * Models a large chart book: 1500 pages of 600 words. Queries are a mix of
+ * single words and two-word phrases.
+ *
+ * Exits with a non-zero status if the index finds different pages to a
+ * full scan.
+ */
+int main() {
+  const auto document = MakeDocument();
+
+  std::vector<std::string> queries;
+  for (std::size_t i = 0; i < QueryCount; ++i) {
+    queries.push_back(
+      (i % 2) ? std::format("w{}", i) : std::format("W{} w{}", i, i + 1));
+  }
+
+  auto start = Clock::now();
+  const auto index = PDFTextIndex::Create(document);
+  std::printf("build: %.1fms\n", Milliseconds(Clock::now() - start));
+
+  std::size_t hits {};
+  start = Clock::now();
+  std::vector<std::vector<PageIndex>> indexed;
+  for (const auto& query: queries) {
+    indexed.push_back(index.Find(query));
+    hits += indexed.back().size();
+  }
+  const auto indexTime = Clock::now() - start;
+
+  // Scanning is slow, so only check a sample
+  constexpr std::size_t ScanCount = 20;
+  bool ok = true;
+  start = Clock::now();
+  for (std::size_t i = 0; i < ScanCount; ++i) {
+    ok = ok && Scan(document, queries.at(i)) == indexed.at(i);
+  }
+  const auto scanTime = Clock::now() - start;
+
+  std::printf(
+    "indexed: %.3fms per query (%zu queries, %zu pages found)\n",
+    Milliseconds(indexTime) / QueryCount,
+    QueryCount,
+    hits);
+  std::printf(
+    "scanned: %.1fms per query\n", Milliseconds(scanTime) / ScanCount);
+
+  if (!(ok && hits)) {
+    std::fprintf(stderr, "FAILED\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/PageMetadataCache.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Stand-in for copying, opening, and parsing a PDF to find its page sizes
+// and navigation; real documents range from a few ms to seconds
+constexpr auto OpenTime = 20ms;
+
+PageMetadata MakeMetadata(std::size_t pageCount) {
+  PageMetadata ret;
+  for (std::size_t i = 0; i < pageCount; ++i) {
+    ret.mPageSizes.push_back({768, 1024});
+    ret.mBookmarks.push_back({
+      "Page " + std::to_string(i),
+      static_cast<PageIndex>(i),
+    });
+  }
+  ret.mLinks.resize(pageCount);
+  for (std::size_t i = 0; i + 1 < pageCount; ++i) {
+    ret.mLinks.at(i).push_back({
+      .mRect = {0.1f, 0.2f, 0.3f, 0.4f},
+      .mDestination = {
+        .mType = PDFNavigation::DestinationType::Page,
+        .mPageIndex = static_cast<PageIndex>(i + 1),
+      },
+    });
+  }
+  return ret;
+}
+
+}// namespace
+
+/** Time until every tab's pages can be published, without and with a
+ * populated cache.
+ *
+ * Models startup with a few dozen PDF tabs; `OpenTime` is the cost of
+ * opening a document, which the warm start skips until it confirms the
+ * entry in the background.
+ *
+ * Exits with a non-zero status if a warm start doesn't return exactly what
+ * the cold start stored.
+ */
+int main() {
+  constexpr std::size_t DocumentCount = 40;
+  constexpr std::size_t PagesPerDocument = 200;
+
+  std::random_device random;
+  const auto root = std::filesystem::temp_directory_path()
+    / ("OpenKneeboard-bench-PageMetadataCache-" + std::to_string(random()));
+  std::filesystem::create_directories(root / "documents");
+
+  std::vector<std::filesystem::path> documents;
+  for (std::size_t i = 0; i < DocumentCount; ++i) {
+    documents.push_back(
+      root / "documents" / ("document-" + std::to_string(i) + ".pdf"));
+    std::ofstream f(documents.back(), std::ios::binary);
+    // Larger than the hashed prefix, so that is what we measure
+    f << std::string(PageMetadataCache::ContentPrefixSize * 2, 'a' + (i % 26))
+      << i;
+  }
+  const auto expected = MakeMetadata(PagesPerDocument);
+
+  const PageMetadataCache cache(root / "cache");
+  const auto startup = [&](bool expectHits) {
+    std::size_t hits {};
+    std::size_t mismatches {};
+    const auto start = Clock::now();
+    for (const auto& document: documents) {
+      const auto key = PageMetadataCache::Key::Create(document);
+      if (!key) {
+        ++mismatches;
+        continue;
+      }
+      if (const auto metadata = cache.Load(*key)) {
+        ++hits;
+        if (*metadata != expected) {
+          ++mismatches;
+        }
+        continue;
+      }
+      std::this_thread::sleep_for(OpenTime);
+      cache.Store(*key, expected);
+    }
+    const auto elapsed = Clock::now() - start;
+    std::printf(
+      "%s: %.1fms for %zu documents (%zu cache hits)\n",
+      expectHits ? "warm" : "cold",
+      std::chrono::duration<double, std::milli>(elapsed).count(),
+      documents.size(),
+      hits);
+    return mismatches == 0 && hits == (expectHits ? documents.size() : 0);
+  };
+
+  const bool cold = startup(false);
+  const bool warm = startup(true);
+
+  std::error_code ec;
+  std::filesystem::remove_all(root, ec);
+
+  const bool ok = cold && warm;
+  if (!ok) {
+    std::fprintf(stderr, "FAILED\n");
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/TaskExecutor.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <exception>
+#include <latch>
+#include <thread>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Starts immediately, and frees itself when it finishes
+struct detached {
+  struct promise_type {
+    detached get_return_object() noexcept {
+      return {};
+    }
+    std::suspend_never initial_suspend() noexcept {
+      return {};
+    }
+    std::suspend_never final_suspend() noexcept {
+      return {};
+    }
+    void return_void() noexcept {
+    }
+    void unhandled_exception() noexcept {
+      std::terminate();
+    }
+  };
+};
+
+/// Continue on the queue's thread, like `task<>` resuming its awaiter
+struct PostTo {
+  RunQueue& mQueue;
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  bool await_suspend(std::coroutine_handle<> coro) const noexcept {
+    // Carry on synchronously if the queue's been stopped; the thread checks
+    // will report it
+    return mQueue.TryPost(coro);
+  }
+  void await_resume() const noexcept {
+  }
+};
+
+/// A `RunQueue` running on its own thread
+struct QueueThread {
+  std::shared_ptr<RunQueue> mQueue {RunQueue::Create()};
+  std::jthread mThread {[queue = mQueue] { queue->Run(); }};
+
+  ~QueueThread() {
+    mQueue->Stop();
+  }
+
+  /// Statistics are updated after resuming, so stop the thread first
+  RunQueue::Statistics StopAndGetStatistics() {
+    mQueue->Stop();
+    mThread.join();
+    return mQueue->GetStatistics();
+  }
+
+  std::thread::id GetID() const noexcept {
+    return mThread.get_id();
+  }
+};
+
+struct Counters {
+  std::atomic_size_t mWrongThread {};
+};
+
+double Nanoseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::nano>(duration).count();
+}
+
+/// Bounce between two threads; each hop is one post and one resume
+detached PingPong(
+  QueueThread& a,
+  QueueThread& b,
+  std::size_t hops,
+  Counters& counters,
+  std::latch& done) {
+  for (std::size_t i = 0; i < hops; ++i) {
+    auto& next = (i % 2) ? a : b;
+    co_await PostTo {*next.mQueue};
+    if (std::this_thread::get_id() != next.GetID()) {
+      ++counters.mWrongThread;
+    }
+  }
+  done.count_down();
+}
+
+detached PostOnce(QueueThread& queue, Counters& counters, std::latch& done) {
+  co_await PostTo {*queue.mQueue};
+  if (std::this_thread::get_id() != queue.GetID()) {
+    ++counters.mWrongThread;
+  }
+  done.count_down();
+}
+
+/// Origin -> pool -> origin, like awaiting a `task<>` that runs on the pool
+detached RoundTrips(
+  QueueThread& origin,
+  ThreadPool& pool,
+  std::size_t count,
+  Counters& counters,
+  std::latch& done) {
+  co_await PostTo {*origin.mQueue};
+  for (std::size_t i = 0; i < count; ++i) {
+    co_await pool.schedule();
+    if (RunQueue::GetForCurrentThread() == origin.mQueue) {
+      ++counters.mWrongThread;
+    }
+    co_await PostTo {*origin.mQueue};
+    if (std::this_thread::get_id() != origin.GetID()) {
+      ++counters.mWrongThread;
+    }
+  }
+  done.count_down();
+}
+
+}// namespace
+
+/** RunQueue post -> resume latency and throughput, and ThreadPool round
+ * trips.
+ *
+ * - latency: one coroutine bouncing between two queue threads, so every
+ *   post has to wake a waiting thread
+ * - throughput: one thread posting to a busy queue thread
+ * - round trips: the `task<>` pattern of hopping to a pool thread and back
+ *   to the originating queue, as one chain and as many concurrent chains
+ *
+ * Exits with a non-zero status if any coroutine resumes on the wrong thread,
+ * or the queues' statistics don't add up.
+ */
+int main() {
+  Counters counters;
+  bool ok = true;
+
+  {
+    constexpr std::size_t Hops = 100'000;
+    QueueThread a;
+    QueueThread b;
+    std::latch done(1);
+    const auto start = Clock::now();
+    PingPong(a, b, Hops, counters, done);
+    done.wait();
+    std::printf(
+      "post -> resume latency: %.0fns per hop (%zu hops)\n",
+      Nanoseconds(Clock::now() - start) / Hops,
+      Hops);
+    const auto stats = b.StopAndGetStatistics();
+    ok = ok && stats.mPosted == Hops / 2 && stats.mResumed == stats.mPosted;
+  }
+
+  {
+    constexpr std::size_t Posts = 1'000'000;
+    QueueThread queue;
+    std::latch done(Posts);
+    const auto start = Clock::now();
+    for (std::size_t i = 0; i < Posts; ++i) {
+      PostOnce(queue, counters, done);
+    }
+    done.wait();
+    const auto elapsed = Clock::now() - start;
+    const auto stats = queue.StopAndGetStatistics();
+    std::printf(
+      "post -> resume throughput: %.2fM/s (%zu posts, %llu waits)\n",
+      Posts / std::chrono::duration<double>(elapsed).count() / 1e6,
+      Posts,
+      static_cast<unsigned long long>(stats.mWaits));
+    ok = ok && stats.mPosted == Posts && stats.mResumed == Posts;
+  }
+
+  constexpr std::size_t RoundTripsPerRun = 200'000;
+  for (const std::size_t threads: {1, 4}) {
+    for (const std::size_t chains: {1, 256}) {
+      ThreadPool pool(threads);
+      QueueThread origin;
+      std::latch done(static_cast<std::ptrdiff_t>(chains));
+      const auto start = Clock::now();
+      for (std::size_t i = 0; i < chains; ++i) {
+        RoundTrips(origin, pool, RoundTripsPerRun / chains, counters, done);
+      }
+      done.wait();
+      const auto elapsed = Clock::now() - start;
+      const auto count = (RoundTripsPerRun / chains) * chains;
+      std::printf(
+        "pool round trips, %zu threads, %zu chains: %.0fns each, %.2fM/s\n",
+        threads,
+        chains,
+        Nanoseconds(elapsed) / count,
+        count / std::chrono::duration<double>(elapsed).count() / 1e6);
+      const auto stats = origin.StopAndGetStatistics();
+      ok = ok && stats.mResumed == count + chains;
+    }
+  }
+
+  if (!(ok && counters.mWrongThread == 0)) {
+    std::fprintf(stderr, "FAILED\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/UniformGridIndex.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <random>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Rect = UniformGridIndex::Rect;
+
+std::optional<std::size_t>
+LinearHitTest(const std::vector<Rect>& rects, float x, float y) {
+  for (std::size_t i = 0; i < rects.size(); ++i) {
+    const auto& r = rects[i];
+    if (x >= r.mLeft && x <= r.mRight && y >= r.mTop && y <= r.mBottom) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+/// Lines of link-sized rectangles, like a dense PDF index page
+std::vector<Rect> MakeLinks(std::size_t count) {
+  constexpr std::size_t PerLine = 8;
+  std::vector<Rect> ret;
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto left = static_cast<float>((i % PerLine) * 100);
+    const auto top = static_cast<float>((i / PerLine) * 12);
+    ret.push_back({left, top, left + 90, top + 10});
+  }
+  return ret;
+}
+
+}// namespace
+
+/** Cursor hit-testing cost with and without the grid.
+ *
+ * Exits with a non-zero status if the grid ever disagrees with a linear
+ * scan.
+ */
+int main() {
+  constexpr std::size_t Probes = 200'000;
+
+  bool ok = true;
+  for (const std::size_t count: {8, 64, 512, 4096}) {
+    const auto rects = MakeLinks(count);
+    const UniformGridIndex index {rects};
+
+    std::mt19937 random(static_cast<unsigned>(count));
+    std::uniform_real_distribution<float> xs(0, 800);
+    std::uniform_real_distribution<float> ys(0, rects.back().mBottom);
+    std::vector<std::pair<float, float>> probes;
+    for (std::size_t i = 0; i < Probes; ++i) {
+      probes.push_back({xs(random), ys(random)});
+    }
+
+    using clock = std::chrono::steady_clock;
+    std::vector<std::optional<std::size_t>> gridHits;
+    gridHits.reserve(Probes);
+    const auto gridStart = clock::now();
+    for (const auto& [x, y]: probes) {
+      gridHits.push_back(index.HitTest(x, y));
+    }
+    const auto gridTime = clock::now() - gridStart;
+
+    std::vector<std::optional<std::size_t>> linearHits;
+    linearHits.reserve(Probes);
+    const auto linearStart = clock::now();
+    for (const auto& [x, y]: probes) {
+      linearHits.push_back(LinearHitTest(rects, x, y));
+    }
+    const auto linearTime = clock::now() - linearStart;
+
+    const auto ns = [](auto duration) {
+      return std::chrono::duration<double, std::nano>(duration).count()
+        / Probes;
+    };
+    std::printf(
+      "%zu rects, %zu cells: grid %.1fns, linear %.1fns per hit test\n",
+      count,
+      index.GetCellCount(),
+      ns(gridTime),
+      ns(linearTime));
+
+    if (gridHits != linearHits) {
+      ok = false;
+    }
+  }
+
+  if (!ok) {
+    std::fprintf(stderr, "FAILED\n");
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/TaskExecutor.hpp>
+
+#include <OpenKneeboard/task/when_all.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+/// A folder of files, each of which needs some blocking I/O to open
+struct Folder {
+  std::size_t mFileCount {};
+  std::chrono::microseconds mOpenTime {};
+};
+
+struct Load {
+  ThreadPool& mPool;
+  Folder mFolder;
+  Clock::time_point mStart {Clock::now()};
+
+  std::size_t mPublished {};
+  Milliseconds mFirst {};
+  Milliseconds mAll {};
+
+  /// Like a file delegate: I/O on a pool thread, then publish it here
+  task<void> CreateDelegate() {
+    co_await mPool.schedule();
+    std::this_thread::sleep_for(mFolder.mOpenTime);
+  }
+
+  void Publish() {
+    if (mPublished++ == 0) {
+      mFirst = Clock::now() - mStart;
+    }
+  }
+
+  /// The old behavior: one at a time, published once they're all ready
+  task<void> Sequential() {
+    for (std::size_t i = 0; i < mFolder.mFileCount; ++i) {
+      co_await this->CreateDelegate();
+    }
+    for (std::size_t i = 0; i < mFolder.mFileCount; ++i) {
+      this->Publish();
+    }
+  }
+
+  /// The new behavior: several at a time, each published when ready
+
+  task<void> Parallel(std::size_t concurrency) {
+    std::vector<std::size_t> files;
+    for (std::size_t i = 0; i < mFolder.mFileCount; ++i) {
+      files.push_back(i);
+    }
+    co_await parallel_for_each(
+      concurrency, std::move(files), [this](std::size_t) -> task<void> {
+        co_await this->CreateDelegate();
+        this->Publish();
+      });
+  }
+};
+
+/** Run a load on a `RunQueue` on this thread, as the tab's owner would.
+ *
+ * `task<>` resumes on the thread that created it, so delegates are
+ * published on this thread.
+ */
+template <class F>
+void Run(Load& load, F body) {
+  const auto queue = RunQueue::Create();
+  const RunQueue::ThreadScope scope(queue);
+
+  [](Load& load, F body, RunQueue& queue) -> fire_and_forget {
+    co_await body(load);
+    load.mAll = Clock::now() - load.mStart;
+    queue.Stop();
+  }(load, std::move(body), *queue);
+  queue->Run();
+}
+
+}// namespace
+
+/** Loading a folder tab, as `FolderPageSource` did and now does.
+ *
+ * Each delegate sleeps on a pool thread to stand in for opening and parsing
+ * its file, then resumes on the loading thread to be published. Reports time
+ * until the first delegate is visible, and until all of them are.
+ *
+ * Exits with a non-zero status if any delegates are missed.
+ */
+int main() {
+  constexpr std::size_t Concurrency = 8;
+
+  ThreadPool pool {Concurrency};
+  bool ok = true;
+  for (const auto folder: {
+         Folder {100, std::chrono::microseconds {1000}},
+         Folder {500, std::chrono::microseconds {200}},
+       }) {
+    Load sequential {pool, folder};
+    Run(sequential, [](Load& load) { return load.Sequential(); });
+    Load parallel {pool, folder};
+    Run(parallel, [](Load& load) { return load.Parallel(Concurrency); });
+
+    std::printf(
+      "%zu files x %lldus: sequential %.1fms to first, %.1fms to all; "
+      "%zu at a time %.1fms to first, %.1fms to all\n",
+      folder.mFileCount,
+      static_cast<long long>(folder.mOpenTime.count()),
+      sequential.mFirst.count(),
+      sequential.mAll.count(),
+      Concurrency,
+      parallel.mFirst.count(),
+      parallel.mAll.count());
+    ok = ok && (sequential.mPublished == folder.mFileCount)
+      && (parallel.mPublished == folder.mFileCount);
+  }
+
+  if (!ok) {
+    std::fprintf(stderr, "FAILED\n");
+    return 1;
+  }
+  return 0;
+}
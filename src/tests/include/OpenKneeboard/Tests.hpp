@@ -0,0 +1,73 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <source_location>
+#include <string_view>
+
+/** Minimal test harness.
+ *
+ * Each test executable registers cases with `TEST_CASE()`, and links
+ * `OpenKneeboard-Tests` for `main()`. `CHECK()` records a failure and
+ * carries on; `REQUIRE()` also abandons the current case.
+ */
+namespace OpenKneeboard::Tests {
+
+void Register(std::string_view name, void (*body)());
+
+void Check(
+  bool passed,
+  std::string_view expression,
+  const std::source_location&);
+void Require(
+  bool passed,
+  std::string_view expression,
+  const std::source_location&);
+
+struct Registration {
+  Registration(std::string_view name, void (*body)()) {
+    Register(name, body);
+  }
+};
+
+}// namespace OpenKneeboard::Tests
+
+#define OPENKNEEBOARD_TESTS_CONCAT_IMPL(a, b) a##b
+#define OPENKNEEBOARD_TESTS_CONCAT(a, b) OPENKNEEBOARD_TESTS_CONCAT_IMPL(a, b)
+#define OPENKNEEBOARD_TEST_CASE_IMPL(NAME, BODY) \
+  static void BODY(); \
+  static const ::OpenKneeboard::Tests::Registration \
+    OPENKNEEBOARD_TESTS_CONCAT(BODY, _Registration) {NAME, &BODY}; \
+  static void BODY()
+
+#define TEST_CASE(NAME) \
+  OPENKNEEBOARD_TEST_CASE_IMPL( \
+    NAME, OPENKNEEBOARD_TESTS_CONCAT(TestCase_, __LINE__))
+
+#define CHECK(...) \
+  ::OpenKneeboard::Tests::Check( \
+    static_cast<bool>(__VA_ARGS__), \
+    #__VA_ARGS__, \
+    std::source_location::current())
+#define REQUIRE(...) \
+  ::OpenKneeboard::Tests::Require( \
+    static_cast<bool>(__VA_ARGS__), \
+    #__VA_ARGS__, \
+    std::source_location::current())
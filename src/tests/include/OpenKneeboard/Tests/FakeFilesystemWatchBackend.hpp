@@ -0,0 +1,109 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/FilesystemWatchService.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace OpenKneeboard::Tests {
+
+/** Stand-in for the OS watches.
+ *
+ * Nothing is reported unless the test calls `Notify()`, so tests control
+ * exactly which notifications the service sees.
+ */
+class FakeFilesystemWatchBackend final : public FilesystemWatchBackend {
+ public:
+  FakeFilesystemWatchBackend() : mState(std::make_shared<State>()) {
+  }
+
+  [[nodiscard]]
+  std::unique_ptr<Handle> Watch(
+    const std::filesystem::path& directory,
+    bool recursive,
+    std::function<void()> onChanged) override {
+    std::unique_lock lock(mState->mMutex);
+    const auto id = mState->mNextID++;
+    mState->mWatches.push_back({id, directory, recursive, onChanged});
+    return std::make_unique<FakeHandle>(mState, id);
+  }
+
+  /// Report a change in `directory`, as the OS would
+  void Notify(const std::filesystem::path& directory) {
+    std::unique_lock lock(mState->mMutex);
+    for (const auto& watch: mState->mWatches) {
+      if (watch.mDirectory == directory) {
+        watch.mOnChanged();
+        continue;
+      }
+      if (!watch.mRecursive) {
+        continue;
+      }
+      const auto relative = directory.lexically_relative(watch.mDirectory);
+      if (!(relative.empty() || *relative.begin() == "..")) {
+        watch.mOnChanged();
+      }
+    }
+  }
+
+  std::size_t GetWatchCount() const {
+    std::unique_lock lock(mState->mMutex);
+    return mState->mWatches.size();
+  }
+
+ private:
+  struct FakeWatch {
+    uint64_t mID {};
+    std::filesystem::path mDirectory;
+    bool mRecursive {};
+    std::function<void()> mOnChanged;
+  };
+  struct State {
+    // Held while invoking callbacks, so handle destructors wait for them
+    mutable std::mutex mMutex;
+    uint64_t mNextID {1};
+    std::vector<FakeWatch> mWatches;
+  };
+
+  class FakeHandle final : public Handle {
+   public:
+    FakeHandle(std::shared_ptr<State> state, uint64_t id)
+      : mState(std::move(state)), mID(id) {
+    }
+
+    ~FakeHandle() override {
+      std::unique_lock lock(mState->mMutex);
+      std::erase_if(
+        mState->mWatches, [id = mID](const auto& it) { return it.mID == id; });
+    }
+
+   private:
+    std::shared_ptr<State> mState;
+    uint64_t mID {};
+  };
+
+  // Shared with handles, which may outlive the backend
+  std::shared_ptr<State> mState;
+};
+
+}// namespace OpenKneeboard::Tests
@@ -0,0 +1,385 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/BookmarkIndex.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using TabID = BookmarkIndex::TabID;
+
+struct Tab {
+  TabID mID;
+  std::vector<PageID> mPages;
+  std::vector<Bookmark> mBookmarks;
+
+  Bookmark AddBookmark(std::size_t page) {
+    mBookmarks.push_back({mID, mPages.at(page), std::to_string(page)});
+    return mBookmarks.back();
+  }
+};
+
+Tab MakeTab(std::size_t pageCount) {
+  Tab ret;
+  ret.mPages.resize(pageCount);
+  return ret;
+}
+
+void SetTabs(BookmarkIndex& index, const std::vector<Tab>& tabs) {
+  std::vector<TabID> ids;
+  for (const auto& tab: tabs) {
+    ids.push_back(tab.mID);
+  }
+  index.SetTabs(ids);
+  for (const auto& tab: tabs) {
+    index.SetTabBookmarks(tab.mID, tab.mPages, tab.mBookmarks);
+  }
+}
+
+/** The straightforward version: walk every tab's pages in order.
+ *
+ * Bookmarks for pages that aren't in the tab are ignored; if there are
+ * several for a page, the last one is used.
+ */
+struct LinearScan {
+  struct Entry {
+    std::size_t mTab {};
+    std::size_t mPage {};
+    Bookmark mBookmark;
+  };
+  std::vector<Entry> mEntries;
+
+  const std::vector<Tab>& mTabs;
+
+  LinearScan(const std::vector<Tab>& tabs) : mTabs(tabs) {
+    for (std::size_t tab = 0; tab < tabs.size(); ++tab) {
+      const auto& pages = tabs.at(tab).mPages;
+      const auto& bookmarks = tabs.at(tab).mBookmarks;
+      for (std::size_t page = 0; page < pages.size(); ++page) {
+        const auto it = std::ranges::find(
+          bookmarks.rbegin(), bookmarks.rend(), pages.at(page),
+          &Bookmark::mPageID);
+        if (it != bookmarks.rend()) {
+          mEntries.push_back({tab, page, *it});
+        }
+      }
+    }
+  }
+
+  std::vector<Bookmark> GetBookmarks() const {
+    std::vector<Bookmark> ret;
+    for (const auto& entry: mEntries) {
+      ret.push_back(entry.mBookmark);
+    }
+    return ret;
+  }
+
+  /// `std::nullopt` page index means the whole tab
+  struct Position {
+    std::size_t mTab {};
+    std::optional<std::size_t> mPage;
+  };
+
+  std::optional<Position> Find(TabID tabID, std::optional<PageID> page)
+    const {
+    const auto tab = std::ranges::find(mTabs, tabID, &Tab::mID);
+    if (tab == mTabs.end()) {
+      return std::nullopt;
+    }
+    Position ret {static_cast<std::size_t>(tab - mTabs.begin())};
+    if (!page) {
+      return ret;
+    }
+    const auto it = std::ranges::find(tab->mPages, *page);
+    if (!*page || it == tab->mPages.end()) {
+      return std::nullopt;
+    }
+    ret.mPage = static_cast<std::size_t>(it - tab->mPages.begin());
+    return ret;
+  }
+
+  std::optional<Bookmark> GetPrevious(
+    TabID tabID,
+    std::optional<PageID> page) const {
+    const auto position = this->Find(tabID, page);
+    if (!position) {
+      return std::nullopt;
+    }
+    std::optional<Bookmark> ret;
+    for (const auto& entry: mEntries) {
+      const bool before = (entry.mTab < position->mTab)
+        || (entry.mTab == position->mTab && position->mPage
+            && entry.mPage < *position->mPage);
+      if (before) {
+        ret = entry.mBookmark;
+      }
+    }
+    return ret;
+  }
+
+  std::optional<Bookmark> GetNext(TabID tabID, std::optional<PageID> page)
+    const {
+    const auto position = this->Find(tabID, page);
+    if (!position) {
+      return std::nullopt;
+    }
+    for (const auto& entry: mEntries) {
+      const bool after = (entry.mTab > position->mTab)
+        || (entry.mTab == position->mTab && position->mPage
+            && entry.mPage > *position->mPage);
+      if (after) {
+        return entry.mBookmark;
+      }
+    }
+    return std::nullopt;
+  }
+};
+
+}// namespace
+
+TEST_CASE("bookmarks are ordered by tab, then page") {
+  std::vector<Tab> tabs {MakeTab(3), MakeTab(2)};
+  const auto b1 = tabs.at(1).AddBookmark(1);
+  const auto a2 = tabs.at(0).AddBookmark(2);
+  const auto a0 = tabs.at(0).AddBookmark(0);
+  // Not a page in the tab, e.g. it was just removed
+  tabs.at(0).mBookmarks.push_back({tabs.at(0).mID, PageID {}, "removed"});
+
+  BookmarkIndex index;
+  SetTabs(index, tabs);
+  CHECK(*index.GetBookmarks() == std::vector {a0, a2, b1});
+}
+
+TEST_CASE("previous and next cross tabs") {
+  std::vector<Tab> tabs {MakeTab(3), MakeTab(2), MakeTab(2)};
+  const auto a1 = tabs.at(0).AddBookmark(1);
+  const auto c0 = tabs.at(2).AddBookmark(0);
+
+  BookmarkIndex index;
+  SetTabs(index, tabs);
+
+  const auto& a = tabs.at(0);
+  CHECK(!index.GetPrevious(a.mID, a.mPages.at(0)));
+  CHECK(index.GetNext(a.mID, a.mPages.at(0)) == a1);
+  // The current page's own bookmark is neither previous nor next
+  CHECK(!index.GetPrevious(a.mID, a.mPages.at(1)));
+  CHECK(index.GetNext(a.mID, a.mPages.at(1)) == c0);
+  CHECK(index.GetPrevious(a.mID, a.mPages.at(2)) == a1);
+
+  // A tab without any bookmarks
+  const auto& b = tabs.at(1);
+  CHECK(index.GetPrevious(b.mID, b.mPages.at(0)) == a1);
+  CHECK(index.GetNext(b.mID, b.mPages.at(1)) == c0);
+
+  const auto& c = tabs.at(2);
+  CHECK(index.GetPrevious(c.mID, c.mPages.at(1)) == c0);
+  CHECK(!index.GetNext(c.mID, c.mPages.at(0)));
+}
+
+TEST_CASE("a tab showing a sub-tab skips its own bookmarks") {
+  std::vector<Tab> tabs {MakeTab(2), MakeTab(3), MakeTab(2)};
+  const auto a0 = tabs.at(0).AddBookmark(0);
+  tabs.at(1).AddBookmark(0);
+  tabs.at(1).AddBookmark(2);
+  const auto c1 = tabs.at(2).AddBookmark(1);
+
+  BookmarkIndex index;
+  SetTabs(index, tabs);
+
+  const auto b = tabs.at(1).mID;
+  CHECK(index.GetPrevious(b, std::nullopt) == a0);
+  CHECK(index.GetNext(b, std::nullopt) == c1);
+  CHECK(!index.GetPrevious(tabs.at(0).mID, std::nullopt));
+  CHECK(!index.GetNext(tabs.at(2).mID, std::nullopt));
+}
+
+TEST_CASE("unknown tabs and pages find nothing") {
+  std::vector<Tab> tabs {MakeTab(2), MakeTab(2)};
+  tabs.at(0).AddBookmark(0);
+  tabs.at(1).AddBookmark(1);
+
+  BookmarkIndex index;
+  SetTabs(index, tabs);
+
+  const auto a = tabs.at(0).mID;
+  CHECK(!index.GetNext(a, PageID {}));
+  CHECK(!index.GetNext(a, PageID {nullptr}));
+  CHECK(!index.GetPrevious(tabs.at(1).mID, PageID {}));
+  // A page from another tab
+  CHECK(!index.GetNext(a, tabs.at(1).mPages.at(0)));
+
+  const TabID unknown;
+  CHECK(!index.GetNext(unknown, std::nullopt));
+  CHECK(!index.GetPrevious(unknown, std::nullopt));
+  CHECK(!index.SetTabBookmarks(unknown, {}, {}));
+}
+
+TEST_CASE("reordering tabs and pages reorders bookmarks") {
+  std::vector<Tab> tabs {MakeTab(3), MakeTab(1)};
+  const auto a0 = tabs.at(0).AddBookmark(0);
+  const auto a2 = tabs.at(0).AddBookmark(2);
+  const auto b0 = tabs.at(1).AddBookmark(0);
+
+  BookmarkIndex index;
+  SetTabs(index, tabs);
+  CHECK(*index.GetBookmarks() == std::vector {a0, a2, b0});
+
+  auto& a = tabs.at(0);
+  std::ranges::reverse(a.mPages);
+  CHECK(index.SetTabBookmarks(a.mID, a.mPages, a.mBookmarks));
+  CHECK(*index.GetBookmarks() == std::vector {a2, a0, b0});
+  CHECK(index.GetNext(a.mID, a.mPages.at(1)) == a0);
+  // Unchanged
+  CHECK(!index.SetTabBookmarks(a.mID, a.mPages, a.mBookmarks));
+
+  const std::vector reversed {tabs.at(1).mID, tabs.at(0).mID};
+  CHECK(index.SetTabs(reversed));
+  CHECK(*index.GetBookmarks() == std::vector {b0, a2, a0});
+  CHECK(index.GetPrevious(a.mID, a.mPages.at(0)) == b0);
+  CHECK(!index.SetTabs(reversed));
+
+  // Removing a tab removes its bookmarks; re-adding it needs its bookmarks
+  // to be set again
+  CHECK(index.SetTabs(std::vector {a.mID}));
+  CHECK(*index.GetBookmarks() == std::vector {a2, a0});
+  CHECK(!index.SetTabs(reversed));
+  CHECK(*index.GetBookmarks() == std::vector {a2, a0});
+  const auto& b = tabs.at(1);
+  CHECK(index.SetTabBookmarks(b.mID, b.mPages, b.mBookmarks));
+  CHECK(*index.GetBookmarks() == std::vector {b0, a2, a0});
+}
+
+TEST_CASE("randomized changes match a linear scan") {
+  std::mt19937 random(1);
+  const auto pick = [&random](std::size_t count) {
+    return std::uniform_int_distribution<std::size_t>(0, count - 1)(random);
+  };
+
+  std::size_t mismatches {};
+  std::size_t comparisons {};
+  for (int run = 0; run < 50; ++run) {
+    std::vector<Tab> tabs;
+    BookmarkIndex index;
+    const auto setTabs = [&] {
+      std::vector<TabID> ids;
+      for (const auto& tab: tabs) {
+        ids.push_back(tab.mID);
+      }
+      index.SetTabs(ids);
+    };
+    const auto setTab = [&](const Tab& tab) {
+      index.SetTabBookmarks(tab.mID, tab.mPages, tab.mBookmarks);
+    };
+
+    for (int step = 0; step < 100; ++step) {
+      switch (pick(6)) {
+        case 0: {
+          // New tabs have no bookmarks in the index until they're set
+          auto it = tabs.insert(
+            tabs.begin() + pick(tabs.size() + 1), MakeTab(pick(6)));
+          setTabs();
+          setTab(*it);
+          break;
+        }
+        case 1:
+          if (!tabs.empty()) {
+            tabs.erase(tabs.begin() + pick(tabs.size()));
+            setTabs();
+          }
+          break;
+        case 2:
+          if (tabs.size() > 1) {
+            std::swap(tabs.at(pick(tabs.size())), tabs.at(pick(tabs.size())));
+            setTabs();
+          }
+          break;
+        case 3:
+        case 4: {
+          // Toggle a bookmark
+          if (tabs.empty()) {
+            break;
+          }
+          auto& tab = tabs.at(pick(tabs.size()));
+          if (tab.mPages.empty()) {
+            break;
+          }
+          const auto page = pick(tab.mPages.size());
+          const auto it = std::ranges::find(
+            tab.mBookmarks, tab.mPages.at(page), &Bookmark::mPageID);
+          if (it == tab.mBookmarks.end()) {
+            tab.AddBookmark(page);
+          } else {
+            tab.mBookmarks.erase(it);
+          }
+          setTab(tab);
+          break;
+        }
+        case 5: {
+          // Reorder, add, and remove pages; bookmarks for removed pages stay
+          // until the tab cleans them up
+          if (tabs.empty()) {
+            break;
+          }
+          auto& tab = tabs.at(pick(tabs.size()));
+          std::ranges::shuffle(tab.mPages, random);
+          if (pick(2)) {
+            tab.mPages.emplace_back();
+          }
+          if (!tab.mPages.empty() && pick(3) == 0) {
+            tab.mPages.erase(tab.mPages.begin() + pick(tab.mPages.size()));
+          }
+          setTab(tab);
+          break;
+        }
+      }
+
+      const LinearScan expected(tabs);
+      ++comparisons;
+      if (*index.GetBookmarks() != expected.GetBookmarks()) {
+        ++mismatches;
+      }
+      for (const auto& tab: tabs) {
+        std::vector<std::optional<PageID>> positions {
+          tab.mPages.begin(), tab.mPages.end()};
+        positions.push_back(std::nullopt);
+        positions.push_back(PageID {});
+        for (const auto& page: positions) {
+          comparisons += 2;
+          if (index.GetPrevious(tab.mID, page)
+              != expected.GetPrevious(tab.mID, page)) {
+            ++mismatches;
+          }
+          if (index.GetNext(tab.mID, page) != expected.GetNext(tab.mID, page)) {
+            ++mismatches;
+          }
+        }
+      }
+    }
+  }
+  CHECK(comparisons > 10000);
+  CHECK(mismatches == 0);
+}
@@ -0,0 +1,242 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CacheFile.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+constexpr uint32_t Magic = 0x54534554;// 'TEST'
+constexpr uint32_t Version = 3;
+
+// Header layout: magic, version, payload size, then the checksum
+constexpr std::size_t VersionOffset = 4;
+constexpr std::size_t PayloadSizeOffset = 8;
+constexpr std::size_t HeaderSize = 56;
+
+std::span<const std::byte> AsBytes(std::string_view value) {
+  return std::as_bytes(std::span {value.data(), value.size()});
+}
+
+struct Fixture {
+  Fixture() {
+    std::random_device random;
+    mRoot = std::filesystem::temp_directory_path()
+      / ("OpenKneeboard-test-CacheFile-" + std::to_string(random()));
+    mPath = mRoot / "entry.bin";
+  }
+
+  ~Fixture() {
+    std::error_code ec;
+    std::filesystem::remove_all(mRoot, ec);
+  }
+
+  std::optional<std::vector<std::byte>> Load(
+    uint32_t magic = Magic,
+    uint32_t version = Version) const {
+    return CacheFile::Load(mPath, magic, version);
+  }
+
+  bool Save(std::string_view payload) const {
+    return CacheFile::Save(mPath, Magic, Version, AsBytes(payload));
+  }
+
+  std::string ReadRaw() const {
+    std::ifstream f(mPath, std::ios::binary);
+    return {std::istreambuf_iterator<char>(f), {}};
+  }
+
+  void WriteRaw(std::string_view content) const {
+    std::ofstream(mPath, std::ios::binary | std::ios::trunc) << content;
+  }
+
+  std::filesystem::path mRoot;
+  std::filesystem::path mPath;
+};
+
+bool Matches(
+  const std::optional<std::vector<std::byte>>& loaded,
+  std::string_view expected) {
+  return loaded && std::ranges::equal(*loaded, AsBytes(expected));
+}
+
+}// namespace
+
+TEST_CASE("round trip") {
+  Fixture f;
+  CHECK(!f.Load());
+  REQUIRE(f.Save("hello world"));
+  CHECK(Matches(f.Load(), "hello world"));
+  CHECK(f.ReadRaw().size() == HeaderSize + 11);
+
+  // Replaced, not appended
+  REQUIRE(f.Save("bye"));
+  CHECK(Matches(f.Load(), "bye"));
+
+  REQUIRE(f.Save({}));
+  CHECK(Matches(f.Load(), {}));
+
+  // No temporary files are left behind
+  CHECK(
+    std::distance(
+      std::filesystem::directory_iterator(f.mRoot),
+      std::filesystem::directory_iterator {})
+    == 1);
+}
+
+TEST_CASE("other versions and magic numbers are misses, and deleted") {
+  Fixture f;
+  REQUIRE(f.Save("payload"));
+  CHECK(!f.Load(Magic, Version + 1));
+  CHECK(!std::filesystem::exists(f.mPath));
+
+  REQUIRE(f.Save("payload"));
+  CHECK(!f.Load(Magic + 1, Version));
+  CHECK(!std::filesystem::exists(f.mPath));
+
+  // Also check the version is read from where it's written
+  REQUIRE(f.Save("payload"));
+  auto raw = f.ReadRaw();
+  ++raw.at(VersionOffset);
+  f.WriteRaw(raw);
+  CHECK(!f.Load());
+  CHECK(!std::filesystem::exists(f.mPath));
+}
+
+TEST_CASE("corrupt payloads fail the checksum, and are deleted") {
+  Fixture f;
+  REQUIRE(f.Save("payload"));
+  auto raw = f.ReadRaw();
+  raw.back() ^= 0x01;
+  f.WriteRaw(raw);
+  CHECK(!f.Load());
+  CHECK(!std::filesystem::exists(f.mPath));
+}
+
+TEST_CASE("corrupt checksums are detected") {
+  Fixture f;
+  REQUIRE(f.Save("payload"));
+  auto raw = f.ReadRaw();
+  raw.at(HeaderSize - 1) ^= 0x01;
+  f.WriteRaw(raw);
+  CHECK(!f.Load());
+  CHECK(!std::filesystem::exists(f.mPath));
+}
+
+TEST_CASE("truncated files are misses, and deleted") {
+  Fixture f;
+  REQUIRE(f.Save("payload"));
+  const auto raw = f.ReadRaw();
+  // Every possible truncation, including mid-header
+  for (std::size_t size = 0; size < raw.size(); ++size) {
+    f.WriteRaw(std::string_view {raw}.substr(0, size));
+    CHECK(!f.Load());
+    CHECK(!std::filesystem::exists(f.mPath));
+  }
+}
+
+TEST_CASE("trailing data is corruption") {
+  Fixture f;
+  REQUIRE(f.Save("payload"));
+  f.WriteRaw(f.ReadRaw() + "x");
+  CHECK(!f.Load());
+  CHECK(!std::filesystem::exists(f.mPath));
+}
+
+TEST_CASE("absurd payload sizes are rejected without allocating") {
+  Fixture f;
+  REQUIRE(f.Save("payload"));
+  auto raw = f.ReadRaw();
+  const uint64_t huge = 1ull << 62;
+  raw.replace(
+    PayloadSizeOffset,
+    sizeof(huge),
+    reinterpret_cast<const char*>(&huge),
+    sizeof(huge));
+  f.WriteRaw(raw);
+  CHECK(!f.Load());
+  CHECK(!std::filesystem::exists(f.mPath));
+}
+
+TEST_CASE("readers are bounds-checked") {
+  CacheFile::Writer w;
+  w.Write<uint32_t>(123);
+  w.Write(std::string_view {"abc"});
+  const auto buffer = w.GetBuffer();
+
+  {
+    CacheFile::Reader r(buffer);
+    uint32_t value {};
+    std::string text;
+    CHECK(r.Read(value));
+    CHECK(value == 123);
+    CHECK(r.Read(text));
+    CHECK(text == "abc");
+    CHECK(r.IsAtEnd());
+  }
+
+  {
+    CacheFile::Reader r(buffer.first(buffer.size() - 1));
+    uint32_t value {};
+    std::string text;
+    CHECK(r.Read(value));
+    CHECK(!r.Read(text));
+    // Failures are sticky
+    CHECK(!r.Read(value));
+    CHECK(!r.IsAtEnd());
+  }
+
+  {
+    // A count of 123 elements can't fit in the remaining 7 bytes
+    CacheFile::Reader r(buffer);
+    uint32_t count {};
+    CHECK(!r.ReadCount(count, 1));
+  }
+}
+
+TEST_CASE("pruning keeps the newest files") {
+  Fixture f;
+  const auto now = std::filesystem::file_time_type::clock::now();
+  for (int i = 0; i < 5; ++i) {
+    const auto path = f.mRoot / std::format("{}.bin", i);
+    REQUIRE(CacheFile::Save(path, Magic, Version, AsBytes("0123456789")));
+    std::filesystem::last_write_time(path, now - std::chrono::minutes(i));
+  }
+  std::ofstream(f.mRoot / "other.txt") << "not a cache file";
+
+  CacheFile::Prune(f.mRoot, 3);
+  CHECK(std::filesystem::exists(f.mRoot / "2.bin"));
+  CHECK(!std::filesystem::exists(f.mRoot / "3.bin"));
+  CHECK(std::filesystem::exists(f.mRoot / "other.txt"));
+
+  CacheFile::Prune(f.mRoot, 3, 2 * (HeaderSize + 10));
+  CHECK(std::filesystem::exists(f.mRoot / "1.bin"));
+  CHECK(!std::filesystem::exists(f.mRoot / "2.bin"));
+}
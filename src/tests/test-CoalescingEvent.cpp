@@ -0,0 +1,236 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/Events.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <functional>
+#include <future>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+using winrt::Windows::System::DispatcherQueueController;
+
+namespace {
+
+struct Receiver final : EventReceiver {
+  using EventReceiver::AddEventListener;
+
+  ~Receiver() override {
+    this->RemoveAllEventListeners();
+  }
+};
+
+/** Run `fn` on a thread with a COM apartment and a message loop, like the
+ * UI thread, and wait for it.
+ *
+ * While `fn` runs, the flush timer can't run on the same thread, so events
+ * are only delivered by explicit flushes. The thread is shared by all tests,
+ * so timers armed by one test can never outlive it.
+ */
+void RunOnUIThread(const std::function<void()>& fn) {
+  static const auto sController
+    = DispatcherQueueController::CreateOnDedicatedThread();
+
+  std::promise<void> done;
+  const bool queued = sController.DispatcherQueue().TryEnqueue([&] {
+    fn();
+    done.set_value();
+  });
+  REQUIRE(queued);
+  done.get_future().wait();
+}
+
+}// namespace
+
+TEST_CASE("repeated emits are delivered once, at the next flush") {
+  std::vector<std::size_t> deliveredAfterFlush;
+  std::size_t deliveredBeforeFlush {};
+
+  RunOnUIThread([&] {
+    CoalescingEvent<> event;
+    Receiver receiver;
+    std::size_t delivered {};
+    receiver.AddEventListener(event, [&delivered] { ++delivered; });
+
+    for (int i = 0; i < 5; ++i) {
+      event.Emit();
+    }
+    deliveredBeforeFlush = delivered;
+    CoalescingEventBase::FlushForCurrentThread();
+    deliveredAfterFlush.push_back(delivered);
+    // Nothing new is pending
+    CoalescingEventBase::FlushForCurrentThread();
+    deliveredAfterFlush.push_back(delivered);
+
+    event.Emit();
+    CoalescingEventBase::FlushForCurrentThread();
+    deliveredAfterFlush.push_back(delivered);
+  });
+
+  CHECK(deliveredBeforeFlush == 0);
+  CHECK(deliveredAfterFlush == std::vector<std::size_t> {1, 1, 2});
+}
+
+TEST_CASE("payloads with merge() are combined") {
+  std::vector<std::unordered_set<int>> delivered;
+
+  RunOnUIThread([&] {
+    CoalescingEvent<std::unordered_set<int>> event;
+    Receiver receiver;
+    receiver.AddEventListener(
+      event,
+      [&delivered](std::unordered_set<int> ids) { delivered.push_back(ids); });
+
+    event.Emit({1, 2});
+    event.Emit({2, 3});
+    event.Emit({});
+    event.Emit({4});
+    CoalescingEventBase::FlushForCurrentThread();
+
+    // Merging starts again after delivery
+    event.Emit({5});
+    CoalescingEventBase::FlushForCurrentThread();
+  });
+
+  REQUIRE(delivered.size() == 2);
+  CHECK(delivered.at(0) == std::unordered_set {1, 2, 3, 4});
+  CHECK(delivered.at(1) == std::unordered_set {5});
+}
+
+TEST_CASE("other payloads are replaced by the latest value") {
+  std::vector<std::string> delivered;
+
+  RunOnUIThread([&] {
+    CoalescingEvent<std::string> event;
+    Receiver receiver;
+    receiver.AddEventListener(
+      event, [&delivered](std::string value) { delivered.push_back(value); });
+
+    event.Emit("first");
+    event.Emit("second");
+    event.Emit("third");
+    CoalescingEventBase::FlushForCurrentThread();
+  });
+
+  CHECK(delivered == std::vector<std::string> {"third"});
+}
+
+TEST_CASE("events are delivered in the order they were first emitted") {
+  std::vector<char> delivered;
+
+  RunOnUIThread([&] {
+    CoalescingEvent<> a;
+    CoalescingEvent<> b;
+    CoalescingEvent<> c;
+    Receiver receiver;
+    receiver.AddEventListener(a, [&delivered] { delivered.push_back('a'); });
+    receiver.AddEventListener(b, [&delivered] { delivered.push_back('b'); });
+    receiver.AddEventListener(c, [&delivered] { delivered.push_back('c'); });
+
+    b.Emit();
+    a.Emit();
+    b.Emit();
+    c.Emit();
+    a.Emit();
+    CoalescingEventBase::FlushForCurrentThread();
+
+    // A new frame, a new order
+    c.Emit();
+    a.Emit();
+    CoalescingEventBase::FlushForCurrentThread();
+  });
+
+  CHECK(delivered == std::vector {'b', 'a', 'c', 'c', 'a'});
+}
+
+TEST_CASE("chains of forwarded events settle within one flush") {
+  std::size_t delivered {};
+
+  RunOnUIThread([&] {
+    Event<> source;
+    CoalescingEvent<> first;
+    CoalescingEvent<> second;
+    Receiver receiver;
+    receiver.AddEventListener(source, first);
+    receiver.AddEventListener(first, second);
+    receiver.AddEventListener(second, [&delivered] { ++delivered; });
+
+    source.Emit();
+    source.Emit();
+    CoalescingEventBase::FlushForCurrentThread();
+  });
+
+  CHECK(delivered == 1);
+}
+
+TEST_CASE("taking a pending emit cancels its delivery") {
+  std::optional<std::tuple<int>> taken;
+  bool takenAgain {true};
+  std::vector<int> delivered;
+
+  RunOnUIThread([&] {
+    CoalescingEvent<int> event;
+    Receiver receiver;
+    receiver.AddEventListener(
+      event, [&delivered](int value) { delivered.push_back(value); });
+
+    event.Emit(1);
+    event.Emit(2);
+    taken = event.TakePending();
+    takenAgain = event.TakePending().has_value();
+    CoalescingEventBase::FlushForCurrentThread();
+
+    // Later emits are delivered as usual
+    event.Emit(3);
+    CoalescingEventBase::FlushForCurrentThread();
+  });
+
+  REQUIRE(taken.has_value());
+  CHECK(std::get<0>(*taken) == 2);
+  CHECK(!takenAgain);
+  CHECK(delivered == std::vector {3});
+}
+
+TEST_CASE("IsPending() is true until an emit is delivered or taken") {
+  std::vector<bool> pending;
+
+  RunOnUIThread([&] {
+    CoalescingEvent<> event;
+    Receiver receiver;
+    receiver.AddEventListener(event, [] {});
+
+    pending.push_back(event.IsPending());
+    event.Emit();
+    pending.push_back(event.IsPending());
+    CoalescingEventBase::FlushForCurrentThread();
+    pending.push_back(event.IsPending());
+
+    event.Emit();
+    (void)event.TakePending();
+    pending.push_back(event.IsPending());
+  });
+
+  CHECK(pending == std::vector {false, true, false, false});
+}
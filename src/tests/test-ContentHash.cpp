@@ -0,0 +1,132 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/ContentHash.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+std::span<const std::byte> AsBytes(std::string_view value) {
+  return std::as_bytes(std::span {value.data(), value.size()});
+}
+
+std::string ToHex(const ContentHash& hash) {
+  const auto str = hash.ToString();
+  return str.substr(0, str.find('-'));
+}
+
+}// namespace
+
+// FIPS 180-2 known answers
+TEST_CASE("SHA-256 of the empty string") {
+  const auto hash = HashContent({});
+  CHECK(
+    ToHex(hash)
+    == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  CHECK(hash.mByteLength == 0);
+  CHECK(hash.ToString() == ToHex(hash) + "-0");
+}
+
+TEST_CASE("SHA-256 of 'abc'") {
+  const auto hash = HashContent(AsBytes("abc"));
+  CHECK(
+    ToHex(hash)
+    == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  CHECK(hash.mByteLength == 3);
+  CHECK(hash.ToString() == ToHex(hash) + "-3");
+}
+
+TEST_CASE("SHA-256 of a million 'a's, in uneven chunks") {
+  const std::string chunk(999, 'a');
+  ContentHasher hasher;
+  std::size_t remaining = 1000000;
+  while (remaining) {
+    const auto count = std::min(remaining, chunk.size());
+    hasher.Update(AsBytes(std::string_view {chunk}.substr(0, count)));
+    remaining -= count;
+  }
+  const auto hash = hasher.Finish();
+  CHECK(
+    ToHex(hash)
+    == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+  CHECK(hash.mByteLength == 1000000);
+}
+
+TEST_CASE("incremental hashing matches one-shot hashing") {
+  std::string data(1000, '\0');
+  std::mt19937 random(1234);
+  for (auto& c: data) {
+    c = static_cast<char>(random());
+  }
+  const auto expected = HashContent(AsBytes(data));
+
+  for (const std::size_t split: {0, 1, 63, 64, 65, 500, 999, 1000}) {
+    ContentHasher hasher;
+    hasher.Update(AsBytes(std::string_view {data}.substr(0, split)));
+    hasher.Update(AsBytes(std::string_view {data}.substr(split)));
+    CHECK(hasher.Finish() == expected);
+  }
+}
+
+TEST_CASE("the length is part of the key") {
+  const auto a = HashContent(AsBytes("abc"));
+  auto b = a;
+  b.mByteLength = 4;
+  CHECK(a != b);
+  CHECK(a.ToString() != b.ToString());
+  CHECK(HashContent(AsBytes("abc")) == a);
+  CHECK(HashContent(AsBytes("abd")) != a);
+}
+
+TEST_CASE("hash file content") {
+  std::random_device random;
+  const auto path = std::filesystem::temp_directory_path()
+    / ("OpenKneeboard-test-ContentHash-" + std::to_string(random()));
+  std::string content(3 * 1024 * 1024 + 17, '\0');
+  for (std::size_t i = 0; i < content.size(); ++i) {
+    content[i] = static_cast<char>(i * 31);
+  }
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+
+  const auto whole = HashFileContent(path);
+  REQUIRE(whole.has_value());
+  CHECK(*whole == HashContent(AsBytes(content)));
+  CHECK(whole->mByteLength == content.size());
+
+  constexpr std::size_t PrefixSize = 1024 * 1024 + 1;
+  const auto prefix = HashFileContent(path, PrefixSize);
+  REQUIRE(prefix.has_value());
+  CHECK(
+    *prefix
+    == HashContent(AsBytes(std::string_view {content}.substr(0, PrefixSize))));
+
+  // Asking for more than there is just hashes the whole file
+  CHECK(HashFileContent(path, content.size() * 2) == whole);
+
+  std::error_code ec;
+  std::filesystem::remove(path, ec);
+  CHECK(!HashFileContent(path).has_value());
+}
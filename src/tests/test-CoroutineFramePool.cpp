@@ -0,0 +1,200 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CoroutineFramePool.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+/// Each thread has its own cache, so run on a new one for a clean slate
+template <class F>
+void OnNewThread(F&& f) {
+  std::jthread(std::forward<F>(f)).join();
+}
+
+void* Allocate(std::size_t size) {
+  auto ret = CoroutineFramePool::Allocate(size, nullptr);
+  // Make sure the whole block is usable
+  std::memset(ret, 0xcd, size);
+  return ret;
+}
+
+}// namespace
+
+TEST_CASE("blocks are reused within a size class") {
+  OnNewThread([] {
+    const auto before = CoroutineFramePool::GetStatistics();
+    auto first = Allocate(100);
+    CoroutineFramePool::Deallocate(first, 100);
+
+    // 65-128 bytes share a size class...
+    auto sameClass = Allocate(128);
+    CHECK(sameClass == first);
+    // ... but 129 doesn't
+    auto otherClass = Allocate(129);
+    CHECK(otherClass != first);
+
+    const auto after = CoroutineFramePool::GetStatistics();
+    CHECK(after.mAllocations - before.mAllocations == 3);
+    CHECK(after.mPoolHits - before.mPoolHits >= 1);
+    CHECK(after.mFramesInFlight - before.mFramesInFlight == 2);
+    CHECK(after.mBytesInFlight - before.mBytesInFlight == 128 + 129);
+
+    CoroutineFramePool::Deallocate(sameClass, 128);
+    CoroutineFramePool::Deallocate(otherClass, 129);
+  });
+}
+
+TEST_CASE("large frames aren't pooled") {
+  OnNewThread([] {
+    constexpr auto Size = CoroutineFramePool::MaxPooledSize + 1;
+    const auto before = CoroutineFramePool::GetStatistics();
+    auto frame = Allocate(Size);
+    CoroutineFramePool::Deallocate(frame, Size);
+    frame = Allocate(Size);
+    CoroutineFramePool::Deallocate(frame, Size);
+
+    const auto after = CoroutineFramePool::GetStatistics();
+    CHECK(after.mAllocations - before.mAllocations == 2);
+    CHECK(after.mLargeAllocations - before.mLargeAllocations == 2);
+    CHECK(after.mPoolHits == before.mPoolHits);
+  });
+}
+
+TEST_CASE("every size class is usable and suitably aligned") {
+  OnNewThread([] {
+    std::vector<std::pair<void*, std::size_t>> frames;
+    for (std::size_t size = 1; size <= CoroutineFramePool::MaxPooledSize;
+         size += 17) {
+      auto frame = Allocate(size);
+      CHECK(
+        reinterpret_cast<uintptr_t>(frame) % __STDCPP_DEFAULT_NEW_ALIGNMENT__
+        == 0);
+      frames.push_back({frame, size});
+    }
+    for (const auto& [frame, size]: frames) {
+      CoroutineFramePool::Deallocate(frame, size);
+    }
+  });
+}
+
+TEST_CASE("frames can be freed on another thread") {
+  constexpr std::size_t Count = 1000;
+  constexpr std::size_t Size = 200;
+
+  const auto before = CoroutineFramePool::GetStatistics();
+  std::vector<void*> frames;
+  OnNewThread([&] {
+    for (std::size_t i = 0; i < Count; ++i) {
+      frames.push_back(Allocate(Size));
+    }
+  });
+  CHECK(
+    CoroutineFramePool::GetStatistics().mFramesInFlight
+      - before.mFramesInFlight
+    == Count);
+
+  // The freeing thread's cache takes them, and spills into the shared pool
+  uint64_t poolHits {};
+  OnNewThread([&] {
+    for (const auto frame: frames) {
+      CoroutineFramePool::Deallocate(frame, Size);
+    }
+    const auto start = CoroutineFramePool::GetStatistics();
+    for (std::size_t i = 0; i < Count; ++i) {
+      frames[i] = Allocate(Size);
+    }
+    poolHits = CoroutineFramePool::GetStatistics().mPoolHits - start.mPoolHits;
+  });
+  CHECK(poolHits > 0);
+
+  // Once that thread has exited, its cache is back in the shared pool too
+  OnNewThread([&] {
+    const auto start = CoroutineFramePool::GetStatistics();
+    for (const auto frame: frames) {
+      CoroutineFramePool::Deallocate(frame, Size);
+    }
+    auto frame = Allocate(Size);
+    CoroutineFramePool::Deallocate(frame, Size);
+    CHECK(CoroutineFramePool::GetStatistics().mPoolHits > start.mPoolHits);
+  });
+
+  const auto after = CoroutineFramePool::GetStatistics();
+  CHECK(after.mFramesInFlight == before.mFramesInFlight);
+  CHECK(after.mBytesInFlight == before.mBytesInFlight);
+  CHECK(after.mAllocations - before.mAllocations == (Count * 2) + 1);
+}
+
+TEST_CASE("concurrent cross-thread frees balance out") {
+  constexpr std::size_t Threads = 4;
+  constexpr std::size_t PerThread = 20000;
+
+  const auto before = CoroutineFramePool::GetStatistics();
+  {
+    // Each thread frees what the previous one allocated
+    std::vector<std::vector<std::pair<void*, std::size_t>>> frames(Threads);
+    for (std::size_t t = 0; t < Threads; ++t) {
+      for (std::size_t i = 0; i < PerThread; ++i) {
+        const auto size = 1 + ((i * 37) % CoroutineFramePool::MaxPooledSize);
+        frames[t].push_back({Allocate(size), size});
+      }
+    }
+    std::vector<std::jthread> threads;
+    for (std::size_t t = 0; t < Threads; ++t) {
+      threads.emplace_back([&frames, t] {
+        auto& mine = frames[(t + 1) % Threads];
+        for (auto& [frame, size]: mine) {
+          CoroutineFramePool::Deallocate(frame, size);
+          frame = Allocate(size);
+        }
+        for (const auto& [frame, size]: mine) {
+          CoroutineFramePool::Deallocate(frame, size);
+        }
+      });
+    }
+  }
+  const auto after = CoroutineFramePool::GetStatistics();
+  CHECK(after.mFramesInFlight == before.mFramesInFlight);
+  CHECK(after.mBytesInFlight == before.mBytesInFlight);
+}
+
+// Leak tracking can't be turned off again, so this must be the last test
+TEST_CASE("leak tracking reports live frames") {
+  CoroutineFramePool::EnableLeakTracking();
+  int caller {};
+  auto frame = CoroutineFramePool::Allocate(300, &caller);
+
+  const auto isFrame = [=](const auto& it) { return it.mFrame == frame; };
+  auto live = CoroutineFramePool::GetLiveFrames();
+  const auto it = std::ranges::find_if(live, isFrame);
+  REQUIRE(it != live.end());
+  CHECK(it->mSize == 300);
+  CHECK(it->mCaller == &caller);
+
+  CoroutineFramePool::Deallocate(frame, 300);
+  live = CoroutineFramePool::GetLiveFrames();
+  CHECK(std::ranges::none_of(live, isFrame));
+}
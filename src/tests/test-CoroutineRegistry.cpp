@@ -0,0 +1,217 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CoroutineRegistry.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+using namespace OpenKneeboard::CoroutineRegistry;
+using namespace std::chrono_literals;
+
+namespace {
+
+std::optional<LiveCoroutine> Find(SlotID slot) {
+  for (auto&& it: GetLiveCoroutines()) {
+    if (it.mSlot == slot) {
+      return it;
+    }
+  }
+  return std::nullopt;
+}
+
+std::size_t CountCreatedBy(const void* creator) {
+  return std::ranges::count_if(GetLiveCoroutines(), [=](const auto& it) {
+    return it.mCreator == creator;
+  });
+}
+
+}// namespace
+
+TEST_CASE("slots track a coroutine's state until unregistered") {
+  const int creator {};
+  const int awaitPoint {};
+  const auto slot = Register(&creator);
+  REQUIRE(slot != NoSlot);
+
+  auto live = Find(slot);
+  REQUIRE(live.has_value());
+  CHECK(live->mCreator == &creator);
+  CHECK(live->mAwaitPoint == nullptr);
+  CHECK(live->mState == CoroutineState::Running);
+  CHECK(live->mThread == std::this_thread::get_id());
+  const auto registeredSequence = live->mThreadSequence;
+
+  OnSuspend(slot, &awaitPoint);
+  live = Find(slot);
+  CHECK(live->mState == CoroutineState::Suspended);
+  CHECK(live->mAwaitPoint == &awaitPoint);
+  CHECK(live->mThreadSequence > registeredSequence);
+
+  // Resumed on another thread
+  std::jthread([slot] { OnResume(slot); }).join();
+  live = Find(slot);
+  CHECK(live->mState == CoroutineState::Running);
+  CHECK(live->mThread != std::this_thread::get_id());
+  // Still useful when it's running again
+  CHECK(live->mAwaitPoint == &awaitPoint);
+
+  OnComplete(slot);
+  CHECK(Find(slot)->mState == CoroutineState::Completed);
+
+  Unregister(slot);
+  CHECK(!Find(slot));
+}
+
+TEST_CASE("a full registry stops tracking, but keeps working") {
+  const int creator {};
+  const auto before = GetStatistics();
+
+  std::vector<SlotID> slots;
+  while (true) {
+    const auto slot = Register(&creator);
+    if (slot == NoSlot) {
+      break;
+    }
+    slots.push_back(slot);
+  }
+  CHECK(GetStatistics().mHighWater == Capacity);
+  CHECK(GetStatistics().mUntracked == before.mUntracked + 1);
+  CHECK(CountCreatedBy(&creator) == slots.size());
+
+  // Everything accepts `NoSlot`
+  OnSuspend(NoSlot, &creator);
+  OnResume(NoSlot);
+  OnComplete(NoSlot);
+  Unregister(NoSlot);
+
+  // Freed slots are reused
+  Unregister(slots.back());
+  const auto reused = Register(&creator);
+  CHECK(reused == slots.back());
+  CHECK(Register(&creator) == NoSlot);
+  CHECK(GetStatistics().mUntracked == before.mUntracked + 2);
+
+  for (const auto slot: slots) {
+    Unregister(slot);
+  }
+  CHECK(CountCreatedBy(&creator) == 0);
+}
+
+TEST_CASE("concurrent updates and reads stay consistent") {
+  constexpr std::size_t Threads = 8;
+  constexpr std::size_t PerThread = 20000;
+  const int creator {};
+  const int awaitPoint {};
+
+  std::atomic_bool done {false};
+  std::atomic_size_t inconsistent {};
+  std::jthread reader([&] {
+    while (!done) {
+      for (auto&& it: GetLiveCoroutines()) {
+        // Only ever suspended at `awaitPoint`, and never completed
+        if (it.mCreator != &creator) {
+          continue;
+        }
+        const auto suspended = (it.mState == CoroutineState::Suspended);
+        if (
+          it.mState == CoroutineState::Completed
+          || (suspended && it.mAwaitPoint != &awaitPoint)) {
+          ++inconsistent;
+        }
+      }
+    }
+  });
+
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t i = 0; i < Threads; ++i) {
+      threads.emplace_back([&] {
+        for (std::size_t j = 0; j < PerThread; ++j) {
+          const auto slot = Register(&creator);
+          OnSuspend(slot, &awaitPoint);
+          OnResume(slot);
+          Unregister(slot);
+        }
+      });
+    }
+  }
+  done = true;
+  reader.join();
+
+  CHECK(inconsistent == 0);
+  CHECK(CountCreatedBy(&creator) == 0);
+}
+
+TEST_CASE("stalls blame the innermost running coroutine") {
+  const int parentCreator {};
+  const int childCreator {};
+  constexpr auto Budget = 20ms;
+
+  const auto parent = Register(&parentCreator);
+  const auto child = Register(&childCreator);
+  {
+    StallDetector detector(std::this_thread::get_id(), Budget);
+    // A busy thread: neither coroutine suspends
+    std::this_thread::sleep_for(Budget * 5);
+
+    const auto stalls = detector.GetStalls();
+    REQUIRE(stalls.size() == 1);
+    CHECK(stalls.front().mCoroutine.mSlot == child);
+    CHECK(stalls.front().mCoroutine.mCreator == &childCreator);
+    CHECK(stalls.front().mOngoing);
+    CHECK(stalls.front().mDuration >= Budget);
+
+    // Once the child's suspended, the parent's the one running
+    OnSuspend(child, nullptr);
+    std::this_thread::sleep_for(Budget * 5);
+    const auto after = detector.GetStalls();
+    REQUIRE(after.size() == 2);
+    CHECK(!after.front().mOngoing);
+    CHECK(after.back().mCoroutine.mSlot == parent);
+
+    OnSuspend(parent, nullptr);
+    std::this_thread::sleep_for(Budget * 3);
+    CHECK(!detector.GetStalls().back().mOngoing);
+  }
+  Unregister(child);
+  Unregister(parent);
+}
+
+TEST_CASE("coroutines that keep suspending aren't stalls") {
+  const int creator {};
+  constexpr auto Budget = 20ms;
+  StallDetector detector(std::this_thread::get_id(), Budget);
+
+  const auto slot = Register(&creator);
+  const auto end = std::chrono::steady_clock::now() + (Budget * 5);
+  while (std::chrono::steady_clock::now() < end) {
+    OnSuspend(slot, nullptr);
+    OnResume(slot);
+    std::this_thread::sleep_for(Budget / 10);
+  }
+  Unregister(slot);
+  CHECK(detector.GetStalls().empty());
+}
@@ -0,0 +1,228 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CursorClickableRegions.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <latch>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+struct Button {
+  D2D1_RECT_F mRect {};
+  int mID {};
+  unsigned int mLayout {};
+
+  bool operator==(const Button& other) const noexcept {
+    return mID == other.mID && mLayout == other.mLayout;
+  }
+};
+
+using Regions = CursorClickableRegions<Button>;
+
+struct Receiver final : EventReceiver {
+  using EventReceiver::AddEventListener;
+
+  ~Receiver() override {
+    this->RemoveAllEventListeners();
+  }
+};
+
+/// Two side-by-side buttons, with empty space below them
+std::vector<Button> MakeButtons(unsigned int layout = 0) {
+  return {
+    {{0, 0, 10, 10}, 1, layout},
+    {{20, 0, 30, 10}, 2, layout},
+  };
+}
+
+constexpr std::pair<float, float> OnFirst {5, 5};
+constexpr std::pair<float, float> OnSecond {25, 5};
+constexpr std::pair<float, float> OnNothing {5, 50};
+
+/// Records what the regions emit
+struct Clicks {
+  Receiver mReceiver;
+  std::vector<int> mClicked;
+  std::size_t mClickedWithoutButton {};
+
+  Clicks(Regions& regions) {
+    mReceiver.AddEventListener(
+      regions.evClicked, [this](KneeboardViewID, const Button& button) {
+        mClicked.push_back(button.mID);
+      });
+    mReceiver.AddEventListener(
+      regions.evClickedWithoutButton,
+      [this](KneeboardViewID) { ++mClickedWithoutButton; });
+  }
+};
+
+void Post(
+  Regions& regions,
+  CursorTouchState state,
+  std::pair<float, float> position) {
+  regions.PostCursorEvent(
+    {},
+    CursorEvent {
+      .mTouchState = state,
+      .mX = position.first,
+      .mY = position.second,
+    });
+}
+
+void Press(Regions& regions, std::pair<float, float> position) {
+  Post(regions, CursorTouchState::TouchingSurface, position);
+}
+
+void Release(Regions& regions, std::pair<float, float> position) {
+  Post(regions, CursorTouchState::NearSurface, position);
+}
+
+}// namespace
+
+TEST_CASE("hovering tracks the button under the cursor") {
+  const auto regions = Regions::Create(MakeButtons());
+  CHECK(!regions->GetHoverButton());
+
+  Post(*regions, CursorTouchState::NearSurface, OnFirst);
+  CHECK(regions->GetHoverButton() == MakeButtons().at(0));
+  CHECK(regions->HaveHoverOrPendingClick());
+
+  Post(*regions, CursorTouchState::NearSurface, OnSecond);
+  CHECK(regions->GetHoverButton() == MakeButtons().at(1));
+
+  Post(*regions, CursorTouchState::NearSurface, OnNothing);
+  CHECK(!regions->GetHoverButton());
+
+  Post(*regions, CursorTouchState::NearSurface, OnFirst);
+  Post(*regions, CursorTouchState::NotNearSurface, OnFirst);
+  CHECK(!regions->GetHoverButton());
+  CHECK(!regions->HaveHoverOrPendingClick());
+}
+
+TEST_CASE("pressing and releasing on the same button clicks it") {
+  const auto regions = Regions::Create(MakeButtons());
+  Clicks clicks(*regions);
+
+  Press(*regions, OnSecond);
+  CHECK(clicks.mClicked.empty());
+  CHECK(regions->HaveHoverOrPendingClick());
+
+  Release(*regions, OnSecond);
+  CHECK(clicks.mClicked == std::vector {2});
+  CHECK(clicks.mClickedWithoutButton == 0);
+}
+
+TEST_CASE("a click is decided by where the touch started and ended") {
+  const auto regions = Regions::Create(MakeButtons());
+  Clicks clicks(*regions);
+
+  // Dragging while touching doesn't change the pressed button
+  Press(*regions, OnFirst);
+  Press(*regions, OnSecond);
+  Release(*regions, OnFirst);
+  CHECK(clicks.mClicked == std::vector {1});
+}
+
+TEST_CASE("releasing away from the pressed button doesn't click") {
+  const auto regions = Regions::Create(MakeButtons());
+  Clicks clicks(*regions);
+
+  Press(*regions, OnFirst);
+  Release(*regions, OnSecond);
+
+  Press(*regions, OnFirst);
+  Release(*regions, OnNothing);
+
+  // A press that started outside any button
+  Press(*regions, OnNothing);
+  Release(*regions, OnFirst);
+
+  CHECK(clicks.mClicked.empty());
+  CHECK(clicks.mClickedWithoutButton == 0);
+
+  // The pending press is never left behind
+  Post(*regions, CursorTouchState::NotNearSurface, OnNothing);
+  CHECK(!regions->HaveHoverOrPendingClick());
+}
+
+TEST_CASE("clicking outside every button is reported") {
+  const auto regions = Regions::Create(MakeButtons());
+  Clicks clicks(*regions);
+
+  Press(*regions, OnNothing);
+  Release(*regions, OnNothing);
+  CHECK(clicks.mClicked.empty());
+  CHECK(clicks.mClickedWithoutButton == 1);
+
+  // Releasing without a press isn't a click
+  Release(*regions, OnNothing);
+  Post(*regions, CursorTouchState::NotNearSurface, OnNothing);
+  CHECK(clicks.mClickedWithoutButton == 1);
+}
+
+TEST_CASE("SetButtons() replaces the buttons and resets the state") {
+  const auto regions = Regions::Create(MakeButtons());
+  Clicks clicks(*regions);
+
+  Post(*regions, CursorTouchState::NearSurface, OnFirst);
+  Press(*regions, OnFirst);
+
+  regions->SetButtons({{{0, 40, 10, 60}, 3, 1}});
+  CHECK(!regions->HaveHoverOrPendingClick());
+  CHECK(regions->GetButtons()->size() == 1);
+
+  // The press started in the old layout
+  Release(*regions, OnFirst);
+  CHECK(clicks.mClicked.empty());
+
+  constexpr std::pair<float, float> onNewButton {5, 50};
+  Press(*regions, onNewButton);
+  Release(*regions, onNewButton);
+  CHECK(clicks.mClicked == std::vector {3});
+}
+
+TEST_CASE("a racing SetButtons() never leaves an old button hovered") {
+  const auto regions = Regions::Create(MakeButtons());
+
+  std::size_t stale {};
+  for (unsigned int layout = 1; layout <= 2000; ++layout) {
+    std::latch start(2);
+    std::thread poster([&] {
+      start.arrive_and_wait();
+      Post(*regions, CursorTouchState::NearSurface, OnFirst);
+    });
+    start.arrive_and_wait();
+    regions->SetButtons(MakeButtons(layout));
+    poster.join();
+
+    // Either the hover was reset, or it came from the new layout
+    const auto hover = regions->GetHoverButton();
+    if (hover && hover->mLayout != layout) {
+      ++stale;
+    }
+    Post(*regions, CursorTouchState::NotNearSurface, OnNothing);
+  }
+  CHECK(stale == 0);
+}
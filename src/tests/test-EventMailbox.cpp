@@ -0,0 +1,211 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/Events.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <latch>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+using winrt::Windows::System::DispatcherQueueController;
+
+namespace {
+
+struct Receiver final : EventReceiver {
+  using EventReceiver::AddEventListener;
+
+  ~Receiver() override {
+    this->RemoveAllEventListeners();
+  }
+};
+
+struct Delivery {
+  std::size_t mProducer {};
+  std::size_t mSequence {};
+};
+
+/// The thread that owns the mailbox, and receives the events
+class OwnerThread final {
+ public:
+  OwnerThread()
+    : mController(DispatcherQueueController::CreateOnDedicatedThread()) {
+  }
+
+  ~OwnerThread() {
+    mController.ShutdownQueueAsync().get();
+  }
+
+  /// Run `fn` on the owner thread, and wait for it
+  void Run(std::function<void()> fn) {
+    std::promise<void> done;
+    const bool queued = mController.DispatcherQueue().TryEnqueue([&] {
+      fn();
+      done.set_value();
+    });
+    REQUIRE(queued);
+    done.get_future().wait();
+  }
+
+  /// Keep the owner thread busy until `release` counts down
+  void Block(std::latch& release) {
+    const bool queued = mController.DispatcherQueue().TryEnqueue(
+      [&release] { release.wait(); });
+    REQUIRE(queued);
+  }
+
+ private:
+  DispatcherQueueController mController {nullptr};
+};
+
+/// Emitting threads can be anywhere; give them a COM apartment, like the
+/// thread pool threads that usually emit
+std::jthread StartProducer(std::function<void()> fn) {
+  return std::jthread([fn = std::move(fn)] {
+    winrt::init_apartment(winrt::apartment_type::multi_threaded);
+    fn();
+    winrt::uninit_apartment();
+  });
+}
+
+bool WaitFor(const std::atomic_size_t& counter, std::size_t expected) {
+  const auto deadline = std::chrono::steady_clock::now() + 10s;
+  while (counter.load() < expected) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+
+}// namespace
+
+TEST_CASE("mailbox events from many threads arrive in order on the owner") {
+  constexpr std::size_t ProducerCount = 8;
+  constexpr std::size_t EventsPerProducer = 5'000;
+  constexpr std::size_t TotalEvents = ProducerCount * EventsPerProducer;
+
+  OwnerThread owner;
+  Event<std::size_t, std::size_t> event;
+  Receiver receiver;
+  std::shared_ptr<EventMailbox> mailbox;
+
+  // Only touched on the owner thread until everything's delivered
+  std::thread::id ownerThreadID;
+  std::vector<Delivery> delivered;
+  bool wrongThread {false};
+  std::atomic_size_t deliveredCount {};
+
+  owner.Run([&] {
+    ownerThreadID = std::this_thread::get_id();
+    mailbox = EventMailbox::GetForCurrentThread();
+    receiver.AddEventListener(
+      event, [&](std::size_t producer, std::size_t sequence) {
+        wrongThread |= (std::this_thread::get_id() != ownerThreadID);
+        delivered.push_back({producer, sequence});
+        ++deliveredCount;
+      });
+  });
+  REQUIRE(mailbox != nullptr);
+
+  {
+    std::vector<std::jthread> producers;
+    for (std::size_t producer = 0; producer < ProducerCount; ++producer) {
+      producers.push_back(StartProducer([&, producer] {
+        for (std::size_t i = 0; i < EventsPerProducer; ++i) {
+          event.EnqueueForContext(mailbox, producer, i);
+        }
+      }));
+    }
+  }
+
+  const bool allDelivered = WaitFor(deliveredCount, TotalEvents);
+  owner.Run([&] {
+    receiver.RemoveAllEventListeners();
+    mailbox = {};
+  });
+  REQUIRE(allDelivered);
+
+  CHECK(!wrongThread);
+  CHECK(delivered.size() == TotalEvents);
+  std::vector<std::size_t> next(ProducerCount, 0);
+  bool inOrder = true;
+  for (const auto& [producer, sequence]: delivered) {
+    inOrder = inOrder && (sequence == next.at(producer));
+    next.at(producer) = sequence + 1;
+  }
+  CHECK(inOrder);
+}
+
+TEST_CASE("handlers run after the whole mailbox batch has been emitted") {
+  constexpr std::size_t BatchSize = 100;
+
+  OwnerThread owner;
+  Event<std::size_t> event;
+  Receiver receiver;
+  std::shared_ptr<EventMailbox> mailbox;
+
+  // Hooks run as each event is emitted, and handlers when they're delivered
+  std::atomic_size_t emitted {};
+  std::atomic_size_t handled {};
+  std::size_t emittedBeforeFirstHandler {};
+
+  owner.Run([&] {
+    mailbox = EventMailbox::GetForCurrentThread();
+    event.AddHook([&](std::size_t) {
+      ++emitted;
+      return EventBase::HookResult::ALLOW_PROPAGATION;
+    });
+    receiver.AddEventListener(event, [&](std::size_t) {
+      if (handled++ == 0) {
+        emittedBeforeFirstHandler = emitted.load();
+      }
+    });
+  });
+
+  // Post the whole batch while the owner is busy, so it's drained at once
+  std::latch release {1};
+  owner.Block(release);
+  StartProducer([&] {
+    for (std::size_t i = 0; i < BatchSize; ++i) {
+      event.EnqueueForContext(mailbox, i);
+    }
+  }).join();
+  CHECK(emitted == 0);
+  release.count_down();
+
+  const bool allHandled = WaitFor(handled, BatchSize);
+  owner.Run([&] {
+    receiver.RemoveAllEventListeners();
+    mailbox = {};
+  });
+  REQUIRE(allHandled);
+  CHECK(emitted == BatchSize);
+  CHECK(emittedBeforeFirstHandler == BatchSize);
+}
@@ -0,0 +1,171 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/EventProfiler.hpp>
+#include <OpenKneeboard/Events.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <chrono>
+#include <source_location>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct Receiver final : EventReceiver {
+  using EventReceiver::AddEventListener;
+
+  ~Receiver() override {
+    this->RemoveAllEventListeners();
+  }
+};
+
+const EventProfiler::Entry* Find(
+  const std::vector<EventProfiler::Entry>& entries,
+  const std::source_location& location) {
+  for (const auto& it: entries) {
+    if (
+      it.mLocation.line() == location.line()
+      && std::string_view {it.mLocation.file_name()}
+        == location.file_name()) {
+      return &it;
+    }
+  }
+  return nullptr;
+}
+
+uint64_t SumHistogram(const EventProfiler::Entry& entry) {
+  uint64_t ret {};
+  for (const auto it: entry.mHistogram) {
+    ret += it;
+  }
+  return ret;
+}
+
+}// namespace
+
+// Must be first: whether profiling has ever been enabled is sticky
+TEST_CASE("nothing is recorded while profiling is off") {
+  EventProfiler::SetEnabled(false);
+  CHECK(!EventProfiler::IsEnabled());
+
+  Event<int> event;
+  Receiver receiver;
+  int calls {};
+  receiver.AddEventListener(event, [&calls](int) { ++calls; });
+  for (int i = 0; i < 1000; ++i) {
+    event.Emit(i);
+  }
+  CHECK(calls == 1000);
+
+  const auto report = EventProfiler::GetTopOffenders(10);
+  CHECK(report.mByReceiver.empty());
+  CHECK(report.mByEmitter.empty());
+  CHECK(EventProfiler::DumpTopOffenders(10).contains("has not been enabled"));
+}
+
+TEST_CASE("handler time is attributed to the receiver and the emitter") {
+  constexpr auto SlowHandlerTime = 2ms;
+
+  EventProfiler::Reset();
+  EventProfiler::SetEnabled(true);
+
+  Event<> event;
+  Receiver receiver;
+  const auto slowReceiver = std::source_location::current();
+  receiver.AddEventListener(
+    event, [=] { std::this_thread::sleep_for(SlowHandlerTime); },
+    slowReceiver);
+  const auto fastReceiver = std::source_location::current();
+  receiver.AddEventListener(event, [] {}, fastReceiver);
+
+  const auto firstEmitter = std::source_location::current();
+  for (int i = 0; i < 3; ++i) {
+    event.Emit(firstEmitter);
+  }
+  const auto secondEmitter = std::source_location::current();
+  for (int i = 0; i < 2; ++i) {
+    event.Emit(secondEmitter);
+  }
+  EventProfiler::SetEnabled(false);
+  // Disabled again, so not recorded
+  event.Emit(secondEmitter);
+
+  const auto report = EventProfiler::GetTopOffenders(10);
+  REQUIRE(report.mByReceiver.size() == 2);
+  REQUIRE(report.mByEmitter.size() == 2);
+
+  const auto slow = Find(report.mByReceiver, slowReceiver);
+  const auto fast = Find(report.mByReceiver, fastReceiver);
+  REQUIRE(slow != nullptr);
+  REQUIRE(fast != nullptr);
+  // Sorted by total time
+  CHECK(&report.mByReceiver.front() == slow);
+
+  CHECK(slow->mCalls == 5);
+  CHECK(slow->mTotal >= 5 * SlowHandlerTime);
+  CHECK(slow->mMax >= SlowHandlerTime);
+  CHECK(SumHistogram(*slow) == 5);
+  // 2ms is 2000us, so at least bucket 11: [1024us, 2048us)
+  for (std::size_t i = 0; i < 11; ++i) {
+    CHECK(slow->mHistogram[i] == 0);
+  }
+
+  CHECK(fast->mCalls == 5);
+  CHECK(fast->mTotal < slow->mTotal);
+  CHECK(fast->mMax < SlowHandlerTime);
+  CHECK(SumHistogram(*fast) == 5);
+
+  // Each emit is charged for both handlers
+  const auto first = Find(report.mByEmitter, firstEmitter);
+  const auto second = Find(report.mByEmitter, secondEmitter);
+  REQUIRE(first != nullptr);
+  REQUIRE(second != nullptr);
+  CHECK(first->mCalls == 6);
+  CHECK(first->mTotal >= 3 * SlowHandlerTime);
+  CHECK(second->mCalls == 4);
+  CHECK(second->mTotal >= 2 * SlowHandlerTime);
+
+  const auto top = EventProfiler::GetTopOffenders(1);
+  REQUIRE(top.mByReceiver.size() == 1);
+  CHECK(top.mByReceiver.front().mLocation.line() == slowReceiver.line());
+
+  const auto dump = EventProfiler::DumpTopOffenders(10);
+  CHECK(dump.contains("5 calls"));
+  CHECK(dump.contains("6 calls"));
+}
+
+TEST_CASE("resetting the profiler discards what was recorded") {
+  EventProfiler::SetEnabled(true);
+  Event<> event;
+  Receiver receiver;
+  receiver.AddEventListener(event, [] {});
+  event.Emit();
+  EventProfiler::SetEnabled(false);
+  CHECK(!EventProfiler::GetTopOffenders(10).mByReceiver.empty());
+
+  EventProfiler::Reset();
+  const auto report = EventProfiler::GetTopOffenders(10);
+  CHECK(report.mByReceiver.empty());
+  CHECK(report.mByEmitter.empty());
+}
@@ -0,0 +1,217 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/FilesystemWatchService.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <OpenKneeboard/Tests/FakeFilesystemWatchBackend.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+using namespace OpenKneeboard;
+using namespace OpenKneeboard::Tests;
+using namespace std::chrono_literals;
+
+namespace {
+
+using path = std::filesystem::path;
+
+constexpr auto SettleTime = 10ms;
+
+struct Fixture {
+  Fixture() {
+    std::random_device random;
+    mRoot = std::filesystem::temp_directory_path()
+      / ("OpenKneeboard-test-FilesystemWatchService-"
+         + std::to_string(random()));
+    std::filesystem::create_directories(mRoot / "sub");
+
+    auto backend = std::make_unique<FakeFilesystemWatchBackend>();
+    mBackend = backend.get();
+    mService = FilesystemWatchService::Create(std::move(backend), SettleTime);
+  }
+
+  ~Fixture() {
+    mService.reset();
+    std::error_code ec;
+    std::filesystem::remove_all(mRoot, ec);
+  }
+
+  /// Write a file that is already 'settled', so isn't debounced again
+  void Write(const path& file, std::string_view content) {
+    std::ofstream(file, std::ios::binary | std::ios::trunc) << content;
+    std::filesystem::last_write_time(
+      file, std::filesystem::file_time_type::clock::now() - 1s);
+  }
+
+  FilesystemWatchService::Callback Counter() {
+    return [this](const path& path) {
+      std::unique_lock lock(mMutex);
+      ++mCallbacks[path];
+      mCallbacksChanged.notify_all();
+    };
+  }
+
+  int GetCallbacks(const path& path) {
+    std::unique_lock lock(mMutex);
+    return mCallbacks[path];
+  }
+
+  bool WaitForCallbacks(const path& path, int count) {
+    std::unique_lock lock(mMutex);
+    return mCallbacksChanged.wait_for(
+      lock, 5s, [&] { return mCallbacks[path] >= count; });
+  }
+
+  path mRoot;
+  FakeFilesystemWatchBackend* mBackend {nullptr};
+  std::shared_ptr<FilesystemWatchService> mService;
+
+  std::mutex mMutex;
+  std::condition_variable mCallbacksChanged;
+  std::map<path, int> mCallbacks;
+};
+
+}// namespace
+
+TEST_CASE("subscriptions in the same directory share an OS watch") {
+  Fixture f;
+  const auto a = f.mService->Subscribe(f.mRoot / "a.png", f.Counter());
+  const auto b = f.mService->Subscribe(f.mRoot / "b.png", f.Counter());
+  const auto c = f.mService->Subscribe(f.mRoot / "c.png", f.Counter());
+  CHECK(f.mBackend->GetWatchCount() == 1);
+  CHECK(f.mService->GetStatistics().mOSWatches == 1);
+  CHECK(f.mService->GetStatistics().mSubscriptions == 3);
+
+  // Recursive, so a separate watch
+  const auto folder = f.mService->Subscribe(f.mRoot, f.Counter());
+  const auto other = f.mService->Subscribe(f.mRoot / "sub/d.png", f.Counter());
+  CHECK(f.mBackend->GetWatchCount() == 3);
+
+  {
+    const auto alsoFolder = f.mService->Subscribe(f.mRoot, f.Counter());
+    CHECK(f.mBackend->GetWatchCount() == 3);
+  }
+  CHECK(f.mBackend->GetWatchCount() == 3);
+}
+
+TEST_CASE("watches are released with their last subscription") {
+  Fixture f;
+  auto a = f.mService->Subscribe(f.mRoot / "a.png", f.Counter());
+  auto b = f.mService->Subscribe(f.mRoot / "b.png", f.Counter());
+  REQUIRE(f.mBackend->GetWatchCount() == 1);
+  a.reset();
+  CHECK(f.mBackend->GetWatchCount() == 1);
+  b.reset();
+  CHECK(f.mBackend->GetWatchCount() == 0);
+  CHECK(f.mService->GetStatistics().mSubscriptions == 0);
+}
+
+TEST_CASE("only changed files are notified") {
+  Fixture f;
+  const auto a = f.mRoot / "a.png";
+  const auto b = f.mRoot / "b.png";
+  f.Write(a, "a");
+  f.Write(b, "b");
+  const auto subA = f.mService->Subscribe(a, f.Counter());
+  const auto subB = f.mService->Subscribe(b, f.Counter());
+
+  f.Write(a, "aaaa");
+  f.mBackend->Notify(f.mRoot);
+  CHECK(f.WaitForCallbacks(a, 1));
+
+  // Give a spurious callback for `b` a chance to show up
+  std::this_thread::sleep_for(SettleTime * 10);
+  CHECK(f.GetCallbacks(a) == 1);
+  CHECK(f.GetCallbacks(b) == 0);
+}
+
+TEST_CASE("bursts of notifications are debounced") {
+  Fixture f;
+  const auto file = f.mRoot / "a.png";
+  f.Write(file, "a");
+  const auto subscription = f.mService->Subscribe(file, f.Counter());
+
+  f.Write(file, "aaaa");
+  for (int i = 0; i < 100; ++i) {
+    f.mBackend->Notify(f.mRoot);
+  }
+  CHECK(f.WaitForCallbacks(file, 1));
+  std::this_thread::sleep_for(SettleTime * 10);
+  CHECK(f.GetCallbacks(file) == 1);
+
+  const auto stats = f.mService->GetStatistics();
+  CHECK(stats.mBackendNotifications == 100);
+  CHECK(stats.mCallbacks == 1);
+}
+
+TEST_CASE("directory subscribers are notified for changes in the tree") {
+  Fixture f;
+  const auto subscription = f.mService->Subscribe(f.mRoot, f.Counter());
+  f.mBackend->Notify(f.mRoot / "sub");
+  CHECK(f.WaitForCallbacks(f.mRoot, 1));
+  f.mBackend->Notify(f.mRoot);
+  CHECK(f.WaitForCallbacks(f.mRoot, 2));
+}
+
+TEST_CASE("no callbacks after unsubscribing") {
+  Fixture f;
+  const auto file = f.mRoot / "a.png";
+  f.Write(file, "a");
+  auto subscription = f.mService->Subscribe(file, f.Counter());
+
+  f.Write(file, "aaaa");
+  f.mBackend->Notify(f.mRoot);
+  subscription.reset();
+  std::this_thread::sleep_for(SettleTime * 10);
+  CHECK(f.GetCallbacks(file) == 0);
+}
+
+TEST_CASE("racing subscriptions always share a live watch") {
+  Fixture f;
+  std::atomic_flag stop;
+  std::jthread churn([&] {
+    while (!stop.test()) {
+      f.mService->Subscribe(f.mRoot / "a.png", f.Counter()).reset();
+    }
+  });
+
+  // CHECK isn't thread-safe, so only the main thread checks
+  int missingWatches = 0;
+  for (int i = 0; i < 10000; ++i) {
+    const auto subscription
+      = f.mService->Subscribe(f.mRoot / "b.png", f.Counter());
+    if (f.mService->GetStatistics().mOSWatches != 1) {
+      ++missingWatches;
+    }
+  }
+  stop.test_and_set();
+  churn.join();
+
+  CHECK(missingWatches == 0);
+  CHECK(f.mBackend->GetWatchCount() == 0);
+}
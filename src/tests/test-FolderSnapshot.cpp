@@ -0,0 +1,260 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/FolderSnapshot.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <string>
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Entry = FolderSnapshot::Entry;
+using Entries = FolderSnapshot::Entries;
+using path = std::filesystem::path;
+
+const std::filesystem::file_time_type T0 {std::chrono::seconds {1000}};
+
+Entry MakeEntry(
+  uint64_t id,
+  uintmax_t size = 123,
+  std::filesystem::file_time_type modified = T0) {
+  return {.mSize = size, .mModified = modified, .mFileID = id};
+}
+
+template <class T>
+bool Contains(const std::vector<T>& haystack, const T& needle) {
+  return std::ranges::find(haystack, needle) != haystack.end();
+}
+
+}// namespace
+
+TEST_CASE("identical snapshots have an empty diff") {
+  const FolderSnapshot a {{{"a.pdf", MakeEntry(1)}, {"b.png", MakeEntry(2)}}};
+  const auto diff = a.Diff(a);
+  CHECK(diff.empty());
+  CHECK(FolderSnapshot {}.Diff(FolderSnapshot {}).empty());
+}
+
+TEST_CASE("added files") {
+  const FolderSnapshot before {{{"a.pdf", MakeEntry(1)}}};
+  const FolderSnapshot after {
+    {{"a.pdf", MakeEntry(1)}, {"b.pdf", MakeEntry(2)}}};
+  const auto diff = before.Diff(after);
+  REQUIRE(diff.mAdded.size() == 1);
+  CHECK(diff.mAdded.front() == "b.pdf");
+  CHECK(diff.mRemoved.empty());
+  CHECK(diff.mModified.empty());
+  CHECK(diff.mReplaced.empty());
+  CHECK(diff.mRenamed.empty());
+}
+
+TEST_CASE("removed files") {
+  const FolderSnapshot before {
+    {{"a.pdf", MakeEntry(1)}, {"b.pdf", MakeEntry(2)}}};
+  const FolderSnapshot after {{{"b.pdf", MakeEntry(2)}}};
+  const auto diff = before.Diff(after);
+  REQUIRE(diff.mRemoved.size() == 1);
+  CHECK(diff.mRemoved.front() == "a.pdf");
+  CHECK(diff.mAdded.empty());
+  CHECK(diff.mRenamed.empty());
+}
+
+TEST_CASE("files written in place are modified") {
+  const FolderSnapshot before {{{"a.pdf", MakeEntry(1, 100)}}};
+  const FolderSnapshot bigger {{{"a.pdf", MakeEntry(1, 200)}}};
+  const FolderSnapshot newer {{{"a.pdf", MakeEntry(1, 100, T0 + 1s)}}};
+
+  for (const auto& after: {bigger, newer}) {
+    const auto diff = before.Diff(after);
+    REQUIRE(diff.mModified.size() == 1);
+    CHECK(diff.mModified.front() == "a.pdf");
+    CHECK(diff.mReplaced.empty());
+    CHECK(diff.mAdded.empty());
+    CHECK(diff.mRemoved.empty());
+  }
+}
+
+TEST_CASE("a different file at the same path is a replacement") {
+  const FolderSnapshot before {{{"a.pdf", MakeEntry(1)}}};
+  const FolderSnapshot after {{{"a.pdf", MakeEntry(2, 456)}}};
+  const auto diff = before.Diff(after);
+  REQUIRE(diff.mReplaced.size() == 1);
+  CHECK(diff.mReplaced.front() == "a.pdf");
+  CHECK(diff.mModified.empty());
+}
+
+TEST_CASE("an unknown file ID is never a replacement") {
+  const FolderSnapshot before {{{"a.pdf", MakeEntry(0)}}};
+  const FolderSnapshot after {{{"a.pdf", MakeEntry(2, 456)}}};
+  const auto diff = before.Diff(after);
+  CHECK(diff.mReplaced.empty());
+  REQUIRE(diff.mModified.size() == 1);
+  CHECK(diff.mModified.front() == "a.pdf");
+}
+
+TEST_CASE("same file at a new path is a rename") {
+  const FolderSnapshot before {
+    {{"a.pdf", MakeEntry(1)}, {"keep.pdf", MakeEntry(3)}}};
+  const FolderSnapshot after {
+    {{"sub/b.pdf", MakeEntry(1)}, {"keep.pdf", MakeEntry(3)}}};
+  const auto diff = before.Diff(after);
+  REQUIRE(diff.mRenamed.size() == 1);
+  CHECK(
+    diff.mRenamed.front() == std::pair {path {"a.pdf"}, path {"sub/b.pdf"}});
+  CHECK(diff.mAdded.empty());
+  CHECK(diff.mRemoved.empty());
+}
+
+TEST_CASE("renames are paired alongside unrelated adds and removes") {
+  const FolderSnapshot before {{
+    {"gone.pdf", MakeEntry(1)},
+    {"old-name.pdf", MakeEntry(2)},
+  }};
+  const FolderSnapshot after {{
+    {"new-name.pdf", MakeEntry(2)},
+    {"new.pdf", MakeEntry(4)},
+  }};
+  const auto diff = before.Diff(after);
+  REQUIRE(diff.mRenamed.size() == 1);
+  CHECK(
+    diff.mRenamed.front()
+    == std::pair {path {"old-name.pdf"}, path {"new-name.pdf"}});
+  REQUIRE(diff.mRemoved.size() == 1);
+  CHECK(diff.mRemoved.front() == "gone.pdf");
+  REQUIRE(diff.mAdded.size() == 1);
+  CHECK(diff.mAdded.front() == "new.pdf");
+}
+
+TEST_CASE("unknown file IDs are never paired as renames") {
+  const FolderSnapshot before {{{"a.pdf", MakeEntry(0)}}};
+  const FolderSnapshot after {{{"b.pdf", MakeEntry(0)}}};
+  const auto diff = before.Diff(after);
+  CHECK(diff.mRenamed.empty());
+  CHECK(Contains(diff.mRemoved, path {"a.pdf"}));
+  CHECK(Contains(diff.mAdded, path {"b.pdf"}));
+}
+
+TEST_CASE("removing one hard link of a file is a removal") {
+  const FolderSnapshot before {{
+    {"a.pdf", MakeEntry(1)},
+    {"b.pdf", MakeEntry(1)},
+  }};
+  const FolderSnapshot after {{{"b.pdf", MakeEntry(1)}}};
+  const auto diff = before.Diff(after);
+  CHECK(diff.mRemoved == std::vector {path {"a.pdf"}});
+  CHECK(diff.mRenamed.empty());
+  CHECK(diff.mAdded.empty());
+}
+
+TEST_CASE("a new hard link to a file that's still there is an addition") {
+  const FolderSnapshot before {{
+    {"a.pdf", MakeEntry(1)},
+    {"b.pdf", MakeEntry(1)},
+  }};
+  const FolderSnapshot after {{
+    {"b.pdf", MakeEntry(1)},
+    {"c.pdf", MakeEntry(1)},
+  }};
+  const auto diff = before.Diff(after);
+  CHECK(diff.mRemoved == std::vector {path {"a.pdf"}});
+  CHECK(diff.mAdded == std::vector {path {"c.pdf"}});
+  CHECK(diff.mRenamed.empty());
+}
+
+TEST_CASE("each hard link is paired with at most one new path") {
+  const FolderSnapshot before {{
+    {"a.pdf", MakeEntry(1)},
+    {"b.pdf", MakeEntry(1)},
+  }};
+  const FolderSnapshot after {{{"c.pdf", MakeEntry(1)}}};
+  const auto diff = before.Diff(after);
+  REQUIRE(diff.mRenamed.size() == 1);
+  CHECK(diff.mRenamed.front().second == "c.pdf");
+  // Whichever link wasn't paired was removed
+  REQUIRE(diff.mRemoved.size() == 1);
+  CHECK(diff.mRemoved.front() != diff.mRenamed.front().first);
+  CHECK(diff.mAdded.empty());
+}
+
+TEST_CASE("scan a directory on disk") {
+  std::random_device random;
+  const auto root = std::filesystem::temp_directory_path()
+    / ("OpenKneeboard-test-FolderSnapshot-" + std::to_string(random()));
+  std::filesystem::create_directories(root / "sub");
+  const auto write = [](const path& file, std::string_view content) {
+    std::ofstream(file, std::ios::binary | std::ios::trunc) << content;
+  };
+
+  write(root / "a.pdf", "aaaa");
+  write(root / "sub" / "b.png", "bb");
+  const auto first = FolderSnapshot::Scan(root);
+  CHECK(first.GetEntries().size() == 2);
+  CHECK(first.GetEntries().at(root / "a.pdf").mSize == 4);
+  CHECK(first.GetEntries().at(root / "sub" / "b.png").mSize == 2);
+  CHECK(first.Diff(FolderSnapshot::Scan(root)).empty());
+
+  std::filesystem::rename(root / "sub" / "b.png", root / "c.png");
+  write(root / "a.pdf", "aaaaaaaa");
+  write(root / "d.txt", "d");
+  const auto second = FolderSnapshot::Scan(root);
+  const auto diff = first.Diff(second);
+  CHECK(Contains(diff.mModified, root / "a.pdf"));
+  CHECK(Contains(diff.mAdded, root / "d.txt"));
+  if (first.GetEntries().at(root / "sub" / "b.png").mFileID) {
+    REQUIRE(diff.mRenamed.size() == 1);
+    CHECK(diff.mRenamed.front().first == root / "sub" / "b.png");
+    CHECK(diff.mRenamed.front().second == root / "c.png");
+  }
+
+  std::filesystem::remove_all(root);
+  CHECK(FolderSnapshot::Scan(root).empty());
+}
+
+TEST_CASE("removing a hard link on disk") {
+  std::random_device random;
+  const auto root = std::filesystem::temp_directory_path()
+    / ("OpenKneeboard-test-FolderSnapshot-" + std::to_string(random()));
+  std::filesystem::create_directories(root);
+  std::ofstream(root / "a.pdf", std::ios::binary) << "aaaa";
+
+  std::error_code ec;
+  std::filesystem::create_hard_link(root / "a.pdf", root / "b.pdf", ec);
+  if (ec) {
+    // Not supported by this filesystem
+    std::filesystem::remove_all(root);
+    return;
+  }
+
+  const auto before = FolderSnapshot::Scan(root);
+  std::filesystem::remove(root / "a.pdf");
+  const auto diff = before.Diff(FolderSnapshot::Scan(root));
+  CHECK(diff.mRemoved == std::vector {root / "a.pdf"});
+  CHECK(diff.mRenamed.empty());
+  CHECK(diff.mAdded.empty());
+  CHECK(diff.mReplaced.empty());
+
+  std::filesystem::remove_all(root);
+}
@@ -0,0 +1,251 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/ImageDecodeCache.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr PixelSize NativeSize {1024, 1024};
+constexpr std::size_t NativeBytes = 1024 * 1024 * 4;
+
+class FailingDecoder final : public ImageDecoder {
+ public:
+  std::optional<PixelSize> GetNativeSize(
+    const std::filesystem::path&) override {
+    return NativeSize;
+  }
+
+  std::shared_ptr<DecodedImage> Decode(
+    const std::filesystem::path&,
+    PixelSize) override {
+    ++mDecodes;
+    return nullptr;
+  }
+
+  std::atomic<int> mDecodes {};
+};
+
+/** Stands in for a page source; `mOnReady` triggers a repaint.
+ *
+ * Must outlive the cache, as workers may still be calling `mOnReady`.
+ */
+struct Page {
+  Page(ImageDecodeCache::Key key, std::shared_ptr<ImageDecoder> decoder)
+    : mKey(key), mDecoder(std::move(decoder)) {
+  }
+
+  ImageDecodeCache::Request GetRequest(
+    PixelSize wanted,
+    std::optional<PixelSize> preview = std::nullopt) {
+    return {
+      .mKey = mKey,
+      .mPath = "page.png",
+      .mDecoder = mDecoder,
+      .mNativeSize = NativeSize,
+      .mWantedSize = wanted,
+      .mPreviewSize = preview,
+      .mOnReady =
+        [this]() {
+          std::unique_lock lock(mMutex);
+          ++mReadyCount;
+          mReady.notify_all();
+        },
+    };
+  }
+
+  bool WaitForReady(int count, std::chrono::milliseconds timeout = 5s) {
+    std::unique_lock lock(mMutex);
+    return mReady.wait_for(
+      lock, timeout, [&] { return mReadyCount >= count; });
+  }
+
+  ImageDecodeCache::Key mKey;
+  std::shared_ptr<ImageDecoder> mDecoder;
+
+  std::mutex mMutex;
+  std::condition_variable mReady;
+  int mReadyCount {};
+};
+
+auto SyntheticDecoder() {
+  return CreateSyntheticImageDecoder(NativeSize, 1ms);
+}
+
+}// namespace
+
+TEST_CASE("mip sizes are power-of-two reductions covering the wanted size") {
+  CHECK(ImageDecodeCache::GetMipSize(NativeSize, NativeSize) == NativeSize);
+  CHECK(
+    ImageDecodeCache::GetMipSize(NativeSize, {2048, 2048}) == NativeSize);
+  CHECK(
+    ImageDecodeCache::GetMipSize(NativeSize, {512, 512})
+    == PixelSize {512, 512});
+  CHECK(
+    ImageDecodeCache::GetMipSize(NativeSize, {500, 500})
+    == PixelSize {512, 512});
+  CHECK(
+    ImageDecodeCache::GetMipSize(NativeSize, {513, 513}) == NativeSize);
+  // Aspect ratio is preserved, so the height decides
+  CHECK(
+    ImageDecodeCache::GetMipSize({1024, 512}, {1024, 128})
+    == PixelSize {256, 128});
+  CHECK(ImageDecodeCache::GetMipSize(NativeSize, {}) == NativeSize);
+}
+
+TEST_CASE("renders before and after a decode") {
+  Page page {1, SyntheticDecoder()};
+  ImageDecodeCache cache {NativeBytes * 4, 1};
+
+  // First render: nothing to show yet, but a decode is queued
+  CHECK(cache.GetOrQueue(page.GetRequest(NativeSize)) == nullptr);
+  REQUIRE(page.WaitForReady(1));
+
+  // Next render: the decoded image
+  const auto image = cache.GetOrQueue(page.GetRequest(NativeSize));
+  REQUIRE(image != nullptr);
+  CHECK(image->GetSize() == NativeSize);
+
+  const auto stats = cache.GetStatistics();
+  CHECK(stats.mMisses == 1);
+  CHECK(stats.mHits == 1);
+  CHECK(stats.mDecodes == 1);
+  CHECK(stats.mBytes == NativeBytes);
+}
+
+TEST_CASE("a preview is shown until the full-size image is decoded") {
+  Page page {1, SyntheticDecoder()};
+  const PixelSize preview {256, 256};
+  ImageDecodeCache cache {NativeBytes * 4, 1};
+
+  CHECK(cache.GetOrQueue(page.GetRequest(NativeSize, preview)) == nullptr);
+  // Once for the preview, once for the full-size image
+  REQUIRE(page.WaitForReady(2));
+
+  const auto image = cache.GetOrQueue(page.GetRequest(NativeSize, preview));
+  REQUIRE(image != nullptr);
+  CHECK(image->GetSize() == NativeSize);
+  CHECK(cache.GetStatistics().mPreviewDecodes == 1);
+  CHECK(cache.GetStatistics().mDecodes == 2);
+  // The preview was replaced, not kept alongside
+  CHECK(cache.GetStatistics().mBytes == NativeBytes);
+}
+
+TEST_CASE("a smaller cached image is returned while a larger one decodes") {
+  Page page {1, SyntheticDecoder()};
+  ImageDecodeCache cache {NativeBytes * 4, 1};
+
+  CHECK(cache.GetOrQueue(page.GetRequest({256, 256})) == nullptr);
+  REQUIRE(page.WaitForReady(1));
+
+  const auto small = cache.GetOrQueue(page.GetRequest(NativeSize));
+  REQUIRE(small != nullptr);
+  CHECK(small->GetSize() == PixelSize {256, 256});
+  REQUIRE(page.WaitForReady(2));
+  const auto large = cache.GetOrQueue(page.GetRequest(NativeSize));
+  REQUIRE(large != nullptr);
+  CHECK(large->GetSize() == NativeSize);
+}
+
+TEST_CASE("prefetched images are cache hits") {
+  Page page {1, SyntheticDecoder()};
+  ImageDecodeCache cache {NativeBytes * 4, 1};
+
+  cache.Prefetch(page.GetRequest(NativeSize));
+  REQUIRE(page.WaitForReady(1));
+  CHECK(cache.GetOrQueue(page.GetRequest(NativeSize)) != nullptr);
+  CHECK(cache.GetStatistics().mMisses == 0);
+}
+
+TEST_CASE("least-recently-used images are evicted to stay within budget") {
+  Page a {1, SyntheticDecoder()};
+  Page b {2, SyntheticDecoder()};
+  Page c {3, SyntheticDecoder()};
+  ImageDecodeCache cache {NativeBytes * 2, 1};
+
+  for (auto page: {&a, &b}) {
+    cache.GetOrQueue(page->GetRequest(NativeSize));
+    REQUIRE(page->WaitForReady(1));
+  }
+  // Make `a` more recent than `b`
+  CHECK(cache.GetOrQueue(a.GetRequest(NativeSize)) != nullptr);
+
+  cache.GetOrQueue(c.GetRequest(NativeSize));
+  REQUIRE(c.WaitForReady(1));
+
+  const auto stats = cache.GetStatistics();
+  CHECK(stats.mEvictions == 1);
+  CHECK(stats.mBytes <= stats.mByteBudget);
+  CHECK(stats.mImages == 2);
+  CHECK(cache.GetOrQueue(a.GetRequest(NativeSize)) != nullptr);
+  CHECK(cache.GetOrQueue(b.GetRequest(NativeSize)) == nullptr);
+}
+
+TEST_CASE("shrinking the budget evicts") {
+  Page a {1, SyntheticDecoder()};
+  ImageDecodeCache cache {NativeBytes * 2, 1};
+  cache.GetOrQueue(a.GetRequest(NativeSize));
+  REQUIRE(a.WaitForReady(1));
+
+  cache.SetByteBudget(NativeBytes / 2);
+  const auto stats = cache.GetStatistics();
+  CHECK(stats.mBytes == 0);
+  CHECK(stats.mImages == 0);
+}
+
+TEST_CASE("erased images are dropped") {
+  Page a {1, SyntheticDecoder()};
+  ImageDecodeCache cache {NativeBytes * 2, 1};
+  cache.GetOrQueue(a.GetRequest(NativeSize));
+  REQUIRE(a.WaitForReady(1));
+
+  cache.Erase(a.mKey);
+  CHECK(cache.GetStatistics().mBytes == 0);
+  CHECK(cache.GetOrQueue(a.GetRequest(NativeSize)) == nullptr);
+}
+
+TEST_CASE("failed decodes are not retried") {
+  const auto decoder = std::make_shared<FailingDecoder>();
+  Page page {1, decoder};
+  ImageDecodeCache cache {NativeBytes * 2, 1};
+
+  CHECK(cache.GetOrQueue(page.GetRequest(NativeSize)) == nullptr);
+  const auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (cache.GetStatistics().mFailedDecodes == 0
+         && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+  REQUIRE(cache.GetStatistics().mFailedDecodes == 1);
+
+  for (int i = 0; i < 10; ++i) {
+    CHECK(cache.GetOrQueue(page.GetRequest(NativeSize)) == nullptr);
+  }
+  std::this_thread::sleep_for(10ms);
+  CHECK(decoder->mDecodes == 1);
+  CHECK(!page.WaitForReady(1, 0ms));
+}
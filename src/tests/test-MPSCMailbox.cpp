@@ -0,0 +1,198 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/MPSCMailbox.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <semaphore>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+namespace {
+
+class Callback final : public MPSCMailbox::Item {
+ public:
+  Callback(std::function<void()> fn) : mFn(std::move(fn)) {
+  }
+
+  void Run() noexcept override {
+    mFn();
+  }
+
+ private:
+  std::function<void()> mFn;
+};
+
+auto MakeItem(std::function<void()> fn) {
+  return std::make_unique<Callback>(std::move(fn));
+}
+
+/// Counts live instances, to check items are freed
+class Counted final : public MPSCMailbox::Item {
+ public:
+  Counted(std::size_t& live) : mLive(live) {
+    ++mLive;
+  }
+  ~Counted() override {
+    --mLive;
+  }
+
+  void Run() noexcept override {
+  }
+
+ private:
+  std::size_t& mLive;
+};
+
+struct Delivery {
+  std::size_t mProducer {};
+  std::size_t mSequence {};
+};
+
+}// namespace
+
+TEST_CASE("items run in push order, and only the first push needs a wakeup") {
+  MPSCMailbox mailbox;
+  std::vector<int> ran;
+
+  CHECK(mailbox.Push(MakeItem([&] { ran.push_back(0); })));
+  for (int i = 1; i < 1000; ++i) {
+    CHECK(!mailbox.Push(MakeItem([&ran, i] { ran.push_back(i); })));
+  }
+  CHECK(ran.empty());
+
+  CHECK(mailbox.Drain() == 1000);
+  REQUIRE(ran.size() == 1000);
+  for (int i = 0; i < 1000; ++i) {
+    CHECK(ran.at(i) == i);
+  }
+
+  CHECK(mailbox.Drain() == 0);
+  // Empty again, so the next push needs another wakeup
+  CHECK(mailbox.Push(MakeItem([] {})));
+  CHECK(mailbox.Drain() == 1);
+}
+
+TEST_CASE("items are freed after running, or with the mailbox") {
+  std::size_t live {};
+  {
+    MPSCMailbox mailbox;
+    std::ignore = mailbox.Push(std::make_unique<Counted>(live));
+    std::ignore = mailbox.Push(std::make_unique<Counted>(live));
+    CHECK(live == 2);
+    CHECK(mailbox.Drain() == 2);
+    CHECK(live == 0);
+
+    std::ignore = mailbox.Push(std::make_unique<Counted>(live));
+    std::ignore = mailbox.Push(std::make_unique<Counted>(live));
+    CHECK(live == 2);
+  }
+  CHECK(live == 0);
+}
+
+TEST_CASE("items pushed while draining are left for the next drain") {
+  MPSCMailbox mailbox;
+  std::vector<int> ran;
+  bool wakeupRequested {false};
+
+  std::ignore = mailbox.Push(MakeItem([&] {
+    ran.push_back(1);
+    wakeupRequested = mailbox.Push(MakeItem([&] { ran.push_back(3); }));
+  }));
+  std::ignore = mailbox.Push(MakeItem([&] { ran.push_back(2); }));
+
+  CHECK(mailbox.Drain() == 2);
+  CHECK(ran == std::vector {1, 2});
+  // The drain already took everything, so the pusher has to wake it again
+  CHECK(wakeupRequested);
+
+  CHECK(mailbox.Drain() == 1);
+  CHECK(ran == std::vector {1, 2, 3});
+}
+
+TEST_CASE("concurrent producers lose no items or wakeups, and keep order") {
+  constexpr std::size_t ProducerCount = 8;
+  constexpr std::size_t ItemsPerProducer = 20'000;
+  constexpr std::size_t TotalItems = ProducerCount * ItemsPerProducer;
+
+  MPSCMailbox mailbox;
+  // Released by each push that asks for a wakeup
+  std::counting_semaphore<> wakeups {0};
+
+  // Only touched by the consumer until it's joined
+  std::vector<Delivery> delivered;
+  delivered.reserve(TotalItems);
+  std::size_t wakeupCount {};
+  bool timedOut {false};
+
+  std::jthread consumer([&] {
+    while (delivered.size() < TotalItems) {
+      // A lost wakeup would otherwise hang the test
+      if (!wakeups.try_acquire_for(10s)) {
+        timedOut = true;
+        return;
+      }
+      ++wakeupCount;
+      mailbox.Drain();
+    }
+  });
+
+  {
+    std::vector<std::jthread> producers;
+    for (std::size_t producer = 0; producer < ProducerCount; ++producer) {
+      producers.emplace_back([&, producer] {
+        for (std::size_t i = 0; i < ItemsPerProducer; ++i) {
+          const auto wake = mailbox.Push(
+            MakeItem([&delivered, producer, i] {
+              delivered.push_back({producer, i});
+            }));
+          if (wake) {
+            wakeups.release();
+          }
+        }
+      });
+    }
+  }
+  consumer.join();
+
+  REQUIRE(!timedOut);
+  CHECK(delivered.size() == TotalItems);
+  CHECK(wakeupCount >= 1);
+  CHECK(wakeupCount <= TotalItems);
+
+  std::vector<std::size_t> next(ProducerCount, 0);
+  bool inOrder = true;
+  for (const auto& [producer, sequence]: delivered) {
+    inOrder = inOrder && (sequence == next.at(producer));
+    next.at(producer) = sequence + 1;
+  }
+  CHECK(inOrder);
+  for (const auto count: next) {
+    CHECK(count == ItemsPerProducer);
+  }
+}
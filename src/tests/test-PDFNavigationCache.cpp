@@ -0,0 +1,122 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/PDFNavigationCache.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <random>
+#include <string>
+#include <string_view>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Key = PDFNavigationCache::Key;
+
+Key MakeKey(std::string_view content) {
+  return HashContent(std::as_bytes(std::span {content.data(), content.size()}));
+}
+
+PDFNavigation::Index MakeIndex() {
+  PDFNavigation::Index ret;
+  ret.mBookmarks = {{"Intro", 0}, {"Charts", 2}};
+  ret.mLinks.resize(3);
+  ret.mLinks.at(0).push_back({
+    .mRect = {0.1f, 0.2f, 0.3f, 0.4f},
+    .mDestination = {
+      .mType = PDFNavigation::DestinationType::URI,
+      .mURI = "https://openkneeboard.com",
+    },
+  });
+  return ret;
+}
+
+std::filesystem::path MakeTemporaryDirectoryName() {
+  std::random_device random;
+  return std::filesystem::temp_directory_path()
+    / ("OpenKneeboard-test-PDFNavigationCache-" + std::to_string(random()));
+}
+
+struct Fixture {
+  ~Fixture() {
+    std::error_code ec;
+    std::filesystem::remove_all(mRoot, ec);
+  }
+
+  const std::filesystem::path mRoot {MakeTemporaryDirectoryName()};
+  PDFNavigationCache mCache {mRoot};
+};
+
+}// namespace
+
+TEST_CASE("round trip") {
+  Fixture f;
+  const auto key = MakeKey("document");
+  const auto index = MakeIndex();
+  CHECK(!f.mCache.Load(key));
+
+  f.mCache.Store(key, index);
+  CHECK(f.mCache.Load(key) == index);
+  CHECK(!f.mCache.LoadTextIndex(key));
+
+  const auto text = PDFTextIndex::Create({"Hello world", "", "ATIS 251.000"});
+  f.mCache.StoreTextIndex(key, text);
+  CHECK(f.mCache.LoadTextIndex(key) == text);
+}
+
+TEST_CASE("keys differing only in length don't match") {
+  Fixture f;
+  const auto key = MakeKey("document");
+  f.mCache.Store(key, MakeIndex());
+
+  auto other = key;
+  ++other.mByteLength;
+  CHECK(!f.mCache.Load(other));
+  CHECK(f.mCache.Load(key).has_value());
+}
+
+TEST_CASE("keys differing only in digest don't match") {
+  Fixture f;
+  const auto key = MakeKey("document");
+  f.mCache.Store(key, MakeIndex());
+
+  const auto other = MakeKey("documenT");
+  REQUIRE(other.mByteLength == key.mByteLength);
+  CHECK(!f.mCache.Load(other));
+}
+
+TEST_CASE("entries are checked against the full stored key") {
+  Fixture f;
+  const auto key = MakeKey("document");
+  const auto other = MakeKey("other document");
+  f.mCache.Store(key, MakeIndex());
+  f.mCache.Store(other, {});
+
+  // Put one entry under the other's name, as a file name collision would
+  const auto entryName = [](const Key& key) {
+    return key.ToString() + ".navigation.bin";
+  };
+  std::filesystem::copy_file(
+    f.mRoot / entryName(key),
+    f.mRoot / entryName(other),
+    std::filesystem::copy_options::overwrite_existing);
+  CHECK(!f.mCache.Load(other));
+  CHECK(f.mCache.Load(key) == MakeIndex());
+}
@@ -0,0 +1,204 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/PDFTextIndex.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Pages = std::vector<PageIndex>;
+
+const std::vector<std::string> Document {
+  "Tune COMM1 to 251.000 for TOWER",
+  "Frequency 251 000; then 000 251",
+  "ILS approach runway 27L. Tower 251.0001",
+  "",
+  "tower tower tower",
+};
+
+}// namespace
+
+TEST_CASE("words are runs of letters and digits, in any case") {
+  const auto index = PDFTextIndex::Create(Document);
+  CHECK(index.Find("tower") == Pages {0, 2, 4});
+  CHECK(index.Find("TOWER") == Pages {0, 2, 4});
+  CHECK(index.Find("comm1") == Pages {0});
+  CHECK(index.Find("27l") == Pages {2});
+  // Only whole words match
+  CHECK(index.Find("tow").empty());
+  CHECK(index.Find("comm").empty());
+}
+
+TEST_CASE("phrases match consecutive words, in order") {
+  const auto index = PDFTextIndex::Create(Document);
+  CHECK(index.Find("251.000") == Pages {0, 1});
+  CHECK(index.Find("251 000") == Pages {0, 1});
+  CHECK(index.Find("251-000") == Pages {0, 1});
+  CHECK(index.Find("000 251") == Pages {1});
+  CHECK(index.Find("runway 27l tower") == Pages {2});
+  CHECK(index.Find("approach tower").empty());
+  // All words must be present
+  CHECK(index.Find("tower missing").empty());
+}
+
+TEST_CASE("each page is found once, in page order") {
+  std::vector<std::string> pages(100, "nothing here");
+  for (std::size_t i = 0; i < pages.size(); i += 7) {
+    pages.at(i) = "needle at the start, then NEEDLE again, and needle";
+  }
+  const auto index = PDFTextIndex::Create(pages);
+
+  Pages expected;
+  for (PageIndex i = 0; i < pages.size(); i += 7) {
+    expected.push_back(i);
+  }
+  CHECK(index.Find("needle") == expected);
+  CHECK(index.Find("then needle") == expected);
+}
+
+TEST_CASE("empty documents, pages, and queries") {
+  const auto empty = PDFTextIndex::Create({});
+  CHECK(empty.IsEmpty());
+  CHECK(empty.Find("tower").empty());
+  CHECK(empty == PDFTextIndex {});
+
+  // e.g. scanned pages, with no text operators
+  const auto blank = PDFTextIndex::Create({"", "", ""});
+  CHECK(blank.IsEmpty());
+
+  const auto index = PDFTextIndex::Create(Document);
+  CHECK(!index.IsEmpty());
+  CHECK(index.Find("").empty());
+  CHECK(index.Find(" ...; ").empty());
+}
+
+TEST_CASE("bytes from unsupported encodings are separators") {
+  // CID fonts and the like give us bytes that aren't ASCII text
+  const auto index = PDFTextIndex::Create({
+    "\x01\x02\xff\xfe",
+    "caf\xe9 tower\x80open",
+  });
+  CHECK(index.Find("caf") == Pages {1});
+  CHECK(index.Find("tower open") == Pages {1});
+  CHECK(index.Find("\xff").empty());
+}
+
+TEST_CASE("round trip through a cache file") {
+  const auto index = PDFTextIndex::Create(Document);
+  CacheFile::Writer w;
+  index.Write(w);
+
+  CacheFile::Reader r(w.GetBuffer());
+  PDFTextIndex copy;
+  REQUIRE(copy.Read(r));
+  CHECK(r.IsAtEnd());
+  CHECK(copy == index);
+  CHECK(copy.Find("251 000") == Pages {0, 1});
+}
+
+TEST_CASE("indices that would break searches aren't read") {
+  CacheFile::Writer w;
+  // Words out of order
+  w.Write<uint32_t>(2);
+  w.Write(std::string_view {"b"});
+  w.Write<uint32_t>(0);
+  w.Write<uint32_t>(1);
+  w.Write(std::string_view {"a"});
+  w.Write<uint32_t>(1);
+  w.Write<uint32_t>(1);
+  w.Write<uint32_t>(2);
+  for (uint32_t i = 0; i < 2; ++i) {
+    w.Write<PageIndex>(0);
+    w.Write<uint32_t>(i);
+  }
+
+  CacheFile::Reader r(w.GetBuffer());
+  PDFTextIndex index;
+  CHECK(!index.Read(r));
+  CHECK(index.IsEmpty());
+
+  // Truncated
+  CacheFile::Writer valid;
+  PDFTextIndex::Create(Document).Write(valid);
+  const auto buffer = valid.GetBuffer();
+  CacheFile::Reader truncated(buffer.first(buffer.size() - 1));
+  CHECK(!index.Read(truncated));
+}
+
+TEST_CASE("lazy indices aren't built until they're used") {
+  int builds = 0;
+  LazyPDFTextIndex lazy([&] {
+    ++builds;
+    return std::optional {PDFTextIndex::Create(Document)};
+  });
+  CHECK(builds == 0);
+
+  const auto index = lazy.Get();
+  CHECK(builds == 1);
+  REQUIRE(index);
+  CHECK(index->Find("tower") == Pages {0, 2, 4});
+
+  CHECK(lazy.Get() == index);
+  CHECK(builds == 1);
+}
+
+TEST_CASE("concurrent searches wait for the first build") {
+  std::atomic_int builds {0};
+  LazyPDFTextIndex lazy([&] {
+    ++builds;
+    // Give the other threads a chance to race us
+    std::this_thread::sleep_for(20ms);
+    return std::optional {PDFTextIndex::Create(Document)};
+  });
+
+  std::vector<std::shared_ptr<const PDFTextIndex>> results(8);
+  {
+    std::vector<std::jthread> threads;
+    for (auto& result: results) {
+      threads.emplace_back([&] { result = lazy.Get(); });
+    }
+  }
+  CHECK(builds == 1);
+  for (const auto& result: results) {
+    CHECK(result && result == results.front());
+  }
+}
+
+TEST_CASE("failed builds give an empty index, and aren't retried") {
+  int builds = 0;
+  LazyPDFTextIndex lazy([&]() -> std::optional<PDFTextIndex> {
+    ++builds;
+    return std::nullopt;
+  });
+  const auto index = lazy.Get();
+  REQUIRE(index);
+  CHECK(index->IsEmpty());
+  CHECK(index->Find("tower").empty());
+  CHECK(lazy.Get() == index);
+  CHECK(builds == 1);
+}
@@ -0,0 +1,232 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/PrerenderScheduler.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <algorithm>
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Clock = PrerenderScheduler::Clock;
+using Options = PrerenderScheduler::Options;
+
+// Simulated; nothing here waits for real time to pass
+const Clock::time_point T0 {std::chrono::hours(1)};
+
+constexpr PageIndex PageCount = 10;
+constexpr auto PlentyOfBudget = 1s;
+constexpr auto NoBudget = 0s;
+
+/// Start and complete everything that fits, returning the pages in order
+std::vector<PageIndex> RenderAll(
+  PrerenderScheduler& scheduler,
+  Clock::time_point now) {
+  std::vector<PageIndex> ret;
+  while (const auto page = scheduler.Next(now, PlentyOfBudget)) {
+    ret.push_back(*page);
+    REQUIRE(scheduler.Complete(*page, 1ms));
+  }
+  return ret;
+}
+
+std::vector<PageIndex> Sorted(std::vector<PageIndex> pages) {
+  std::ranges::sort(pages);
+  return pages;
+}
+
+std::size_t CountRendered(const PrerenderScheduler& scheduler) {
+  std::size_t ret {};
+  for (PageIndex page = 0; page < PageCount; ++page) {
+    ret += scheduler.IsRendered(page);
+  }
+  return ret;
+}
+
+}// namespace
+
+TEST_CASE("neighbouring pages are rendered nearest first") {
+  PrerenderScheduler scheduler {Options {.mPagesAhead = 2, .mPagesBehind = 1}};
+  scheduler.SetCurrentPage(1, 5, PageCount, T0);
+  CHECK(RenderAll(scheduler, T0) == std::vector<PageIndex> {6, 4, 7});
+  CHECK(!scheduler.HasPendingWork());
+  CHECK(!scheduler.IsRendered(5));
+  CHECK(scheduler.GetStatistics().mCompleted == 3);
+}
+
+TEST_CASE("current pages shown as a preview are wanted first") {
+  PrerenderScheduler scheduler;
+  scheduler.SetCurrentPage(1, 0, PageCount, T0, /* isPreview = */ true);
+  CHECK(RenderAll(scheduler, T0) == std::vector<PageIndex> {0, 1});
+}
+
+TEST_CASE("current pages shown at full quality aren't rendered again") {
+  PrerenderScheduler scheduler;
+  scheduler.SetCurrentPage(1, 5, PageCount, T0);
+  CHECK(Sorted(RenderAll(scheduler, T0)) == std::vector<PageIndex> {4, 6});
+  CHECK(!scheduler.IsRendered(5));
+
+  // Another view showing a preview of the same page still wants it
+  scheduler.SetCurrentPage(2, 5, PageCount, T0, /* isPreview = */ true);
+  CHECK(RenderAll(scheduler, T0) == std::vector<PageIndex> {5});
+}
+
+TEST_CASE("a current page stops being wanted once shown at full quality") {
+  PrerenderScheduler scheduler {Options {.mPagesAhead = 0, .mPagesBehind = 0}};
+  scheduler.SetCurrentPage(1, 5, PageCount, T0, /* isPreview = */ true);
+  REQUIRE(scheduler.HasPendingWork());
+
+  // e.g. rendered directly because the estimate dropped
+  scheduler.SetCurrentPage(1, 5, PageCount, T0);
+  CHECK(!scheduler.HasPendingWork());
+  CHECK(!scheduler.Next(T0, PlentyOfBudget));
+}
+
+TEST_CASE("renders that don't fit wait for the user to settle") {
+  PrerenderScheduler scheduler {Options {
+    .mSettleTime = 250ms,
+    .mInitialEstimate = 20ms,
+  }};
+  scheduler.SetCurrentPage(1, 5, PageCount, T0);
+  CHECK(!scheduler.Next(T0, 10ms));
+  CHECK(!scheduler.Next(T0 + 249ms, NoBudget));
+  CHECK(scheduler.Next(T0 + 250ms, NoBudget) == 6);
+  CHECK(scheduler.GetStatistics().mOverBudget == 1);
+
+  // Only one at a time
+  CHECK(!scheduler.Next(T0 + 250ms, PlentyOfBudget));
+}
+
+TEST_CASE("the estimate follows measured render times") {
+  PrerenderScheduler scheduler {Options {.mInitialEstimate = 20ms}};
+  scheduler.SetCurrentPage(1, 5, PageCount, T0);
+  const auto page = scheduler.Next(T0, PlentyOfBudget);
+  REQUIRE(page.has_value());
+  CHECK(scheduler.Complete(*page, 100ms));
+  CHECK(scheduler.GetStatistics().mEstimate == 40ms);
+}
+
+TEST_CASE("jumping evicts pages that are no longer wanted") {
+  PrerenderScheduler scheduler;
+  scheduler.SetCurrentPage(1, 2, PageCount, T0);
+  CHECK(Sorted(RenderAll(scheduler, T0)) == std::vector<PageIndex> {1, 3});
+
+  // In progress while the user jumps
+  scheduler.SetCurrentPage(1, 7, PageCount, T0 + 1s);
+  const auto page = scheduler.Next(T0 + 1s, PlentyOfBudget);
+  REQUIRE(page == 8);
+  scheduler.SetCurrentPage(1, 0, PageCount, T0 + 2s);
+  CHECK(Sorted(scheduler.TakeEvictions()) == std::vector<PageIndex> {1, 3});
+  CHECK(!scheduler.Complete(*page, 1ms));
+  CHECK(scheduler.GetStatistics().mDiscarded == 1);
+  CHECK(CountRendered(scheduler) == 0);
+}
+
+TEST_CASE("pages of idle views are evicted without other activity") {
+  PrerenderScheduler scheduler {Options {.mViewTimeout = 5s}};
+  scheduler.SetCurrentPage(1, 5, PageCount, T0);
+  RenderAll(scheduler, T0);
+  REQUIRE(CountRendered(scheduler) == 2);
+  CHECK(scheduler.GetNextExpiry() == T0 + 5s);
+
+  scheduler.Expire(T0 + 4s);
+  CHECK(scheduler.TakeEvictions().empty());
+
+  scheduler.Expire(T0 + 5s);
+  CHECK(Sorted(scheduler.TakeEvictions()) == std::vector<PageIndex> {4, 6});
+  CHECK(CountRendered(scheduler) == 0);
+  CHECK(!scheduler.GetNextExpiry());
+  CHECK(!scheduler.HasPendingWork());
+}
+
+TEST_CASE("the next expiry follows the oldest view") {
+  PrerenderScheduler scheduler {Options {.mViewTimeout = 5s}};
+  scheduler.SetCurrentPage(1, 2, PageCount, T0);
+  scheduler.SetCurrentPage(2, 7, PageCount, T0 + 3s);
+  CHECK(!scheduler.GetNextExpiry());
+
+  RenderAll(scheduler, T0 + 3s);
+  CHECK(scheduler.GetNextExpiry() == T0 + 5s);
+  scheduler.Expire(T0 + 5s);
+  CHECK(Sorted(scheduler.TakeEvictions()) == std::vector<PageIndex> {1, 3});
+  CHECK(scheduler.GetNextExpiry() == T0 + 8s);
+
+  // Seeing the view again postpones it
+  scheduler.SetCurrentPage(2, 7, PageCount, T0 + 6s);
+  CHECK(scheduler.GetNextExpiry() == T0 + 11s);
+}
+
+TEST_CASE("removing a view only evicts its pages") {
+  PrerenderScheduler scheduler;
+  scheduler.SetCurrentPage(1, 2, PageCount, T0);
+  scheduler.SetCurrentPage(2, 7, PageCount, T0);
+  RenderAll(scheduler, T0);
+  REQUIRE(CountRendered(scheduler) == 4);
+
+  scheduler.RemoveView(1);
+  CHECK(Sorted(scheduler.TakeEvictions()) == std::vector<PageIndex> {1, 3});
+  CHECK(scheduler.IsRendered(6));
+  CHECK(scheduler.IsRendered(8));
+
+  // Unknown views are ignored
+  scheduler.RemoveView(1);
+  CHECK(scheduler.TakeEvictions().empty());
+}
+
+TEST_CASE("rendered pages never exceed the hard cap") {
+  PrerenderScheduler scheduler {Options {
+    .mPagesAhead = 2,
+    .mPagesBehind = 2,
+    .mMaxRendered = 3,
+  }};
+  scheduler.SetCurrentPage(1, 5, PageCount, T0, /* isPreview = */ true);
+  // The current page, then the nearest on each side
+  CHECK(RenderAll(scheduler, T0) == std::vector<PageIndex> {5, 6, 4});
+  CHECK(!scheduler.HasPendingWork());
+
+  // Current pages are kept first
+  scheduler.SetCurrentPage(2, 0, PageCount, T0, /* isPreview = */ true);
+  scheduler.SetCurrentPage(3, 9, PageCount, T0, /* isPreview = */ true);
+  CHECK(Sorted(scheduler.TakeEvictions()) == std::vector<PageIndex> {4, 6});
+  CHECK(Sorted(RenderAll(scheduler, T0)) == std::vector<PageIndex> {0, 9});
+  CHECK(CountRendered(scheduler) == 3);
+
+  for (PageIndex page = 0; page < PageCount; ++page) {
+    scheduler.SetCurrentPage(1, page, PageCount, T0 + 1s, true);
+    RenderAll(scheduler, T0 + 1s);
+    scheduler.TakeEvictions();
+    CHECK(CountRendered(scheduler) <= 3);
+  }
+}
+
+TEST_CASE("failed pages aren't retried until reset") {
+  PrerenderScheduler scheduler {Options {.mPagesBehind = 0}};
+  scheduler.SetCurrentPage(1, 5, PageCount, T0);
+  const auto page = scheduler.Next(T0, PlentyOfBudget);
+  REQUIRE(page == 6);
+  scheduler.Fail(*page);
+  CHECK(!scheduler.Next(T0, PlentyOfBudget));
+  CHECK(!scheduler.HasPendingWork());
+
+  scheduler.Reset();
+  CHECK(scheduler.Next(T0, PlentyOfBudget) == 6);
+}
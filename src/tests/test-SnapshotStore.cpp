@@ -0,0 +1,158 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/SnapshotStore.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using path = std::filesystem::path;
+
+struct Fixture {
+  Fixture() {
+    std::random_device random;
+    mRoot = std::filesystem::temp_directory_path()
+      / ("OpenKneeboard-test-SnapshotStore-" + std::to_string(random()));
+    std::filesystem::create_directories(mRoot / "sources");
+    mStore = SnapshotStore::Create(mRoot / "snapshots");
+  }
+
+  ~Fixture() {
+    mStore.reset();
+    std::error_code ec;
+    std::filesystem::remove_all(mRoot, ec);
+  }
+
+  path Write(std::string_view name, std::string_view content) {
+    const auto ret = mRoot / "sources" / name;
+    Overwrite(ret, content);
+    return ret;
+  }
+
+  static void Overwrite(const path& file, std::string_view content) {
+    std::ofstream(file, std::ios::binary | std::ios::trunc) << content;
+  }
+
+  static std::string Read(const path& file) {
+    std::ifstream f(file, std::ios::binary);
+    return {std::istreambuf_iterator<char> {f}, {}};
+  }
+
+  path mRoot;
+  std::shared_ptr<SnapshotStore> mStore;
+};
+
+}// namespace
+
+TEST_CASE("identical content shares a snapshot") {
+  Fixture f;
+  const auto a = f.mStore->Acquire(f.Write("a.pdf", "content"));
+  const auto b = f.mStore->Acquire(f.Write("b.pdf", "content"));
+  REQUIRE(a && b);
+  CHECK(a == b);
+  CHECK(a->GetContentHash().mByteLength == 7);
+  CHECK(Fixture::Read(a->GetPath()) == "content");
+
+  const auto stats = f.mStore->GetStatistics();
+  CHECK(stats.mCopied == 1);
+  CHECK(stats.mReused == 1);
+}
+
+TEST_CASE("content of the same length is not shared") {
+  Fixture f;
+  const auto a = f.mStore->Acquire(f.Write("a.pdf", "aaaa"));
+  const auto b = f.mStore->Acquire(f.Write("b.pdf", "bbbb"));
+  REQUIRE(a && b);
+  CHECK(a != b);
+  CHECK(a->GetContentHash() != b->GetContentHash());
+  CHECK(Fixture::Read(b->GetPath()) == "bbbb");
+}
+
+TEST_CASE("a modified live snapshot is not shared") {
+  Fixture f;
+  const auto source = f.Write("a.pdf", "original");
+  const auto damaged = f.mStore->Acquire(source);
+  REQUIRE(damaged);
+  // Same length, so only the modification time can tell; set it explicitly
+  // as the filesystem's timestamps may be coarser than this test
+  const auto modified = std::filesystem::last_write_time(damaged->GetPath());
+  Fixture::Overwrite(damaged->GetPath(), "modified");
+  std::filesystem::last_write_time(
+    damaged->GetPath(), modified + std::chrono::seconds(1));
+
+  const auto fresh = f.mStore->Acquire(source);
+  REQUIRE(fresh);
+  CHECK(fresh != damaged);
+  CHECK(fresh->GetContentHash() == damaged->GetContentHash());
+  CHECK(Fixture::Read(fresh->GetPath()) == "original");
+
+  const auto stats = f.mStore->GetStatistics();
+  CHECK(stats.mDamaged == 1);
+  CHECK(stats.mReused == 0);
+  CHECK(stats.mCopied == 2);
+
+  // The fresh copy is shared from now on
+  CHECK(f.mStore->Acquire(source) == fresh);
+}
+
+TEST_CASE("an intact leftover file is adopted") {
+  Fixture f;
+  const auto source = f.Write("a.pdf", "leftover");
+  auto first = f.mStore->Acquire(source);
+  REQUIRE(first);
+  const auto snapshotPath = first->GetPath();
+  const auto key = first->GetContentHash();
+
+  // As if a release failed to delete it
+  const auto leftover = snapshotPath.parent_path() / "leftover.tmp";
+  std::filesystem::copy_file(snapshotPath, leftover);
+  first.reset();
+  REQUIRE(!std::filesystem::exists(snapshotPath));
+  std::filesystem::rename(leftover, snapshotPath);
+
+  const auto second = f.mStore->Acquire(source);
+  REQUIRE(second);
+  CHECK(second->GetPath() == snapshotPath);
+  CHECK(second->GetContentHash() == key);
+  CHECK(f.mStore->GetStatistics().mCopied == 1);
+}
+
+TEST_CASE("a damaged leftover file is replaced") {
+  Fixture f;
+  const auto source = f.Write("a.pdf", "leftover");
+  auto first = f.mStore->Acquire(source);
+  REQUIRE(first);
+  const auto snapshotPath = first->GetPath();
+  first.reset();
+  Fixture::Overwrite(snapshotPath, "leftbver");
+
+  const auto second = f.mStore->Acquire(source);
+  REQUIRE(second);
+  CHECK(Fixture::Read(second->GetPath()) == "leftover");
+  CHECK(f.mStore->GetStatistics().mCopied == 2);
+}
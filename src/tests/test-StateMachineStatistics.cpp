@@ -0,0 +1,278 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/StateMachineStatistics.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <source_location>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+namespace {
+
+enum class TestLock {
+  Unlocked,
+  TryLock,
+  Locked,
+};
+
+using Statistics = StateMachineStatistics<TestLock>;
+
+constexpr auto Unlocked = Statistics::GetIndex(TestLock::Unlocked);
+constexpr auto TryLock = Statistics::GetIndex(TestLock::TryLock);
+constexpr auto Locked = Statistics::GetIndex(TestLock::Locked);
+
+template <auto* TStatistics>
+using TestStateMachine = StateMachine<
+  TestLock,
+  TestLock::Unlocked,
+  lockable_transitions<TestLock>(),
+  std::nullopt,
+  InstrumentStateMachine<TStatistics>>;
+
+template <auto* TStatistics>
+using TestAtomicStateMachine = AtomicStateMachine<
+  TestLock,
+  TestLock::Unlocked,
+  lockable_transitions<TestLock>(),
+  std::nullopt,
+  InstrumentStateMachine<TStatistics>>;
+
+template <class T>
+struct UninstrumentedLayout {
+  T mState;
+  std::source_location mCreator;
+};
+
+uint64_t Sum(const auto& counters) {
+  return std::accumulate(counters.begin(), counters.end(), uint64_t {0});
+}
+
+uint64_t Sum(const Statistics::ByTransition<uint64_t>& counters) {
+  uint64_t ret {};
+  for (auto&& row: counters) {
+    ret += Sum(row);
+  }
+  return ret;
+}
+
+// Each test case records into its own statistics, so they're independent
+constinit Statistics gSuccessfulStats;
+constinit Statistics gFailedStats;
+constinit Statistics gTimeInStateStats;
+constinit Statistics gSharedStats;
+constinit Statistics gAtomicStats;
+constinit Statistics gToStringStats;
+
+}// namespace
+
+// Without instrumentation, state machines are no larger than their state and
+// creator
+static_assert(
+  sizeof(StateMachine<
+         TestLock,
+         TestLock::Unlocked,
+         lockable_transitions<TestLock>()>)
+  == sizeof(UninstrumentedLayout<TestLock>));
+static_assert(
+  sizeof(AtomicStateMachine<
+         TestLock,
+         TestLock::Unlocked,
+         lockable_transitions<TestLock>()>)
+  == sizeof(UninstrumentedLayout<std::atomic<TestLock>>));
+
+static_assert(Statistics::GetBucket(0ns) == 0);
+static_assert(Statistics::GetBucket(999ns) == 0);
+static_assert(Statistics::GetBucket(-1s) == 0);
+static_assert(Statistics::GetBucket(1us) == 1);
+static_assert(Statistics::GetBucket(2us) == 2);
+static_assert(Statistics::GetBucket(3us) == 2);
+static_assert(Statistics::GetBucket(4us) == 3);
+static_assert(Statistics::GetBucket(1024us) == 11);
+static_assert(Statistics::GetBucket(2047us) == 11);
+static_assert(
+  Statistics::GetBucket(24h) == Statistics::HistogramBuckets - 1);
+
+TEST_CASE("successful transitions are counted by source and destination") {
+  TestStateMachine<&gSuccessfulStats> sm;
+  for (int i = 0; i < 3; ++i) {
+    sm.Transition<TestLock::Unlocked, TestLock::TryLock>();
+    sm.Transition<TestLock::TryLock, TestLock::Locked>();
+    sm.Transition<TestLock::Locked, TestLock::Unlocked>();
+  }
+  sm.Transition<TestLock::Unlocked, TestLock::TryLock>();
+  sm.Transition<TestLock::TryLock, TestLock::Unlocked>();
+
+  const auto stats = gSuccessfulStats.GetSnapshot();
+  CHECK(stats.mTransitions[Unlocked][TryLock] == 4);
+  CHECK(stats.mTransitions[TryLock][Locked] == 3);
+  CHECK(stats.mTransitions[Locked][Unlocked] == 3);
+  CHECK(stats.mTransitions[TryLock][Unlocked] == 1);
+  CHECK(Sum(stats.mTransitions) == 11);
+  CHECK(Sum(stats.mFailedTransitions) == 0);
+
+  // One time-in-state sample per transition, attributed to the state left
+  CHECK(Sum(stats.mTimeInState[Unlocked]) == 4);
+  CHECK(Sum(stats.mTimeInState[TryLock]) == 4);
+  CHECK(Sum(stats.mTimeInState[Locked]) == 3);
+}
+
+TEST_CASE("failed transitions are counted, and don't change the state") {
+  TestStateMachine<&gFailedStats> sm;
+  CHECK(!sm.TryTransition<TestLock::Locked, TestLock::Unlocked>());
+  CHECK(!sm.TryTransition<TestLock::TryLock, TestLock::Locked>());
+  CHECK(!sm.TryTransition<TestLock::TryLock, TestLock::Locked>());
+  CHECK(sm.Get() == TestLock::Unlocked);
+
+  CHECK(sm.TryTransition<TestLock::Unlocked, TestLock::TryLock>());
+  const auto failed = sm.TryTransition<TestLock::Unlocked, TestLock::TryLock>();
+  REQUIRE(!failed);
+  CHECK(failed.error() == TestLock::TryLock);
+
+  const auto stats = gFailedStats.GetSnapshot();
+  CHECK(stats.mFailedTransitions[Locked][Unlocked] == 1);
+  CHECK(stats.mFailedTransitions[TryLock][Locked] == 2);
+  CHECK(stats.mFailedTransitions[Unlocked][TryLock] == 1);
+  CHECK(Sum(stats.mFailedTransitions) == 4);
+
+  CHECK(stats.mTransitions[Unlocked][TryLock] == 1);
+  CHECK(Sum(stats.mTransitions) == 1);
+  // Failures don't leave a state, so don't record time in it
+  CHECK(Sum(stats.mTimeInState[Unlocked]) == 1);
+  CHECK(Sum(stats.mTimeInState[TryLock]) == 0);
+  CHECK(Sum(stats.mTimeInState[Locked]) == 0);
+}
+
+TEST_CASE("time in state is recorded in the bucket for its duration") {
+  constexpr auto sleepTime = 2ms;
+  constexpr auto minimumBucket = Statistics::GetBucket(sleepTime);
+
+  TestStateMachine<&gTimeInStateStats> sm;
+  sm.Transition<TestLock::Unlocked, TestLock::TryLock>();
+  std::this_thread::sleep_for(sleepTime);
+  sm.Transition<TestLock::TryLock, TestLock::Locked>();
+
+  const auto stats = gTimeInStateStats.GetSnapshot();
+  const auto& buckets = stats.mTimeInState[TryLock];
+  REQUIRE(Sum(buckets) == 1);
+  // Sleeps can overrun, but never end early
+  for (std::size_t i = 0; i < minimumBucket; ++i) {
+    CHECK(buckets[i] == 0);
+  }
+  // ... and this would be a very long overrun
+  CHECK(buckets.back() == 0);
+}
+
+TEST_CASE("state machines with the same statistics add to the same counters") {
+  {
+    TestStateMachine<&gSharedStats> a;
+    TestAtomicStateMachine<&gSharedStats> b;
+    a.Transition<TestLock::Unlocked, TestLock::TryLock>();
+    b.Transition<TestLock::Unlocked, TestLock::TryLock>();
+    CHECK(!b.TryTransition<TestLock::Unlocked, TestLock::TryLock>());
+  }
+  {
+    TestStateMachine<&gSharedStats> c;
+    c.Transition<TestLock::Unlocked, TestLock::TryLock>();
+  }
+
+  const auto stats = gSharedStats.GetSnapshot();
+  CHECK(stats.mTransitions[Unlocked][TryLock] == 3);
+  CHECK(stats.mFailedTransitions[Unlocked][TryLock] == 1);
+  CHECK(Sum(stats.mTimeInState[Unlocked]) == 3);
+}
+
+TEST_CASE("racing AtomicStateMachine transitions are all counted") {
+  constexpr std::size_t ThreadCount = 8;
+  constexpr std::size_t Iterations = 20'000;
+
+  struct Tally {
+    uint64_t mAcquired {};
+    uint64_t mFailed {};
+  };
+  std::vector<Tally> tallies(ThreadCount);
+
+  {
+    TestAtomicStateMachine<&gAtomicStats> sm;
+    std::atomic_flag go;
+    std::vector<std::jthread> threads;
+    for (auto& tally: tallies) {
+      threads.emplace_back([&sm, &go, &tally] {
+        go.wait(false);
+        for (std::size_t i = 0; i < Iterations; ++i) {
+          if (!sm.TryTransition<TestLock::Unlocked, TestLock::TryLock>()) {
+            ++tally.mFailed;
+            continue;
+          }
+          ++tally.mAcquired;
+          // We hold the lock, so these can't fail; if they do, the
+          // failed-transition counters below will show it
+          std::ignore = sm.TryTransition<TestLock::TryLock, TestLock::Locked>();
+          std::ignore
+            = sm.TryTransition<TestLock::Locked, TestLock::Unlocked>();
+        }
+      });
+    }
+    go.test_and_set();
+    go.notify_all();
+  }
+
+  uint64_t acquired {};
+  uint64_t failed {};
+  for (auto&& it: tallies) {
+    acquired += it.mAcquired;
+    failed += it.mFailed;
+  }
+  CHECK(acquired + failed == ThreadCount * Iterations);
+
+  const auto stats = gAtomicStats.GetSnapshot();
+  CHECK(stats.mTransitions[Unlocked][TryLock] == acquired);
+  CHECK(stats.mTransitions[TryLock][Locked] == acquired);
+  CHECK(stats.mTransitions[Locked][Unlocked] == acquired);
+  CHECK(stats.mFailedTransitions[Unlocked][TryLock] == failed);
+  CHECK(stats.mFailedTransitions[TryLock][Locked] == 0);
+  CHECK(stats.mFailedTransitions[Locked][Unlocked] == 0);
+
+  // No time-in-state samples are lost or double-counted either
+  CHECK(Sum(stats.mTimeInState[Unlocked]) == acquired);
+  CHECK(Sum(stats.mTimeInState[TryLock]) == acquired);
+  CHECK(Sum(stats.mTimeInState[Locked]) == acquired);
+}
+
+TEST_CASE("snapshots describe only the transitions and states used") {
+  TestStateMachine<&gToStringStats> sm;
+  sm.Transition<TestLock::Unlocked, TestLock::TryLock>();
+  CHECK(!sm.TryTransition<TestLock::Unlocked, TestLock::TryLock>());
+
+  const auto text = gToStringStats.GetSnapshot().ToString();
+  CHECK(text.contains(std::format(
+    "{} -> {}: 1 (1 failed)", TestLock::Unlocked, TestLock::TryLock)));
+  CHECK(text.contains(std::format("Time in {}:", TestLock::Unlocked)));
+  CHECK(!text.contains(std::format("Time in {}:", TestLock::TryLock)));
+  CHECK(!text.contains(std::format("{} ->", TestLock::Locked)));
+}
@@ -0,0 +1,244 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/TaskExecutor.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <latch>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+namespace {
+
+/// Starts immediately, and frees itself when it finishes
+struct detached {
+  struct promise_type {
+    detached get_return_object() noexcept {
+      return {};
+    }
+    std::suspend_never initial_suspend() noexcept {
+      return {};
+    }
+    std::suspend_never final_suspend() noexcept {
+      return {};
+    }
+    void return_void() noexcept {
+    }
+    void unhandled_exception() noexcept {
+      std::terminate();
+    }
+  };
+};
+
+struct PostTo {
+  RunQueue& mQueue;
+  bool mPosted {false};
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  bool await_suspend(std::coroutine_handle<> coro) noexcept {
+    // Once posted, the coroutine - and this awaiter - may already have been
+    // resumed and destroyed on another thread
+    mPosted = true;
+    if (mQueue.TryPost(coro)) {
+      return true;
+    }
+    // Carry on synchronously if the queue's been stopped
+    mPosted = false;
+    return false;
+  }
+  bool await_resume() const noexcept {
+    return mPosted;
+  }
+};
+
+detached AppendAfterPost(RunQueue& queue, std::vector<int>& out, int value) {
+  const bool posted = co_await PostTo {queue};
+  if (posted) {
+    out.push_back(value);
+  }
+}
+
+struct Resumption {
+  std::thread::id mThread;
+  std::shared_ptr<RunQueue> mQueue;
+};
+
+detached RecordAfterPost(RunQueue& queue, Resumption& out, std::latch& done) {
+  co_await PostTo {queue};
+  out = {std::this_thread::get_id(), RunQueue::GetForCurrentThread()};
+  done.count_down();
+}
+
+detached RecordOnPool(
+  ThreadPool& pool,
+  Resumption& first,
+  Resumption& second,
+  std::latch& done) {
+  co_await pool.schedule();
+  first = {std::this_thread::get_id(), RunQueue::GetForCurrentThread()};
+  // Like `task<>`, continuing via the current thread's queue
+  co_await PostTo {*first.mQueue};
+  second = {std::this_thread::get_id(), RunQueue::GetForCurrentThread()};
+  done.count_down();
+}
+
+}// namespace
+
+TEST_CASE("RunPending resumes in posting order") {
+  const auto queue = RunQueue::Create();
+  std::vector<int> resumed;
+  for (int i = 0; i < 3; ++i) {
+    AppendAfterPost(*queue, resumed, i);
+  }
+  CHECK(resumed.empty());
+
+  CHECK(queue->RunPending() == 3);
+  CHECK(resumed == std::vector<int> {0, 1, 2});
+  CHECK(queue->RunPending() == 0);
+
+  const auto stats = queue->GetStatistics();
+  CHECK(stats.mPosted == 3);
+  CHECK(stats.mResumed == 3);
+  CHECK(stats.mWaits == 0);
+}
+
+TEST_CASE("stopped queues reject posts, but still drain") {
+  const auto queue = RunQueue::Create();
+  std::vector<int> resumed;
+  AppendAfterPost(*queue, resumed, 1);
+  queue->Stop();
+  AppendAfterPost(*queue, resumed, 2);
+  CHECK(resumed.empty());
+
+  // Returns immediately, as it's stopped
+  queue->Run();
+  CHECK(resumed == std::vector<int> {1});
+  CHECK(queue->GetStatistics().mPosted == 1);
+}
+
+TEST_CASE("ThreadScope nests") {
+  CHECK(!RunQueue::GetForCurrentThread());
+  const auto outer = RunQueue::Create();
+  const auto inner = RunQueue::Create();
+  {
+    const RunQueue::ThreadScope outerScope(outer);
+    CHECK(RunQueue::GetForCurrentThread() == outer);
+    {
+      const RunQueue::ThreadScope innerScope(inner);
+      CHECK(RunQueue::GetForCurrentThread() == inner);
+    }
+    CHECK(RunQueue::GetForCurrentThread() == outer);
+  }
+  CHECK(!RunQueue::GetForCurrentThread());
+}
+
+TEST_CASE("Run resumes posts from other threads on its own thread") {
+  constexpr std::size_t Producers = 4;
+  constexpr std::size_t PerProducer = 250;
+
+  const auto queue = RunQueue::Create();
+  std::thread::id runThread;
+  std::jthread runner([&] {
+    runThread = std::this_thread::get_id();
+    queue->Run();
+  });
+
+  std::vector<Resumption> resumptions(Producers * PerProducer);
+  std::latch done(resumptions.size());
+  {
+    std::vector<std::jthread> producers;
+    for (std::size_t i = 0; i < Producers; ++i) {
+      producers.emplace_back([&, i] {
+        for (std::size_t j = 0; j < PerProducer; ++j) {
+          RecordAfterPost(*queue, resumptions[(i * PerProducer) + j], done);
+        }
+      });
+    }
+  }
+  done.wait();
+  queue->Stop();
+  runner.join();
+
+  for (const auto& it: resumptions) {
+    CHECK(it.mThread == runThread);
+    CHECK(it.mQueue == queue);
+  }
+  const auto stats = queue->GetStatistics();
+  CHECK(stats.mPosted == resumptions.size());
+  CHECK(stats.mResumed == resumptions.size());
+}
+
+TEST_CASE("Run sleeps until there's work") {
+  const auto queue = RunQueue::Create();
+  std::jthread runner([&] { queue->Run(); });
+  while (queue->GetStatistics().mWaits == 0) {
+    std::this_thread::sleep_for(1ms);
+  }
+
+  std::vector<int> resumed;
+  AppendAfterPost(*queue, resumed, 1);
+  queue->Stop();
+  runner.join();
+  CHECK(resumed == std::vector<int> {1});
+}
+
+TEST_CASE("ThreadPool continuations stay on the same pool thread") {
+  constexpr std::size_t Coroutines = 64;
+
+  std::vector<Resumption> first(Coroutines);
+  std::vector<Resumption> second(Coroutines);
+  {
+    ThreadPool pool(4);
+    CHECK(pool.GetThreadCount() == 4);
+
+    std::latch done(Coroutines);
+    for (std::size_t i = 0; i < Coroutines; ++i) {
+      RecordOnPool(pool, first[i], second[i], done);
+    }
+    done.wait();
+  }
+
+  const auto self = std::this_thread::get_id();
+  for (std::size_t i = 0; i < Coroutines; ++i) {
+    CHECK(first[i].mThread != self);
+    CHECK(first[i].mQueue != nullptr);
+    CHECK(second[i].mThread == first[i].mThread);
+    CHECK(second[i].mQueue == first[i].mQueue);
+  }
+}
+
+TEST_CASE("ThreadPool has at least one thread") {
+  ThreadPool pool(0);
+  CHECK(pool.GetThreadCount() == 1);
+
+  Resumption first;
+  Resumption second;
+  std::latch done(1);
+  RecordOnPool(pool, first, second, done);
+  done.wait();
+  CHECK(first.mThread != std::this_thread::get_id());
+}
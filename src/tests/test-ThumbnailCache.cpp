@@ -0,0 +1,203 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/ThumbnailCache.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Key = ThumbnailCache::Key;
+using Size = ThumbnailCache::Size;
+using Thumbnail = ThumbnailCache::Thumbnail;
+
+constexpr Size ThumbnailSize {16, 8};
+
+Key MakeKey(PageIndex page, Size size = ThumbnailSize) {
+  constexpr std::string_view content {"document"};
+  return {
+    .mContentHash
+    = HashContent(std::as_bytes(std::span {content.data(), content.size()})),
+    .mPage = page,
+    .mSize = size,
+  };
+}
+
+Thumbnail MakeThumbnail(uint8_t fill, Size size = ThumbnailSize) {
+  return {
+    .mSize = size,
+    .mPixels = std::vector<std::byte>(
+      std::size_t {size.mWidth} * size.mHeight * 4, std::byte {fill}),
+  };
+}
+
+std::filesystem::path MakeTemporaryDirectoryName() {
+  std::random_device random;
+  return std::filesystem::temp_directory_path()
+    / ("OpenKneeboard-test-ThumbnailCache-" + std::to_string(random()));
+}
+
+struct Fixture {
+  Fixture(uint64_t maxBytes = ThumbnailCache::DefaultMaxBytes)
+    : mCache(mRoot, maxBytes) {
+  }
+
+  ~Fixture() {
+    std::error_code ec;
+    std::filesystem::remove_all(mRoot, ec);
+  }
+
+  std::vector<std::filesystem::path> GetFiles() const {
+    std::vector<std::filesystem::path> ret;
+    // The cache only creates its directory when it first stores something
+    std::error_code ec;
+    for (auto&& it: std::filesystem::directory_iterator(mRoot, ec)) {
+      ret.push_back(it.path());
+    }
+    return ret;
+  }
+
+  /// Entry names end with `-{page}-{width}x{height}.bin`
+  std::filesystem::path GetPath(PageIndex page) const {
+    const auto suffix = "-" + std::to_string(page) + "-"
+      + std::to_string(ThumbnailSize.mWidth) + "x"
+      + std::to_string(ThumbnailSize.mHeight) + ".bin";
+    for (auto&& path: this->GetFiles()) {
+      if (path.filename().string().ends_with(suffix)) {
+        return path;
+      }
+    }
+    return {};
+  }
+
+  const std::filesystem::path mRoot {MakeTemporaryDirectoryName()};
+  ThumbnailCache mCache;
+};
+
+}// namespace
+
+TEST_CASE("round trip") {
+  Fixture f;
+  const auto key = MakeKey(0);
+  CHECK(!f.mCache.Load(key));
+
+  f.mCache.Store(key, MakeThumbnail(0x42));
+  CHECK(f.mCache.Load(key) == MakeThumbnail(0x42));
+
+  const auto stats = f.mCache.GetStatistics();
+  CHECK(stats.mHits == 1);
+  CHECK(stats.mMisses == 1);
+  CHECK(stats.mStores == 1);
+}
+
+TEST_CASE("every part of the key matters") {
+  Fixture f;
+  const auto key = MakeKey(1);
+  f.mCache.Store(key, MakeThumbnail(1));
+
+  CHECK(!f.mCache.Load(MakeKey(2)));
+  CHECK(!f.mCache.Load(MakeKey(1, {16, 16})));
+
+  auto otherDigest = key;
+  ++otherDigest.mContentHash.mSHA256.front();
+  CHECK(!f.mCache.Load(otherDigest));
+
+  auto otherLength = key;
+  ++otherLength.mContentHash.mByteLength;
+  CHECK(!f.mCache.Load(otherLength));
+
+  CHECK(f.mCache.Load(key) == MakeThumbnail(1));
+}
+
+TEST_CASE("thumbnails that don't match their key aren't stored") {
+  Fixture f;
+  f.mCache.Store(MakeKey(0), MakeThumbnail(0, {8, 8}));
+
+  auto truncated = MakeThumbnail(0);
+  truncated.mPixels.pop_back();
+  f.mCache.Store(MakeKey(0), truncated);
+
+  CHECK(f.GetFiles().empty());
+  CHECK(f.mCache.GetStatistics().mStores == 0);
+}
+
+TEST_CASE("corrupt entries are misses, and are removed") {
+  Fixture f;
+  const auto key = MakeKey(0);
+  f.mCache.Store(key, MakeThumbnail(0xff));
+  const auto path = f.GetPath(0);
+  REQUIRE(!path.empty());
+
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(-1, std::ios::end);
+    file.put('\0');
+  }
+  CHECK(!f.mCache.Load(key));
+  CHECK(f.GetFiles().empty());
+}
+
+TEST_CASE("pruning keeps the most recently used entries") {
+  // Every entry is the same size
+  uint64_t entryBytes {};
+  {
+    Fixture f;
+    f.mCache.Store(MakeKey(0), MakeThumbnail(0));
+    entryBytes = std::filesystem::file_size(f.GetPath(0));
+  }
+
+  // Room for all but two entries
+  constexpr auto Pages = ThumbnailCache::StoresPerPrune + 1;
+  Fixture f((Pages - 2) * entryBytes);
+
+  // The first store prunes, then every `StoresPerPrune` after that; this
+  // stops just short of the second prune.
+  for (PageIndex page = 0; page < Pages - 1; ++page) {
+    f.mCache.Store(MakeKey(page), MakeThumbnail(page));
+  }
+  REQUIRE(f.GetFiles().size() == Pages - 1);
+  CHECK(f.mCache.GetStatistics().mPrunes == 1);
+
+  // Make page 0 the least-recently used, then page 1, ...
+  const auto then
+    = std::filesystem::file_time_type::clock::now() - std::chrono::hours(1);
+  for (PageIndex page = 0; page < Pages - 1; ++page) {
+    std::filesystem::last_write_time(
+      f.GetPath(page), then + std::chrono::minutes(page));
+  }
+  // ... but loading counts as using
+  REQUIRE(f.mCache.Load(MakeKey(0)).has_value());
+
+  f.mCache.Store(MakeKey(Pages - 1), MakeThumbnail(Pages - 1));
+  CHECK(f.mCache.GetStatistics().mPrunes == 2);
+  CHECK(f.GetFiles().size() == Pages - 2);
+
+  CHECK(f.GetPath(1).empty());
+  CHECK(f.GetPath(2).empty());
+  for (PageIndex page: {PageIndex {0}, PageIndex {3}, PageIndex {Pages - 1}}) {
+    CHECK(f.mCache.Load(MakeKey(page)) == MakeThumbnail(page));
+  }
+}
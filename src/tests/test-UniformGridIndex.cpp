@@ -0,0 +1,147 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/UniformGridIndex.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Rect = UniformGridIndex::Rect;
+
+std::optional<std::size_t>
+LinearHitTest(const std::vector<Rect>& rects, float x, float y) {
+  for (std::size_t i = 0; i < rects.size(); ++i) {
+    const auto& r = rects[i];
+    if (x >= r.mLeft && x <= r.mRight && y >= r.mTop && y <= r.mBottom) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+std::vector<Rect> MakeRandomRects(std::size_t count, unsigned seed) {
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<float> position(0, 1000);
+  std::uniform_real_distribution<float> extent(0, 150);
+  std::vector<Rect> ret;
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto left = position(random);
+    const auto top = position(random);
+    ret.push_back({left, top, left + extent(random), top + extent(random)});
+  }
+  return ret;
+}
+
+/// Random points, plus every corner and edge midpoint of every rectangle
+std::vector<std::pair<float, float>> MakeProbes(
+  const std::vector<Rect>& rects,
+  unsigned seed) {
+  std::mt19937 random(seed);
+  // Deliberately wider than the rectangles' bounding box
+  std::uniform_real_distribution<float> position(-100, 1300);
+  std::vector<std::pair<float, float>> ret;
+  for (std::size_t i = 0; i < 5000; ++i) {
+    ret.push_back({position(random), position(random)});
+  }
+  for (const auto& r: rects) {
+    const auto midX = (r.mLeft + r.mRight) / 2;
+    const auto midY = (r.mTop + r.mBottom) / 2;
+    for (const auto x: {r.mLeft, midX, r.mRight}) {
+      for (const auto y: {r.mTop, midY, r.mBottom}) {
+        ret.push_back({x, y});
+      }
+    }
+  }
+  return ret;
+}
+
+bool MatchesLinearScan(const std::vector<Rect>& rects, unsigned seed) {
+  const UniformGridIndex index {rects};
+  for (const auto& [x, y]: MakeProbes(rects, seed)) {
+    if (index.HitTest(x, y) != LinearHitTest(rects, x, y)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}// namespace
+
+TEST_CASE("small sets are scanned linearly") {
+  const auto rects = MakeRandomRects(UniformGridIndex::MinGridSize - 1, 1);
+  const UniformGridIndex index {rects};
+  CHECK(index.GetCellCount() == 0);
+  CHECK(MatchesLinearScan(rects, 1));
+}
+
+TEST_CASE("random overlapping rectangles match a linear scan") {
+  for (const auto count: {16, 17, 100, 1000, 5000}) {
+    const auto seed = static_cast<unsigned>(count);
+    const auto rects = MakeRandomRects(count, seed);
+    const UniformGridIndex index {rects};
+    CHECK(index.GetCellCount() > 1);
+    CHECK(index.GetCellCount() <= UniformGridIndex::MaxCellsPerAxis
+            * UniformGridIndex::MaxCellsPerAxis);
+    CHECK(MatchesLinearScan(rects, seed));
+  }
+}
+
+TEST_CASE("the first rectangle wins when they overlap") {
+  std::vector<Rect> rects(UniformGridIndex::MinGridSize, Rect {0, 0, 10, 10});
+  const UniformGridIndex index {rects};
+  CHECK(index.HitTest(5, 5) == 0);
+  CHECK(index.HitTest(10, 10) == 0);
+  CHECK(!index.HitTest(10.5f, 5));
+}
+
+TEST_CASE("zero-width and zero-height bounds match a linear scan") {
+  std::vector<Rect> row;
+  std::vector<Rect> column;
+  for (std::size_t i = 0; i < 32; ++i) {
+    const auto offset = static_cast<float>(i * 10);
+    row.push_back({offset, 5, offset + 8, 5});
+    column.push_back({5, offset, 5, offset + 8});
+  }
+  CHECK(MatchesLinearScan(row, 2));
+  CHECK(MatchesLinearScan(column, 3));
+  CHECK(UniformGridIndex {row}.HitTest(4, 5) == 0);
+  CHECK(!UniformGridIndex {row}.HitTest(4, 5.5f));
+}
+
+TEST_CASE("invalid rectangles never match") {
+  constexpr auto NaN = std::numeric_limits<float>::quiet_NaN();
+  auto rects = MakeRandomRects(64, 4);
+  rects.at(3) = {NaN, 0, 1000, 1000};
+  rects.at(7) = {1000, 1000, 0, 0};
+  const UniformGridIndex index {rects};
+
+  for (const auto& [x, y]: MakeProbes(rects, 4)) {
+    const auto hit = index.HitTest(x, y);
+    CHECK(!(hit == 3 || hit == 7));
+    CHECK(hit == LinearHitTest(rects, x, y));
+  }
+  CHECK(!index.HitTest(NaN, 500));
+  CHECK(!index.HitTest(500, NaN));
+}
@@ -0,0 +1,282 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CoroutineRegistry.hpp>
+#include <OpenKneeboard/TaskExecutor.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <OpenKneeboard/task.hpp>
+#include <OpenKneeboard/task/with_stop_token.hpp>
+
+#include <chrono>
+#include <coroutine>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+using namespace OpenKneeboard;
+using namespace OpenKneeboard::CoroutineRegistry;
+using namespace std::chrono_literals;
+
+namespace {
+
+/// How many live coroutines are in each state
+struct Counts {
+  std::size_t mRunning {};
+  std::size_t mSuspended {};
+  std::size_t mCompleted {};
+
+  bool operator==(const Counts&) const noexcept = default;
+};
+
+Counts GetCounts() {
+  Counts ret;
+  for (auto&& it: GetLiveCoroutines()) {
+    switch (it.mState) {
+      case CoroutineState::Running:
+        ++ret.mRunning;
+        break;
+      case CoroutineState::Suspended:
+        ++ret.mSuspended;
+        break;
+      case CoroutineState::Completed:
+        ++ret.mCompleted;
+        break;
+    }
+  }
+  return ret;
+}
+
+/// Background threads may still be finishing their coroutines
+bool WaitForCounts(const Counts& expected) {
+  const auto timeout = std::chrono::steady_clock::now() + 5s;
+  while (GetCounts() != expected) {
+    if (std::chrono::steady_clock::now() > timeout) {
+      return false;
+    }
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+
+/// Run a test coroutine on a `RunQueue`, as `task<>` needs one or COM
+template <class F>
+void RunOnQueue(F f) {
+  const auto queue = RunQueue::Create();
+  const RunQueue::ThreadScope scope(queue);
+
+  bool done = false;
+  [](F f, bool& done) -> fire_and_forget {
+    co_await f();
+    done = true;
+  }(std::move(f), done);
+
+  const auto timeout = std::chrono::steady_clock::now() + 5s;
+  while (!done && std::chrono::steady_clock::now() < timeout) {
+    if (!queue->RunPending()) {
+      std::this_thread::sleep_for(1ms);
+    }
+  }
+  CHECK(done);
+}
+
+/// Resumes on the current thread's `RunQueue`, letting everything else
+/// that's queued run first
+struct Yield {
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(std::coroutine_handle<> coro) const {
+    (void)RunQueue::GetForCurrentThread()->TryPost(coro);
+  }
+  void await_resume() const noexcept {
+  }
+};
+
+struct Event {
+  std::coroutine_handle<> mWaiting;
+  bool mIsSet {false};
+
+  struct Awaiter {
+    Event* mEvent {nullptr};
+
+    bool await_ready() const noexcept {
+      return mEvent->mIsSet;
+    }
+    void await_suspend(std::coroutine_handle<> coro) const noexcept {
+      mEvent->mWaiting = coro;
+    }
+    void await_resume() const noexcept {
+    }
+  };
+
+  Awaiter operator co_await() noexcept {
+    return {this};
+  }
+
+  void Set() {
+    mIsSet = true;
+    if (const auto waiting = std::exchange(mWaiting, {})) {
+      waiting.resume();
+    }
+  }
+};
+
+/// Doesn't suspend after all; records the registry state when it's asked to
+struct SuspendRefused {
+  Counts* mDuringSuspend {nullptr};
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  bool await_suspend(std::coroutine_handle<>) const {
+    *mDuringSuspend = GetCounts();
+    return false;
+  }
+  void await_resume() const noexcept {
+  }
+};
+
+struct SuspendThrows {
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(std::coroutine_handle<>) const {
+    throw std::runtime_error {"await_suspend"};
+  }
+  void await_resume() const noexcept {
+  }
+};
+
+task<int> Immediate(int value) {
+  co_return value;
+}
+
+task<int> WaitFor(Event& event, int value) {
+  co_await event;
+  co_return value;
+}
+
+}// namespace
+
+TEST_CASE("tasks that complete without suspending are unregistered") {
+  const auto before = GetCounts();
+  RunOnQueue([]() -> task<void> {
+    const auto inside = GetCounts();
+
+    auto child = Immediate(1);
+    // Completed, but still alive until it's awaited
+    auto expected = inside;
+    ++expected.mCompleted;
+    CHECK(GetCounts() == expected);
+
+    const auto first = co_await std::move(child);
+    CHECK(first == 1);
+    CHECK(GetCounts() == inside);
+
+    const auto second = co_await Immediate(2);
+    CHECK(second == 2);
+    CHECK(GetCounts() == inside);
+  });
+  CHECK(WaitForCounts(before));
+}
+
+TEST_CASE("awaiters that don't suspend leave the coroutine running") {
+  const auto before = GetCounts();
+  RunOnQueue([]() -> task<void> {
+    const auto inside = GetCounts();
+
+    // Marked as suspended while the awaiter decides...
+    Counts duringSuspend;
+    co_await SuspendRefused {&duringSuspend};
+    CHECK(duringSuspend.mSuspended == inside.mSuspended + 1);
+    CHECK(duringSuspend.mRunning == inside.mRunning - 1);
+    // ... but running again afterwards
+    CHECK(GetCounts() == inside);
+
+    co_await std::suspend_never {};
+    CHECK(GetCounts() == inside);
+  });
+  CHECK(WaitForCounts(before));
+}
+
+TEST_CASE("exceptions from await_suspend leave the coroutine running") {
+  const auto before = GetCounts();
+  RunOnQueue([]() -> task<void> {
+    const auto inside = GetCounts();
+    bool threw = false;
+    try {
+      co_await SuspendThrows {};
+    } catch (const std::runtime_error&) {
+      threw = true;
+    }
+    CHECK(threw);
+    CHECK(GetCounts() == inside);
+  });
+  CHECK(WaitForCounts(before));
+}
+
+TEST_CASE("suspended tasks record where they're waiting") {
+  const auto before = GetCounts();
+  RunOnQueue([]() -> task<void> {
+    const auto inside = GetCounts();
+
+    Event event;
+    auto child = WaitFor(event, 1);
+    auto expected = inside;
+    ++expected.mSuspended;
+    CHECK(GetCounts() == expected);
+    std::size_t waiting {};
+    for (auto&& it: GetLiveCoroutines()) {
+      if (it.mState == CoroutineState::Suspended && it.mAwaitPoint) {
+        ++waiting;
+      }
+    }
+    CHECK(waiting == expected.mSuspended);
+
+    event.Set();
+    const auto result = co_await std::move(child);
+    CHECK(result == 1);
+    CHECK(GetCounts() == inside);
+  });
+  CHECK(WaitForCounts(before));
+}
+
+TEST_CASE("cancelled tasks stay registered until they complete") {
+  const auto before = GetCounts();
+  RunOnQueue([]() -> task<void> {
+    const auto inside = GetCounts();
+
+    Event event;
+    std::stop_source stop;
+    auto cancellable = with_stop_token(stop.get_token(), WaitFor(event, 1));
+    stop.request_stop();
+    const auto result = co_await std::move(cancellable);
+    CHECK(result == std::unexpected {CancellableError::Cancelled});
+
+    // `with_stop_token()` has returned, but the task it was waiting for is
+    // still waiting for the event - as is its watcher
+    CHECK(GetCounts().mSuspended >= inside.mSuspended + 2);
+
+    event.Set();
+    co_await Yield {};
+  });
+  CHECK(WaitForCounts(before));
+}
@@ -0,0 +1,278 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/TaskExecutor.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <OpenKneeboard/task/when_all.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+/** Virtual time, so tests control exactly which task completes first.
+ *
+ * `co_await Sleep {n}` resumes the coroutine once `n` ticks have passed.
+ */
+uint64_t gNow {};
+std::multimap<uint64_t, std::coroutine_handle<>> gTimers;
+
+struct Sleep {
+  uint64_t mTicks {};
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(std::coroutine_handle<> coro) const {
+    gTimers.emplace(gNow + mTicks, coro);
+  }
+  void await_resume() const noexcept {
+  }
+};
+
+/** Run a test coroutine on a `RunQueue` until nothing's left to do.
+ *
+ * `task<>` resumes awaiters via the creating thread's queue; timers fire in
+ * order once everything that's ready has run.
+ */
+template <class F>
+void RunUntilIdle(F f) {
+  gNow = 0;
+  const auto queue = RunQueue::Create();
+  const RunQueue::ThreadScope scope(queue);
+
+  bool done = false;
+  [](F f, bool& done) -> fire_and_forget {
+    co_await f();
+    done = true;
+  }(std::move(f), done);
+
+  while (true) {
+    while (queue->RunPending()) {
+    }
+    if (gTimers.empty()) {
+      break;
+    }
+    const auto it = gTimers.begin();
+    gNow = it->first;
+    const auto coro = it->second;
+    gTimers.erase(it);
+    coro.resume();
+  }
+  CHECK(done);
+}
+
+struct TestError : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+task<int> Delayed(int& completed, uint64_t ticks, int value) {
+  co_await Sleep {ticks};
+  ++completed;
+  co_return value;
+}
+
+task<int> DelayedThrow(int& completed, uint64_t ticks, int value) {
+  co_await Sleep {ticks};
+  ++completed;
+  throw TestError {std::to_string(value)};
+}
+
+/// Calls to a `parallel_for_each()` callback
+struct Calls {
+  std::vector<int> mStarted;
+  std::size_t mInFlight {};
+  std::size_t mMaxInFlight {};
+  std::size_t mCompleted {};
+
+  task<void> Call(int input, uint64_t ticks) {
+    mStarted.push_back(input);
+    mMaxInFlight = std::max(mMaxInFlight, ++mInFlight);
+    co_await Sleep {ticks};
+    --mInFlight;
+    ++mCompleted;
+  }
+};
+
+std::vector<int> Inputs(int count) {
+  std::vector<int> ret;
+  for (int i = 0; i < count; ++i) {
+    ret.push_back(i);
+  }
+  return ret;
+}
+
+}// namespace
+
+TEST_CASE("when_any returns the first task to complete") {
+  int completed {};
+  RunUntilIdle([&]() -> task<void> {
+    std::vector<task<int>> tasks;
+    tasks.push_back(Delayed(completed, 30, 0));
+    tasks.push_back(Delayed(completed, 10, 1));
+    tasks.push_back(Delayed(completed, 20, 2));
+    const auto first = co_await when_any(std::move(tasks));
+    CHECK(first.mIndex == 1);
+    CHECK(first.mValue == 1);
+    CHECK(gNow == 10);
+    CHECK(completed == 1);
+  });
+  // The others still run to completion
+  CHECK(completed == 3);
+  CHECK(gNow == 30);
+}
+
+TEST_CASE("when_any with already-completed tasks picks the first") {
+  int completed {};
+  RunUntilIdle([&]() -> task<void> {
+    std::vector<task<int>> tasks;
+    tasks.push_back(Delayed(completed, 0, 0));
+    tasks.push_back(Delayed(completed, 0, 1));
+    // Let both complete before `when_any()` sees them
+    co_await Sleep {1};
+    const auto first = co_await when_any(std::move(tasks));
+    CHECK(first.mIndex == 0);
+    CHECK(first.mValue == 0);
+  });
+  CHECK(completed == 2);
+}
+
+TEST_CASE("when_any rethrows the first task's exception") {
+  int completed {};
+  RunUntilIdle([&]() -> task<void> {
+    std::vector<task<int>> tasks;
+    tasks.push_back(Delayed(completed, 20, 0));
+    tasks.push_back(DelayedThrow(completed, 10, 1));
+    tasks.push_back(DelayedThrow(completed, 30, 2));
+    std::string what;
+    try {
+      co_await when_any(std::move(tasks));
+    } catch (const TestError& e) {
+      what = e.what();
+    }
+    CHECK(what == "1");
+  });
+  // Later exceptions are discarded
+  CHECK(completed == 3);
+}
+
+TEST_CASE("when_any supports task<void>") {
+  Calls calls;
+  RunUntilIdle([&]() -> task<void> {
+    std::vector<task<void>> tasks;
+    tasks.push_back(calls.Call(0, 20));
+    tasks.push_back(calls.Call(1, 5));
+    const auto first = co_await when_any(std::move(tasks));
+    CHECK(first.mIndex == 1);
+  });
+  CHECK(calls.mCompleted == 2);
+}
+
+TEST_CASE("parallel_for_each respects the concurrency bound") {
+  for (const std::size_t bound: {1, 3, 10, 100}) {
+    Calls calls;
+    RunUntilIdle([&]() -> task<void> {
+      co_await parallel_for_each(bound, Inputs(10), [&](int i) {
+        return calls.Call(i, 1 + ((i * 7) % 5));
+      });
+      CHECK(calls.mInFlight == 0);
+    });
+    CHECK(calls.mCompleted == 10);
+    CHECK(calls.mMaxInFlight == std::min<std::size_t>(bound, 10));
+    // Calls start in input order
+    CHECK(calls.mStarted == Inputs(10));
+  }
+}
+
+TEST_CASE("parallel_for_each starts nothing once stopped") {
+  Calls calls;
+  std::stop_source stop;
+  RunUntilIdle([&]() -> task<void> {
+    co_await parallel_for_each(
+      2,
+      Inputs(10),
+      [&](int i) {
+        if (i == 4) {
+          stop.request_stop();
+        }
+        return calls.Call(i, 10);
+      },
+      stop.get_token());
+    // Returns normally, after the calls in flight have completed
+    CHECK(calls.mInFlight == 0);
+  });
+  CHECK(calls.mStarted == Inputs(5));
+  CHECK(calls.mCompleted == 5);
+}
+
+TEST_CASE("parallel_for_each with a stopped token calls nothing") {
+  Calls calls;
+  std::stop_source stop;
+  stop.request_stop();
+  RunUntilIdle([&]() -> task<void> {
+    co_await parallel_for_each(
+      4,
+      Inputs(10),
+      [&](int i) { return calls.Call(i, 1); },
+      stop.get_token());
+  });
+  CHECK(calls.mStarted.empty());
+}
+
+TEST_CASE("parallel_for_each rethrows after in-flight calls complete") {
+  Calls calls;
+  RunUntilIdle([&]() -> task<void> {
+    bool threw = false;
+    try {
+      co_await parallel_for_each(3, Inputs(10), [&](int i) -> task<void> {
+        co_await calls.Call(i, (i == 1) ? 1 : 10);
+        if (i == 1) {
+          throw TestError {"1"};
+        }
+      });
+    } catch (const TestError&) {
+      threw = true;
+    }
+    CHECK(threw);
+    CHECK(calls.mInFlight == 0);
+  });
+  // 0-2 start together; 1 throws first, so nothing else starts
+  CHECK(calls.mStarted == Inputs(3));
+  CHECK(calls.mCompleted == 3);
+}
+
+TEST_CASE("bounded when_all keeps results in input order") {
+  int completed {};
+  RunUntilIdle([&]() -> task<void> {
+    const auto results
+      = co_await when_all(2, Inputs(6), [&](int i) -> task<int> {
+          return Delayed(completed, 10 - i, i * 10);
+        });
+    CHECK(results == std::vector<int> {0, 10, 20, 30, 40, 50});
+  });
+  CHECK(completed == 6);
+}
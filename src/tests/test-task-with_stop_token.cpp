@@ -0,0 +1,317 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2025 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/TaskExecutor.hpp>
+#include <OpenKneeboard/Tests.hpp>
+
+#include <OpenKneeboard/task/resume_background.hpp>
+#include <OpenKneeboard/task/with_stop_token.hpp>
+
+#include <shims/winrt/base.h>
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+/** Run a test coroutine on a `RunQueue` until it completes.
+ *
+ * Unlike test-task-when_all, this waits for other threads: a stop resumes
+ * the stopped task from the thread pool.
+ */
+template <class F>
+void Run(F f) {
+  const auto queue = RunQueue::Create();
+  const RunQueue::ThreadScope scope(queue);
+
+  bool done = false;
+  [](F f, bool& done, RunQueue& queue) -> fire_and_forget {
+    co_await f();
+    done = true;
+    queue.Stop();
+  }(std::move(f), done, *queue);
+  queue->Run();
+  CHECK(done);
+}
+
+/// Suspends its awaiter until `Open()`, which resumes it on the same thread
+struct Gate {
+  std::coroutine_handle<> mWaiting;
+  bool mOpen {};
+
+  bool await_ready() const noexcept {
+    return mOpen;
+  }
+  void await_suspend(std::coroutine_handle<> coro) noexcept {
+    mWaiting = coro;
+  }
+  void await_resume() const noexcept {
+  }
+
+  void Open() {
+    mOpen = true;
+    if (const auto coro = std::exchange(mWaiting, {})) {
+      coro.resume();
+    }
+  }
+};
+
+/// Resumes the awaiter on `mQueue`'s thread
+struct ResumeOn {
+  RunQueue& mQueue;
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(std::coroutine_handle<> coro) const noexcept {
+    if (!mQueue.TryPost(coro)) {
+      std::terminate();
+    }
+  }
+  void await_resume() const noexcept {
+  }
+};
+
+struct TestError : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+constexpr auto Cancelled = std::unexpected {CancellableError::Cancelled};
+
+task<int> Gated(Gate& gate, int& completed, int value) {
+  co_await gate;
+  ++completed;
+  co_return value;
+}
+
+task<int> GatedThrow(Gate& gate, int& completed, int value) {
+  co_await gate;
+  ++completed;
+  throw TestError {std::to_string(value)};
+}
+
+/** Like loading a delegate: work on the thread pool, then finish on `queue`.
+ *
+ * Finishing on the queue's thread means that once `completed` is updated
+ * there, nothing else from this task is still pending.
+ */
+task<int> Background(RunQueue& queue, std::atomic<int>& completed, int value) {
+  co_await winrt::resume_background();
+  co_await ResumeOn {queue};
+  ++completed;
+  if (value % 4 == 0) {
+    throw TestError {std::to_string(value)};
+  }
+  co_return value;
+}
+
+}// namespace
+
+TEST_CASE("with_stop_token returns the result if not stopped") {
+  int completed {};
+  Gate gate;
+  Run([&]() -> task<void> {
+    std::stop_source source;
+    auto it = with_stop_token(source.get_token(), Gated(gate, completed, 42));
+    gate.Open();
+    const auto result = co_await std::move(it);
+    CHECK(result == 42);
+    CHECK(completed == 1);
+  });
+}
+
+TEST_CASE("with_stop_token with a stopped token doesn't wait") {
+  int completed {};
+  Gate gate;
+  Run([&]() -> task<void> {
+    std::stop_source source;
+    source.request_stop();
+    const auto result = co_await with_stop_token(
+      source.get_token(), Gated(gate, completed, 42));
+    CHECK(result == Cancelled);
+    CHECK(completed == 0);
+
+    // The wrapped task still runs to completion
+    gate.Open();
+    CHECK(completed == 1);
+  });
+}
+
+TEST_CASE("with_stop_token stops waiting when stopped") {
+  int completed {};
+  Gate gate;
+  Run([&]() -> task<void> {
+    std::stop_source source;
+    auto it = with_stop_token(source.get_token(), Gated(gate, completed, 42));
+    source.request_stop();
+    const auto result = co_await std::move(it);
+    CHECK(result == Cancelled);
+    CHECK(completed == 0);
+
+    gate.Open();
+    CHECK(completed == 1);
+  });
+}
+
+TEST_CASE("with_stop_token ignores stops after completion") {
+  int completed {};
+  Gate gate;
+  Run([&]() -> task<void> {
+    std::stop_source source;
+    auto it = with_stop_token(source.get_token(), Gated(gate, completed, 42));
+    gate.Open();
+    source.request_stop();
+    const auto result = co_await std::move(it);
+    CHECK(result == 42);
+    CHECK(completed == 1);
+  });
+}
+
+TEST_CASE("with_stop_token doesn't resume its caller from request_stop()") {
+  int completed {};
+  Gate gate;
+  Run([&]() -> task<void> {
+    std::stop_source source;
+    bool resumed = false;
+    auto caller = [](auto it, bool& resumed) -> task<CancellableResult<int>> {
+      const auto result = co_await std::move(it);
+      resumed = true;
+      co_return result;
+    }(with_stop_token(source.get_token(), Gated(gate, completed, 42)), resumed);
+
+    source.request_stop();
+    CHECK(!resumed);
+
+    const auto result = co_await std::move(caller);
+    CHECK(resumed);
+    CHECK(result == Cancelled);
+
+    gate.Open();
+    CHECK(completed == 1);
+  });
+}
+
+TEST_CASE("with_stop_token rethrows if not stopped") {
+  int completed {};
+  Gate gate;
+  Run([&]() -> task<void> {
+    std::stop_source source;
+    auto it
+      = with_stop_token(source.get_token(), GatedThrow(gate, completed, 42));
+    gate.Open();
+    bool threw = false;
+    try {
+      co_await std::move(it);
+    } catch (const TestError&) {
+      threw = true;
+    }
+    CHECK(threw);
+    CHECK(completed == 1);
+  });
+}
+
+TEST_CASE("with_stop_token discards exceptions once stopped") {
+  int completed {};
+  Gate gate;
+  Run([&]() -> task<void> {
+    std::stop_source source;
+    auto it
+      = with_stop_token(source.get_token(), GatedThrow(gate, completed, 42));
+    source.request_stop();
+    const auto result = co_await std::move(it);
+    CHECK(result == Cancelled);
+
+    gate.Open();
+    CHECK(completed == 1);
+  });
+}
+
+TEST_CASE("with_stop_token races between completion and stop") {
+  constexpr int Iterations = 1000;
+
+  std::atomic<int> completed {};
+  int values {};
+  int cancelled {};
+  int errors {};
+  int wrong {};
+  Run([&]() -> task<void> {
+    auto& queue = *RunQueue::GetForCurrentThread();
+    for (int i = 0; i < Iterations; ++i) {
+      std::stop_source source;
+      std::jthread stopper {[source]() mutable { source.request_stop(); }};
+      try {
+        const auto result = co_await with_stop_token(
+          source.get_token(), Background(queue, completed, i));
+        if (!result) {
+          ++cancelled;
+        } else if (*result == i) {
+          ++values;
+        } else {
+          ++wrong;
+        }
+      } catch (const TestError&) {
+        ++errors;
+      }
+    }
+
+    // Abandoned tasks keep running; wait for them so nothing outlives `queue`
+    while (completed < Iterations) {
+      co_await ResumeOn {queue};
+    }
+  });
+
+  CHECK(values + cancelled + errors == Iterations);
+  CHECK(wrong == 0);
+  CHECK(errors <= Iterations / 4);
+  CHECK(completed == Iterations);
+}
+
+TEST_CASE("resume_background(stop_token) stays on this thread if stopped") {
+  Run([&]() -> task<void> {
+    std::stop_source source;
+    source.request_stop();
+    const auto thread = std::this_thread::get_id();
+    const auto result = co_await resume_background(source.get_token());
+    CHECK(result == Cancelled);
+    CHECK(std::this_thread::get_id() == thread);
+  });
+}
+
+TEST_CASE("resume_background(stop_token) switches threads if not stopped") {
+  Run([&]() -> task<void> {
+    std::stop_source source;
+    bool resumed = false;
+    std::thread::id thread;
+    co_await [](auto token, bool& resumed, auto& thread) -> task<void> {
+      const auto result = co_await resume_background(token);
+      resumed = result.has_value();
+      thread = std::this_thread::get_id();
+    }(source.get_token(), resumed, thread);
+    CHECK(resumed);
+    CHECK(thread != std::this_thread::get_id());
+  });
+}
@@ -1,5 +1,6 @@
 set(
   SYSTEM_LIBRARIES
+  Bcrypt
   Comctl32
   D2d1
   D3d11